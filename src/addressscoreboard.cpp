@@ -0,0 +1,214 @@
+#include <QtCore/QMutexLocker>
+#include <algorithm>
+#include <math.h>
+#include "addressscoreboard.h"
+
+/**
+ * @class AddressScoreboard
+ *
+ * @brief The AddressScoreboard class keeps the connection outcomes per remote address and port
+ *
+ * Every failed attempt adds 1 to the penalty of the address; the penalty halves every halfLife() milliseconds
+ * and is reset by a successful connection. The round trip time of the handshake is smoothed over the successful connections.
+ *
+ * order() puts the addresses without a penalty first, fastest first, and then the penalized addresses,
+ * least penalized first; the addresses without a round trip time yet and the ties keep the resolver order.
+ * As the penalties decay, the failed addresses move back up and get probed again.
+ *
+ * The class is thread-safe.
+ *
+ * @see SocketConnector::setAddressScoreboard()
+ */
+
+Q_GLOBAL_STATIC(AddressScoreboard, globalScoreboard)
+
+/*
+ * An address is ordered as failed while its penalty is at least this; a single failure stays for one half-life
+ */
+static const qreal failed_threshold = 0.5;
+
+static QString entryKey(const QHostAddress& a, quint16 port)
+{
+	return a.toString() + QLatin1Char('/') + QString::number(port);
+}
+
+struct Rank {
+	int index;
+	bool failed;
+	qreal penalty;
+	qint64 rtt;
+
+	bool operator<(const Rank& other) const
+	{
+		if (this->failed != other.failed) {
+			return !this->failed;
+		}
+
+		if (this->failed) {
+			return this->penalty < other.penalty;
+		}
+
+		// The addresses with no round trip time keep their places after the measured ones
+		if ((this->rtt < 0) != (other.rtt < 0)) {
+			return this->rtt >= 0;
+		}
+
+		return this->rtt < other.rtt;
+	}
+};
+
+/**
+ * @brief Creates an empty scoreboard
+ */
+AddressScoreboard::AddressScoreboard(void)
+	: m_mutex(), m_clock(), m_entries(), m_half_life(30000)
+{
+	this->m_clock.start();
+}
+
+/**
+ * @brief Returns the process-wide scoreboard
+ * @return Shared scoreboard
+ */
+AddressScoreboard* AddressScoreboard::globalInstance(void)
+{
+	return globalScoreboard();
+}
+
+/**
+ * @brief Records a successful connection to @a a on @a port
+ * @param a Remote address
+ * @param port Remote port
+ * @param rtt Duration of the handshake, in microseconds
+ */
+void AddressScoreboard::reportSuccess(const QHostAddress& a, quint16 port, qint64 rtt)
+{
+	QMutexLocker locker(&this->m_mutex);
+
+	Entry& e = this->m_entries[entryKey(a, port)];
+	++e.health.successes;
+	e.health.penalty = 0;
+	e.health.rtt     = (e.health.rtt < 0) ? rtt : (e.health.rtt * 7 + rtt) / 8;
+	e.updated        = this->m_clock.elapsed();
+}
+
+/**
+ * @brief Records a failed connection attempt to @a a on @a port
+ * @param a Remote address
+ * @param port Remote port
+ * @param error @c errno value
+ */
+void AddressScoreboard::reportFailure(const QHostAddress& a, quint16 port, int error)
+{
+	QMutexLocker locker(&this->m_mutex);
+
+	qint64 now = this->m_clock.elapsed();
+	QHash<QString, Entry>::Iterator it = this->m_entries.find(entryKey(a, port));
+	if (it == this->m_entries.end()) {
+		Entry e;
+		e.updated = now;
+		it = this->m_entries.insert(entryKey(a, port), e);
+	}
+
+	++it->health.failures;
+	it->health.lastError = error;
+	it->health.penalty   = this->penalty(*it, now) + 1;
+	it->updated          = now;
+}
+
+/**
+ * @brief Orders @a addresses by their health on @a port
+ * @param addresses Addresses in the resolver order
+ * @param port Remote port
+ * @return The same addresses, best first
+ */
+QList<QHostAddress> AddressScoreboard::order(const QList<QHostAddress>& addresses, quint16 port)
+{
+	QMutexLocker locker(&this->m_mutex);
+
+	qint64 now = this->m_clock.elapsed();
+	QList<Rank> ranks;
+	for (int i=0; i<addresses.size(); ++i) {
+		Rank r;
+		r.index   = i;
+		r.failed  = false;
+		r.penalty = 0;
+		r.rtt     = -1;
+
+		QHash<QString, Entry>::ConstIterator it = this->m_entries.constFind(entryKey(addresses.at(i), port));
+		if (it != this->m_entries.constEnd()) {
+			r.penalty = this->penalty(*it, now);
+			r.failed  = r.penalty >= failed_threshold;
+			r.rtt     = it->health.rtt;
+		}
+
+		ranks.append(r);
+	}
+
+	std::stable_sort(ranks.begin(), ranks.end());
+
+	QList<QHostAddress> res;
+	for (int i=0; i<ranks.size(); ++i) {
+		res.append(addresses.at(ranks.at(i).index));
+	}
+
+	return res;
+}
+
+/**
+ * @brief Returns the health of @a a on @a port
+ * @param a Remote address
+ * @param port Remote port
+ * @return Health record; @c penalty is decayed to the current time
+ */
+AddressScoreboard::Health AddressScoreboard::health(const QHostAddress& a, quint16 port) const
+{
+	QMutexLocker locker(&this->m_mutex);
+
+	QHash<QString, Entry>::ConstIterator it = this->m_entries.constFind(entryKey(a, port));
+	if (it == this->m_entries.constEnd()) {
+		return Health();
+	}
+
+	Health h  = it->health;
+	h.penalty = this->penalty(*it, this->m_clock.elapsed());
+	return h;
+}
+
+/**
+ * @brief Forgets all recorded outcomes
+ */
+void AddressScoreboard::clear(void)
+{
+	QMutexLocker locker(&this->m_mutex);
+	this->m_entries.clear();
+}
+
+/**
+ * @brief Sets the time in which a penalty halves
+ * @param msecs Half-life (msec); the default is 30000
+ */
+void AddressScoreboard::setHalfLife(uint msecs)
+{
+	QMutexLocker locker(&this->m_mutex);
+	this->m_half_life = qMax(msecs, 1u);
+}
+
+/**
+ * @brief Returns the time in which a penalty halves
+ * @return Half-life (msec)
+ */
+uint AddressScoreboard::halfLife(void) const
+{
+	QMutexLocker locker(&this->m_mutex);
+	return this->m_half_life;
+}
+
+qreal AddressScoreboard::penalty(const Entry& e, qint64 now) const
+{
+	if (e.health.penalty <= 0) {
+		return 0;
+	}
+
+	return e.health.penalty * ::pow(0.5, qreal(now - e.updated) / qreal(this->m_half_life));
+}
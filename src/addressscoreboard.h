@@ -0,0 +1,52 @@
+#ifndef ADDRESSSCOREBOARD_H
+#define ADDRESSSCOREBOARD_H
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtNetwork/QHostAddress>
+
+class AddressScoreboard {
+public:
+	struct Health {
+		quint64 successes;
+		quint64 failures;
+		int lastError;
+		qint64 rtt;
+		qreal penalty;
+
+		Health(void) : successes(0), failures(0), lastError(0), rtt(-1), penalty(0) {}
+	};
+
+	AddressScoreboard(void);
+
+	static AddressScoreboard* globalInstance(void);
+
+	void reportSuccess(const QHostAddress& a, quint16 port, qint64 rtt);
+	void reportFailure(const QHostAddress& a, quint16 port, int error);
+	QList<QHostAddress> order(const QList<QHostAddress>& addresses, quint16 port);
+
+	Health health(const QHostAddress& a, quint16 port) const;
+	void clear(void);
+
+	void setHalfLife(uint msecs);
+	uint halfLife(void) const;
+
+private:
+	Q_DISABLE_COPY(AddressScoreboard)
+
+	struct Entry {
+		Health health;
+		qint64 updated;
+	};
+
+	mutable QMutex m_mutex;
+	QElapsedTimer m_clock;
+	QHash<QString, Entry> m_entries;
+	uint m_half_life;
+
+	qreal penalty(const Entry& e, qint64 now) const;
+};
+
+#endif // ADDRESSSCOREBOARD_H
@@ -0,0 +1,175 @@
+#include "batchconnector.h"
+#include "batchconnector_p.h"
+
+/**
+ * @class BatchConnector
+ *
+ * @brief The BatchConnector class establishes many TCP connections at once
+ *
+ * Unlike SocketConnector, which needs a QSocketNotifier and a QTimer per connection attempt, BatchConnector
+ * drives all pending non-blocking connects through one epoll instance: only the epoll descriptor is registered
+ * with the event loop, the completions are harvested in bulk, and one timer tracks the connection timeouts.
+ * On Linux 5.19 and newer the whole batch can be handed over to io_uring instead, see setBackend().
+ *
+ * The endpoints must be IP addresses: no host name lookups are performed.
+ *
+ * @note This class is available on Linux only.
+ */
+
+/**
+ * @enum BatchConnector::Backend
+ *
+ * The mechanism which drives the connection attempts
+ *
+ * @var BatchConnector::EpollBackend
+ * Non-blocking @c connect() calls which are watched with epoll (the default)
+ *
+ * @var BatchConnector::IoUringBackend
+ * The sockets are created and connected by io_uring requests: one @c io_uring_enter() call
+ * creates the sockets of the whole batch, the next one submits all the connects together with their timeouts.
+ * Requires Linux 5.19 or newer
+ *
+ * @var BatchConnector::AutoBackend
+ * io_uring if the kernel supports it, epoll otherwise
+ */
+
+/**
+ * @fn void BatchConnector::connected(int id, qintptr socket)
+ *
+ * This signal is emitted when the connection to the endpoint with the ID @a id has been established.
+ * The receiver takes the ownership of the non-blocking @a socket descriptor (for example, it can pass it
+ * to @c QAbstractSocket::setSocketDescriptor()). If the signal is not connected to anything, the descriptor is closed;
+ * the descriptors delivered to a receiver through a queued connection are lost if the receiver is destroyed first.
+ *
+ * @sa connectMany()
+ */
+
+/**
+ * @fn void BatchConnector::error(int id, QAbstractSocket::SocketError socketError)
+ *
+ * This signal is emitted when the connection to the endpoint with the ID @a id has failed.
+ * @c QAbstractSocket::SocketTimeoutError means that the connection was not established within connectionTimeout().
+ *
+ * @sa connectMany()
+ */
+
+/**
+ * @fn void BatchConnector::finished()
+ *
+ * This signal is emitted when there are no more pending connection attempts.
+ *
+ * @warning If you need to delete the sender() of any signal of this class in a slot connected to it,
+ * use the @c deleteLater() function.
+ */
+
+/**
+ * @brief Creates a new @c BatchConnector
+ * @param parent Object parent
+ */
+BatchConnector::BatchConnector(QObject* parent)
+	: QObject(parent), d_ptr(new BatchConnectorPrivate(this))
+{
+}
+
+/**
+ * @brief Destroys the @c BatchConnector and aborts all pending connection attempts
+ */
+BatchConnector::~BatchConnector(void)
+{
+#if QT_VERSION < 0x040600
+	delete this->d_ptr;
+	this->d_ptr = 0;
+#endif
+}
+
+/**
+ * @brief Starts connecting to all @a endpoints
+ * @param endpoints Endpoints; if the local address of an endpoint is not null, the socket is bound to it first
+ * @return ID of the first endpoint; the following endpoints get consecutive IDs
+ *
+ * The connections which succeed or fail immediately are reported from within this call.
+ * connectMany() can be called again while the previous batches are still pending.
+ */
+int BatchConnector::connectMany(const QList<Endpoint>& endpoints)
+{
+	Q_D(BatchConnector);
+	return d->connectMany(endpoints);
+}
+
+/**
+ * @brief Aborts all pending connection attempts
+ *
+ * No signals are emitted for the aborted attempts.
+ */
+void BatchConnector::abort(void)
+{
+	Q_D(BatchConnector);
+	d->abort();
+}
+
+/**
+ * @brief Returns the number of pending connection attempts
+ * @return Number of pending connection attempts
+ */
+int BatchConnector::pendingCount(void) const
+{
+	Q_D(const BatchConnector);
+	return d->m_tracker.pending();
+}
+
+/**
+ * @brief Sets the connection timeout for the subsequent connectMany() calls
+ * @param timeout Timeout value (msec)
+ */
+void BatchConnector::setConnectionTimeout(uint timeout)
+{
+	Q_D(BatchConnector);
+	d->m_timeout = timeout;
+}
+
+/**
+ * @brief Returns the current connection timeout
+ * @return Connection timeout
+ */
+uint BatchConnector::connectionTimeout(void) const
+{
+	Q_D(const BatchConnector);
+	return d->m_timeout;
+}
+
+/**
+ * @brief Selects the mechanism which drives the connection attempts
+ * @param backend Backend
+ * @return Whether the backend has been changed; @c false if there are pending connection attempts
+ * or if @a backend is @c IoUringBackend and io_uring is not available
+ *
+ * @c AutoBackend falls back to @c EpollBackend silently.
+ *
+ * @sa isIoUringAvailable()
+ */
+bool BatchConnector::setBackend(BatchConnector::Backend backend)
+{
+	Q_D(BatchConnector);
+	return d->setBackend(backend);
+}
+
+/**
+ * @brief Returns the backend in use
+ * @return @c EpollBackend or @c IoUringBackend
+ */
+BatchConnector::Backend BatchConnector::backend(void) const
+{
+	Q_D(const BatchConnector);
+	return d->m_ring ? BatchConnector::IoUringBackend : BatchConnector::EpollBackend;
+}
+
+/**
+ * @brief Checks whether the running kernel supports the io_uring operations needed by @c IoUringBackend
+ * @return Whether io_uring is available
+ */
+bool BatchConnector::isIoUringAvailable(void)
+{
+	return IoUring::isAvailable();
+}
+
+#include "moc_batchconnector.cpp"
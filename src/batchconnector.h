@@ -0,0 +1,67 @@
+#ifndef BATCHCONNECTOR_H
+#define BATCHCONNECTOR_H
+
+#include <QtCore/QObject>
+#include <QtCore/QList>
+#include <QtNetwork/QAbstractSocket>
+#include <QtNetwork/QHostAddress>
+
+#if QT_VERSION < 0x050000
+typedef qptrdiff qintptr;
+#endif
+
+class BatchConnectorPrivate;
+
+class BatchConnector : public QObject {
+	Q_OBJECT
+public:
+	struct Endpoint {
+		QHostAddress address;
+		quint16 port;
+		QHostAddress local;
+
+		Endpoint(const QHostAddress& a = QHostAddress(), quint16 p = 0, const QHostAddress& l = QHostAddress())
+			: address(a), port(p), local(l)
+		{
+		}
+	};
+
+	enum Backend {
+		EpollBackend,
+		IoUringBackend,
+		AutoBackend
+	};
+
+	BatchConnector(QObject* parent = 0);
+	virtual ~BatchConnector(void);
+
+	int connectMany(const QList<Endpoint>& endpoints);
+	void abort(void);
+	int pendingCount(void) const;
+
+	void setConnectionTimeout(uint timeout);
+	uint connectionTimeout(void) const;
+
+	bool setBackend(Backend backend);
+	Backend backend(void) const;
+	static bool isIoUringAvailable(void);
+
+Q_SIGNALS:
+	void connected(int id, qintptr socket);
+	void error(int id, QAbstractSocket::SocketError);
+	void finished(void);
+
+private:
+	Q_DISABLE_COPY(BatchConnector)
+	Q_DECLARE_PRIVATE(BatchConnector)
+#if QT_VERSION >= 0x040600
+	QScopedPointer<BatchConnectorPrivate> d_ptr;
+#else
+	BatchConnectorPrivate* d_ptr;
+#endif
+
+	Q_PRIVATE_SLOT(d_func(), void _q_harvest())
+	Q_PRIVATE_SLOT(d_func(), void _q_expire())
+};
+
+#endif // BATCHCONNECTOR_H
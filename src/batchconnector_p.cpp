@@ -0,0 +1,568 @@
+#include <QtCore/QSocketNotifier>
+#include <QtCore/QTimer>
+#include <climits>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <net/if.h>
+#include <errno.h>
+#include <string.h>
+#include "batchconnector.h"
+#include "batchconnector_p.h"
+
+static socklen_t makeAddress(const QHostAddress& a, quint16 port, struct sockaddr_storage* ss)
+{
+	memset(ss, 0, sizeof(*ss));
+
+	switch (a.protocol()) {
+		case QAbstractSocket::IPv4Protocol: {
+			struct sockaddr_in* sa = reinterpret_cast<struct sockaddr_in*>(ss);
+			sa->sin_family      = AF_INET;
+			sa->sin_port        = htons(port);
+			sa->sin_addr.s_addr = htonl(a.toIPv4Address());
+			return sizeof(struct sockaddr_in);
+		}
+
+		case QAbstractSocket::IPv6Protocol: {
+			struct sockaddr_in6* sa = reinterpret_cast<struct sockaddr_in6*>(ss);
+			sa->sin6_family = AF_INET6;
+			sa->sin6_port   = htons(port);
+#ifndef QT_NO_IPV6IFNAME
+			sa->sin6_scope_id = ::if_nametoindex(a.scopeId().toLatin1().data());
+#else
+			sa->sin6_scope_id = a.scopeId().toInt();
+#endif
+			Q_IPV6ADDR tmp = a.toIPv6Address();
+			memcpy(&sa->sin6_addr.s6_addr, &tmp, sizeof(tmp));
+			return sizeof(struct sockaddr_in6);
+		}
+
+		default:
+			return 0;
+	}
+}
+
+enum RingOp {
+	RingSocket  = 0,
+	RingConnect = 1,
+	RingOther   = 2
+};
+
+static const quint32 ring_id_mask = 0x3FFFFFFF;
+
+/*
+ * The user data of a submission: the operation, the ID of the attempt (or the index in the batch) and the descriptor
+ * (or, for a socket creation, the generation of the batch). The ID tells a stale completion from the one of a new attempt
+ * which has got the same descriptor number
+ */
+static quint64 ringTag(RingOp op, int id, int fd)
+{
+	return (quint64(op) << 62) | (quint64(quint32(id) & ring_id_mask) << 32) | quint32(fd);
+}
+
+static RingOp ringOp(quint64 tag)
+{
+	return RingOp(tag >> 62);
+}
+
+static int ringId(quint64 tag)
+{
+	return int((tag >> 32) & ring_id_mask);
+}
+
+static int ringFd(quint64 tag)
+{
+	return int(quint32(tag));
+}
+
+BatchConnectorPrivate::BatchConnectorPrivate(BatchConnector* const q)
+	: q_ptr(q), m_epoll(::epoll_create1(EPOLL_CLOEXEC)), m_notifier(0), m_timer(new QTimer(q)),
+	  m_tracker(m_epoll), m_next_id(0), m_timeout(30000),
+	  m_ring(0), m_ring_event(-1), m_ring_notifier(0), m_ring_timeout(), m_ring_batch(0)
+{
+	this->m_timer->setSingleShot(true);
+	QObject::connect(this->m_timer, SIGNAL(timeout()), q, SLOT(_q_expire()));
+
+	if (-1 != this->m_epoll) {
+		this->m_notifier = new QSocketNotifier(this->m_epoll, QSocketNotifier::Read, q);
+		QObject::connect(this->m_notifier, SIGNAL(activated(int)), q, SLOT(_q_harvest()));
+	}
+	else {
+		qWarning("%s: epoll_create1() failed: %s", Q_FUNC_INFO, strerror(errno));
+	}
+}
+
+BatchConnectorPrivate::~BatchConnectorPrivate(void)
+{
+	this->abort();
+	this->stopRing();
+	delete this->m_notifier;
+
+	if (-1 != this->m_epoll) {
+		::close(this->m_epoll);
+	}
+}
+
+int BatchConnectorPrivate::connectMany(const QList<BatchConnector::Endpoint>& endpoints)
+{
+	if (this->m_ring) {
+		return this->connectManyRing(endpoints);
+	}
+
+	int first = this->m_next_id;
+	QVector<Result> results;
+
+	for (int i=0; i<endpoints.size(); ++i) {
+		int id  = this->m_next_id++;
+		int err = EBADF;
+		int fd  = (-1 != this->m_epoll) ? BatchConnectorPrivate::startConnect(endpoints.at(i), &err) : -1;
+
+		if (-1 != fd && EINPROGRESS == err) {
+			this->m_tracker.track(fd, id, this->m_timeout);
+		}
+		else {
+			Result r = { id, fd, err };
+			results.append(r);
+		}
+	}
+
+	this->scheduleExpiry();
+	this->deliver(results);
+	return first;
+}
+
+void BatchConnectorPrivate::abort(void)
+{
+	if (this->m_ring) {
+		this->abortRing();
+		return;
+	}
+
+	this->m_tracker.closeAll();
+	this->m_timer->stop();
+}
+
+QAbstractSocket::SocketError BatchConnectorPrivate::mapError(int err)
+{
+	switch (err) {
+		case ECONNREFUSED:
+			return QAbstractSocket::ConnectionRefusedError;
+
+		case ETIMEDOUT:
+			return QAbstractSocket::SocketTimeoutError;
+
+		case ENETUNREACH:
+		case EHOSTUNREACH:
+		case ENETDOWN:
+			return QAbstractSocket::NetworkError;
+
+		case EADDRINUSE:
+			return QAbstractSocket::AddressInUseError;
+
+		case EADDRNOTAVAIL:
+			return QAbstractSocket::SocketAddressNotAvailableError;
+
+		case EACCES:
+		case EPERM:
+			return QAbstractSocket::SocketAccessError;
+
+		case EAFNOSUPPORT:
+		case EPROTONOSUPPORT:
+			return QAbstractSocket::UnsupportedSocketOperationError;
+
+		case EMFILE:
+		case ENFILE:
+		case ENOBUFS:
+		case ENOMEM:
+		case EBUSY:
+		case EAGAIN:
+			return QAbstractSocket::SocketResourceError;
+
+		default:
+			return QAbstractSocket::UnknownSocketError;
+	}
+}
+
+int BatchConnectorPrivate::startConnect(const BatchConnector::Endpoint& e, int* err)
+{
+	struct sockaddr_storage ss;
+	socklen_t len = makeAddress(e.address, e.port, &ss);
+	if (!len) {
+		*err = EAFNOSUPPORT;
+		return -1;
+	}
+
+	int fd = ::socket(ss.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (-1 == fd) {
+		*err = errno;
+		return -1;
+	}
+
+	if (!e.local.isNull()) {
+		struct sockaddr_storage local;
+		socklen_t local_len = makeAddress(e.local, 0, &local);
+		if (!local_len || -1 == ::bind(fd, reinterpret_cast<struct sockaddr*>(&local), local_len)) {
+			*err = local_len ? errno : EAFNOSUPPORT;
+			::close(fd);
+			return -1;
+		}
+	}
+
+	int res;
+	do {
+		res = ::connect(fd, reinterpret_cast<struct sockaddr*>(&ss), len);
+	} while (-1 == res && EINTR == errno);
+
+	*err = res ? errno : 0;
+	if (res && EINPROGRESS != *err) {
+		::close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+void BatchConnectorPrivate::scheduleExpiry(void)
+{
+	qint64 delay = this->m_tracker.nextDeadline();
+	if (-1 == delay) {
+		this->m_timer->stop();
+	}
+	else {
+		this->m_timer->start(int(qMin(delay, qint64(INT_MAX))));
+	}
+}
+
+void BatchConnectorPrivate::deliver(const QVector<Result>& results)
+{
+	Q_Q(BatchConnector);
+
+	for (int i=0; i<results.size(); ++i) {
+		const Result& r = results.at(i);
+		if (-1 != r.fd) {
+			// Nobody would take the ownership of the descriptor
+			if (q->receivers(SIGNAL(connected(int,qintptr)))) {
+				Q_EMIT q->connected(r.id, r.fd);
+			}
+			else {
+				::close(r.fd);
+			}
+		}
+		else {
+			Q_EMIT q->error(r.id, BatchConnectorPrivate::mapError(r.err));
+		}
+	}
+
+	if (!results.isEmpty() && !this->m_tracker.pending()) {
+		Q_EMIT q->finished();
+	}
+}
+
+void BatchConnectorPrivate::_q_harvest(void)
+{
+	if (this->m_ring) {
+		this->harvestRing();
+		return;
+	}
+
+	const int max_events = 256;
+	struct epoll_event events[max_events];
+	QVector<Result> results;
+
+	int n;
+	do {
+		n = ::epoll_wait(this->m_epoll, events, max_events, 0);
+		for (int i=0; i<n; ++i) {
+			int fd = events[i].data.fd;
+			if (-1 == this->m_tracker.id(fd)) {
+				continue;
+			}
+
+			int err     = 0;
+			socklen_t l = sizeof(err);
+			::getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &l);
+
+			Result r = { this->m_tracker.untrack(fd), fd, err };
+			if (err) {
+				::close(fd);
+				r.fd = -1;
+			}
+
+			results.append(r);
+		}
+	} while (max_events == n);
+
+	this->scheduleExpiry();
+	this->deliver(results);
+}
+
+void BatchConnectorPrivate::_q_expire(void)
+{
+	QVector<Result> results;
+
+	int id;
+	while (-1 != (id = this->m_tracker.expire())) {
+		Result r = { id, -1, ETIMEDOUT };
+		results.append(r);
+	}
+
+	this->scheduleExpiry();
+	this->deliver(results);
+}
+
+bool BatchConnectorPrivate::setBackend(BatchConnector::Backend backend)
+{
+	if (this->m_tracker.pending()) {
+		return false;
+	}
+
+	switch (backend) {
+		case BatchConnector::EpollBackend:
+			this->stopRing();
+			return true;
+
+		case BatchConnector::IoUringBackend:
+			return this->m_ring || this->startRing();
+
+		case BatchConnector::AutoBackend:
+			if (!this->m_ring) {
+				this->startRing();
+			}
+
+			return true;
+
+		default:
+			return false;
+	}
+}
+
+bool BatchConnectorPrivate::startRing(void)
+{
+	Q_Q(BatchConnector);
+
+	IoUring* ring = new IoUring();
+	int event     = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (-1 == event || !ring->setup(256, 4096) || !ring->hasSocketOps() || !ring->registerEventFd(event)) {
+		delete ring;
+		if (-1 != event) {
+			::close(event);
+		}
+
+		return false;
+	}
+
+	this->m_ring          = ring;
+	this->m_ring_event    = event;
+	this->m_ring_notifier = new QSocketNotifier(event, QSocketNotifier::Read, q);
+	QObject::connect(this->m_ring_notifier, SIGNAL(activated(int)), q, SLOT(_q_harvest()));
+	return true;
+}
+
+void BatchConnectorPrivate::stopRing(void)
+{
+	delete this->m_ring_notifier;
+	delete this->m_ring;
+	this->m_ring_notifier = 0;
+	this->m_ring          = 0;
+
+	if (-1 != this->m_ring_event) {
+		::close(this->m_ring_event);
+		this->m_ring_event = -1;
+	}
+}
+
+int BatchConnectorPrivate::connectManyRing(const QList<BatchConnector::Endpoint>& endpoints)
+{
+	int first = this->m_next_id;
+	int n     = endpoints.size();
+	QVector<Result> results;
+	QVector<struct sockaddr_storage> addresses(n);
+	QVector<socklen_t> lengths(n);
+	QVector<int> fds(n);
+	QVector<int> errors(n);
+
+	// The socket completions of a batch which has given up on them carry an older generation
+	quint32 batch = ++this->m_ring_batch;
+
+	this->m_next_id += n;
+	this->m_ring_timeout.tv_sec  = this->m_timeout / 1000;
+	this->m_ring_timeout.tv_nsec = long(this->m_timeout % 1000) * 1000000;
+
+	// The sockets of the whole batch are created with one submission
+	int wanted = 0;
+	for (int i=0; i<n; ++i) {
+		fds[i]     = -1;
+		lengths[i] = makeAddress(endpoints.at(i).address, endpoints.at(i).port, &addresses[i]);
+		errors[i]  = lengths[i] ? EBUSY : EAFNOSUPPORT;
+
+		struct io_uring_sqe* sqe = lengths[i] ? this->m_ring->nextSqe() : 0;
+		if (sqe) {
+			IoUring::prepSocket(sqe, addresses[i].ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, ringTag(RingSocket, i, int(batch)));
+			errors[i] = EINPROGRESS;
+			++wanted;
+		}
+	}
+
+	int created = 0;
+	while (created < wanted) {
+		if (this->m_ring->submit(wanted - created) < 0) {
+			// The sockets still to come are closed by completeRing() when they turn up
+			int err = errno;
+			for (int i=0; i<n; ++i) {
+				if (EINPROGRESS == errors[i]) {
+					errors[i] = err;
+				}
+			}
+
+			break;
+		}
+
+		struct io_uring_cqe* cqe;
+		while (0 != (cqe = this->m_ring->peekCqe())) {
+			if (RingSocket == ringOp(cqe->user_data) && quint32(ringFd(cqe->user_data)) == batch) {
+				int i = ringId(cqe->user_data);
+				if (cqe->res >= 0) {
+					fds[i] = cqe->res;
+				}
+
+				errors[i] = (cqe->res >= 0) ? 0 : -cqe->res;
+				++created;
+			}
+			else {
+				// A connection, or a socket, of an earlier batch
+				this->completeRing(cqe, results);
+			}
+
+			this->m_ring->cqeSeen();
+		}
+	}
+
+	// Then the connects, each one linked with its timeout
+	for (int i=0; i<n; ++i) {
+		int id = first + i;
+		int fd = fds[i];
+		if (-1 == fd) {
+			Result r = { id, -1, errors[i] };
+			results.append(r);
+			continue;
+		}
+
+		const BatchConnector::Endpoint& e = endpoints.at(i);
+		if (!e.local.isNull()) {
+			// There is no IORING_OP_BIND before Linux 6.11
+			struct sockaddr_storage local;
+			socklen_t local_len = makeAddress(e.local, 0, &local);
+			if (!local_len || -1 == ::bind(fd, reinterpret_cast<struct sockaddr*>(&local), local_len)) {
+				Result r = { id, -1, local_len ? errno : EAFNOSUPPORT };
+				results.append(r);
+				::close(fd);
+				continue;
+			}
+		}
+
+		if (!this->m_ring->reserve(2)) {
+			Result r = { id, -1, errno };
+			results.append(r);
+			::close(fd);
+			continue;
+		}
+
+		this->m_tracker.watch(fd, id);
+
+		struct io_uring_sqe* sqe = this->m_ring->nextSqe();
+		IoUring::prepConnect(sqe, fd, reinterpret_cast<struct sockaddr*>(&addresses[i]), lengths[i], ringTag(RingConnect, id, fd));
+		sqe->flags |= IOSQE_IO_LINK;
+		IoUring::prepLinkTimeout(this->m_ring->nextSqe(), &this->m_ring_timeout, ringTag(RingOther, id, fd));
+	}
+
+	// The addresses are copied by the kernel when the entries are submitted
+	this->m_ring->submit();
+	this->deliver(results);
+	return first;
+}
+
+void BatchConnectorPrivate::abortRing(void)
+{
+	for (int fd=0; fd<this->m_tracker.capacity(); ++fd) {
+		int id = this->m_tracker.id(fd);
+		if (-1 == id) {
+			continue;
+		}
+
+		this->m_tracker.take(fd);
+
+		// The completion of the cancelled connect is ignored: the ID no longer matches
+		if (this->m_ring->reserve(2)) {
+			IoUring::prepCancel(this->m_ring->nextSqe(), ringTag(RingConnect, id, fd), ringTag(RingOther, id, fd));
+			IoUring::prepClose(this->m_ring->nextSqe(), fd, ringTag(RingOther, id, fd));
+		}
+		else {
+			::close(fd);
+		}
+	}
+
+	this->m_ring->submit();
+}
+
+void BatchConnectorPrivate::harvestRing(void)
+{
+	quint64 value;
+	while (-1 == ::read(this->m_ring_event, &value, sizeof(value)) && EINTR == errno) {
+	}
+
+	QVector<Result> results;
+	do {
+		struct io_uring_cqe* cqe;
+		while (0 != (cqe = this->m_ring->peekCqe())) {
+			this->completeRing(cqe, results);
+			this->m_ring->cqeSeen();
+		}
+	} while (this->m_ring->hasOverflow() && this->m_ring->submit() >= 0);
+
+	// Submits the closes of the failed sockets
+	this->m_ring->submit();
+	this->deliver(results);
+}
+
+void BatchConnectorPrivate::completeRing(const struct io_uring_cqe* cqe, QVector<Result>& results)
+{
+	// A socket of a batch which has given up waiting for it
+	if (RingSocket == ringOp(cqe->user_data)) {
+		if (cqe->res >= 0) {
+			::close(cqe->res);
+		}
+
+		return;
+	}
+
+	// The link timeouts, the closes and the cancellations need no attention
+	if (RingConnect != ringOp(cqe->user_data)) {
+		return;
+	}
+
+	int fd = ringFd(cqe->user_data);
+	int id = this->m_tracker.id(fd);
+	if (-1 == id || ringId(cqe->user_data) != int(quint32(id) & ring_id_mask)) {
+		return;
+	}
+
+	Result r = { this->m_tracker.take(fd), fd, 0 };
+
+	if (cqe->res < 0) {
+		// The connect is cancelled when its linked timeout fires
+		r.err = (-ECANCELED == cqe->res) ? ETIMEDOUT : -cqe->res;
+		r.fd  = -1;
+
+		struct io_uring_sqe* sqe = this->m_ring->nextSqe();
+		if (sqe) {
+			IoUring::prepClose(sqe, fd, ringTag(RingOther, r.id, fd));
+		}
+		else {
+			::close(fd);
+		}
+	}
+
+	results.append(r);
+}
@@ -0,0 +1,66 @@
+#ifndef BATCHCONNECTOR_P_H
+#define BATCHCONNECTOR_P_H
+
+#include <QtCore/QList>
+#include <QtCore/QVector>
+#include "batchconnector.h"
+#include "connecttracker_p.h"
+#include "iouring_p.h"
+#include "qt4compat.h"
+
+#if QT_VERSION >= 0x040400
+QT_FORWARD_DECLARE_CLASS(QSocketNotifier)
+QT_FORWARD_DECLARE_CLASS(QTimer)
+#else
+class QSocketNotifier;
+class QTimer;
+#endif
+
+class Q_DECL_HIDDEN BatchConnectorPrivate {
+	Q_DECLARE_PUBLIC(BatchConnector)
+	BatchConnector* const q_ptr;
+public:
+	BatchConnectorPrivate(BatchConnector* const q);
+	~BatchConnectorPrivate(void);
+
+	int connectMany(const QList<BatchConnector::Endpoint>& endpoints);
+	void abort(void);
+	bool setBackend(BatchConnector::Backend backend);
+
+	static QAbstractSocket::SocketError mapError(int err);
+	static int startConnect(const BatchConnector::Endpoint& e, int* err);
+
+private:
+	struct Result {
+		int id;
+		int fd;
+		int err;
+	};
+
+	int m_epoll;
+	QSocketNotifier* m_notifier;
+	QTimer* m_timer;
+	ConnectTracker m_tracker;
+	int m_next_id;
+	uint m_timeout;
+	IoUring* m_ring;
+	int m_ring_event;
+	QSocketNotifier* m_ring_notifier;
+	struct __kernel_timespec m_ring_timeout;
+	quint32 m_ring_batch;
+
+	void scheduleExpiry(void);
+	void deliver(const QVector<Result>& results);
+
+	bool startRing(void);
+	void stopRing(void);
+	int connectManyRing(const QList<BatchConnector::Endpoint>& endpoints);
+	void abortRing(void);
+	void harvestRing(void);
+	void completeRing(const struct io_uring_cqe* cqe, QVector<Result>& results);
+
+	void _q_harvest(void);
+	void _q_expire(void);
+};
+
+#endif // BATCHCONNECTOR_P_H
@@ -0,0 +1,293 @@
+#include <QtCore/QMutexLocker>
+#include "circuitbreaker.h"
+
+/**
+ * @class CircuitBreaker
+ *
+ * @brief The CircuitBreaker class stops the connections to the destinations which keep failing
+ *
+ * Every destination (host name or address as passed to SocketConnector::connectToHost(), and port) has a circuit:
+ * @li @c Closed: the connections are allowed; failureThreshold() consecutive failures trip the circuit;
+ * @li @c Open: the connections are rejected right away; after openTime() milliseconds the circuit becomes half-open;
+ * @li @c HalfOpen: up to probeLimit() connections are let through at a time; the first success closes the circuit,
+ * a failure opens it again.
+ *
+ * The class is thread-safe and can be shared by any number of connectors.
+ *
+ * @see SocketConnector::setCircuitBreaker()
+ */
+
+Q_GLOBAL_STATIC(CircuitBreaker, globalBreaker)
+
+static QString circuitKey(const QString& host, quint16 port)
+{
+	return host + QLatin1Char('/') + QString::number(port);
+}
+
+/**
+ * @brief Creates a circuit breaker
+ * @param threshold Number of consecutive failures which trips a circuit
+ * @param open_time Time a tripped circuit stays open, in milliseconds
+ * @param probes Number of concurrent connections allowed through a half-open circuit
+ */
+CircuitBreaker::CircuitBreaker(uint threshold, uint open_time, uint probes)
+	: m_mutex(), m_clock(), m_circuits(), m_threshold(qMax(threshold, 1u)), m_open_time(open_time), m_probe_limit(qMax(probes, 1u)),
+	  m_trips(0), m_rejections(0)
+{
+	this->m_clock.start();
+}
+
+/**
+ * @brief Returns the process-wide circuit breaker
+ * @return Shared circuit breaker
+ */
+CircuitBreaker* CircuitBreaker::globalInstance(void)
+{
+	return globalBreaker();
+}
+
+/**
+ * @brief Decides whether a connection to @a host:@a port may be attempted
+ * @param host Host name or address
+ * @param port Port
+ * @return Whether the connection is allowed
+ *
+ * Every allowed connection must be followed by reportSuccess(), reportFailure(), or cancel().
+ */
+bool CircuitBreaker::allow(const QString& host, quint16 port)
+{
+	QMutexLocker locker(&this->m_mutex);
+
+	QHash<QString, Circuit>::Iterator it = this->m_circuits.find(circuitKey(host, port));
+	if (it == this->m_circuits.end()) {
+		return true;
+	}
+
+	this->update(*it);
+	switch (it->state) {
+		case Closed:
+			return true;
+
+		case HalfOpen:
+			if (it->probes < this->m_probe_limit) {
+				++it->probes;
+				return true;
+			}
+
+			break;
+
+		case Open:
+		default:
+			break;
+	}
+
+	++this->m_rejections;
+	return false;
+}
+
+/**
+ * @brief Records a successful connection to @a host:@a port
+ * @param host Host name or address
+ * @param port Port
+ */
+void CircuitBreaker::reportSuccess(const QString& host, quint16 port)
+{
+	QMutexLocker locker(&this->m_mutex);
+
+	// The closed circuits with no failures are not kept
+	QHash<QString, Circuit>::Iterator it = this->m_circuits.find(circuitKey(host, port));
+	if (it != this->m_circuits.end() && !it->trips) {
+		this->m_circuits.erase(it);
+	}
+	else if (it != this->m_circuits.end()) {
+		it->state    = Closed;
+		it->failures = 0;
+		it->probes   = 0;
+	}
+}
+
+/**
+ * @brief Records a failed connection to @a host:@a port
+ * @param host Host name or address
+ * @param port Port
+ */
+void CircuitBreaker::reportFailure(const QString& host, quint16 port)
+{
+	QMutexLocker locker(&this->m_mutex);
+
+	QString key = circuitKey(host, port);
+	QHash<QString, Circuit>::Iterator it = this->m_circuits.find(key);
+	if (it == this->m_circuits.end()) {
+		Circuit c;
+		c.state     = Closed;
+		c.failures  = 0;
+		c.probes    = 0;
+		c.opened_at = 0;
+		c.trips     = 0;
+		it = this->m_circuits.insert(key, c);
+	}
+
+	this->update(*it);
+	if (HalfOpen == it->state) {
+		this->trip(*it);
+	}
+	else if (Closed == it->state && ++it->failures >= this->m_threshold) {
+		this->trip(*it);
+	}
+}
+
+/**
+ * @brief Records that an allowed connection to @a host:@a port was abandoned without an outcome
+ * @param host Host name or address
+ * @param port Port
+ */
+void CircuitBreaker::cancel(const QString& host, quint16 port)
+{
+	QMutexLocker locker(&this->m_mutex);
+
+	QHash<QString, Circuit>::Iterator it = this->m_circuits.find(circuitKey(host, port));
+	if (it != this->m_circuits.end() && it->probes) {
+		--it->probes;
+	}
+}
+
+/**
+ * @brief Returns the state of the circuit of @a host:@a port
+ * @param host Host name or address
+ * @param port Port
+ * @return Circuit state
+ */
+CircuitBreaker::State CircuitBreaker::state(const QString& host, quint16 port) const
+{
+	QMutexLocker locker(&this->m_mutex);
+
+	QHash<QString, Circuit>::ConstIterator it = this->m_circuits.constFind(circuitKey(host, port));
+	if (it == this->m_circuits.constEnd()) {
+		return Closed;
+	}
+
+	Circuit c = *it;
+	this->update(c);
+	return c.state;
+}
+
+/**
+ * @brief Returns how many times the circuit of @a host:@a port has tripped
+ * @param host Host name or address
+ * @param port Port
+ * @return Number of trips
+ */
+quint64 CircuitBreaker::trips(const QString& host, quint16 port) const
+{
+	QMutexLocker locker(&this->m_mutex);
+
+	QHash<QString, Circuit>::ConstIterator it = this->m_circuits.constFind(circuitKey(host, port));
+	return (it != this->m_circuits.constEnd()) ? it->trips : 0;
+}
+
+/**
+ * @brief Returns how many times any circuit has tripped
+ * @return Number of trips
+ */
+quint64 CircuitBreaker::trips(void) const
+{
+	QMutexLocker locker(&this->m_mutex);
+	return this->m_trips;
+}
+
+/**
+ * @brief Returns how many connections have been rejected
+ * @return Number of rejections
+ */
+quint64 CircuitBreaker::rejections(void) const
+{
+	QMutexLocker locker(&this->m_mutex);
+	return this->m_rejections;
+}
+
+/**
+ * @brief Closes all circuits and forgets their history
+ */
+void CircuitBreaker::reset(void)
+{
+	QMutexLocker locker(&this->m_mutex);
+	this->m_circuits.clear();
+}
+
+/**
+ * @brief Sets the number of consecutive failures which trips a circuit
+ * @param threshold Number of failures; the default is 5
+ */
+void CircuitBreaker::setFailureThreshold(uint threshold)
+{
+	QMutexLocker locker(&this->m_mutex);
+	this->m_threshold = qMax(threshold, 1u);
+}
+
+/**
+ * @brief Returns the number of consecutive failures which trips a circuit
+ * @return Number of failures
+ */
+uint CircuitBreaker::failureThreshold(void) const
+{
+	QMutexLocker locker(&this->m_mutex);
+	return this->m_threshold;
+}
+
+/**
+ * @brief Sets the time a tripped circuit stays open
+ * @param msecs Time (msec); the default is 30000
+ */
+void CircuitBreaker::setOpenTime(uint msecs)
+{
+	QMutexLocker locker(&this->m_mutex);
+	this->m_open_time = msecs;
+}
+
+/**
+ * @brief Returns the time a tripped circuit stays open
+ * @return Time (msec)
+ */
+uint CircuitBreaker::openTime(void) const
+{
+	QMutexLocker locker(&this->m_mutex);
+	return this->m_open_time;
+}
+
+/**
+ * @brief Sets the number of concurrent connections allowed through a half-open circuit
+ * @param probes Number of connections; the default is 1
+ */
+void CircuitBreaker::setProbeLimit(uint probes)
+{
+	QMutexLocker locker(&this->m_mutex);
+	this->m_probe_limit = qMax(probes, 1u);
+}
+
+/**
+ * @brief Returns the number of concurrent connections allowed through a half-open circuit
+ * @return Number of connections
+ */
+uint CircuitBreaker::probeLimit(void) const
+{
+	QMutexLocker locker(&this->m_mutex);
+	return this->m_probe_limit;
+}
+
+void CircuitBreaker::trip(Circuit& c)
+{
+	c.state     = Open;
+	c.failures  = 0;
+	c.probes    = 0;
+	c.opened_at = this->m_clock.elapsed();
+	++c.trips;
+	++this->m_trips;
+}
+
+void CircuitBreaker::update(Circuit& c) const
+{
+	if (Open == c.state && this->m_clock.elapsed() - c.opened_at >= qint64(this->m_open_time)) {
+		c.state  = HalfOpen;
+		c.probes = 0;
+	}
+}
@@ -0,0 +1,63 @@
+#ifndef CIRCUITBREAKER_H
+#define CIRCUITBREAKER_H
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QString>
+
+class CircuitBreaker {
+public:
+	enum State {
+		Closed,
+		Open,
+		HalfOpen
+	};
+
+	CircuitBreaker(uint threshold = 5, uint open_time = 30000, uint probes = 1);
+
+	static CircuitBreaker* globalInstance(void);
+
+	bool allow(const QString& host, quint16 port);
+	void reportSuccess(const QString& host, quint16 port);
+	void reportFailure(const QString& host, quint16 port);
+	void cancel(const QString& host, quint16 port);
+
+	State state(const QString& host, quint16 port) const;
+	quint64 trips(const QString& host, quint16 port) const;
+	quint64 trips(void) const;
+	quint64 rejections(void) const;
+	void reset(void);
+
+	void setFailureThreshold(uint threshold);
+	uint failureThreshold(void) const;
+	void setOpenTime(uint msecs);
+	uint openTime(void) const;
+	void setProbeLimit(uint probes);
+	uint probeLimit(void) const;
+
+private:
+	Q_DISABLE_COPY(CircuitBreaker)
+
+	struct Circuit {
+		State state;
+		uint failures;
+		uint probes;
+		qint64 opened_at;
+		quint64 trips;
+	};
+
+	mutable QMutex m_mutex;
+	QElapsedTimer m_clock;
+	QHash<QString, Circuit> m_circuits;
+	uint m_threshold;
+	uint m_open_time;
+	uint m_probe_limit;
+	quint64 m_trips;
+	quint64 m_rejections;
+
+	void trip(Circuit& c);
+	void update(Circuit& c) const;
+};
+
+#endif // CIRCUITBREAKER_H
@@ -0,0 +1,343 @@
+#ifndef CONNECTAWAITABLE_H
+#define CONNECTAWAITABLE_H
+
+#include <QtCore/QObject>
+#include <QtCore/QPointer>
+#include <QtCore/QTimerEvent>
+#include "socketconnector.h"
+
+/*
+ * The library itself does not need C++20: the awaitable is header-only and available
+ * to the translation units which are compiled with coroutine support
+ */
+#if QT_VERSION >= 0x050000 && defined(__cpp_impl_coroutine) && defined(__has_include)
+#	if __has_include(<coroutine>)
+#		include <coroutine>
+#		define SOCKETCONNECTOR_HAS_COROUTINES
+#	endif
+#endif
+
+#ifdef SOCKETCONNECTOR_HAS_COROUTINES
+
+/**
+ * @brief The outcome of awaitConnect()
+ *
+ * On success @c socket is the connected descriptor, owned by the caller; otherwise it is -1 and @c error tells why.
+ * A cancellation with SocketConnector::abort() is reported as @c QAbstractSocket::OperationError.
+ */
+struct ConnectResult {
+	qintptr socket;
+	QAbstractSocket::SocketError error;
+
+	ConnectResult(void) : socket(-1), error(QAbstractSocket::UnknownSocketError) {}
+
+	bool isValid(void) const
+	{
+		return -1 != this->socket;
+	}
+};
+
+class ConnectAwaitHelper;
+
+/**
+ * @brief The awaitable returned by awaitConnect()
+ *
+ * The awaitable is a plain struct in the frame of the awaiting coroutine. The signal connections live in a helper
+ * which is created by the first await on a connector and reused by all the later ones; an await itself makes
+ * no connections. What an await still allocates is the share of the event loop: the registration of the timers
+ * (the deadline and the resumption) with the event dispatcher.
+ *
+ * The coroutine is resumed from the event loop of the connector's thread (never from within a signal of the connector,
+ * so the coroutine may destroy the connector) and never from a nested event loop.
+ *
+ * If the coroutine is destroyed while it waits, the host lookup and the connection attempt are aborted.
+ */
+struct ConnectAwaitable {
+	ConnectAwaitable(SocketConnector* conn, const QString& address, quint16 port, int timeout)
+		: m_conn(conn), m_address(address), m_port(port), m_timeout(timeout),
+		  m_helper(0), m_handle(), m_result(), m_pending(false), m_suspending(false)
+	{
+	}
+
+	~ConnectAwaitable(void);
+
+	bool await_ready(void) const noexcept
+	{
+		return false;
+	}
+
+	bool await_suspend(std::coroutine_handle<> handle);
+
+	ConnectResult await_resume(void) const noexcept
+	{
+		return this->m_result;
+	}
+
+private:
+	friend class ConnectAwaitHelper;
+
+	SocketConnector* m_conn;
+	QString m_address;
+	quint16 m_port;
+	int m_timeout;
+	ConnectAwaitHelper* m_helper;
+	std::coroutine_handle<> m_handle;
+	ConnectResult m_result;
+	bool m_pending;
+	bool m_suspending;
+};
+
+/*
+ * Connected once to the signals of its connector; serves one awaitable at a time.
+ * The helper is a child of the connector: when the connector is destroyed during an await,
+ * the helper outlives it until the coroutine has been resumed
+ */
+class ConnectAwaitHelper : public QObject {
+public:
+	static ConnectAwaitHelper* get(SocketConnector* conn)
+	{
+		const QObjectList& children = conn->children();
+		for (int i=0; i<children.size(); ++i) {
+			ConnectAwaitHelper* h = dynamic_cast<ConnectAwaitHelper*>(children.at(i));
+			if (h) {
+				return h;
+			}
+		}
+
+		return new ConnectAwaitHelper(conn);
+	}
+
+	bool begin(ConnectAwaitable* a)
+	{
+		if (this->m_waiter || !this->m_conn) {
+			return false;
+		}
+
+		this->m_waiter = a;
+		a->m_helper    = this;
+		a->m_pending   = true;
+
+		if (a->m_timeout >= 0) {
+			this->m_deadline = this->startTimer(a->m_timeout);
+		}
+
+		return true;
+	}
+
+	void started(ConnectAwaitable* a)
+	{
+		// A failure right away is reported with error(); UnconnectedState without it means abort()
+		if (a->m_pending && (!this->m_conn || QAbstractSocket::UnconnectedState == this->m_conn->state())) {
+			this->finish(-1, QAbstractSocket::OperationError, false);
+		}
+
+		if (!a->m_pending) {
+			this->release();
+		}
+	}
+
+	void cancel(ConnectAwaitable* a)
+	{
+		if (this->m_waiter != a) {
+			return;
+		}
+
+		if (a->m_pending) {
+			this->finish(-1, QAbstractSocket::OperationError, true);
+		}
+
+		this->release();
+	}
+
+protected:
+	virtual void timerEvent(QTimerEvent* e)
+	{
+		if (e->timerId() == this->m_deadline) {
+			this->finish(-1, QAbstractSocket::SocketTimeoutError, true);
+			this->resume();
+		}
+		else if (e->timerId() == this->m_resume) {
+			if (this->m_waiter && this->m_waiter->m_pending) {
+				this->finish(-1, QAbstractSocket::OperationError, false);
+			}
+
+			this->resume();
+		}
+	}
+
+private:
+	QPointer<SocketConnector> m_conn;
+	ConnectAwaitable* m_waiter;
+	int m_deadline;
+	int m_resume;
+	bool m_orphan;
+
+	explicit ConnectAwaitHelper(SocketConnector* conn)
+		: QObject(conn), m_conn(conn), m_waiter(0), m_deadline(0), m_resume(0), m_orphan(false)
+	{
+		QObject::connect(conn, &SocketConnector::connected, this, [this]() {
+			if (this->m_waiter && this->m_waiter->m_pending) {
+				this->finish(this->m_conn->releaseSocketDescriptor(), QAbstractSocket::UnknownSocketError, false);
+				this->scheduleResume();
+			}
+		});
+
+		QObject::connect(conn, static_cast<void (SocketConnector::*)(QAbstractSocket::SocketError)>(&SocketConnector::error), this, [this](QAbstractSocket::SocketError e) {
+			if (this->m_waiter && this->m_waiter->m_pending) {
+				this->finish(-1, e, false);
+				this->scheduleResume();
+			}
+		});
+
+		// SocketConnector::abort() leaves UnconnectedState with neither connected() nor error(); a failure emits error() right after.
+		// The check is made when the coroutine is about to be resumed, by then error() has had its chance
+		QObject::connect(conn, &SocketConnector::stateChanged, this, [this](QAbstractSocket::SocketState state) {
+			if (this->m_waiter && this->m_waiter->m_pending && QAbstractSocket::UnconnectedState == state) {
+				this->scheduleResume();
+			}
+		});
+
+		QObject::connect(conn, &QObject::destroyed, this, [this]() {
+			if (!this->m_waiter) {
+				return;
+			}
+
+			// Survives the connector until the coroutine is resumed
+			this->setParent(0);
+			this->m_orphan = true;
+			if (this->m_waiter->m_pending) {
+				this->finish(-1, QAbstractSocket::OperationError, false);
+			}
+
+			this->scheduleResume();
+		});
+	}
+
+	void finish(qintptr fd, QAbstractSocket::SocketError e, bool abort)
+	{
+		ConnectAwaitable* a = this->m_waiter;
+		a->m_pending = false;
+
+		if (this->m_deadline) {
+			this->killTimer(this->m_deadline);
+			this->m_deadline = 0;
+		}
+
+		if (abort && this->m_conn) {
+			this->m_conn->abort();
+		}
+
+		a->m_result.socket = fd;
+		a->m_result.error  = (-1 == fd) ? e : QAbstractSocket::UnknownSocketError;
+	}
+
+	void scheduleResume(void)
+	{
+		// Resumed from the event loop: the connector may still be emitting the signal which has brought us here
+		if (!this->m_waiter->m_suspending && !this->m_resume) {
+			this->m_resume = this->startTimer(0);
+		}
+	}
+
+	void release(void)
+	{
+		if (this->m_deadline) {
+			this->killTimer(this->m_deadline);
+			this->m_deadline = 0;
+		}
+
+		if (this->m_resume) {
+			this->killTimer(this->m_resume);
+			this->m_resume = 0;
+		}
+
+		if (this->m_waiter) {
+			this->m_waiter->m_helper = 0;
+			this->m_waiter           = 0;
+		}
+
+		if (this->m_orphan) {
+			this->deleteLater();
+		}
+	}
+
+	void resume(void)
+	{
+		// The coroutine may await on the same connector again right away
+		std::coroutine_handle<> handle = this->m_waiter->m_handle;
+		this->release();
+		handle.resume();
+	}
+};
+
+inline ConnectAwaitable::~ConnectAwaitable(void)
+{
+	if (this->m_helper) {
+		this->m_helper->cancel(this);
+	}
+}
+
+inline bool ConnectAwaitable::await_suspend(std::coroutine_handle<> handle)
+{
+	SocketConnector* conn = this->m_conn;
+	this->m_handle        = handle;
+
+	if (!conn || (QAbstractSocket::UnconnectedState != conn->state() && QAbstractSocket::BoundState != conn->state())) {
+		this->m_result.error = QAbstractSocket::OperationError;
+		return false;
+	}
+
+	if (-1 == conn->socketDescriptor() && !conn->createTcpSocket()) {
+		this->m_result.error = QAbstractSocket::SocketResourceError;
+		return false;
+	}
+
+	ConnectAwaitHelper* helper = ConnectAwaitHelper::get(conn);
+	if (!helper->begin(this)) {
+		this->m_result.error = QAbstractSocket::OperationError;
+		return false;
+	}
+
+	this->m_suspending = true;
+	conn->connectToHost(this->m_address, this->m_port);
+	this->m_suspending = false;
+
+	// The attempt may have completed synchronously: then the coroutine goes on without suspending
+	helper->started(this);
+	return this->m_pending;
+}
+
+/**
+ * @brief Connects @a conn to @a address on @a port; to be used with @c co_await
+ * @param conn Connector; if it has no socket, a TCP socket is created
+ * @param address Host name, IP address or, for an @c AF_UNIX socket, path
+ * @param port Port, in native byte order
+ * @param timeout Overall deadline (msec), including the host lookup; -1 for none
+ * @return Awaitable yielding a ConnectResult
+ *
+ * @code
+ * ConnectResult r = co_await awaitConnect(&connector, "example.com", 443, 5000);
+ * if (r.isValid()) {
+ *     socket->setSocketDescriptor(r.socket);
+ * }
+ * @endcode
+ *
+ * To cancel the connection, call SocketConnector::abort() or destroy the awaiting coroutine.
+ * @note Requires C++20 and Qt 5
+ */
+inline ConnectAwaitable awaitConnect(SocketConnector* conn, const QString& address, quint16 port, int timeout = -1)
+{
+	return ConnectAwaitable(conn, address, port, timeout);
+}
+
+/**
+ * @overload
+ */
+inline ConnectAwaitable awaitConnect(SocketConnector* conn, const QHostAddress& address, quint16 port, int timeout = -1)
+{
+	return ConnectAwaitable(conn, address.toString(), port, timeout);
+}
+
+#endif // SOCKETCONNECTOR_HAS_COROUTINES
+
+#endif // CONNECTAWAITABLE_H
@@ -0,0 +1,171 @@
+#include "connectorengine.h"
+#include "connectorengine_p.h"
+
+/**
+ * @class ConnectorEngine
+ *
+ * @brief The ConnectorEngine class establishes TCP connections in a number of shard threads
+ *
+ * Each shard is a thread which runs its own epoll loop, without a Qt event loop: the pending connects
+ * are driven like in BatchConnector, so one event loop no longer caps the connect rate. submit() can be called
+ * from any thread. It pushes the request onto the lock-free queue of the next shard, in turn, and wakes the shard
+ * up through an eventfd only if its queue was empty.
+ *
+ * The completions are reported with the connected() and error() signals, emitted from the shard threads.
+ * With the default (automatic) connection type they are delivered in the thread of the receiver.
+ *
+ * The endpoints must be IP addresses: no host name lookups are performed.
+ *
+ * @note This class is available on Linux only.
+ */
+
+/**
+ * @fn void ConnectorEngine::connected(int id, qintptr socket)
+ *
+ * This signal is emitted from a shard thread when the connection requested by the submit() call which has returned @a id
+ * has been established. The receiver takes the ownership of the non-blocking @a socket descriptor; if the signal is not connected,
+ * the connection is closed right away.
+ *
+ * @warning With a queued connection the descriptor travels in the event queue of the receiver. If the receiver is destroyed,
+ * or its thread stops, before the event is delivered, the descriptor leaks.
+ *
+ * @sa submit()
+ */
+
+/**
+ * @fn void ConnectorEngine::error(int id, QAbstractSocket::SocketError socketError)
+ *
+ * This signal is emitted from a shard thread when the connection requested by the submit() call which has returned @a id has failed.
+ * @c QAbstractSocket::SocketTimeoutError means that the connection was not established within connectionTimeout().
+ *
+ * @sa submit()
+ */
+
+/**
+ * @brief Creates a new @c ConnectorEngine
+ * @param parent Object parent
+ *
+ * The engine has QThread::idealThreadCount() shards by default; they are started by start().
+ */
+ConnectorEngine::ConnectorEngine(QObject* parent)
+	: QObject(parent), d_ptr(new ConnectorEnginePrivate(this))
+{
+}
+
+/**
+ * @brief Stops the shards and destroys the @c ConnectorEngine
+ */
+ConnectorEngine::~ConnectorEngine(void)
+{
+#if QT_VERSION < 0x040600
+	delete this->d_ptr;
+	this->d_ptr = 0;
+#endif
+}
+
+/**
+ * @brief Starts the shard threads
+ * @return Whether the shards are running
+ *
+ * The shard count, the affinity and the connection timeout are taken into account when the shards are started.
+ */
+bool ConnectorEngine::start(void)
+{
+	Q_D(ConnectorEngine);
+	return d->start();
+}
+
+/**
+ * @brief Stops the shard threads
+ *
+ * The pending connection attempts are aborted; no signals are emitted for them.
+ * stop() must not be called concurrently with submit().
+ */
+void ConnectorEngine::stop(void)
+{
+	Q_D(ConnectorEngine);
+	d->stop();
+}
+
+/**
+ * @brief Returns whether the shards have been started
+ * @return Whether the engine is running
+ */
+bool ConnectorEngine::isRunning(void) const
+{
+	Q_D(const ConnectorEngine);
+	return !d->m_shards.isEmpty();
+}
+
+/**
+ * @brief Requests a connection to @a endpoint
+ * @param endpoint Endpoint; if its local address is not null, the socket is bound to it first
+ * @return ID of the request, or -1 if the engine is not running
+ *
+ * This function is thread-safe and does not block: the connect is started by a shard thread.
+ */
+int ConnectorEngine::submit(const BatchConnector::Endpoint& endpoint)
+{
+	Q_D(ConnectorEngine);
+	return d->submit(endpoint);
+}
+
+/**
+ * @brief Sets the number of shards used by the next start()
+ * @param n Number of shard threads
+ */
+void ConnectorEngine::setShardCount(int n)
+{
+	Q_D(ConnectorEngine);
+	d->m_shard_count = qMax(n, 1);
+}
+
+/**
+ * @brief Returns the number of shards
+ * @return Number of shard threads
+ */
+int ConnectorEngine::shardCount(void) const
+{
+	Q_D(const ConnectorEngine);
+	return d->m_shards.isEmpty() ? d->m_shard_count : d->m_shards.size();
+}
+
+/**
+ * @brief Sets the CPUs the shards are pinned to by the next start()
+ * @param cpus CPU numbers; shard @c i is pinned to <tt>cpus[i % cpus.size()]</tt>. If empty, the shards are not pinned
+ */
+void ConnectorEngine::setCpuAffinity(const QList<int>& cpus)
+{
+	Q_D(ConnectorEngine);
+	d->m_cpus = cpus;
+}
+
+/**
+ * @brief Returns the CPUs the shards are pinned to
+ * @return CPU numbers
+ */
+QList<int> ConnectorEngine::cpuAffinity(void) const
+{
+	Q_D(const ConnectorEngine);
+	return d->m_cpus;
+}
+
+/**
+ * @brief Sets the connection timeout used by the next start()
+ * @param timeout Timeout value (msec)
+ */
+void ConnectorEngine::setConnectionTimeout(uint timeout)
+{
+	Q_D(ConnectorEngine);
+	d->m_timeout = timeout;
+}
+
+/**
+ * @brief Returns the connection timeout
+ * @return Connection timeout
+ */
+uint ConnectorEngine::connectionTimeout(void) const
+{
+	Q_D(const ConnectorEngine);
+	return d->m_timeout;
+}
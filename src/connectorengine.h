@@ -0,0 +1,48 @@
+#ifndef CONNECTORENGINE_H
+#define CONNECTORENGINE_H
+
+#include <QtCore/QObject>
+#include <QtCore/QList>
+#include <QtNetwork/QAbstractSocket>
+#include "batchconnector.h"
+
+#if QT_VERSION < 0x050000
+typedef qptrdiff qintptr;
+#endif
+
+class ConnectorEnginePrivate;
+
+class ConnectorEngine : public QObject {
+	Q_OBJECT
+public:
+	ConnectorEngine(QObject* parent = 0);
+	virtual ~ConnectorEngine(void);
+
+	bool start(void);
+	void stop(void);
+	bool isRunning(void) const;
+
+	int submit(const BatchConnector::Endpoint& endpoint);
+
+	void setShardCount(int n);
+	int shardCount(void) const;
+	void setCpuAffinity(const QList<int>& cpus);
+	QList<int> cpuAffinity(void) const;
+	void setConnectionTimeout(uint timeout);
+	uint connectionTimeout(void) const;
+
+Q_SIGNALS:
+	void connected(int id, qintptr socket);
+	void error(int id, QAbstractSocket::SocketError);
+
+private:
+	Q_DISABLE_COPY(ConnectorEngine)
+	Q_DECLARE_PRIVATE(ConnectorEngine)
+#if QT_VERSION >= 0x040600
+	QScopedPointer<ConnectorEnginePrivate> d_ptr;
+#else
+	ConnectorEnginePrivate* d_ptr;
+#endif
+};
+
+#endif // CONNECTORENGINE_H
@@ -0,0 +1,281 @@
+#include <QtCore/QMetaType>
+#include <climits>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include "batchconnector_p.h"
+#include "connectorengine.h"
+#include "connectorengine_p.h"
+
+static ConnectorShard::Request* loadQueue(QAtomicPointer<ConnectorShard::Request>& queue)
+{
+#if QT_VERSION >= 0x050000
+	return queue.loadAcquire();
+#else
+	return queue;
+#endif
+}
+
+ConnectorShard::ConnectorShard(ConnectorEnginePrivate* engine, int cpu, uint timeout)
+	: QThread(0), m_engine(engine), m_cpu(cpu), m_timeout(timeout),
+	  m_epoll(::epoll_create1(EPOLL_CLOEXEC)), m_eventfd(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+	  m_queue(0), m_stopping(0), m_tracker(m_epoll)
+{
+	if (this->isValid()) {
+		struct epoll_event ev;
+		memset(&ev, 0, sizeof(ev));
+		ev.events  = EPOLLIN;
+		ev.data.fd = this->m_eventfd;
+		::epoll_ctl(this->m_epoll, EPOLL_CTL_ADD, this->m_eventfd, &ev);
+	}
+	else {
+		qWarning("%s: failed to create the epoll set: %s", Q_FUNC_INFO, strerror(errno));
+	}
+}
+
+ConnectorShard::~ConnectorShard(void)
+{
+	this->shutdown();
+
+	// The requests submitted after the loop has ended are dropped
+	Request* r = this->m_queue.fetchAndStoreAcquire(0);
+	while (r) {
+		Request* next = r->next;
+		delete r;
+		r = next;
+	}
+
+	if (-1 != this->m_epoll) {
+		::close(this->m_epoll);
+	}
+
+	if (-1 != this->m_eventfd) {
+		::close(this->m_eventfd);
+	}
+}
+
+bool ConnectorShard::isValid(void) const
+{
+	return -1 != this->m_epoll && -1 != this->m_eventfd;
+}
+
+void ConnectorShard::submit(Request* r)
+{
+	Request* head;
+	do {
+		head    = loadQueue(this->m_queue);
+		r->next = head;
+	} while (!this->m_queue.testAndSetRelease(head, r));
+
+	// Only a push onto the empty stack needs to wake the shard up: the others are taken along with it
+	if (!head) {
+		this->wakeUp();
+	}
+}
+
+void ConnectorShard::shutdown(void)
+{
+	if (this->isRunning()) {
+		this->m_stopping.fetchAndStoreRelease(1);
+		this->wakeUp();
+		this->wait();
+	}
+}
+
+void ConnectorShard::wakeUp(void)
+{
+	quint64 one = 1;
+	while (-1 == ::write(this->m_eventfd, &one, sizeof(one)) && EINTR == errno) {
+	}
+}
+
+void ConnectorShard::run(void)
+{
+	if (-1 != this->m_cpu) {
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(this->m_cpu, &set);
+		if (::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set)) {
+			qWarning("%s: failed to pin the shard to CPU %d", Q_FUNC_INFO, this->m_cpu);
+		}
+	}
+
+	const int max_events = 256;
+	struct epoll_event events[max_events];
+
+	while (!this->m_stopping.fetchAndAddAcquire(0)) {
+		int n = ::epoll_wait(this->m_epoll, events, max_events, this->nextTimeout());
+		for (int i=0; i<n; ++i) {
+			int fd = events[i].data.fd;
+			if (fd == this->m_eventfd) {
+				this->takeRequests();
+			}
+			else {
+				this->harvest(fd);
+			}
+		}
+
+		this->expire();
+	}
+
+	this->m_tracker.closeAll();
+}
+
+void ConnectorShard::takeRequests(void)
+{
+	// The counter is reset before the stack is taken: a request pushed in between wakes the shard up once more
+	quint64 value;
+	while (-1 == ::read(this->m_eventfd, &value, sizeof(value)) && EINTR == errno) {
+	}
+
+	Request* r = this->m_queue.fetchAndStoreAcquire(0);
+
+	// The stack holds the newest request first
+	Request* fifo = 0;
+	while (r) {
+		Request* next = r->next;
+		r->next = fifo;
+		fifo    = r;
+		r       = next;
+	}
+
+	while (fifo) {
+		Request* next = fifo->next;
+		this->startRequest(fifo);
+		delete fifo;
+		fifo = next;
+	}
+}
+
+void ConnectorShard::startRequest(const Request* r)
+{
+	int err = EBADF;
+	int fd  = BatchConnectorPrivate::startConnect(r->endpoint, &err);
+
+	if (-1 != fd && EINPROGRESS == err) {
+		this->m_tracker.track(fd, r->id, this->m_timeout);
+	}
+	else {
+		this->m_engine->finished(r->id, fd, err);
+	}
+}
+
+void ConnectorShard::harvest(int fd)
+{
+	if (-1 == this->m_tracker.id(fd)) {
+		return;
+	}
+
+	int err     = 0;
+	socklen_t l = sizeof(err);
+	::getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &l);
+
+	int id = this->m_tracker.untrack(fd);
+	if (err) {
+		::close(fd);
+		fd = -1;
+	}
+
+	this->m_engine->finished(id, fd, err);
+}
+
+void ConnectorShard::expire(void)
+{
+	int id;
+	while (-1 != (id = this->m_tracker.expire())) {
+		this->m_engine->finished(id, -1, ETIMEDOUT);
+	}
+}
+
+int ConnectorShard::nextTimeout(void)
+{
+	qint64 delay = this->m_tracker.nextDeadline();
+	return (-1 == delay) ? -1 : int(qMin(delay, qint64(INT_MAX)));
+}
+
+ConnectorEnginePrivate::ConnectorEnginePrivate(ConnectorEngine* const q)
+	: q_ptr(q), m_shards(), m_next_id(0), m_next_shard(0), m_shard_count(qMax(QThread::idealThreadCount(), 1)), m_cpus(), m_timeout(30000)
+{
+	// The signals are emitted from the shard threads
+	qRegisterMetaType<qintptr>("qintptr");
+	qRegisterMetaType<QAbstractSocket::SocketError>("QAbstractSocket::SocketError");
+}
+
+ConnectorEnginePrivate::~ConnectorEnginePrivate(void)
+{
+	this->stop();
+}
+
+bool ConnectorEnginePrivate::start(void)
+{
+	if (!this->m_shards.isEmpty()) {
+		return true;
+	}
+
+	int n = qMax(this->m_shard_count, 1);
+	for (int i=0; i<n; ++i) {
+		int cpu = this->m_cpus.isEmpty() ? -1 : this->m_cpus.at(i % this->m_cpus.size());
+		ConnectorShard* shard = new ConnectorShard(this, cpu, this->m_timeout);
+		if (!shard->isValid()) {
+			delete shard;
+			this->stop();
+			return false;
+		}
+
+		this->m_shards.append(shard);
+		shard->start();
+	}
+
+	return true;
+}
+
+void ConnectorEnginePrivate::stop(void)
+{
+	for (int i=0; i<this->m_shards.size(); ++i) {
+		this->m_shards.at(i)->shutdown();
+		delete this->m_shards.at(i);
+	}
+
+	this->m_shards.clear();
+}
+
+int ConnectorEnginePrivate::submit(const BatchConnector::Endpoint& endpoint)
+{
+	int n = this->m_shards.size();
+	if (!n) {
+		return -1;
+	}
+
+	ConnectorShard::Request* r = new ConnectorShard::Request;
+	r->next     = 0;
+	r->endpoint = endpoint;
+	r->id       = this->m_next_id.fetchAndAddRelaxed(1) & INT_MAX;
+
+	uint shard = uint(this->m_next_shard.fetchAndAddRelaxed(1));
+	int id     = r->id;
+	this->m_shards.at(int(shard % uint(n)))->submit(r);
+	return id;
+}
+
+void ConnectorEnginePrivate::finished(int id, int fd, int err)
+{
+	Q_Q(ConnectorEngine);
+
+	if (-1 != fd) {
+		// Nobody would take the ownership of the descriptor
+		if (q->receivers(SIGNAL(connected(int,qintptr)))) {
+			Q_EMIT q->connected(id, fd);
+		}
+		else {
+			::close(fd);
+		}
+	}
+	else {
+		Q_EMIT q->error(id, BatchConnectorPrivate::mapError(err));
+	}
+}
@@ -0,0 +1,77 @@
+#ifndef CONNECTORENGINE_P_H
+#define CONNECTORENGINE_P_H
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QAtomicPointer>
+#include <QtCore/QList>
+#include <QtCore/QThread>
+#include <QtCore/QVector>
+#include "batchconnector.h"
+#include "connecttracker_p.h"
+#include "qt4compat.h"
+
+class ConnectorEngine;
+class ConnectorEnginePrivate;
+
+/*
+ * A shard runs its own epoll loop in its own thread. The requests are pushed onto a lock-free stack
+ * by any number of producers; the shard takes the whole stack at once when the eventfd wakes it up
+ */
+class Q_DECL_HIDDEN ConnectorShard : public QThread {
+public:
+	struct Request {
+		Request* next;
+		BatchConnector::Endpoint endpoint;
+		int id;
+	};
+
+	ConnectorShard(ConnectorEnginePrivate* engine, int cpu, uint timeout);
+	virtual ~ConnectorShard(void);
+
+	bool isValid(void) const;
+	void submit(Request* r);
+	void shutdown(void);
+
+protected:
+	virtual void run(void);
+
+private:
+	ConnectorEnginePrivate* m_engine;
+	int m_cpu;
+	uint m_timeout;
+	int m_epoll;
+	int m_eventfd;
+	QAtomicPointer<Request> m_queue;
+	QAtomicInt m_stopping;
+	ConnectTracker m_tracker;
+
+	void wakeUp(void);
+	void takeRequests(void);
+	void startRequest(const Request* r);
+	void harvest(int fd);
+	void expire(void);
+	int nextTimeout(void);
+};
+
+class Q_DECL_HIDDEN ConnectorEnginePrivate {
+	Q_DECLARE_PUBLIC(ConnectorEngine)
+	ConnectorEngine* const q_ptr;
+public:
+	ConnectorEnginePrivate(ConnectorEngine* const q);
+	~ConnectorEnginePrivate(void);
+
+	bool start(void);
+	void stop(void);
+	int submit(const BatchConnector::Endpoint& endpoint);
+	void finished(int id, int fd, int err);
+
+private:
+	QVector<ConnectorShard*> m_shards;
+	QAtomicInt m_next_id;
+	QAtomicInt m_next_shard;
+	int m_shard_count;
+	QList<int> m_cpus;
+	uint m_timeout;
+};
+
+#endif // CONNECTORENGINE_P_H
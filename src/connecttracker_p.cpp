@@ -0,0 +1,150 @@
+#include <algorithm>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <string.h>
+#include "connecttracker_p.h"
+
+/*
+ * Orders the deadline heap: the earliest deadline is on top
+ */
+template<typename T>
+static bool laterDeadline(const T& a, const T& b)
+{
+	return a.when > b.when;
+}
+
+ConnectTracker::ConnectTracker(int epoll)
+	: m_epoll(epoll), m_clock(), m_ids(), m_deadlines(), m_pending(0)
+{
+	this->m_clock.start();
+}
+
+/*
+ * Registers the connect in progress on @a fd with the epoll set; it fails with @c ETIMEDOUT after @a timeout ms
+ */
+void ConnectTracker::track(int fd, int id, uint timeout)
+{
+	this->watch(fd, id);
+
+	struct epoll_event ev;
+	memset(&ev, 0, sizeof(ev));
+	ev.events  = EPOLLOUT;
+	ev.data.fd = fd;
+	::epoll_ctl(this->m_epoll, EPOLL_CTL_ADD, fd, &ev);
+
+	Deadline d = { this->m_clock.elapsed() + timeout, fd, id };
+	this->m_deadlines.append(d);
+	std::push_heap(this->m_deadlines.begin(), this->m_deadlines.end(), laterDeadline<Deadline>);
+}
+
+int ConnectTracker::untrack(int fd)
+{
+	struct epoll_event ev;
+	::epoll_ctl(this->m_epoll, EPOLL_CTL_DEL, fd, &ev);
+	return this->take(fd);
+}
+
+/*
+ * Records the attempt on @a fd without the epoll set and the deadline: the io_uring backend has its own
+ */
+void ConnectTracker::watch(int fd, int id)
+{
+	if (fd >= this->m_ids.size()) {
+		int old = this->m_ids.size();
+		this->m_ids.resize(qMax(fd + 1, 2 * old));
+		for (int i=old; i<this->m_ids.size(); ++i) {
+			this->m_ids[i] = -1;
+		}
+	}
+
+	this->m_ids[fd] = id;
+	++this->m_pending;
+}
+
+int ConnectTracker::take(int fd)
+{
+	int id = this->m_ids.at(fd);
+	this->m_ids[fd] = -1;
+	--this->m_pending;
+	return id;
+}
+
+/*
+ * Returns the ID of the attempt in progress on @a fd, or -1
+ */
+int ConnectTracker::id(int fd) const
+{
+	return (fd >= 0 && fd < this->m_ids.size()) ? this->m_ids.at(fd) : -1;
+}
+
+int ConnectTracker::pending(void) const
+{
+	return this->m_pending;
+}
+
+/*
+ * All the descriptors with an attempt in progress are below this
+ */
+int ConnectTracker::capacity(void) const
+{
+	return this->m_ids.size();
+}
+
+/*
+ * Returns the number of ms until the earliest deadline, or -1 when no attempt has one
+ */
+qint64 ConnectTracker::nextDeadline(void)
+{
+	while (!this->m_deadlines.isEmpty() && !this->isLive(this->m_deadlines.first())) {
+		this->popDeadline();
+	}
+
+	if (this->m_deadlines.isEmpty()) {
+		return -1;
+	}
+
+	return qMax(Q_INT64_C(0), this->m_deadlines.first().when - this->m_clock.elapsed());
+}
+
+/*
+ * Closes the next attempt whose deadline has passed and returns its ID; returns -1 when there is none
+ */
+int ConnectTracker::expire(void)
+{
+	qint64 now = this->m_clock.elapsed();
+	while (!this->m_deadlines.isEmpty() && this->m_deadlines.first().when <= now) {
+		Deadline d = this->popDeadline();
+		if (this->isLive(d)) {
+			this->untrack(d.fd);
+			::close(d.fd);
+			return d.id;
+		}
+	}
+
+	return -1;
+}
+
+void ConnectTracker::closeAll(void)
+{
+	for (int fd=0; fd<this->m_ids.size(); ++fd) {
+		if (-1 != this->m_ids.at(fd)) {
+			this->untrack(fd);
+			::close(fd);
+		}
+	}
+
+	this->m_deadlines.clear();
+}
+
+bool ConnectTracker::isLive(const Deadline& d) const
+{
+	return d.fd < this->m_ids.size() && this->m_ids.at(d.fd) == d.id;
+}
+
+ConnectTracker::Deadline ConnectTracker::popDeadline(void)
+{
+	std::pop_heap(this->m_deadlines.begin(), this->m_deadlines.end(), laterDeadline<Deadline>);
+	Deadline d = this->m_deadlines.last();
+	this->m_deadlines.removeLast();
+	return d;
+}
@@ -0,0 +1,49 @@
+#ifndef CONNECTTRACKER_P_H
+#define CONNECTTRACKER_P_H
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QVector>
+#include "qt4compat.h"
+
+/*
+ * The connects in progress of BatchConnector and of a ConnectorEngine shard: the ID of the attempt by descriptor,
+ * the registration in the epoll set and the deadlines. The timeout may change between the attempts,
+ * so the deadlines are kept in a heap; the deadlines of the completed attempts are dropped lazily
+ */
+class Q_DECL_HIDDEN ConnectTracker {
+public:
+	explicit ConnectTracker(int epoll);
+
+	void track(int fd, int id, uint timeout);
+	int untrack(int fd);
+	void watch(int fd, int id);
+	int take(int fd);
+
+	int id(int fd) const;
+	int pending(void) const;
+	int capacity(void) const;
+
+	qint64 nextDeadline(void);
+	int expire(void);
+	void closeAll(void);
+
+private:
+	Q_DISABLE_COPY(ConnectTracker)
+
+	struct Deadline {
+		qint64 when;
+		int fd;
+		int id;
+	};
+
+	int m_epoll;
+	QElapsedTimer m_clock;
+	QVector<int> m_ids;
+	QVector<Deadline> m_deadlines;
+	int m_pending;
+
+	bool isLive(const Deadline& d) const;
+	Deadline popDeadline(void);
+};
+
+#endif // CONNECTTRACKER_P_H
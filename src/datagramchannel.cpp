@@ -0,0 +1,469 @@
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <net/if.h>
+#include <unistd.h>
+#include <string.h>
+#include "datagramchannel.h"
+#include "datagramchannel_p.h"
+#include "socketconnector.h"
+
+#ifndef SOL_UDP
+#	define SOL_UDP 17
+#endif
+
+#ifndef UDP_SEGMENT
+#	define UDP_SEGMENT 103
+#endif
+
+/**
+ * @class DatagramRing
+ *
+ * @brief The DatagramRing class is a preallocated set of datagram buffers for DatagramChannel
+ *
+ * A ring consists of count() slots of slotSize() bytes each. A slot holds one datagram: its payload, its size,
+ * its peer address and, with the segmentation offloads, its segment size. Everything the @c sendmmsg() and
+ * @c recvmmsg() calls need is allocated when the ring is created, so no memory is allocated per datagram.
+ *
+ * The storage of the payloads can be provided by the caller; it must hold @c count * @c slotSize bytes
+ * and outlive the ring.
+ *
+ * @see DatagramChannel::send(), DatagramChannel::receive()
+ */
+
+/**
+ * @class DatagramChannel
+ *
+ * @brief The DatagramChannel class sends and receives UDP datagrams in batches
+ *
+ * @c QUdpSocket makes a system call per datagram. DatagramChannel takes over the descriptor of a UDP socket
+ * (usually one made by SocketConnector::createUdpSocket() and bindTo()) and moves a whole range of a DatagramRing
+ * with one @c sendmmsg() or @c recvmmsg() call.
+ *
+ * On top of that, a slot larger than its segment size is sent as a train of datagrams with UDP generic segmentation
+ * offload (@c UDP_SEGMENT, Linux 4.18), and with setReceiveOffloadEnabled() the kernel coalesces the datagrams of a flow
+ * into one slot (@c UDP_GRO, Linux 5.0).
+ *
+ * The I/O never blocks: send() and receive() return 0 when the socket is not ready. readyRead() is emitted
+ * when there are datagrams to receive.
+ *
+ * @note This class is available on Linux only.
+ */
+
+/**
+ * @fn void DatagramChannel::readyRead()
+ *
+ * This signal is emitted whenever there are datagrams to receive(). It is emitted again as long as some are left.
+ */
+
+/**
+ * @brief Creates a ring with @a count slots of @a slotSize bytes each and allocates the storage for them
+ * @param count Number of slots
+ * @param slotSize Size of a slot (bytes)
+ */
+DatagramRing::DatagramRing(int count, int slotSize)
+	: d_ptr(new DatagramRingPrivate(new char[qMax(count, 0) * qptrdiff(qMax(slotSize, 0))], true, qMax(count, 0), qMax(slotSize, 0)))
+{
+}
+
+/**
+ * @brief Creates a ring with @a count slots of @a slotSize bytes each in the caller's @a storage
+ * @param storage Storage of the payloads, at least @a count * @a slotSize bytes; the caller keeps its ownership
+ * @param count Number of slots
+ * @param slotSize Size of a slot (bytes)
+ */
+DatagramRing::DatagramRing(char* storage, int count, int slotSize)
+	: d_ptr(new DatagramRingPrivate(storage, false, qMax(count, 0), qMax(slotSize, 0)))
+{
+}
+
+/**
+ * @brief Destroys the ring; the storage is freed unless it has been provided by the caller
+ */
+DatagramRing::~DatagramRing(void)
+{
+#if QT_VERSION < 0x040600
+	delete this->d_ptr;
+	this->d_ptr = 0;
+#endif
+}
+
+/**
+ * @brief Returns the number of slots
+ * @return Number of slots
+ */
+int DatagramRing::count(void) const
+{
+	Q_D(const DatagramRing);
+	return d->m_count;
+}
+
+/**
+ * @brief Returns the size of a slot
+ * @return Size of a slot (bytes)
+ */
+int DatagramRing::slotSize(void) const
+{
+	Q_D(const DatagramRing);
+	return d->m_slot_size;
+}
+
+/**
+ * @brief Returns the payload of the @a slot
+ * @param slot Slot index
+ * @return Pointer to slotSize() bytes
+ */
+char* DatagramRing::data(int slot)
+{
+	Q_D(DatagramRing);
+	Q_ASSERT(slot >= 0 && slot < d->m_count);
+	return static_cast<char*>(d->m_iov.at(slot).iov_base);
+}
+
+/**
+ * @overload
+ */
+const char* DatagramRing::data(int slot) const
+{
+	Q_D(const DatagramRing);
+	Q_ASSERT(slot >= 0 && slot < d->m_count);
+	return static_cast<const char*>(d->m_iov.at(slot).iov_base);
+}
+
+/**
+ * @brief Returns the size of the datagram in the @a slot
+ * @param slot Slot index
+ * @return The size set by setSize(), or the number of bytes received
+ *
+ * A datagram larger than slotSize() is truncated by receive().
+ */
+int DatagramRing::size(int slot) const
+{
+	Q_D(const DatagramRing);
+	Q_ASSERT(slot >= 0 && slot < d->m_count);
+	return d->m_sizes.at(slot);
+}
+
+/**
+ * @brief Sets the size of the datagram to send from the @a slot
+ * @param slot Slot index
+ * @param size Size (bytes), at most slotSize()
+ */
+void DatagramRing::setSize(int slot, int size)
+{
+	Q_D(DatagramRing);
+	Q_ASSERT(slot >= 0 && slot < d->m_count);
+	d->m_sizes[slot] = qBound(0, size, d->m_slot_size);
+}
+
+/**
+ * @brief Returns the segment size of the @a slot
+ * @param slot Slot index
+ * @return The segment size set by setSegmentSize(), or the size of the coalesced datagrams after receive();
+ * 0 if the slot holds a single datagram
+ */
+int DatagramRing::segmentSize(int slot) const
+{
+	Q_D(const DatagramRing);
+	Q_ASSERT(slot >= 0 && slot < d->m_count);
+	return d->m_segments.at(slot);
+}
+
+/**
+ * @brief Sends the @a slot as a train of datagrams of @a size bytes each
+ * @param slot Slot index
+ * @param size Segment size (bytes); 0 sends the slot as one datagram
+ *
+ * The last datagram may be shorter. The kernel limits the train to 64 KiB and 64 segments (128 since Linux 6.3).
+ *
+ * @see DatagramChannel::isSegmentationOffloadSupported()
+ */
+void DatagramRing::setSegmentSize(int slot, int size)
+{
+	Q_D(DatagramRing);
+	Q_ASSERT(slot >= 0 && slot < d->m_count);
+	d->m_segments[slot] = qBound(0, size, 0xFFFF);
+}
+
+/**
+ * @brief Sets the destination of the datagram in the @a slot
+ * @param slot Slot index
+ * @param address Destination address
+ * @param port Destination port
+ * @return Whether @a address is an IPv4 or an IPv6 address
+ *
+ * A slot with no destination is sent to the peer of the connected socket. After receive() the destination
+ * of a slot is the sender of the datagram, so that a reply can be sent from the same slot.
+ */
+bool DatagramRing::setDestination(int slot, const QHostAddress& address, quint16 port)
+{
+	Q_D(DatagramRing);
+	Q_ASSERT(slot >= 0 && slot < d->m_count);
+
+	struct sockaddr_storage* ss = &d->m_names[slot];
+	memset(ss, 0, sizeof(*ss));
+	d->m_name_lengths[slot] = 0;
+
+	switch (address.protocol()) {
+		case QAbstractSocket::IPv4Protocol: {
+			struct sockaddr_in* sa = reinterpret_cast<struct sockaddr_in*>(ss);
+			sa->sin_family      = AF_INET;
+			sa->sin_port        = htons(port);
+			sa->sin_addr.s_addr = htonl(address.toIPv4Address());
+			d->m_name_lengths[slot] = sizeof(struct sockaddr_in);
+			return true;
+		}
+
+		case QAbstractSocket::IPv6Protocol: {
+			struct sockaddr_in6* sa = reinterpret_cast<struct sockaddr_in6*>(ss);
+			sa->sin6_family = AF_INET6;
+			sa->sin6_port   = htons(port);
+#ifndef QT_NO_IPV6IFNAME
+			sa->sin6_scope_id = ::if_nametoindex(address.scopeId().toLatin1().data());
+#else
+			sa->sin6_scope_id = address.scopeId().toInt();
+#endif
+			Q_IPV6ADDR tmp = address.toIPv6Address();
+			memcpy(&sa->sin6_addr.s6_addr, &tmp, sizeof(tmp));
+			d->m_name_lengths[slot] = sizeof(struct sockaddr_in6);
+			return true;
+		}
+
+		default:
+			return false;
+	}
+}
+
+/**
+ * @brief Sends the datagram in the @a slot to the peer of the connected socket
+ * @param slot Slot index
+ */
+void DatagramRing::clearDestination(int slot)
+{
+	Q_D(DatagramRing);
+	Q_ASSERT(slot >= 0 && slot < d->m_count);
+	d->m_name_lengths[slot] = 0;
+}
+
+/**
+ * @brief Returns the sender of the datagram received into the @a slot
+ * @param slot Slot index
+ * @return Sender address, or a null address if the slot has no peer address
+ *
+ * Unlike the rest of the slot accessors, this one allocates: call it only for the datagrams which need it.
+ */
+QHostAddress DatagramRing::sender(int slot) const
+{
+	Q_D(const DatagramRing);
+	Q_ASSERT(slot >= 0 && slot < d->m_count);
+
+	if (!d->m_name_lengths.at(slot)) {
+		return QHostAddress();
+	}
+
+	const struct sockaddr_storage* ss = &d->m_names.at(slot);
+	if (AF_INET == ss->ss_family) {
+		return QHostAddress(ntohl(reinterpret_cast<const struct sockaddr_in*>(ss)->sin_addr.s_addr));
+	}
+
+	if (AF_INET6 == ss->ss_family) {
+		QHostAddress a;
+		a.setAddress(const_cast<quint8*>(reinterpret_cast<const struct sockaddr_in6*>(ss)->sin6_addr.s6_addr));
+		return a;
+	}
+
+	return QHostAddress();
+}
+
+/**
+ * @brief Returns the port of the sender of the datagram received into the @a slot
+ * @param slot Slot index
+ * @return Sender port, or 0 if the slot has no peer address
+ */
+quint16 DatagramRing::senderPort(int slot) const
+{
+	Q_D(const DatagramRing);
+	Q_ASSERT(slot >= 0 && slot < d->m_count);
+
+	if (!d->m_name_lengths.at(slot)) {
+		return 0;
+	}
+
+	const struct sockaddr_storage* ss = &d->m_names.at(slot);
+	if (AF_INET == ss->ss_family) {
+		return ntohs(reinterpret_cast<const struct sockaddr_in*>(ss)->sin_port);
+	}
+
+	if (AF_INET6 == ss->ss_family) {
+		return ntohs(reinterpret_cast<const struct sockaddr_in6*>(ss)->sin6_port);
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Creates a channel with no socket
+ * @param parent Object parent
+ */
+DatagramChannel::DatagramChannel(QObject* parent)
+	: QObject(parent), d_ptr(new DatagramChannelPrivate(this))
+{
+}
+
+/**
+ * @brief Destroys the channel and closes the socket
+ */
+DatagramChannel::~DatagramChannel(void)
+{
+#if QT_VERSION < 0x040600
+	delete this->d_ptr;
+	this->d_ptr = 0;
+#endif
+}
+
+/**
+ * @brief Takes the ownership of the datagram socket @a fd
+ * @param fd Native descriptor of a @c SOCK_DGRAM socket; it may be connected or just bound
+ * @return Whether @a fd is a datagram socket
+ *
+ * The socket which the channel owns is closed first.
+ */
+bool DatagramChannel::setSocketDescriptor(qintptr fd)
+{
+	Q_D(DatagramChannel);
+	return d->setSocketDescriptor(int(fd));
+}
+
+/**
+ * @brief Takes over the connected UDP socket of @a conn
+ * @param conn Connector in @c ConnectedState whose socket has been made by SocketConnector::createUdpSocket()
+ * @return Whether the socket has been taken over; on success @a conn enters @c UnconnectedState
+ *
+ * @see SocketConnector::releaseSocketDescriptor()
+ */
+bool DatagramChannel::takeSocket(SocketConnector* conn)
+{
+	Q_D(DatagramChannel);
+
+	if (QAbstractSocket::UdpSocket != conn->socketType()) {
+		return false;
+	}
+
+	qintptr fd = conn->releaseSocketDescriptor();
+	if (-1 == fd) {
+		return false;
+	}
+
+	if (!d->setSocketDescriptor(int(fd))) {
+		::close(int(fd));
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief Returns the native descriptor of the socket
+ * @return Socket descriptor, or -1 if the channel has no socket
+ */
+qintptr DatagramChannel::socketDescriptor(void) const
+{
+	Q_D(const DatagramChannel);
+	return d->m_fd;
+}
+
+/**
+ * @brief Closes the socket
+ */
+void DatagramChannel::close(void)
+{
+	Q_D(DatagramChannel);
+	d->close();
+}
+
+/**
+ * @brief Enables UDP generic receive offload (@c UDP_GRO)
+ * @param enable Whether the kernel may coalesce the received datagrams
+ * @return Whether the option has been set; @c false if the channel has no socket or the kernel is older than 5.0
+ *
+ * With the offload enabled, consecutive datagrams of the same size from the same sender can be received into one slot;
+ * DatagramRing::segmentSize() then tells where each of them ends. The slots should be large enough (up to 64 KiB)
+ * to benefit from it.
+ */
+bool DatagramChannel::setReceiveOffloadEnabled(bool enable)
+{
+	Q_D(DatagramChannel);
+	return d->setReceiveOffload(enable);
+}
+
+/**
+ * @brief Returns whether UDP generic receive offload is enabled
+ * @return Whether @c UDP_GRO is enabled
+ */
+bool DatagramChannel::receiveOffloadEnabled(void) const
+{
+	Q_D(const DatagramChannel);
+	return d->m_gro;
+}
+
+/**
+ * @brief Checks whether the kernel supports UDP generic segmentation offload
+ * @return Whether DatagramRing::setSegmentSize() can be used
+ */
+bool DatagramChannel::isSegmentationOffloadSupported(void)
+{
+	int fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	if (-1 == fd) {
+		return false;
+	}
+
+	int v       = 0;
+	socklen_t l = sizeof(v);
+	bool res    = (0 == ::getsockopt(fd, SOL_UDP, UDP_SEGMENT, &v, &l));
+	::close(fd);
+	return res;
+}
+
+/**
+ * @brief Sends the datagrams in @a count slots of @a ring starting with @a first
+ * @param ring Ring with the datagrams; the sizes (and the destinations) must be set
+ * @param first Index of the first slot
+ * @param count Number of slots
+ * @return Number of slots sent, 0 if the socket buffer is full, or -1 on error (see error())
+ *
+ * The slots are sent with one @c sendmmsg() call; the kernel may send fewer than @a count of them
+ * (at most 1024 per call).
+ */
+int DatagramChannel::send(DatagramRing& ring, int first, int count)
+{
+	Q_D(DatagramChannel);
+	return d->send(ring.d_func(), first, count);
+}
+
+/**
+ * @brief Receives up to @a count datagrams into the slots of @a ring starting with @a first
+ * @param ring Ring to receive into
+ * @param first Index of the first slot
+ * @param count Number of slots
+ * @return Number of datagrams received, 0 if there are none, or -1 on error (see error())
+ *
+ * The datagrams are received with one @c recvmmsg() call. For every slot filled, DatagramRing::size(),
+ * DatagramRing::segmentSize() and the sender are updated.
+ */
+int DatagramChannel::receive(DatagramRing& ring, int first, int count)
+{
+	Q_D(DatagramChannel);
+	return d->receive(ring.d_func(), first, count);
+}
+
+/**
+ * @brief Returns the last error
+ * @return Type of the last error which occurred
+ */
+QAbstractSocket::SocketError DatagramChannel::error(void) const
+{
+	Q_D(const DatagramChannel);
+	return d->m_error;
+}
+
+#include "moc_datagramchannel.cpp"
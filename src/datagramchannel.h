@@ -0,0 +1,82 @@
+#ifndef DATAGRAMCHANNEL_H
+#define DATAGRAMCHANNEL_H
+
+#include <QtCore/QObject>
+#include <QtNetwork/QAbstractSocket>
+#include <QtNetwork/QHostAddress>
+
+#if QT_VERSION < 0x050000
+typedef qptrdiff qintptr;
+#endif
+
+class DatagramChannelPrivate;
+class DatagramRingPrivate;
+class SocketConnector;
+
+class DatagramRing {
+public:
+	DatagramRing(int count, int slotSize);
+	DatagramRing(char* storage, int count, int slotSize);
+	~DatagramRing(void);
+
+	int count(void) const;
+	int slotSize(void) const;
+
+	char* data(int slot);
+	const char* data(int slot) const;
+	int size(int slot) const;
+	void setSize(int slot, int size);
+	int segmentSize(int slot) const;
+	void setSegmentSize(int slot, int size);
+
+	bool setDestination(int slot, const QHostAddress& address, quint16 port);
+	void clearDestination(int slot);
+	QHostAddress sender(int slot) const;
+	quint16 senderPort(int slot) const;
+
+private:
+	Q_DISABLE_COPY(DatagramRing)
+	Q_DECLARE_PRIVATE(DatagramRing)
+#if QT_VERSION >= 0x040600
+	QScopedPointer<DatagramRingPrivate> d_ptr;
+#else
+	DatagramRingPrivate* d_ptr;
+#endif
+
+	friend class DatagramChannel;
+};
+
+class DatagramChannel : public QObject {
+	Q_OBJECT
+public:
+	DatagramChannel(QObject* parent = 0);
+	virtual ~DatagramChannel(void);
+
+	bool setSocketDescriptor(qintptr fd);
+	bool takeSocket(SocketConnector* conn);
+	qintptr socketDescriptor(void) const;
+	void close(void);
+
+	bool setReceiveOffloadEnabled(bool enable);
+	bool receiveOffloadEnabled(void) const;
+	static bool isSegmentationOffloadSupported(void);
+
+	int send(DatagramRing& ring, int first, int count);
+	int receive(DatagramRing& ring, int first, int count);
+
+	QAbstractSocket::SocketError error(void) const;
+
+Q_SIGNALS:
+	void readyRead(void);
+
+private:
+	Q_DISABLE_COPY(DatagramChannel)
+	Q_DECLARE_PRIVATE(DatagramChannel)
+#if QT_VERSION >= 0x040600
+	QScopedPointer<DatagramChannelPrivate> d_ptr;
+#else
+	DatagramChannelPrivate* d_ptr;
+#endif
+};
+
+#endif // DATAGRAMCHANNEL_H
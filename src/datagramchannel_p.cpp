@@ -0,0 +1,252 @@
+#include <QtCore/QSocketNotifier>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <errno.h>
+#include <string.h>
+#include "datagramchannel.h"
+#include "datagramchannel_p.h"
+
+#ifndef SOL_UDP
+#	define SOL_UDP 17
+#endif
+
+#ifndef UDP_SEGMENT
+#	define UDP_SEGMENT 103
+#endif
+
+#ifndef UDP_GRO
+#	define UDP_GRO 104
+#endif
+
+DatagramRingPrivate::DatagramRingPrivate(char* storage, bool owned, int count, int slot_size)
+	: m_storage(storage), m_owned(owned), m_count(count), m_slot_size(slot_size),
+	  m_headers(count), m_iov(count), m_names(count), m_name_lengths(count), m_sizes(count), m_segments(count),
+	  m_control(count * DatagramRingPrivate::controlSpace() / int(sizeof(quint64)))
+{
+	if (count) {
+		memset(this->m_headers.data(), 0, count * sizeof(struct mmsghdr));
+	}
+
+	for (int i=0; i<count; ++i) {
+		this->m_iov[i].iov_base  = storage + qptrdiff(i) * slot_size;
+		this->m_iov[i].iov_len   = slot_size;
+		this->m_name_lengths[i]  = 0;
+		this->m_sizes[i]         = 0;
+		this->m_segments[i]      = 0;
+	}
+}
+
+DatagramRingPrivate::~DatagramRingPrivate(void)
+{
+	if (this->m_owned) {
+		delete[] this->m_storage;
+	}
+}
+
+int DatagramRingPrivate::controlSpace(void)
+{
+	// Room for one UDP_SEGMENT or UDP_GRO message, padded so that every slot stays aligned
+	return int((CMSG_SPACE(sizeof(int)) + sizeof(quint64) - 1) & ~(sizeof(quint64) - 1));
+}
+
+DatagramChannelPrivate::DatagramChannelPrivate(DatagramChannel* const q)
+	: q_ptr(q), m_fd(-1), m_notifier(0), m_gro(false), m_error(QAbstractSocket::UnknownSocketError)
+{
+}
+
+DatagramChannelPrivate::~DatagramChannelPrivate(void)
+{
+	this->close();
+}
+
+bool DatagramChannelPrivate::setSocketDescriptor(int fd)
+{
+	Q_Q(DatagramChannel);
+
+	int type    = 0;
+	socklen_t l = sizeof(type);
+	if (-1 == ::getsockopt(fd, SOL_SOCKET, SO_TYPE, &type, &l) || SOCK_DGRAM != type) {
+		this->m_error = QAbstractSocket::UnsupportedSocketOperationError;
+		return false;
+	}
+
+	this->close();
+	this->m_fd       = fd;
+	this->m_notifier = new QSocketNotifier(fd, QSocketNotifier::Read, q);
+	QObject::connect(this->m_notifier, SIGNAL(activated(int)), q, SIGNAL(readyRead()));
+	return true;
+}
+
+void DatagramChannelPrivate::close(void)
+{
+	delete this->m_notifier;
+	this->m_notifier = 0;
+	this->m_gro      = false;
+
+	if (-1 != this->m_fd) {
+		::close(this->m_fd);
+		this->m_fd = -1;
+	}
+}
+
+bool DatagramChannelPrivate::setReceiveOffload(bool enable)
+{
+	int v = enable ? 1 : 0;
+	if (-1 == this->m_fd || -1 == ::setsockopt(this->m_fd, SOL_UDP, UDP_GRO, &v, sizeof(v))) {
+		this->m_error = QAbstractSocket::UnsupportedSocketOperationError;
+		return false;
+	}
+
+	this->m_gro = enable;
+	return true;
+}
+
+int DatagramChannelPrivate::send(DatagramRingPrivate* ring, int first, int count)
+{
+	if (-1 == this->m_fd || !DatagramChannelPrivate::checkRange(ring, first, count)) {
+		this->m_error = QAbstractSocket::UnknownSocketError;
+		return -1;
+	}
+
+	const int space = DatagramRingPrivate::controlSpace() / int(sizeof(quint64));
+	for (int i=first; i<first+count; ++i) {
+		struct msghdr& h = ring->m_headers[i].msg_hdr;
+		ring->m_iov[i].iov_len = ring->m_sizes.at(i);
+
+		h.msg_iov     = &ring->m_iov[i];
+		h.msg_iovlen  = 1;
+		h.msg_name    = ring->m_name_lengths.at(i) ? &ring->m_names[i] : 0;
+		h.msg_namelen = ring->m_name_lengths.at(i);
+		h.msg_flags   = 0;
+
+		int segment = ring->m_segments.at(i);
+		if (segment > 0 && segment < ring->m_sizes.at(i)) {
+			// The kernel (or the NIC) splits the payload into datagrams of segment bytes
+			quint16 v         = quint16(segment);
+			h.msg_control     = &ring->m_control[i * space];
+			h.msg_controllen  = CMSG_SPACE(sizeof(v));
+
+			struct cmsghdr* c = CMSG_FIRSTHDR(&h);
+			c->cmsg_level     = SOL_UDP;
+			c->cmsg_type      = UDP_SEGMENT;
+			c->cmsg_len       = CMSG_LEN(sizeof(v));
+			memcpy(CMSG_DATA(c), &v, sizeof(v));
+		}
+		else {
+			h.msg_control    = 0;
+			h.msg_controllen = 0;
+		}
+	}
+
+	int n;
+	do {
+		n = ::sendmmsg(this->m_fd, count ? &ring->m_headers[first] : 0, count, MSG_DONTWAIT);
+	} while (-1 == n && EINTR == errno);
+
+	if (-1 == n) {
+		if (EAGAIN == errno || EWOULDBLOCK == errno) {
+			return 0;
+		}
+
+		this->m_error = DatagramChannelPrivate::mapError(errno);
+	}
+
+	return n;
+}
+
+int DatagramChannelPrivate::receive(DatagramRingPrivate* ring, int first, int count)
+{
+	if (-1 == this->m_fd || !DatagramChannelPrivate::checkRange(ring, first, count)) {
+		this->m_error = QAbstractSocket::UnknownSocketError;
+		return -1;
+	}
+
+	const int space = DatagramRingPrivate::controlSpace() / int(sizeof(quint64));
+	for (int i=first; i<first+count; ++i) {
+		struct msghdr& h = ring->m_headers[i].msg_hdr;
+		ring->m_iov[i].iov_len = ring->m_slot_size;
+
+		h.msg_iov        = &ring->m_iov[i];
+		h.msg_iovlen     = 1;
+		h.msg_name       = &ring->m_names[i];
+		h.msg_namelen    = sizeof(struct sockaddr_storage);
+		h.msg_control    = this->m_gro ? &ring->m_control[i * space] : 0;
+		h.msg_controllen = this->m_gro ? DatagramRingPrivate::controlSpace() : 0;
+		h.msg_flags      = 0;
+	}
+
+	int n;
+	do {
+		n = ::recvmmsg(this->m_fd, count ? &ring->m_headers[first] : 0, count, MSG_DONTWAIT, 0);
+	} while (-1 == n && EINTR == errno);
+
+	if (-1 == n) {
+		if (EAGAIN == errno || EWOULDBLOCK == errno) {
+			return 0;
+		}
+
+		this->m_error = DatagramChannelPrivate::mapError(errno);
+		return -1;
+	}
+
+	for (int i=first; i<first+n; ++i) {
+		struct msghdr& h = ring->m_headers[i].msg_hdr;
+		ring->m_sizes[i]        = int(ring->m_headers.at(i).msg_len);
+		ring->m_name_lengths[i] = h.msg_namelen;
+		ring->m_segments[i]     = 0;
+
+		if (this->m_gro) {
+			for (struct cmsghdr* c = CMSG_FIRSTHDR(&h); c; c = CMSG_NXTHDR(&h, c)) {
+				if (SOL_UDP == c->cmsg_level && UDP_GRO == c->cmsg_type) {
+					memcpy(&ring->m_segments[i], CMSG_DATA(c), sizeof(int));
+				}
+			}
+		}
+	}
+
+	return n;
+}
+
+bool DatagramChannelPrivate::checkRange(const DatagramRingPrivate* ring, int first, int count)
+{
+	return first >= 0 && count >= 0 && first <= ring->m_count && count <= ring->m_count - first;
+}
+
+QAbstractSocket::SocketError DatagramChannelPrivate::mapError(int err)
+{
+	switch (err) {
+		case ECONNREFUSED:
+			return QAbstractSocket::ConnectionRefusedError;
+
+		case EMSGSIZE:
+			return QAbstractSocket::DatagramTooLargeError;
+
+		case ENETUNREACH:
+		case EHOSTUNREACH:
+		case ENETDOWN:
+			return QAbstractSocket::NetworkError;
+
+		case EACCES:
+		case EPERM:
+			return QAbstractSocket::SocketAccessError;
+
+		case EDESTADDRREQ:
+		case ENOTCONN:
+			return QAbstractSocket::SocketAddressNotAvailableError;
+
+		case EINVAL:
+		case EIO:
+		case EOPNOTSUPP:
+			// UDP_SEGMENT with a wrong segment size or too many segments, or no checksum offload
+			return QAbstractSocket::UnsupportedSocketOperationError;
+
+		case ENOBUFS:
+		case ENOMEM:
+			return QAbstractSocket::SocketResourceError;
+
+		default:
+			return QAbstractSocket::UnknownSocketError;
+	}
+}
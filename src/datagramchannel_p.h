@@ -0,0 +1,66 @@
+#ifndef DATAGRAMCHANNEL_P_H
+#define DATAGRAMCHANNEL_P_H
+
+#include <QtCore/QVector>
+#include <sys/socket.h>
+#include "datagramchannel.h"
+#include "qt4compat.h"
+
+#if QT_VERSION >= 0x040400
+QT_FORWARD_DECLARE_CLASS(QSocketNotifier)
+#else
+class QSocketNotifier;
+#endif
+
+/*
+ * All the memory a batch needs is allocated here, once: the payloads, the message headers,
+ * the addresses and the control messages which carry the segment sizes
+ */
+class Q_DECL_HIDDEN DatagramRingPrivate {
+public:
+	DatagramRingPrivate(char* storage, bool owned, int count, int slot_size);
+	~DatagramRingPrivate(void);
+
+	static int controlSpace(void);
+
+private:
+	char* m_storage;
+	bool m_owned;
+	int m_count;
+	int m_slot_size;
+	QVector<struct mmsghdr> m_headers;
+	QVector<struct iovec> m_iov;
+	QVector<struct sockaddr_storage> m_names;
+	QVector<socklen_t> m_name_lengths;
+	QVector<int> m_sizes;
+	QVector<int> m_segments;
+	QVector<quint64> m_control;
+
+	friend class DatagramRing;
+	friend class DatagramChannelPrivate;
+};
+
+class Q_DECL_HIDDEN DatagramChannelPrivate {
+	Q_DECLARE_PUBLIC(DatagramChannel)
+	DatagramChannel* const q_ptr;
+public:
+	DatagramChannelPrivate(DatagramChannel* const q);
+	~DatagramChannelPrivate(void);
+
+	bool setSocketDescriptor(int fd);
+	void close(void);
+	bool setReceiveOffload(bool enable);
+	int send(DatagramRingPrivate* ring, int first, int count);
+	int receive(DatagramRingPrivate* ring, int first, int count);
+
+	static bool checkRange(const DatagramRingPrivate* ring, int first, int count);
+	static QAbstractSocket::SocketError mapError(int err);
+
+private:
+	int m_fd;
+	QSocketNotifier* m_notifier;
+	bool m_gro;
+	QAbstractSocket::SocketError m_error;
+};
+
+#endif // DATAGRAMCHANNEL_P_H
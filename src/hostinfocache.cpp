@@ -0,0 +1,249 @@
+#include <QtCore/QMutexLocker>
+#include "hostinfocache.h"
+#include "hostinfocache_p.h"
+
+/**
+ * @class HostInfoCache
+ *
+ * @brief The HostInfoCache class caches the results of QHostInfo::lookupHost()
+ *
+ * Successful lookups are cached for ttl() milliseconds and failed ones for negativeTtl() milliseconds.
+ * When an entry is used after refreshThreshold() percent of its lifetime has passed, it is refreshed in the background,
+ * so that the names which are in use never miss. Concurrent lookups of the same name are coalesced into one resolver request.
+ *
+ * The cache is thread-safe; the results of lookupHost() are delivered to the receivers in their threads.
+ *
+ * @see SocketConnector::setHostInfoCache()
+ */
+
+Q_GLOBAL_STATIC(HostInfoCache, globalCache)
+
+/**
+ * @brief Creates a new @c HostInfoCache
+ * @param parent Object parent
+ */
+HostInfoCache::HostInfoCache(QObject* parent)
+	: QObject(parent), d_ptr(new HostInfoCachePrivate(this))
+{
+}
+
+/**
+ * @brief Destroys the @c HostInfoCache
+ */
+HostInfoCache::~HostInfoCache(void)
+{
+#if QT_VERSION < 0x040600
+	delete this->d_ptr;
+	this->d_ptr = 0;
+#endif
+}
+
+/**
+ * @brief Returns the process-wide cache instance
+ * @return Shared cache
+ *
+ * The instance lives in the thread which calls this function first; that thread must run an event loop.
+ */
+HostInfoCache* HostInfoCache::globalInstance(void)
+{
+	return globalCache();
+}
+
+/**
+ * @brief Looks up @a name in the cache
+ * @param name Host name
+ * @param info Receives the cached result on success
+ * @return Whether the cache has a valid entry for @a name
+ *
+ * The cached result may be negative, i.e. @c info->error() is not @c QHostInfo::NoError.
+ */
+bool HostInfoCache::cachedHostInfo(const QString& name, QHostInfo* info)
+{
+	Q_D(HostInfoCache);
+	return d->cachedHostInfo(name, info);
+}
+
+/**
+ * @brief Looks up @a name and caches the result
+ * @param name Host name
+ * @param receiver Object to receive the result
+ * @param member Slot (e.g., @c SLOT(lookedUp(QHostInfo))) to be invoked with the result
+ * @return Lookup ID which can be passed to abortHostLookup()
+ *
+ * Unlike QHostInfo::lookupHost(), the cache is not consulted: call cachedHostInfo() first.
+ * If there is already a lookup of @a name in progress, no new request is made and the receiver gets the result of that lookup.
+ */
+int HostInfoCache::lookupHost(const QString& name, QObject* receiver, const char* member)
+{
+	Q_D(HostInfoCache);
+	return d->lookupHost(name, receiver, member);
+}
+
+/**
+ * @brief Aborts the lookup with the ID @a id
+ * @param id Lookup ID returned by lookupHost()
+ *
+ * The receiver will not be notified; the result of the lookup is still cached.
+ */
+void HostInfoCache::abortHostLookup(int id)
+{
+	Q_D(HostInfoCache);
+	d->abortHostLookup(id);
+}
+
+/**
+ * @brief Removes all entries from the cache
+ */
+void HostInfoCache::clear(void)
+{
+	Q_D(HostInfoCache);
+	d->clear();
+}
+
+/**
+ * @brief Stores @a info as the lookup result for @a name
+ * @param name Host name
+ * @param info Lookup result
+ *
+ * The entry expires like a resolver result. This can be used to preload the cache, e.g. from a static host list.
+ */
+void HostInfoCache::insert(const QString& name, const QHostInfo& info)
+{
+	Q_D(HostInfoCache);
+	d->insert(name, info);
+}
+
+/**
+ * @brief Sets the lifetime of the successful lookup results
+ * @param ttl Lifetime (msec); the default is 60000
+ */
+void HostInfoCache::setTtl(uint ttl)
+{
+	Q_D(HostInfoCache);
+	QMutexLocker locker(&d->m_mutex);
+	d->m_ttl = ttl;
+}
+
+/**
+ * @brief Returns the lifetime of the successful lookup results
+ * @return Lifetime (msec)
+ */
+uint HostInfoCache::ttl(void) const
+{
+	Q_D(const HostInfoCache);
+	QMutexLocker locker(&d->m_mutex);
+	return d->m_ttl;
+}
+
+/**
+ * @brief Sets the lifetime of the failed lookup results
+ * @param ttl Lifetime (msec); the default is 5000
+ */
+void HostInfoCache::setNegativeTtl(uint ttl)
+{
+	Q_D(HostInfoCache);
+	QMutexLocker locker(&d->m_mutex);
+	d->m_negative_ttl = ttl;
+}
+
+/**
+ * @brief Returns the lifetime of the failed lookup results
+ * @return Lifetime (msec)
+ */
+uint HostInfoCache::negativeTtl(void) const
+{
+	Q_D(const HostInfoCache);
+	QMutexLocker locker(&d->m_mutex);
+	return d->m_negative_ttl;
+}
+
+/**
+ * @brief Sets the age (in percent of ttl()) after which a used entry is refreshed in the background
+ * @param percent Percentage, 80 by default; 100 disables the background refresh
+ */
+void HostInfoCache::setRefreshThreshold(uint percent)
+{
+	Q_D(HostInfoCache);
+	QMutexLocker locker(&d->m_mutex);
+	d->m_refresh_threshold = qMin(percent, 100u);
+}
+
+/**
+ * @brief Returns the age (in percent of ttl()) after which a used entry is refreshed in the background
+ * @return Percentage
+ */
+uint HostInfoCache::refreshThreshold(void) const
+{
+	Q_D(const HostInfoCache);
+	QMutexLocker locker(&d->m_mutex);
+	return d->m_refresh_threshold;
+}
+
+/**
+ * @brief Returns the number of cachedHostInfo() calls which found a valid entry
+ * @return Number of hits
+ */
+quint64 HostInfoCache::hits(void) const
+{
+	Q_D(const HostInfoCache);
+	QMutexLocker locker(&d->m_mutex);
+	return d->m_hits;
+}
+
+/**
+ * @brief Returns the number of cachedHostInfo() calls which found no valid entry
+ * @return Number of misses
+ */
+quint64 HostInfoCache::misses(void) const
+{
+	Q_D(const HostInfoCache);
+	QMutexLocker locker(&d->m_mutex);
+	return d->m_misses;
+}
+
+/**
+ * @brief Returns the ratio of hits to all cachedHostInfo() calls
+ * @return Hit rate, from 0 to 1
+ */
+qreal HostInfoCache::hitRate(void) const
+{
+	Q_D(const HostInfoCache);
+	QMutexLocker locker(&d->m_mutex);
+	quint64 total = d->m_hits + d->m_misses;
+	return total ? qreal(d->m_hits) / qreal(total) : qreal(0);
+}
+
+/**
+ * @brief Returns the number of completed resolver lookups
+ * @return Number of lookups
+ */
+quint64 HostInfoCache::lookupCount(void) const
+{
+	Q_D(const HostInfoCache);
+	QMutexLocker locker(&d->m_mutex);
+	return d->m_lookup_count;
+}
+
+/**
+ * @brief Returns the average duration of the resolver lookups
+ * @return Average duration (msec)
+ */
+qreal HostInfoCache::averageLookupTime(void) const
+{
+	Q_D(const HostInfoCache);
+	QMutexLocker locker(&d->m_mutex);
+	return d->m_lookup_count ? qreal(d->m_lookup_time) / qreal(d->m_lookup_count) : qreal(0);
+}
+
+/**
+ * @brief Returns the duration of the slowest resolver lookup
+ * @return Duration (msec)
+ */
+qint64 HostInfoCache::maxLookupTime(void) const
+{
+	Q_D(const HostInfoCache);
+	QMutexLocker locker(&d->m_mutex);
+	return d->m_max_lookup_time;
+}
+
+#include "moc_hostinfocache.cpp"
@@ -0,0 +1,49 @@
+#ifndef HOSTINFOCACHE_H
+#define HOSTINFOCACHE_H
+
+#include <QtCore/QObject>
+#include <QtNetwork/QHostInfo>
+
+class HostInfoCachePrivate;
+
+class HostInfoCache : public QObject {
+	Q_OBJECT
+public:
+	HostInfoCache(QObject* parent = 0);
+	virtual ~HostInfoCache(void);
+
+	static HostInfoCache* globalInstance(void);
+
+	bool cachedHostInfo(const QString& name, QHostInfo* info);
+	int lookupHost(const QString& name, QObject* receiver, const char* member);
+	void abortHostLookup(int id);
+	void clear(void);
+	void insert(const QString& name, const QHostInfo& info);
+
+	void setTtl(uint ttl);
+	uint ttl(void) const;
+	void setNegativeTtl(uint ttl);
+	uint negativeTtl(void) const;
+	void setRefreshThreshold(uint percent);
+	uint refreshThreshold(void) const;
+
+	quint64 hits(void) const;
+	quint64 misses(void) const;
+	qreal hitRate(void) const;
+	quint64 lookupCount(void) const;
+	qreal averageLookupTime(void) const;
+	qint64 maxLookupTime(void) const;
+
+private:
+	Q_DISABLE_COPY(HostInfoCache)
+	Q_DECLARE_PRIVATE(HostInfoCache)
+#if QT_VERSION >= 0x040600
+	QScopedPointer<HostInfoCachePrivate> d_ptr;
+#else
+	HostInfoCachePrivate* d_ptr;
+#endif
+
+	Q_PRIVATE_SLOT(d_func(), void _q_lookedUp(QHostInfo))
+};
+
+#endif // HOSTINFOCACHE_H
@@ -0,0 +1,203 @@
+#include <QtCore/QMetaObject>
+#include <QtCore/QMutexLocker>
+#include <climits>
+#include "hostinfocache.h"
+#include "hostinfocache_p.h"
+
+HostInfoCachePrivate::HostInfoCachePrivate(HostInfoCache* const q)
+	: q_ptr(q),
+#if QT_VERSION >= 0x050E00
+	  m_mutex(),
+#else
+	  m_mutex(QMutex::Recursive),
+#endif
+	  m_clock(), m_entries(), m_flights(), m_lookups(), m_next_sweep(0), m_next_id(1),
+	  m_ttl(60000), m_negative_ttl(5000), m_refresh_threshold(80),
+	  m_hits(0), m_misses(0), m_lookup_count(0), m_lookup_time(0), m_max_lookup_time(0)
+{
+	this->m_clock.start();
+}
+
+bool HostInfoCachePrivate::cachedHostInfo(const QString& name, QHostInfo* info)
+{
+	QMutexLocker locker(&this->m_mutex);
+
+	qint64 now = this->m_clock.elapsed();
+	QHash<QString, Entry>::Iterator it = this->m_entries.find(name);
+	if (it == this->m_entries.end() || now >= it->expires_at) {
+		if (it != this->m_entries.end()) {
+			this->m_entries.erase(it);
+		}
+
+		++this->m_misses;
+		return false;
+	}
+
+	++this->m_hits;
+	*info = it->info;
+
+	// Refresh ahead of expiry so that the hot names never miss; the entry stays valid meanwhile
+	if (now >= it->refresh_at && !this->m_flights.contains(name)) {
+		this->startLookup(name);
+	}
+
+	return true;
+}
+
+int HostInfoCachePrivate::lookupHost(const QString& name, QObject* receiver, const char* member)
+{
+	QMutexLocker locker(&this->m_mutex);
+
+	Waiter w;
+	w.id       = this->m_next_id;
+	w.receiver = receiver;
+	w.method   = QByteArray(member + 1); // Skip the SLOT()/SIGNAL() code
+	w.method.truncate(w.method.indexOf('('));
+
+	this->m_next_id = (this->m_next_id < INT_MAX) ? this->m_next_id + 1 : 1;
+	this->m_lookups.insert(w.id, name);
+
+	QHash<QString, Flight>::Iterator it = this->m_flights.find(name);
+	if (it != this->m_flights.end()) {
+		it->waiters.append(w);
+	}
+	else {
+		Flight f;
+		f.lookup_id = -1;
+		f.started   = this->m_clock.elapsed();
+		f.waiters.append(w);
+		this->m_flights.insert(name, f);
+		this->startLookup(name);
+	}
+
+	return w.id;
+}
+
+void HostInfoCachePrivate::abortHostLookup(int id)
+{
+	QMutexLocker locker(&this->m_mutex);
+
+	QString name = this->m_lookups.take(id);
+	QHash<QString, Flight>::Iterator it = this->m_flights.find(name);
+	if (it == this->m_flights.end()) {
+		return;
+	}
+
+	// The resolver lookup itself keeps running: its result is still useful for the cache
+	QList<Waiter>& waiters = it->waiters;
+	for (int i=0; i<waiters.size(); ++i) {
+		if (waiters.at(i).id == id) {
+			waiters.removeAt(i);
+			break;
+		}
+	}
+}
+
+void HostInfoCachePrivate::clear(void)
+{
+	QMutexLocker locker(&this->m_mutex);
+	this->m_entries.clear();
+}
+
+void HostInfoCachePrivate::insert(const QString& name, const QHostInfo& info)
+{
+	QMutexLocker locker(&this->m_mutex);
+	this->store(name, info, this->m_clock.elapsed());
+}
+
+void HostInfoCachePrivate::store(const QString& name, const QHostInfo& info, qint64 now)
+{
+	bool ok = QHostInfo::NoError == info.error() && !info.addresses().isEmpty();
+
+	Entry e;
+	e.info       = info;
+	e.expires_at = now + (ok ? this->m_ttl : this->m_negative_ttl);
+	e.refresh_at = ok ? now + qint64(this->m_ttl) * this->m_refresh_threshold / 100 : e.expires_at;
+	this->m_entries.insert(name, e);
+	this->sweep(now);
+}
+
+void HostInfoCachePrivate::sweep(qint64 now)
+{
+	// The names which are never looked up again would stay forever: drop the expired entries once per TTL
+	if (now < this->m_next_sweep) {
+		return;
+	}
+
+	this->m_next_sweep = now + qMax(this->m_ttl, this->m_negative_ttl);
+
+	QHash<QString, Entry>::Iterator it = this->m_entries.begin();
+	while (it != this->m_entries.end()) {
+		if (now >= it->expires_at) {
+			it = this->m_entries.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+}
+
+void HostInfoCachePrivate::startLookup(const QString& name)
+{
+	Q_Q(HostInfoCache);
+
+	if (!this->m_flights.contains(name)) {
+		Flight f;
+		f.lookup_id = -1;
+		f.started   = this->m_clock.elapsed();
+		this->m_flights.insert(name, f);
+	}
+
+	// The result may be delivered synchronously, hence the flight is registered beforehand
+	int id = QHostInfo::lookupHost(name, q, SLOT(_q_lookedUp(QHostInfo)));
+
+	QHash<QString, Flight>::Iterator it = this->m_flights.find(name);
+	if (it != this->m_flights.end()) {
+		it->lookup_id = id;
+	}
+}
+
+void HostInfoCachePrivate::_q_lookedUp(const QHostInfo& info)
+{
+	QList<Waiter> waiters;
+
+	{
+		QMutexLocker locker(&this->m_mutex);
+
+		QString name = info.hostName();
+		qint64 now   = this->m_clock.elapsed();
+
+		QHash<QString, Flight>::Iterator it = this->m_flights.find(name);
+		if (it != this->m_flights.end()) {
+			qint64 elapsed = now - it->started;
+			++this->m_lookup_count;
+			this->m_lookup_time += elapsed;
+			this->m_max_lookup_time = qMax(this->m_max_lookup_time, elapsed);
+
+			waiters = it->waiters;
+			for (int i=0; i<waiters.size(); ++i) {
+				this->m_lookups.remove(waiters.at(i).id);
+			}
+
+			this->m_flights.erase(it);
+		}
+
+		bool ok = QHostInfo::NoError == info.error() && !info.addresses().isEmpty();
+		QHash<QString, Entry>::ConstIterator ci = this->m_entries.constFind(name);
+		bool have_positive = ci != this->m_entries.constEnd() && now < ci->expires_at && !ci->info.addresses().isEmpty();
+
+		// A failed refresh does not evict an entry which is still valid
+		if (ok || !have_positive) {
+			this->store(name, info, now);
+		}
+	}
+
+	for (int i=0; i<waiters.size(); ++i) {
+		const Waiter& w = waiters.at(i);
+		if (w.receiver) {
+			QHostInfo copy(info);
+			copy.setLookupId(w.id);
+			QMetaObject::invokeMethod(w.receiver, w.method.constData(), Qt::AutoConnection, Q_ARG(QHostInfo, copy));
+		}
+	}
+}
@@ -0,0 +1,74 @@
+#ifndef HOSTINFOCACHE_P_H
+#define HOSTINFOCACHE_P_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QPointer>
+#include <QtNetwork/QHostInfo>
+#include "qt4compat.h"
+
+class HostInfoCache;
+
+class Q_DECL_HIDDEN HostInfoCachePrivate {
+	Q_DECLARE_PUBLIC(HostInfoCache)
+	HostInfoCache* const q_ptr;
+public:
+	HostInfoCachePrivate(HostInfoCache* const q);
+
+	bool cachedHostInfo(const QString& name, QHostInfo* info);
+	int lookupHost(const QString& name, QObject* receiver, const char* member);
+	void abortHostLookup(int id);
+	void clear(void);
+	void insert(const QString& name, const QHostInfo& info);
+
+private:
+	struct Entry {
+		QHostInfo info;
+		qint64 refresh_at;
+		qint64 expires_at;
+	};
+
+	struct Waiter {
+		int id;
+		QPointer<QObject> receiver;
+		QByteArray method;
+	};
+
+	struct Flight {
+		int lookup_id;
+		qint64 started;
+		QList<Waiter> waiters;
+	};
+
+	// The resolver may deliver the result synchronously, into _q_lookedUp(), while the lock is held
+#if QT_VERSION >= 0x050E00
+	mutable QRecursiveMutex m_mutex;
+#else
+	mutable QMutex m_mutex;
+#endif
+	QElapsedTimer m_clock;
+	QHash<QString, Entry> m_entries;
+	QHash<QString, Flight> m_flights;
+	QHash<int, QString> m_lookups;
+	qint64 m_next_sweep;
+	int m_next_id;
+	uint m_ttl;
+	uint m_negative_ttl;
+	uint m_refresh_threshold;
+	quint64 m_hits;
+	quint64 m_misses;
+	quint64 m_lookup_count;
+	qint64 m_lookup_time;
+	qint64 m_max_lookup_time;
+
+	void startLookup(const QString& name);
+	void store(const QString& name, const QHostInfo& info, qint64 now);
+	void sweep(qint64 now);
+
+	void _q_lookedUp(const QHostInfo& info);
+};
+
+#endif // HOSTINFOCACHE_P_H
@@ -0,0 +1,303 @@
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "iouring_p.h"
+
+#ifndef __NR_io_uring_setup
+#	define __NR_io_uring_setup    425
+#	define __NR_io_uring_enter    426
+#	define __NR_io_uring_register 427
+#endif
+
+static int io_uring_setup(unsigned int entries, struct io_uring_params* p)
+{
+	return int(::syscall(__NR_io_uring_setup, entries, p));
+}
+
+static int io_uring_enter(int fd, unsigned int to_submit, unsigned int min_complete, unsigned int flags)
+{
+	return int(::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, 0, 0));
+}
+
+static int io_uring_register(int fd, unsigned int opcode, void* arg, unsigned int nr_args)
+{
+	return int(::syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+IoUring::IoUring(void)
+	: m_fd(-1), m_sq_ring(MAP_FAILED), m_sq_ring_size(0), m_cq_ring(MAP_FAILED), m_cq_ring_size(0), m_sqes(0), m_sqes_size(0),
+	  m_sq_head(0), m_sq_tail(0), m_sq_flags(0), m_sq_array(0), m_sq_mask(0), m_sq_entries(0), m_sqe_tail(0),
+	  m_cq_head(0), m_cq_tail(0), m_cq_mask(0), m_cqes(0)
+{
+	memset(this->m_supported, 0, sizeof(this->m_supported));
+}
+
+IoUring::~IoUring(void)
+{
+	this->release();
+}
+
+bool IoUring::setup(unsigned int entries, unsigned int cq_entries)
+{
+	this->release();
+
+	struct io_uring_params p;
+	memset(&p, 0, sizeof(p));
+	p.flags      = IORING_SETUP_CQSIZE;
+	p.cq_entries = cq_entries;
+
+	this->m_fd = io_uring_setup(entries, &p);
+	if (-1 == this->m_fd) {
+		return false;
+	}
+
+	this->m_sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+	this->m_cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		this->m_sq_ring_size = qMax(this->m_sq_ring_size, this->m_cq_ring_size);
+		this->m_cq_ring_size = this->m_sq_ring_size;
+	}
+
+	this->m_sq_ring = ::mmap(0, this->m_sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->m_fd, IORING_OFF_SQ_RING);
+	if (MAP_FAILED == this->m_sq_ring) {
+		this->release();
+		return false;
+	}
+
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		this->m_cq_ring = this->m_sq_ring;
+	}
+	else {
+		this->m_cq_ring = ::mmap(0, this->m_cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->m_fd, IORING_OFF_CQ_RING);
+		if (MAP_FAILED == this->m_cq_ring) {
+			this->release();
+			return false;
+		}
+	}
+
+	this->m_sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+	void* sqes = ::mmap(0, this->m_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->m_fd, IORING_OFF_SQES);
+	if (MAP_FAILED == sqes) {
+		this->release();
+		return false;
+	}
+
+	char* sq = static_cast<char*>(this->m_sq_ring);
+	char* cq = static_cast<char*>(this->m_cq_ring);
+
+	this->m_sqes       = static_cast<struct io_uring_sqe*>(sqes);
+	this->m_sq_head    = reinterpret_cast<unsigned int*>(sq + p.sq_off.head);
+	this->m_sq_tail    = reinterpret_cast<unsigned int*>(sq + p.sq_off.tail);
+	this->m_sq_flags   = reinterpret_cast<unsigned int*>(sq + p.sq_off.flags);
+	this->m_sq_array   = reinterpret_cast<unsigned int*>(sq + p.sq_off.array);
+	this->m_sq_mask    = *reinterpret_cast<unsigned int*>(sq + p.sq_off.ring_mask);
+	this->m_sq_entries = p.sq_entries;
+	this->m_sqe_tail   = *this->m_sq_tail;
+
+	this->m_cq_head = reinterpret_cast<unsigned int*>(cq + p.cq_off.head);
+	this->m_cq_tail = reinterpret_cast<unsigned int*>(cq + p.cq_off.tail);
+	this->m_cq_mask = *reinterpret_cast<unsigned int*>(cq + p.cq_off.ring_mask);
+	this->m_cqes    = reinterpret_cast<struct io_uring_cqe*>(cq + p.cq_off.cqes);
+
+	this->probe();
+	return true;
+}
+
+bool IoUring::isValid(void) const
+{
+	return -1 != this->m_fd;
+}
+
+bool IoUring::registerEventFd(int fd)
+{
+	return 0 == io_uring_register(this->m_fd, IORING_REGISTER_EVENTFD, &fd, 1);
+}
+
+bool IoUring::isSupported(int op) const
+{
+	return op >= 0 && op < IORING_OP_LAST && this->m_supported[op];
+}
+
+bool IoUring::reserve(unsigned int n)
+{
+	// A linked chain must not be split between two submissions
+	unsigned int head = __atomic_load_n(this->m_sq_head, __ATOMIC_ACQUIRE);
+	if (this->m_sq_entries - (this->m_sqe_tail - head) >= n) {
+		return true;
+	}
+
+	if (this->submit() < 0) {
+		return false;
+	}
+
+	head = __atomic_load_n(this->m_sq_head, __ATOMIC_ACQUIRE);
+	return this->m_sq_entries - (this->m_sqe_tail - head) >= n;
+}
+
+struct io_uring_sqe* IoUring::nextSqe(void)
+{
+	unsigned int head = __atomic_load_n(this->m_sq_head, __ATOMIC_ACQUIRE);
+	if (this->m_sqe_tail - head >= this->m_sq_entries) {
+		// The ring is full: hand the prepared entries over to the kernel first
+		if (this->submit() < 0) {
+			return 0;
+		}
+
+		head = __atomic_load_n(this->m_sq_head, __ATOMIC_ACQUIRE);
+		if (this->m_sqe_tail - head >= this->m_sq_entries) {
+			return 0;
+		}
+	}
+
+	unsigned int idx = this->m_sqe_tail & this->m_sq_mask;
+	struct io_uring_sqe* sqe = &this->m_sqes[idx];
+	memset(sqe, 0, sizeof(*sqe));
+	this->m_sq_array[idx] = idx;
+	++this->m_sqe_tail;
+	return sqe;
+}
+
+int IoUring::submit(unsigned int wait_nr)
+{
+	__atomic_store_n(this->m_sq_tail, this->m_sqe_tail, __ATOMIC_RELEASE);
+
+	// The entries the kernel has not consumed yet (after EAGAIN or EBUSY) are passed again
+	unsigned int pending = this->m_sqe_tail - __atomic_load_n(this->m_sq_head, __ATOMIC_ACQUIRE);
+
+	// Entering with IORING_ENTER_GETEVENTS also moves the overflown completions back to the ring
+	unsigned int flags = (wait_nr || this->hasOverflow()) ? IORING_ENTER_GETEVENTS : 0;
+	if (!pending && !flags) {
+		return 0;
+	}
+
+	int res;
+	do {
+		res = io_uring_enter(this->m_fd, pending, wait_nr, flags);
+	} while (-1 == res && EINTR == errno);
+
+	return res;
+}
+
+struct io_uring_cqe* IoUring::peekCqe(void)
+{
+	unsigned int head = *this->m_cq_head;
+	if (head == __atomic_load_n(this->m_cq_tail, __ATOMIC_ACQUIRE)) {
+		return 0;
+	}
+
+	return &this->m_cqes[head & this->m_cq_mask];
+}
+
+void IoUring::cqeSeen(void)
+{
+	__atomic_store_n(this->m_cq_head, *this->m_cq_head + 1, __ATOMIC_RELEASE);
+}
+
+bool IoUring::hasOverflow(void) const
+{
+	return 0 != (__atomic_load_n(this->m_sq_flags, __ATOMIC_RELAXED) & IORING_SQ_CQ_OVERFLOW);
+}
+
+bool IoUring::hasSocketOps(void) const
+{
+	return this->isSupported(IORING_OP_SOCKET)
+		&& this->isSupported(IORING_OP_CONNECT)
+		&& this->isSupported(IORING_OP_LINK_TIMEOUT)
+		&& this->isSupported(IORING_OP_CLOSE)
+		&& this->isSupported(IORING_OP_ASYNC_CANCEL)
+	;
+}
+
+bool IoUring::isAvailable(void)
+{
+	// io_uring may be missing from the kernel, disabled by the kernel.io_uring_disabled sysctl, or blocked by seccomp
+	IoUring ring;
+	return ring.setup(2, 4) && ring.hasSocketOps();
+}
+
+void IoUring::prepSocket(struct io_uring_sqe* sqe, int domain, int type, int proto, quint64 data)
+{
+	sqe->opcode    = IORING_OP_SOCKET;
+	sqe->fd        = domain;
+	sqe->off       = type;
+	sqe->len       = proto;
+	sqe->user_data = data;
+}
+
+void IoUring::prepConnect(struct io_uring_sqe* sqe, int fd, const struct sockaddr* sa, socklen_t len, quint64 data)
+{
+	sqe->opcode    = IORING_OP_CONNECT;
+	sqe->fd        = fd;
+	sqe->addr      = reinterpret_cast<quint64>(sa);
+	sqe->off       = len;
+	sqe->user_data = data;
+}
+
+void IoUring::prepLinkTimeout(struct io_uring_sqe* sqe, const struct __kernel_timespec* ts, quint64 data)
+{
+	sqe->opcode    = IORING_OP_LINK_TIMEOUT;
+	sqe->fd        = -1;
+	sqe->addr      = reinterpret_cast<quint64>(ts);
+	sqe->len       = 1;
+	sqe->user_data = data;
+}
+
+void IoUring::prepClose(struct io_uring_sqe* sqe, int fd, quint64 data)
+{
+	sqe->opcode    = IORING_OP_CLOSE;
+	sqe->fd        = fd;
+	sqe->user_data = data;
+}
+
+void IoUring::prepCancel(struct io_uring_sqe* sqe, quint64 target, quint64 data)
+{
+	sqe->opcode    = IORING_OP_ASYNC_CANCEL;
+	sqe->fd        = -1;
+	sqe->addr      = target;
+	sqe->user_data = data;
+}
+
+void IoUring::release(void)
+{
+	if (this->m_sqes) {
+		::munmap(this->m_sqes, this->m_sqes_size);
+		this->m_sqes = 0;
+	}
+
+	if (MAP_FAILED != this->m_cq_ring && this->m_cq_ring != this->m_sq_ring) {
+		::munmap(this->m_cq_ring, this->m_cq_ring_size);
+	}
+
+	if (MAP_FAILED != this->m_sq_ring) {
+		::munmap(this->m_sq_ring, this->m_sq_ring_size);
+	}
+
+	this->m_sq_ring = MAP_FAILED;
+	this->m_cq_ring = MAP_FAILED;
+
+	if (-1 != this->m_fd) {
+		::close(this->m_fd);
+		this->m_fd = -1;
+	}
+}
+
+void IoUring::probe(void)
+{
+	const unsigned int n = IORING_OP_LAST;
+	size_t size = sizeof(struct io_uring_probe) + n * sizeof(struct io_uring_probe_op);
+	struct io_uring_probe* p = static_cast<struct io_uring_probe*>(::calloc(1, size));
+	if (!p) {
+		return;
+	}
+
+	if (0 == io_uring_register(this->m_fd, IORING_REGISTER_PROBE, p, n)) {
+		for (unsigned int i=0; i<p->ops_len && i<n; ++i) {
+			this->m_supported[i] = (p->ops[i].flags & IO_URING_OP_SUPPORTED) ? 1 : 0;
+		}
+	}
+
+	::free(p);
+}
@@ -0,0 +1,69 @@
+#ifndef IOURING_P_H
+#define IOURING_P_H
+
+#include <QtCore/QtGlobal>
+#include <linux/io_uring.h>
+#include <sys/socket.h>
+#include <stddef.h>
+#include "qt4compat.h"
+
+/*
+ * A minimal io_uring: the rings are set up and driven with the raw system calls, so that there is no dependency on liburing
+ */
+class Q_DECL_HIDDEN IoUring {
+public:
+	IoUring(void);
+	~IoUring(void);
+
+	bool setup(unsigned int entries, unsigned int cq_entries);
+	bool isValid(void) const;
+	bool registerEventFd(int fd);
+	bool isSupported(int op) const;
+	bool hasSocketOps(void) const;
+
+	bool reserve(unsigned int n);
+	struct io_uring_sqe* nextSqe(void);
+	int submit(unsigned int wait_nr = 0);
+	struct io_uring_cqe* peekCqe(void);
+	void cqeSeen(void);
+	bool hasOverflow(void) const;
+
+	static bool isAvailable(void);
+
+	static void prepSocket(struct io_uring_sqe* sqe, int domain, int type, int proto, quint64 data);
+	static void prepConnect(struct io_uring_sqe* sqe, int fd, const struct sockaddr* sa, socklen_t len, quint64 data);
+	static void prepLinkTimeout(struct io_uring_sqe* sqe, const struct __kernel_timespec* ts, quint64 data);
+	static void prepClose(struct io_uring_sqe* sqe, int fd, quint64 data);
+	static void prepCancel(struct io_uring_sqe* sqe, quint64 target, quint64 data);
+
+private:
+	Q_DISABLE_COPY(IoUring)
+
+	int m_fd;
+	void* m_sq_ring;
+	size_t m_sq_ring_size;
+	void* m_cq_ring;
+	size_t m_cq_ring_size;
+	struct io_uring_sqe* m_sqes;
+	size_t m_sqes_size;
+
+	unsigned int* m_sq_head;
+	unsigned int* m_sq_tail;
+	unsigned int* m_sq_flags;
+	unsigned int* m_sq_array;
+	unsigned int m_sq_mask;
+	unsigned int m_sq_entries;
+	unsigned int m_sqe_tail;
+
+	unsigned int* m_cq_head;
+	unsigned int* m_cq_tail;
+	unsigned int m_cq_mask;
+	struct io_uring_cqe* m_cqes;
+
+	unsigned char m_supported[IORING_OP_LAST];
+
+	void release(void);
+	void probe(void);
+};
+
+#endif // IOURING_P_H
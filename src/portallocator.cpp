@@ -0,0 +1,181 @@
+#include <QtCore/QMutexLocker>
+#include "portallocator.h"
+
+// The cursors of the destinations not seen since the previous sweep are dropped when there are this many
+static const int max_cursors = 4096;
+
+/**
+ * @class PortAllocator
+ *
+ * @brief The PortAllocator class assigns local ports for the connections from a bound address
+ *
+ * When a socket is bound to an address with port 0, the kernel has to reserve a port which is unique for that address
+ * without knowing the destination, so one local address cannot have more outgoing connections than there are
+ * ephemeral ports. However, a connection is identified by the 4-tuple (local address, local port, remote address, remote port),
+ * so the same local port can be used for connections to different destinations.
+ *
+ * PortAllocator keeps a cursor per (local address, destination) and hands out the ports of its range in a round-robin fashion
+ * (the cursors of the destinations which have not been connected to for a while are dropped, so the memory use is bounded);
+ * SocketConnector binds the socket only when the destination address is known and sets @c SO_REUSEADDR so that the kernel
+ * lets several sockets share the local port. If the 4-tuple is still in use, the kernel rejects the connection with
+ * @c EADDRNOTAVAIL, and the connector retries with the next port (this is counted as a conflict).
+ *
+ * The class is thread-safe and can be shared by any number of connectors.
+ *
+ * @see SocketConnector::setPortAllocator()
+ */
+
+/**
+ * @brief Creates an allocator for the port range [@a first, @a last]
+ * @param first First port of the range
+ * @param last Last port of the range
+ */
+PortAllocator::PortAllocator(quint16 first, quint16 last)
+	: m_mutex(), m_first(qMax(quint16(1), qMin(first, last))), m_last(qMax(first, last)),
+	  m_cursors(), m_generation(0), m_handed_out(), m_allocations(0), m_reuses(0), m_conflicts(0), m_exhaustions(0)
+{
+}
+
+/**
+ * @brief Returns the first port of the range
+ * @return Port
+ */
+quint16 PortAllocator::firstPort(void) const
+{
+	return this->m_first;
+}
+
+/**
+ * @brief Returns the last port of the range
+ * @return Port
+ */
+quint16 PortAllocator::lastPort(void) const
+{
+	return this->m_last;
+}
+
+/**
+ * @brief Returns the next local port for a connection from @a local to @a remote:@a remote_port
+ * @param local Local address
+ * @param remote Remote address
+ * @param remote_port Remote port
+ * @return Local port
+ */
+quint16 PortAllocator::allocate(const QHostAddress& local, const QHostAddress& remote, quint16 remote_port)
+{
+	QMutexLocker locker(&this->m_mutex);
+
+	quint32 range    = quint32(this->m_last) - quint32(this->m_first) + 1;
+	QString local_id = local.toString();
+	QString dest_id  = local_id + QLatin1Char('|') + remote.toString() + QLatin1Char('|') + QString::number(remote_port);
+
+	QHash<QString, Cursor>::Iterator it = this->m_cursors.find(dest_id);
+	if (it == this->m_cursors.end()) {
+		if (this->m_cursors.size() >= max_cursors) {
+			this->sweepCursors();
+		}
+
+		// Different destinations start at different offsets so that they do not walk the range in lockstep
+		Cursor c = { quint32(qHash(dest_id) % range), this->m_generation };
+		it = this->m_cursors.insert(dest_id, c);
+	}
+
+	quint32 offset = it->offset;
+	it->offset     = (offset + 1) % range;
+	it->generation = this->m_generation;
+
+	QBitArray& used = this->m_handed_out[local_id];
+	if (quint32(used.size()) != range) {
+		used.resize(int(range));
+	}
+
+	if (used.testBit(int(offset))) {
+		++this->m_reuses;
+	}
+	else {
+		used.setBit(int(offset));
+	}
+
+	++this->m_allocations;
+	return quint16(this->m_first + offset);
+}
+
+void PortAllocator::sweepCursors(void)
+{
+	// A dropped cursor starts over from the offset of its destination: at worst, a port is tried again and conflicts
+	QHash<QString, Cursor>::Iterator it = this->m_cursors.begin();
+	while (it != this->m_cursors.end()) {
+		if (it->generation != this->m_generation) {
+			it = this->m_cursors.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+
+	if (this->m_cursors.size() >= max_cursors) {
+		this->m_cursors.clear();
+	}
+
+	++this->m_generation;
+}
+
+/**
+ * @brief Records that the kernel rejected an allocated port because the 4-tuple was in use
+ */
+void PortAllocator::reportConflict(void)
+{
+	QMutexLocker locker(&this->m_mutex);
+	++this->m_conflicts;
+}
+
+/**
+ * @brief Records that a connection attempt failed because no usable port was found
+ */
+void PortAllocator::reportExhausted(void)
+{
+	QMutexLocker locker(&this->m_mutex);
+	++this->m_exhaustions;
+}
+
+/**
+ * @brief Returns the number of ports handed out
+ * @return Number of allocations
+ */
+quint64 PortAllocator::allocations(void) const
+{
+	QMutexLocker locker(&this->m_mutex);
+	return this->m_allocations;
+}
+
+/**
+ * @brief Returns the number of allocations of a port which had already been handed out for the same local address
+ * @return Number of reuses
+ *
+ * Every reuse is a connection which would have needed one more ephemeral port without the allocator.
+ */
+quint64 PortAllocator::reuses(void) const
+{
+	QMutexLocker locker(&this->m_mutex);
+	return this->m_reuses;
+}
+
+/**
+ * @brief Returns the number of allocated ports rejected by the kernel
+ * @return Number of conflicts
+ */
+quint64 PortAllocator::conflicts(void) const
+{
+	QMutexLocker locker(&this->m_mutex);
+	return this->m_conflicts;
+}
+
+/**
+ * @brief Returns the number of connection attempts which failed because no usable port was found
+ * @return Number of exhaustions
+ */
+quint64 PortAllocator::exhaustions(void) const
+{
+	QMutexLocker locker(&this->m_mutex);
+	return this->m_exhaustions;
+}
@@ -0,0 +1,47 @@
+#ifndef PORTALLOCATOR_H
+#define PORTALLOCATOR_H
+
+#include <QtCore/QBitArray>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtNetwork/QHostAddress>
+
+class PortAllocator {
+public:
+	PortAllocator(quint16 first = 32768, quint16 last = 60999);
+
+	quint16 firstPort(void) const;
+	quint16 lastPort(void) const;
+
+	quint16 allocate(const QHostAddress& local, const QHostAddress& remote, quint16 remote_port);
+	void reportConflict(void);
+	void reportExhausted(void);
+
+	quint64 allocations(void) const;
+	quint64 reuses(void) const;
+	quint64 conflicts(void) const;
+	quint64 exhaustions(void) const;
+
+private:
+	Q_DISABLE_COPY(PortAllocator)
+
+	struct Cursor {
+		quint32 offset;
+		quint32 generation;
+	};
+
+	mutable QMutex m_mutex;
+	quint16 m_first;
+	quint16 m_last;
+	QHash<QString, Cursor> m_cursors;
+	quint32 m_generation;
+	QHash<QString, QBitArray> m_handed_out;
+	quint64 m_allocations;
+	quint64 m_reuses;
+	quint64 m_conflicts;
+	quint64 m_exhaustions;
+
+	void sweepCursors(void);
+};
+
+#endif // PORTALLOCATOR_H
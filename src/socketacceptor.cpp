@@ -0,0 +1,266 @@
+#include "socketacceptor.h"
+#include "socketacceptor_p.h"
+
+/**
+ * @class SocketAcceptor
+ *
+ * @brief The SocketAcceptor class accepts TCP connections in a number of listener threads
+ *
+ * listen() creates one listening socket per listener thread, all of them bound to the same address and port with
+ * @c SO_REUSEPORT; the kernel spreads the incoming connections over the sockets, so one accept loop no longer caps
+ * the accept rate. Each listener runs its own epoll loop, without a Qt event loop, and accepts the connections with
+ * @c accept4() in bursts of up to acceptBurst() per readiness event; the accepted sockets are non-blocking and close-on-exec.
+ *
+ * The accepted sockets are reported with the newConnection() signal, emitted from the listener threads. With the default
+ * (automatic) connection type it is delivered in the thread of the receiver, which can adopt the socket with assignTo().
+ *
+ * @note This class is available on Linux only.
+ */
+
+/**
+ * @fn void SocketAcceptor::newConnection(qintptr socket)
+ *
+ * This signal is emitted from a listener thread when a connection has been accepted.
+ * The receiver takes the ownership of the non-blocking @a socket descriptor; if the signal is not connected,
+ * the connection is closed right away.
+ *
+ * @warning With a queued connection (the default for a receiver in another thread) the descriptor travels in the event queue
+ * of the receiver. If the receiver is destroyed, or its thread stops, before the event is delivered, nobody owns
+ * the descriptor and it leaks. Either keep the receivers alive for as long as the acceptor listens, or connect with
+ * @c Qt::DirectConnection and hand the descriptor off in the listener thread.
+ *
+ * @sa assignTo()
+ */
+
+/**
+ * @brief Creates a new @c SocketAcceptor
+ * @param parent Object parent
+ *
+ * The acceptor has QThread::idealThreadCount() listeners by default; they are started by listen().
+ */
+SocketAcceptor::SocketAcceptor(QObject* parent)
+	: QObject(parent), d_ptr(new SocketAcceptorPrivate(this))
+{
+}
+
+/**
+ * @brief Stops the listeners and destroys the @c SocketAcceptor
+ */
+SocketAcceptor::~SocketAcceptor(void)
+{
+#if QT_VERSION < 0x040600
+	delete this->d_ptr;
+	this->d_ptr = 0;
+#endif
+}
+
+/**
+ * @brief Starts listening for the connections on @a address and @a port
+ * @param address Local address; @c QHostAddress::Any listens on all IPv4 and, with Qt 5, IPv6 addresses
+ * @param port Port, in native byte order; if 0, a port is chosen automatically (see serverPort())
+ * @return Whether the listeners are running; if not, serverError() tells why
+ *
+ * The listener count, the affinity, the CPU steering, the backlog and the accept burst are taken into account by listen().
+ */
+bool SocketAcceptor::listen(const QHostAddress& address, quint16 port)
+{
+	Q_D(SocketAcceptor);
+	return d->listen(address, port);
+}
+
+/**
+ * @brief Stops the listener threads and closes the listening sockets
+ *
+ * The connections which have not been accepted yet are reset. The sockets already reported with newConnection() are not affected.
+ */
+void SocketAcceptor::close(void)
+{
+	Q_D(SocketAcceptor);
+	d->close();
+}
+
+/**
+ * @brief Returns whether the acceptor is listening for the connections
+ * @return Whether the listeners are running
+ */
+bool SocketAcceptor::isListening(void) const
+{
+	Q_D(const SocketAcceptor);
+	return !d->m_listeners.isEmpty();
+}
+
+/**
+ * @brief Returns the address the acceptor is listening on
+ * @return Local address, or the null address if not listening
+ */
+QHostAddress SocketAcceptor::serverAddress(void) const
+{
+	Q_D(const SocketAcceptor);
+	return d->m_address;
+}
+
+/**
+ * @brief Returns the port the acceptor is listening on
+ * @return Port, or 0 if not listening
+ */
+quint16 SocketAcceptor::serverPort(void) const
+{
+	Q_D(const SocketAcceptor);
+	return d->m_port;
+}
+
+/**
+ * @brief Returns the reason why the last listen() has failed
+ * @return Error
+ */
+QAbstractSocket::SocketError SocketAcceptor::serverError(void) const
+{
+	Q_D(const SocketAcceptor);
+	return d->m_error;
+}
+
+/**
+ * @brief Assigns an accepted @a socket to a @a target
+ * @param socket Descriptor reported by newConnection()
+ * @param target Socket to take the connection over, in the thread it belongs to
+ * @return Whether a call to @c target->setSocketDescriptor() succeeded; if it has not, the caller still owns @a socket
+ */
+bool SocketAcceptor::assignTo(qintptr socket, QAbstractSocket* target)
+{
+	return target->setSocketDescriptor(socket, QAbstractSocket::ConnectedState, QIODevice::ReadWrite);
+}
+
+/**
+ * @brief Sets the number of listeners started by the next listen()
+ * @param n Number of listening sockets and threads
+ */
+void SocketAcceptor::setListenerCount(int n)
+{
+	Q_D(SocketAcceptor);
+	d->m_listener_count = qMax(n, 1);
+}
+
+/**
+ * @brief Returns the number of listeners
+ * @return Number of listener threads
+ */
+int SocketAcceptor::listenerCount(void) const
+{
+	Q_D(const SocketAcceptor);
+	return d->m_listeners.isEmpty() ? d->m_listener_count : d->m_listeners.size();
+}
+
+/**
+ * @brief Sets the CPUs the listeners are pinned to by the next listen()
+ * @param cpus CPU numbers; listener @c i is pinned to <tt>cpus[i % cpus.size()]</tt>. If empty, the listeners are not pinned
+ * unless the CPU steering is enabled
+ */
+void SocketAcceptor::setCpuAffinity(const QList<int>& cpus)
+{
+	Q_D(SocketAcceptor);
+	d->m_cpus = cpus;
+}
+
+/**
+ * @brief Returns the CPUs the listeners are pinned to
+ * @return CPU numbers
+ */
+QList<int> SocketAcceptor::cpuAffinity(void) const
+{
+	Q_D(const SocketAcceptor);
+	return d->m_cpus;
+}
+
+/**
+ * @brief Enables or disables the steering of the connections to the listener running on the CPU which has received them
+ * @param enable Whether to attach the steering program
+ *
+ * listen() attaches a classic BPF program with @c SO_ATTACH_REUSEPORT_CBPF, which picks listener number <tt>cpu % listenerCount()</tt>
+ * for a connection whose SYN has been processed by CPU @c cpu. Unless cpuAffinity() says otherwise, listener @c i is pinned to CPU @c i.
+ * The connection and its packets then stay on one CPU, provided that the NIC queues are bound to the CPUs the same way.
+ *
+ * If the program cannot be attached (before Linux 4.5), the kernel spreads the connections by the hash of the addresses.
+ * The steering is disabled by default.
+ */
+void SocketAcceptor::setCpuSteeringEnabled(bool enable)
+{
+	Q_D(SocketAcceptor);
+	d->m_steering = enable;
+}
+
+/**
+ * @brief Returns whether the CPU steering is enabled
+ * @return Whether the CPU steering is enabled
+ */
+bool SocketAcceptor::cpuSteeringEnabled(void) const
+{
+	Q_D(const SocketAcceptor);
+	return d->m_steering;
+}
+
+/**
+ * @brief Sets the backlog of every listening socket
+ * @param backlog Length of the queue of the connections not accepted yet; @c SOMAXCONN by default
+ */
+void SocketAcceptor::setBacklog(int backlog)
+{
+	Q_D(SocketAcceptor);
+	d->m_backlog = backlog;
+}
+
+/**
+ * @brief Returns the backlog of every listening socket
+ * @return Backlog
+ */
+int SocketAcceptor::backlog(void) const
+{
+	Q_D(const SocketAcceptor);
+	return d->m_backlog;
+}
+
+/**
+ * @brief Sets the maximal number of connections accepted per readiness event
+ * @param n Number of @c accept4() calls, 64 by default
+ *
+ * The connections left in the backlog after a burst are accepted after the next @c epoll_wait(), which lets close() in.
+ */
+void SocketAcceptor::setAcceptBurst(int n)
+{
+	Q_D(SocketAcceptor);
+	d->m_burst = qMax(n, 1);
+}
+
+/**
+ * @brief Returns the maximal number of connections accepted per readiness event
+ * @return Accept burst
+ */
+int SocketAcceptor::acceptBurst(void) const
+{
+	Q_D(const SocketAcceptor);
+	return d->m_burst;
+}
+
+/**
+ * @brief Sets the socket options of the accepted connections
+ * @param profile Socket options
+ * @return Whether the profile has been applied to the listening sockets, if any
+ *
+ * The profile is applied to the listening sockets, before they are bound; Linux copies the options onto the accepted sockets,
+ * so that accepting a connection takes no extra system calls. The buffer sizes have to be set this way anyway:
+ * the window scale of a connection is chosen from the receive buffer size of the listening socket.
+ */
+bool SocketAcceptor::setSocketOptionProfile(const SocketOptionProfile& profile)
+{
+	Q_D(SocketAcceptor);
+	return d->setProfile(profile);
+}
+
+/**
+ * @brief Returns the socket options of the accepted connections
+ * @return Socket options
+ */
+SocketOptionProfile SocketAcceptor::socketOptionProfile(void) const
+{
+	Q_D(const SocketAcceptor);
+	return d->m_profile;
+}
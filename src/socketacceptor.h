@@ -0,0 +1,59 @@
+#ifndef SOCKETACCEPTOR_H
+#define SOCKETACCEPTOR_H
+
+#include <QtCore/QObject>
+#include <QtCore/QList>
+#include <QtNetwork/QAbstractSocket>
+#include <QtNetwork/QHostAddress>
+#include "socketoptionprofile.h"
+
+#if QT_VERSION < 0x050000
+typedef qptrdiff qintptr;
+#endif
+
+class SocketAcceptorPrivate;
+
+class SocketAcceptor : public QObject {
+	Q_OBJECT
+public:
+	SocketAcceptor(QObject* parent = 0);
+	virtual ~SocketAcceptor(void);
+
+	bool listen(const QHostAddress& address = QHostAddress::Any, quint16 port = 0);
+	void close(void);
+	bool isListening(void) const;
+
+	QHostAddress serverAddress(void) const;
+	quint16 serverPort(void) const;
+	QAbstractSocket::SocketError serverError(void) const;
+
+	static bool assignTo(qintptr socket, QAbstractSocket* target);
+
+	void setListenerCount(int n);
+	int listenerCount(void) const;
+	void setCpuAffinity(const QList<int>& cpus);
+	QList<int> cpuAffinity(void) const;
+	void setCpuSteeringEnabled(bool enable);
+	bool cpuSteeringEnabled(void) const;
+	void setBacklog(int backlog);
+	int backlog(void) const;
+	void setAcceptBurst(int n);
+	int acceptBurst(void) const;
+
+	bool setSocketOptionProfile(const SocketOptionProfile& profile);
+	SocketOptionProfile socketOptionProfile(void) const;
+
+Q_SIGNALS:
+	void newConnection(qintptr socket);
+
+private:
+	Q_DISABLE_COPY(SocketAcceptor)
+	Q_DECLARE_PRIVATE(SocketAcceptor)
+#if QT_VERSION >= 0x040600
+	QScopedPointer<SocketAcceptorPrivate> d_ptr;
+#else
+	SocketAcceptorPrivate* d_ptr;
+#endif
+};
+
+#endif // SOCKETACCEPTOR_H
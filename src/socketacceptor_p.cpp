@@ -0,0 +1,407 @@
+#include <QtCore/QMetaType>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <net/if.h>
+#include <linux/filter.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include "socketacceptor.h"
+#include "socketacceptor_p.h"
+
+#ifndef SO_REUSEPORT
+#	define SO_REUSEPORT 15
+#endif
+
+#ifndef SO_ATTACH_REUSEPORT_CBPF
+#	define SO_ATTACH_REUSEPORT_CBPF 51
+#endif
+
+// How long a listener stops accepting when the process or the system is out of descriptors or memory
+static const int resource_pause = 100;
+
+static socklen_t makeAddress(const QHostAddress& a, quint16 port, struct sockaddr_storage* ss)
+{
+	memset(ss, 0, sizeof(*ss));
+
+	switch (a.protocol()) {
+		case QAbstractSocket::IPv4Protocol: {
+			struct sockaddr_in* sa = reinterpret_cast<struct sockaddr_in*>(ss);
+			sa->sin_family      = AF_INET;
+			sa->sin_port        = htons(port);
+			sa->sin_addr.s_addr = htonl(a.toIPv4Address());
+			return sizeof(struct sockaddr_in);
+		}
+
+		case QAbstractSocket::IPv6Protocol: {
+			struct sockaddr_in6* sa = reinterpret_cast<struct sockaddr_in6*>(ss);
+			sa->sin6_family = AF_INET6;
+			sa->sin6_port   = htons(port);
+#ifndef QT_NO_IPV6IFNAME
+			sa->sin6_scope_id = ::if_nametoindex(a.scopeId().toLatin1().data());
+#else
+			sa->sin6_scope_id = a.scopeId().toInt();
+#endif
+			Q_IPV6ADDR tmp = a.toIPv6Address();
+			memcpy(&sa->sin6_addr.s6_addr, &tmp, sizeof(tmp));
+			return sizeof(struct sockaddr_in6);
+		}
+
+#if QT_VERSION >= 0x050000
+		case QAbstractSocket::AnyIPProtocol: {
+			// QHostAddress::Any: a dual-stack socket
+			struct sockaddr_in6* sa = reinterpret_cast<struct sockaddr_in6*>(ss);
+			sa->sin6_family = AF_INET6;
+			sa->sin6_port   = htons(port);
+			sa->sin6_addr   = in6addr_any;
+			return sizeof(struct sockaddr_in6);
+		}
+#endif
+
+		default:
+			return 0;
+	}
+}
+
+static QAbstractSocket::SocketError listenError(int err)
+{
+	switch (err) {
+		case EADDRINUSE:
+			return QAbstractSocket::AddressInUseError;
+
+		case EACCES:
+		case EPERM:
+			return QAbstractSocket::SocketAccessError;
+
+		case EADDRNOTAVAIL:
+			return QAbstractSocket::SocketAddressNotAvailableError;
+
+		case EMFILE:
+		case ENFILE:
+		case ENOBUFS:
+		case ENOMEM:
+			return QAbstractSocket::SocketResourceError;
+
+		case EAFNOSUPPORT:
+			return QAbstractSocket::UnsupportedSocketOperationError;
+
+		default:
+			return QAbstractSocket::UnknownSocketError;
+	}
+}
+
+AcceptorListener::AcceptorListener(SocketAcceptorPrivate* acceptor, int fd, int cpu, int burst)
+	: QThread(0), m_acceptor(acceptor), m_fd(fd), m_cpu(cpu), m_burst(qMax(burst, 1)),
+	  m_epoll(::epoll_create1(EPOLL_CLOEXEC)), m_eventfd(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)), m_stopping(0)
+{
+	if (this->isValid()) {
+		struct epoll_event ev;
+		memset(&ev, 0, sizeof(ev));
+		ev.events  = EPOLLIN;
+		ev.data.fd = this->m_eventfd;
+		::epoll_ctl(this->m_epoll, EPOLL_CTL_ADD, this->m_eventfd, &ev);
+
+		ev.data.fd = this->m_fd;
+		::epoll_ctl(this->m_epoll, EPOLL_CTL_ADD, this->m_fd, &ev);
+	}
+	else {
+		qWarning("%s: failed to create the epoll set: %s", Q_FUNC_INFO, strerror(errno));
+	}
+}
+
+AcceptorListener::~AcceptorListener(void)
+{
+	this->shutdown();
+
+	if (-1 != this->m_epoll) {
+		::close(this->m_epoll);
+	}
+
+	if (-1 != this->m_eventfd) {
+		::close(this->m_eventfd);
+	}
+
+	// The connections still in the backlog of this socket are reset
+	::close(this->m_fd);
+}
+
+bool AcceptorListener::isValid(void) const
+{
+	return -1 != this->m_epoll && -1 != this->m_eventfd;
+}
+
+int AcceptorListener::socket(void) const
+{
+	return this->m_fd;
+}
+
+void AcceptorListener::shutdown(void)
+{
+	if (this->isRunning()) {
+		this->m_stopping.fetchAndStoreRelease(1);
+
+		quint64 one = 1;
+		while (-1 == ::write(this->m_eventfd, &one, sizeof(one)) && EINTR == errno) {
+		}
+
+		this->wait();
+	}
+}
+
+void AcceptorListener::run(void)
+{
+	if (-1 != this->m_cpu) {
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(this->m_cpu, &set);
+		if (::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set)) {
+			qWarning("%s: failed to pin the listener to CPU %d", Q_FUNC_INFO, this->m_cpu);
+		}
+	}
+
+	const int max_events = 2;
+	struct epoll_event events[max_events];
+	int timeout = -1;
+
+	while (!this->m_stopping.fetchAndAddAcquire(0)) {
+		int n = ::epoll_wait(this->m_epoll, events, max_events, timeout);
+		if (!n && -1 != timeout) {
+			this->watch(true);
+			timeout = -1;
+			continue;
+		}
+
+		for (int i=0; i<n; ++i) {
+			if (events[i].data.fd == this->m_fd && !this->acceptBurst()) {
+				// Nothing can be accepted now, and the listening socket would stay readable: stop watching it for a while
+				this->watch(false);
+				timeout = resource_pause;
+			}
+		}
+	}
+}
+
+bool AcceptorListener::acceptBurst(void)
+{
+	// Level-triggered: whatever is left in the backlog after a burst is reported by the next epoll_wait()
+	for (int i=0; i<this->m_burst; ++i) {
+		int fd = ::accept4(this->m_fd, 0, 0, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (-1 != fd) {
+			this->m_acceptor->accepted(fd);
+			continue;
+		}
+
+		switch (errno) {
+			case EAGAIN:
+#if EWOULDBLOCK != EAGAIN
+			case EWOULDBLOCK:
+#endif
+				return true;
+
+			case EMFILE:
+			case ENFILE:
+			case ENOBUFS:
+			case ENOMEM:
+				return false;
+
+			default:
+				// EINTR, or the connection has gone before it could be accepted (ECONNABORTED, EPROTO...)
+				break;
+		}
+	}
+
+	return true;
+}
+
+void AcceptorListener::watch(bool enable)
+{
+	struct epoll_event ev;
+	memset(&ev, 0, sizeof(ev));
+	ev.events  = enable ? EPOLLIN : 0;
+	ev.data.fd = this->m_fd;
+	::epoll_ctl(this->m_epoll, EPOLL_CTL_MOD, this->m_fd, &ev);
+}
+
+SocketAcceptorPrivate::SocketAcceptorPrivate(SocketAcceptor* const q)
+	: q_ptr(q), m_listeners(), m_address(), m_port(0), m_domain(-1), m_error(QAbstractSocket::UnknownSocketError),
+	  m_listener_count(qMax(QThread::idealThreadCount(), 1)), m_cpus(), m_steering(false), m_backlog(SOMAXCONN), m_burst(64), m_profile()
+{
+	// The signal is emitted from the listener threads
+	qRegisterMetaType<qintptr>("qintptr");
+}
+
+SocketAcceptorPrivate::~SocketAcceptorPrivate(void)
+{
+	this->close();
+}
+
+bool SocketAcceptorPrivate::listen(const QHostAddress& address, quint16 port)
+{
+	if (!this->m_listeners.isEmpty()) {
+		qWarning("%s: already listening on port %u", Q_FUNC_INFO, uint(this->m_port));
+		return false;
+	}
+
+	int n = qMax(this->m_listener_count, 1);
+	QVector<int> fds;
+	for (int i=0; i<n; ++i) {
+		// The first socket picks the port if none is given; the others join its SO_REUSEPORT group
+		int fd = this->createListener(address, port);
+		if (-1 == fd) {
+			for (int j=0; j<fds.size(); ++j) {
+				::close(fds.at(j));
+			}
+
+			return false;
+		}
+
+		fds.append(fd);
+	}
+
+	if (this->m_steering && n > 1 && !attachSteering(fds.first(), n)) {
+		qWarning("%s: failed to attach the CPU steering program: %s", Q_FUNC_INFO, strerror(errno));
+	}
+
+	for (int i=0; i<n; ++i) {
+		AcceptorListener* listener = new AcceptorListener(this, fds.at(i), this->listenerCpu(i), this->m_burst);
+		this->m_listeners.append(listener);
+		if (!listener->isValid()) {
+			for (int j=i+1; j<n; ++j) {
+				::close(fds.at(j));
+			}
+
+			this->close();
+			this->m_error = QAbstractSocket::SocketResourceError;
+			return false;
+		}
+	}
+
+	for (int i=0; i<n; ++i) {
+		this->m_listeners.at(i)->start();
+	}
+
+	this->m_address = address;
+	this->m_port    = port;
+	return true;
+}
+
+void SocketAcceptorPrivate::close(void)
+{
+	for (int i=0; i<this->m_listeners.size(); ++i) {
+		this->m_listeners.at(i)->shutdown();
+		delete this->m_listeners.at(i);
+	}
+
+	this->m_listeners.clear();
+	this->m_address.clear();
+	this->m_port   = 0;
+	this->m_domain = -1;
+}
+
+bool SocketAcceptorPrivate::setProfile(const SocketOptionProfile& profile)
+{
+	this->m_profile = profile;
+
+	bool res = true;
+	for (int i=0; i<this->m_listeners.size(); ++i) {
+		res = profile.apply(this->m_listeners.at(i)->socket(), this->m_domain, SOCK_STREAM) && res;
+	}
+
+	return res;
+}
+
+void SocketAcceptorPrivate::accepted(int fd)
+{
+	Q_Q(SocketAcceptor);
+
+	// Nobody would take the ownership of the descriptor
+	if (q->receivers(SIGNAL(newConnection(qintptr)))) {
+		Q_EMIT q->newConnection(fd);
+	}
+	else {
+		::close(fd);
+	}
+}
+
+int SocketAcceptorPrivate::createListener(const QHostAddress& address, quint16& port)
+{
+	struct sockaddr_storage ss;
+	socklen_t len = makeAddress(address, port, &ss);
+	if (!len) {
+		this->m_error = QAbstractSocket::UnsupportedSocketOperationError;
+		return -1;
+	}
+
+	int domain = ss.ss_family;
+	int fd     = ::socket(domain, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (-1 == fd) {
+		this->m_error = listenError(errno);
+		return -1;
+	}
+
+	int one  = 1;
+	int zero = 0;
+	::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	if (AF_INET6 == domain && QAbstractSocket::IPv6Protocol != address.protocol()) {
+		::setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &zero, sizeof(zero));
+	}
+
+	// The options of the listening socket are inherited by the accepted sockets; the buffer sizes must be set before listen()
+	bool ok =
+		   -1 != ::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one))
+		&& this->m_profile.apply(fd, domain, SOCK_STREAM)
+		&& -1 != ::bind(fd, reinterpret_cast<struct sockaddr*>(&ss), len)
+		&& -1 != ::listen(fd, this->m_backlog)
+	;
+
+	if (ok && !port) {
+		len = sizeof(ss);
+		ok  = -1 != ::getsockname(fd, reinterpret_cast<struct sockaddr*>(&ss), &len);
+		if (ok) {
+			port = ntohs(AF_INET == domain ? reinterpret_cast<struct sockaddr_in*>(&ss)->sin_port : reinterpret_cast<struct sockaddr_in6*>(&ss)->sin6_port);
+		}
+	}
+
+	if (!ok) {
+		this->m_error = listenError(errno);
+		::close(fd);
+		return -1;
+	}
+
+	this->m_domain = domain;
+	return fd;
+}
+
+int SocketAcceptorPrivate::listenerCpu(int i) const
+{
+	if (!this->m_cpus.isEmpty()) {
+		return this->m_cpus.at(i % this->m_cpus.size());
+	}
+
+	// The steering program picks the listener by the number of the CPU: listener i has to run there
+	if (this->m_steering && i < QThread::idealThreadCount()) {
+		return i;
+	}
+
+	return -1;
+}
+
+bool SocketAcceptorPrivate::attachSteering(int fd, int n)
+{
+	// A = the CPU which has received the SYN, modulo the size of the group; the socket with this index takes the connection
+	struct sock_filter code[] = {
+		{ BPF_LD  | BPF_W | BPF_ABS, 0, 0, quint32(SKF_AD_OFF + SKF_AD_CPU) },
+		{ BPF_ALU | BPF_MOD | BPF_K, 0, 0, quint32(n) },
+		{ BPF_RET | BPF_A, 0, 0, 0 }
+	};
+
+	struct sock_fprog prog;
+	prog.len    = sizeof(code) / sizeof(code[0]);
+	prog.filter = code;
+
+	return -1 != ::setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog));
+}
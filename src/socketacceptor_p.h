@@ -0,0 +1,75 @@
+#ifndef SOCKETACCEPTOR_P_H
+#define SOCKETACCEPTOR_P_H
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QList>
+#include <QtCore/QThread>
+#include <QtCore/QVector>
+#include <QtNetwork/QHostAddress>
+#include "socketacceptor.h"
+#include "socketoptionprofile.h"
+#include "qt4compat.h"
+
+class SocketAcceptor;
+class SocketAcceptorPrivate;
+
+/*
+ * A listener owns one of the SO_REUSEPORT listening sockets and runs its own epoll loop in its own thread;
+ * the kernel spreads the incoming connections over the listening sockets of the group
+ */
+class Q_DECL_HIDDEN AcceptorListener : public QThread {
+public:
+	AcceptorListener(SocketAcceptorPrivate* acceptor, int fd, int cpu, int burst);
+	virtual ~AcceptorListener(void);
+
+	bool isValid(void) const;
+	int socket(void) const;
+	void shutdown(void);
+
+protected:
+	virtual void run(void);
+
+private:
+	SocketAcceptorPrivate* m_acceptor;
+	int m_fd;
+	int m_cpu;
+	int m_burst;
+	int m_epoll;
+	int m_eventfd;
+	QAtomicInt m_stopping;
+
+	bool acceptBurst(void);
+	void watch(bool enable);
+};
+
+class Q_DECL_HIDDEN SocketAcceptorPrivate {
+	Q_DECLARE_PUBLIC(SocketAcceptor)
+	SocketAcceptor* const q_ptr;
+public:
+	SocketAcceptorPrivate(SocketAcceptor* const q);
+	~SocketAcceptorPrivate(void);
+
+	bool listen(const QHostAddress& address, quint16 port);
+	void close(void);
+	bool setProfile(const SocketOptionProfile& profile);
+	void accepted(int fd);
+
+private:
+	QVector<AcceptorListener*> m_listeners;
+	QHostAddress m_address;
+	quint16 m_port;
+	int m_domain;
+	QAbstractSocket::SocketError m_error;
+	int m_listener_count;
+	QList<int> m_cpus;
+	bool m_steering;
+	int m_backlog;
+	int m_burst;
+	SocketOptionProfile m_profile;
+
+	int createListener(const QHostAddress& address, quint16& port);
+	int listenerCpu(int i) const;
+	static bool attachSteering(int fd, int n);
+};
+
+#endif // SOCKETACCEPTOR_P_H
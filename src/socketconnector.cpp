@@ -1,7 +1,9 @@
 #include <QtNetwork/QHostAddress>
+#include <QtNetwork/QLocalSocket>
 #include <sys/socket.h>
 #include "socketconnector.h"
 #include "socketconnector_p.h"
+#include "socketfuturejoin_p.h"
 
 /**
  * @class SocketConnector
@@ -60,6 +62,33 @@
  * @sa error()
  */
 
+/**
+ * @fn void SocketConnector::connectionTimed(const SocketConnector::ConnectionTimings& timings)
+ *
+ * This signal is emitted when a connection started with connectToHost() succeeds or fails,
+ * right before connected() or error(), if the timings are enabled.
+ *
+ * @sa setTimingsEnabled(), connectionTimings()
+ */
+
+/**
+ * @fn void SocketConnector::reconnectScheduled(int attempt, int delay)
+ *
+ * This signal is emitted when reconnection attempt number @a attempt (counting from 1) is scheduled
+ * to start in @a delay milliseconds, after a connection has failed or scheduleReconnect() has been called.
+ *
+ * @sa setAutoReconnectEnabled(), reconnectAbandoned()
+ */
+
+/**
+ * @fn void SocketConnector::reconnectAbandoned(int attempts)
+ *
+ * This signal is emitted when the connection has failed after maxReconnectAttempts() reconnection
+ * attempts; @a attempts is the number of attempts made. No further attempt is scheduled.
+ *
+ * @sa setMaxReconnectAttempts(), reconnectScheduled()
+ */
+
 /**
  * @fn void SocketConnector::stateChanged(QAbstractSocket::SocketState socketState)
  *
@@ -104,6 +133,8 @@ SocketConnector::~SocketConnector(void)
  * @see state()
  *
  * The socket can only be assigned to @c SocketConnector if the current state is @c QAbstractSocket::UnconnectedState
+ *
+ * The socket is created non-blocking and close-on-exec, and socketOptionProfile() is applied to it.
  */
 bool SocketConnector::createSocket(int domain, int type, int proto)
 {
@@ -135,6 +166,19 @@ bool SocketConnector::createUdpSocket(void)
 	return this->createSocket(AF_INET, SOCK_DGRAM, 0);
 }
 
+/**
+ * @brief Creates a new Unix domain stream socket and assigns it to the @c SocketConnector.
+ * @return Whether the socket was created successfully
+ * @see createSocket(), assignTo()
+ *
+ * This function is the same as @code createSocket(AF_UNIX, SOCK_STREAM, 0) @endcode
+ * Use @code createSocket(AF_UNIX, SOCK_SEQPACKET, 0) @endcode for a socket which preserves the message boundaries.
+ */
+bool SocketConnector::createLocalSocket(void)
+{
+	return this->createSocket(AF_UNIX, SOCK_STREAM, 0);
+}
+
 /**
  * @brief Binds to address @a a on port @a port
  * @param a Address to bind to
@@ -142,6 +186,7 @@ bool SocketConnector::createUdpSocket(void)
  * @return Whether the operation succeeded
  *
  * The socket can be bound to an address if the current state is @c QAbstractSocket::UnconnectedState.
+ * When binding to a fixed port, @c SO_REUSEADDR is set so that the port can be reused while the previous connection is in @c TIME_WAIT.
  * It may be an error to call @c bindTo() again after a successful call to @c bindTo().
  * On success, the functions returns @c true and the socket enters @c BoundState; otherwise it returns @c false.
  */
@@ -161,6 +206,11 @@ bool SocketConnector::bindTo(const QHostAddress& a, quint16 port)
  * Finally, if a connection is established, SocketConnector enters @c ConnectedState and emits @c connected().
  *
  * At any point, the socket can emit error() to signal that an error occurred.
+ * @note The immediate failures of the connection attempts are handled synchronously: error() and stateChanged() may be emitted
+ * from within this call, before it returns. Connect to these signals before calling connectToHost().
+ *
+ * For an @c AF_UNIX socket @a address is the path of the server socket and @a port is ignored; on Linux a path starting with @c '@'
+ * names a socket in the abstract namespace. There is no lookup: SocketConnector enters @c ConnectingState directly and @c hostFound() is not emitted.
  */
 void SocketConnector::connectToHost(const QString& address, quint16 port)
 {
@@ -200,6 +250,62 @@ void SocketConnector::abort(void)
 	d->abort();
 }
 
+/**
+ * @brief Starts the work of a connection which is likely to be requested soon
+ * @param host Host name or IP address the next connectToHost() is expected to connect to
+ * @param port Port, in native byte order
+ * @param mode @c PrefetchLookup to resolve @a host only; @c PrefetchConnection to open the connection as well
+ * @param budget How long (msec) the speculative work and its result are kept
+ * @return Whether the hint has been taken; it is not for an @c AF_UNIX socket
+ * @see prefetchCount(), prefetchHits(), prefetchExpired()
+ *
+ * The lookup and the connection are made aside, without changing state() and without any signal, so the connector
+ * may be busy with another connection meanwhile. When connectToHost() is called with the same @a host and @a port,
+ * it claims the result: a prefetched connection is used as is (connected() may be emitted from within connectToHost()),
+ * a connection being opened is waited for, and otherwise the resolved addresses or the pending lookup save the lookup time.
+ *
+ * The connection is made with the socket parameters set by createSocket() and bindTo() beforehand, through hostInfoCache()
+ * and addressScoreboard() if set; only a lookup is made for a socket bound to a fixed port or with fastOpenData().
+ *
+ * Only one target is prefetched at a time: a hint for another target discards the previous one, and a hint for the same
+ * target extends the budget. The work which has not been claimed within @a budget is discarded and counted in prefetchExpired().
+ */
+bool SocketConnector::prefetch(const QString& host, quint16 port, SocketConnector::PrefetchMode mode, int budget)
+{
+	Q_D(SocketConnector);
+	return d->prefetch(host, port, PrefetchConnection == mode, budget);
+}
+
+/**
+ * @brief Returns the number of prefetch() hints taken
+ * @return Number of hints
+ */
+quint64 SocketConnector::prefetchCount(void) const
+{
+	Q_D(const SocketConnector);
+	return d->m_prefetch_count;
+}
+
+/**
+ * @brief Returns the number of prefetch() results claimed by connectToHost()
+ * @return Number of hits
+ */
+quint64 SocketConnector::prefetchHits(void) const
+{
+	Q_D(const SocketConnector);
+	return d->m_prefetch_hits;
+}
+
+/**
+ * @brief Returns the number of prefetch() results discarded unused
+ * @return Number of expired or superseded hints
+ */
+quint64 SocketConnector::prefetchExpired(void) const
+{
+	Q_D(const SocketConnector);
+	return d->m_prefetch_expired;
+}
+
 /**
  * @brief Waits until the socket is connected, up to @a timeout milliseconds.
  * @param timeout
@@ -211,10 +317,106 @@ bool SocketConnector::waitForConnected(int timeout)
 	return d->waitForConnected(timeout);
 }
 
+/**
+ * @brief Starts connecting to @a address on @a port and returns a future of the connected descriptor
+ * @param address Host name, IP address or, for an @c AF_UNIX socket, path
+ * @param port Port, in native byte order
+ * @return Future of the connected native descriptor (owned by whoever takes the result), or of -1 on failure (see error())
+ * @see connectToHost(), whenAny(), whenAll()
+ *
+ * The connection is made by connectToHost() in the thread of the connector, which must run an event loop;
+ * nothing blocks or waits, so the future can be composed with @c QFutureWatcher or @c QtConcurrent continuations
+ * from the threads of a pool. A TCP socket is created if there is none.
+ *
+ * Once the future has its result, SocketConnector is in @c UnconnectedState; the socket must not be taken
+ * with assignTo() or releaseSocketDescriptor() in the meantime. Cancelling the future aborts the connection.
+ * With sourceAddressSet(), whoever takes the result releases its source address, see SourceAddressSet::releaseSocket().
+ */
+QFuture<qintptr> SocketConnector::connectAsync(const QString& address, quint16 port)
+{
+	Q_D(SocketConnector);
+	return d->connectAsync(address, port);
+}
+
+/**
+ * @overload
+ */
+QFuture<qintptr> SocketConnector::connectAsync(const QHostAddress& address, quint16 port)
+{
+	return this->connectAsync(address.toString(), port);
+}
+
+/**
+ * @brief Returns a future of the first connection established by any of @a futures
+ * @param futures Futures returned by connectAsync()
+ * @return Future of the first valid descriptor, or of -1 if all the connections have failed
+ *
+ * As soon as one connection succeeds, the other futures are cancelled, and the descriptors of the connections
+ * which complete anyway are closed. Cancelling the returned future cancels all of @a futures.
+ *
+ * The futures are watched from the main thread; the calling thread does not need an event loop.
+ */
+QFuture<qintptr> SocketConnector::whenAny(const QList<QFuture<qintptr> >& futures)
+{
+	return SocketFutureJoin::start(SocketFutureJoin::Any, futures);
+}
+
+/**
+ * @brief Returns a future which finishes when all of @a futures have finished
+ * @param futures Futures returned by connectAsync()
+ * @return Future with one result per future in @a futures, in the same order: a descriptor or -1
+ *
+ * Cancelling the returned future cancels all of @a futures.
+ *
+ * The futures are watched from the main thread; the calling thread does not need an event loop.
+ */
+QFuture<qintptr> SocketConnector::whenAll(const QList<QFuture<qintptr> >& futures)
+{
+	return SocketFutureJoin::start(SocketFutureJoin::All, futures);
+}
+
+/**
+ * @brief Connects to @a address on @a port without an event loop
+ * @param address Host name or IP address
+ * @param port Port
+ * @param timeout Time limit for the whole operation, in milliseconds, or -1 for no limit
+ * @return Connected native socket descriptor, or -1 on failure (see error())
+ * @see connectToHost(), releaseSocketDescriptor()
+ *
+ * The resolved addresses are tried in turn, each for at most connectionTimeout() milliseconds, by waiting on the descriptor
+ * with @c poll(); the host name is resolved with QHostInfo::fromName() unless it is found in hostInfoCache().
+ * No signals are emitted and no events are posted, so this can be used in the threads that do not run an event loop.
+ * Happy Eyeballs is not used in this mode.
+ *
+ * The socket must be created (and bound, if needed) beforehand. On success the caller owns the descriptor,
+ * and SocketConnector enters @c UnconnectedState. With sourceAddressSet(), the caller also releases the source address
+ * of the connection, see SourceAddressSet::releaseSocket().
+ *
+ * For an @c AF_UNIX socket @a address is the path of the server socket, as in connectToHost().
+ */
+qintptr SocketConnector::connectToHostBlocking(const QString& address, quint16 port, int timeout)
+{
+	Q_D(SocketConnector);
+	return d->connectBlocking(address, port, timeout);
+}
+
+/**
+ * @overload
+ */
+qintptr SocketConnector::connectToHostBlocking(const QHostAddress& address, quint16 port, int timeout)
+{
+	return this->connectToHostBlocking(address.toString(), port, timeout);
+}
+
 /**
  * @brief Assigns the connected socket to a @a target
  * @param target
  * @return Whether a call to @c target->setSocketDescriptor() succeeded
+ * @see SocketDispatcher
+ *
+ * @a target must live in the current thread; SocketDispatcher hands the connections off to the sockets in other threads.
+ * With sourceAddressSet(), the owner of @a target releases the source address of the connection before closing it,
+ * see SourceAddressSet::releaseSocket().
  */
 bool SocketConnector::assignTo(QAbstractSocket* target)
 {
@@ -226,6 +428,7 @@ bool SocketConnector::assignTo(QAbstractSocket* target)
 		if (res) {
 			d->m_fd    = -1;
 			d->m_state = QAbstractSocket::UnconnectedState;
+			d->m_connected_source.clear();
 		}
 
 		return true;
@@ -234,9 +437,102 @@ bool SocketConnector::assignTo(QAbstractSocket* target)
 	return false;
 }
 
+/**
+ * @brief Assigns the connected Unix domain socket to a @a target
+ * @param target
+ * @return Whether a call to @c target->setSocketDescriptor() succeeded
+ * @see createLocalSocket()
+ *
+ * Only @c SOCK_STREAM sockets can be assigned: QLocalSocket does not keep the message boundaries.
+ * @c SOCK_SEQPACKET sockets are handed off with releaseSocketDescriptor().
+ */
+bool SocketConnector::assignTo(QLocalSocket* target)
+{
+	Q_D(SocketConnector);
+
+	if (QAbstractSocket::ConnectedState != d->m_state || AF_UNIX != d->m_domain || SOCK_STREAM != d->m_type) {
+		return false;
+	}
+
+	if (!target->setSocketDescriptor(d->m_fd, QLocalSocket::ConnectedState, QIODevice::ReadWrite)) {
+		return false;
+	}
+
+	d->m_fd    = -1;
+	d->m_state = QAbstractSocket::UnconnectedState;
+	d->m_connected_source.clear();
+	return true;
+}
+
+/**
+ * @brief Releases the ownership of the connected socket
+ * @return Native socket descriptor, or -1 if the socket is not connected
+ * @see assignTo()
+ *
+ * This is the counterpart of assignTo() for the consumers which work with native descriptors.
+ * On success SocketConnector enters @c UnconnectedState and the caller is responsible for closing the descriptor
+ * and, with sourceAddressSet(), for releasing its source address, see SourceAddressSet::releaseSocket().
+ */
+qintptr SocketConnector::releaseSocketDescriptor(void)
+{
+	Q_D(SocketConnector);
+
+	if (QAbstractSocket::ConnectedState == d->m_state) {
+		int fd     = d->m_fd;
+		d->m_fd    = -1;
+		d->m_state = QAbstractSocket::UnconnectedState;
+		d->m_connected_source.clear();
+		return fd;
+	}
+
+	return -1;
+}
+
+/**
+ * @brief Enables the per-phase timing of the connections
+ * @param enable Whether to record the timings
+ * @see connectionTimings(), connectionTimed()
+ *
+ * When enabled, every connectToHost() and connectToHostBlocking() records a ConnectionTimings:
+ * the start and the end of the host lookup, the start, the end, and the outcome (0 or @c errno) of every attempt,
+ * and the end of the connection. The timestamps are @c CLOCK_MONOTONIC nanoseconds; the end of a phase and the start
+ * of the next one share one clock reading. The attempts racing under Happy Eyeballs overlap; the ones abandoned
+ * when another attempt wins end with @c ECANCELED, the timed out ones with @c ETIMEDOUT.
+ *
+ * The recording allocates the list of the attempts, hence it is disabled by default. It must not be changed while connecting.
+ */
+void SocketConnector::setTimingsEnabled(bool enable)
+{
+	Q_D(SocketConnector);
+	d->m_timings_enabled = enable;
+}
+
+/**
+ * @brief Returns whether the per-phase timing of the connections is enabled
+ * @return Whether the timings are recorded
+ */
+bool SocketConnector::timingsEnabled(void) const
+{
+	Q_D(const SocketConnector);
+	return d->m_timings_enabled;
+}
+
+/**
+ * @brief Returns the timings of the last connection
+ * @return Timings recorded by the last connectToHost() or connectToHostBlocking()
+ * @see setTimingsEnabled()
+ */
+SocketConnector::ConnectionTimings SocketConnector::connectionTimings(void) const
+{
+	Q_D(const SocketConnector);
+	return d->m_timings;
+}
+
 /**
  * @brief Returns the socket type (TCP, UDP, or other).
  * @return Socket type
+ *
+ * @c AF_UNIX sockets have no QAbstractSocket::SocketType and are reported as @c UnknownSocketType; see isLocalSocket().
  */
 QAbstractSocket::SocketType SocketConnector::socketType(void) const
 {
@@ -259,6 +555,17 @@ QAbstractSocket::SocketType SocketConnector::socketType(void) const
 	return QAbstractSocket::UnknownSocketType;
 }
 
+/**
+ * @brief Returns whether the socket is a Unix domain socket
+ * @return Whether the socket has been created in the @c AF_UNIX domain
+ * @see createLocalSocket()
+ */
+bool SocketConnector::isLocalSocket(void) const
+{
+	Q_D(const SocketConnector);
+	return AF_UNIX == d->m_domain;
+}
+
 /**
  * @brief Returns the state of the socket.
  * @return Socket state
@@ -309,4 +616,439 @@ uint SocketConnector::connectionTimeout(void) const
 	return d->m_connectiont_timeout;
 }
 
+/**
+ * @brief Enables or disables @c IP_BIND_ADDRESS_NO_PORT for the binds with port 0
+ * @param enable Whether to defer the local port reservation to @c connect()
+ * @see bindTo()
+ *
+ * Normally bindTo() with port 0 makes the kernel reserve an ephemeral port which is unique for the local address,
+ * which limits the number of outgoing connections per local address to the size of the ephemeral port range.
+ * With @c IP_BIND_ADDRESS_NO_PORT the port is chosen at connect time, when the destination is known,
+ * and can be shared by the connections to different destinations. This option must be set before bindTo() is called.
+ *
+ * The option is disabled by default. It requires Linux 4.2 or newer and is silently ignored elsewhere.
+ */
+void SocketConnector::setBindAddressNoPort(bool enable)
+{
+	Q_D(SocketConnector);
+	d->m_bind_no_port = enable;
+}
+
+/**
+ * @brief Returns whether @c IP_BIND_ADDRESS_NO_PORT is used for the binds with port 0
+ * @return Whether the option is enabled
+ */
+bool SocketConnector::bindAddressNoPort(void) const
+{
+	Q_D(const SocketConnector);
+	return d->m_bind_no_port;
+}
+
+/**
+ * @brief Sets the allocator for the local ports of the bound connections
+ * @param allocator Port allocator (it must outlive the @c SocketConnector), or 0 to let the kernel choose the port
+ * @see bindTo(), PortAllocator
+ *
+ * When the allocator is set and bindTo() is called with port 0, the socket is bound only when the destination address
+ * is known, to the port suggested by the allocator. The allocator must be set before bindTo() is called.
+ */
+void SocketConnector::setPortAllocator(PortAllocator* allocator)
+{
+	Q_D(SocketConnector);
+	d->m_port_allocator = allocator;
+}
+
+/**
+ * @brief Returns the allocator for the local ports of the bound connections
+ * @return Port allocator or 0
+ */
+PortAllocator* SocketConnector::portAllocator(void) const
+{
+	Q_D(const SocketConnector);
+	return d->m_port_allocator;
+}
+
+/**
+ * @brief Sets the local addresses the connections are spread across
+ * @param set Source address set (it must outlive the @c SocketConnector), or 0 to use the address given to bindTo()
+ * @see bindTo(), SourceAddressSet
+ *
+ * When the set is not empty, every connection attempt is bound to the address chosen by the set, and the address
+ * passed to bindTo() is not used; the port passed to bindTo() or chosen by portAllocator() is. If the socket cannot
+ * be bound to an address, the next one is tried. The set must not be changed while the socket is connected.
+ */
+void SocketConnector::setSourceAddressSet(SourceAddressSet* set)
+{
+	Q_D(SocketConnector);
+	d->m_source_set = set;
+}
+
+/**
+ * @brief Returns the local addresses the connections are spread across
+ * @return Source address set or 0
+ */
+SourceAddressSet* SocketConnector::sourceAddressSet(void) const
+{
+	Q_D(const SocketConnector);
+	return d->m_source_set;
+}
+
+/**
+ * @brief Sets the reservoir the sockets are taken from
+ * @param reservoir Socket reservoir (it can be shared and must outlive the @c SocketConnector), or 0 to create every socket on demand
+ * @see createSocket(), SocketReservoir
+ *
+ * When the reservoir is set, createSocket() and the re-creation of the socket between the connection attempts take a ready socket
+ * from the pool matching the domain, type and protocol of the connector and, for the sockets bound to an address with port 0
+ * and bindAddressNoPort(), the bound address; the socket option profile is applied to the socket taken.
+ * If the pool is empty, the socket is created as usual. The sockets bound to a fixed port, bound when the destination is known
+ * or bound with a socket option profile never come from the reservoir.
+ */
+void SocketConnector::setSocketReservoir(SocketReservoir* reservoir)
+{
+	Q_D(SocketConnector);
+	d->m_reservoir = reservoir;
+}
+
+/**
+ * @brief Returns the reservoir the sockets are taken from
+ * @return Socket reservoir or 0
+ */
+SocketReservoir* SocketConnector::socketReservoir(void) const
+{
+	Q_D(const SocketConnector);
+	return d->m_reservoir;
+}
+
+/**
+ * @brief Sets the socket options to apply to every socket created by the @c SocketConnector
+ * @param profile Socket options
+ * @return Whether the options could be applied to the current socket
+ * @see createSocket()
+ *
+ * The profile is applied by createSocket() and whenever the socket is re-created between the connection attempts,
+ * right after the socket is created and before it is bound and connected. If the profile cannot be applied,
+ * the socket is not used: createSocket() fails and the connection attempt moves on to the next address.
+ *
+ * If there is a socket in @c UnconnectedState or @c BoundState, the profile is applied to it immediately.
+ */
+bool SocketConnector::setSocketOptionProfile(const SocketOptionProfile& profile)
+{
+	Q_D(SocketConnector);
+	d->m_profile = profile;
+
+	if (-1 != d->m_fd && (QAbstractSocket::UnconnectedState == d->m_state || QAbstractSocket::BoundState == d->m_state)) {
+		return profile.apply(d->m_fd, d->m_domain, d->m_type);
+	}
+
+	return true;
+}
+
+/**
+ * @brief Returns the socket options applied to every socket created by the @c SocketConnector
+ * @return Socket options
+ */
+SocketOptionProfile SocketConnector::socketOptionProfile(void) const
+{
+	Q_D(const SocketConnector);
+	return d->m_profile;
+}
+
+/**
+ * @brief Sets the host name cache used by connectToHost()
+ * @param cache Cache (it must outlive the @c SocketConnector), or 0 to call QHostInfo::lookupHost() directly
+ * @see HostInfoCache::globalInstance()
+ *
+ * If the cache has a valid entry for the host name, the connection is started right from the connectToHost() call.
+ */
+void SocketConnector::setHostInfoCache(HostInfoCache* cache)
+{
+	Q_D(SocketConnector);
+	d->m_cache = cache;
+}
+
+/**
+ * @brief Returns the host name cache used by connectToHost()
+ * @return Cache or 0
+ */
+HostInfoCache* SocketConnector::hostInfoCache(void) const
+{
+	Q_D(const SocketConnector);
+	return d->m_cache;
+}
+
+/**
+ * @brief Sets the scoreboard which orders the resolved addresses by their past connection outcomes
+ * @param scoreboard Scoreboard (usually AddressScoreboard::globalInstance(); it must outlive the @c SocketConnector), or 0 to keep the resolver order
+ * @see AddressScoreboard
+ *
+ * The outcome of every connection attempt is reported to the scoreboard, and the resolved addresses are tried
+ * in the order given by AddressScoreboard::order(): the healthy and fast addresses first, the recently failed ones last.
+ */
+void SocketConnector::setAddressScoreboard(AddressScoreboard* scoreboard)
+{
+	Q_D(SocketConnector);
+	d->m_scoreboard = scoreboard;
+}
+
+/**
+ * @brief Returns the scoreboard which orders the resolved addresses
+ * @return Scoreboard or 0
+ */
+AddressScoreboard* SocketConnector::addressScoreboard(void) const
+{
+	Q_D(const SocketConnector);
+	return d->m_scoreboard;
+}
+
+/**
+ * @brief Sets the circuit breaker which guards the destinations
+ * @param breaker Circuit breaker (usually CircuitBreaker::globalInstance(); it must outlive the @c SocketConnector), or 0 to disable
+ * @see CircuitBreaker
+ *
+ * While the circuit of the destination is open, connectToHost() emits error() with @c ConnectionRefusedError right away,
+ * without creating any sockets or notifiers, and connectToHostBlocking() returns -1. The outcome of every allowed
+ * connection is reported to the breaker; aborted connections are not counted.
+ */
+void SocketConnector::setCircuitBreaker(CircuitBreaker* breaker)
+{
+	Q_D(SocketConnector);
+	d->m_breaker = breaker;
+}
+
+/**
+ * @brief Returns the circuit breaker which guards the destinations
+ * @return Circuit breaker or 0
+ */
+CircuitBreaker* SocketConnector::circuitBreaker(void) const
+{
+	Q_D(const SocketConnector);
+	return d->m_breaker;
+}
+
+/**
+ * @brief Sets the payload to be sent with TCP Fast Open
+ * @param data First payload; an empty array disables TCP Fast Open (the default)
+ * @see fastOpenAccepted(), fastOpenBytesSent()
+ *
+ * When the payload is set, TCP connections are initiated with @c sendto(MSG_FASTOPEN) instead of @c connect(),
+ * so that the payload goes out in the SYN if the kernel has a Fast Open cookie for the server.
+ * If there is no cookie yet or the client side of TCP Fast Open is disabled, the connection is established as usual
+ * and the payload is written right after the handshake, before connected() is emitted. If the server does not accept
+ * the data in the SYN, the kernel retransmits it after the handshake.
+ *
+ * The payload is not sent from the Happy Eyeballs racing attempts, as it could reach more than one server.
+ */
+void SocketConnector::setFastOpenData(const QByteArray& data)
+{
+	Q_D(SocketConnector);
+	d->m_fastopen_data = data;
+}
+
+/**
+ * @brief Returns the payload to be sent with TCP Fast Open
+ * @return First payload
+ */
+QByteArray SocketConnector::fastOpenData(void) const
+{
+	Q_D(const SocketConnector);
+	return d->m_fastopen_data;
+}
+
+/**
+ * @brief Returns whether the server acknowledged the data sent in the SYN
+ * @return Whether the payload saved the round trip
+ *
+ * The value is valid once the socket is connected.
+ */
+bool SocketConnector::fastOpenAccepted(void) const
+{
+	Q_D(const SocketConnector);
+	return d->m_fastopen_accepted;
+}
+
+/**
+ * @brief Returns how many bytes of the TCP Fast Open payload have been written to the socket
+ * @return Number of bytes
+ *
+ * This is normally the size of fastOpenData(); if it is less (the socket buffer was full), the caller must write the rest.
+ */
+qint64 SocketConnector::fastOpenBytesSent(void) const
+{
+	Q_D(const SocketConnector);
+	return d->m_fastopen_sent;
+}
+
+/**
+ * @brief Enables or disables Happy Eyeballs (RFC 8305) connection racing
+ * @param enable Whether to race connection attempts
+ * @see setAttemptDelay()
+ *
+ * When enabled and the host lookup yields more than one address, the addresses are reordered so that
+ * IPv6 and IPv4 addresses alternate and the connection attempts are staggered: a new attempt is started every attemptDelay()
+ * milliseconds (or as soon as the previous attempt fails) without waiting for the previous attempts to time out.
+ * The first attempt to succeed wins, all other attempts are aborted and the winning socket becomes socketDescriptor().
+ *
+ * Every attempt uses a fresh socket of the address family of the target address. If the socket is bound to an address,
+ * only the addresses of the same family are tried; if it is bound to a fixed port, the attempts are made sequentially.
+ *
+ * Connection racing is disabled by default.
+ */
+void SocketConnector::setHappyEyeballsEnabled(bool enable)
+{
+	Q_D(SocketConnector);
+	d->m_happy_eyeballs = enable;
+}
+
+/**
+ * @brief Returns whether Happy Eyeballs connection racing is enabled
+ * @return Whether Happy Eyeballs connection racing is enabled
+ */
+bool SocketConnector::happyEyeballsEnabled(void) const
+{
+	Q_D(const SocketConnector);
+	return d->m_happy_eyeballs;
+}
+
+/**
+ * @brief Sets the delay between two consecutive connection attempts in Happy Eyeballs mode
+ * @param delay Delay (msec); RFC 8305 recommends 250 ms, which is the default
+ * @see setHappyEyeballsEnabled()
+ */
+void SocketConnector::setAttemptDelay(uint delay)
+{
+	Q_D(SocketConnector);
+	d->m_attempt_delay = delay;
+}
+
+/**
+ * @brief Returns the delay between two consecutive connection attempts in Happy Eyeballs mode
+ * @return Connection attempt delay (msec)
+ */
+uint SocketConnector::attemptDelay(void) const
+{
+	Q_D(const SocketConnector);
+	return d->m_attempt_delay;
+}
+
+/**
+ * @brief Enables or disables reconnection with exponential backoff
+ * @param enable Whether to reconnect automatically
+ * @see setReconnectDelay(), setMaxReconnectDelay(), setMaxReconnectAttempts(), scheduleReconnect()
+ *
+ * When enabled and a connection started with connectToHost() fails with error(), the same host and port are tried again
+ * after a delay; reconnectScheduled() is emitted when an attempt is scheduled. The delay is random between reconnectDelay()
+ * and three times the previous delay ("decorrelated jitter"), but never longer than maxReconnectDelay(): the delays grow
+ * exponentially and the clients which have lost a server at the same time do not reconnect at the same time.
+ *
+ * If the socket has been closed or handed off, it is created again with the parameters of the last createSocket()
+ * and bound to the address of the last bindTo(). disconnectFromHost(), abort() and createSocket() cancel the pending attempt;
+ * a successful connection resets the backoff.
+ *
+ * Reconnection is disabled by default.
+ */
+void SocketConnector::setAutoReconnectEnabled(bool enable)
+{
+	Q_D(SocketConnector);
+	d->setReconnectEnabled(enable);
+}
+
+/**
+ * @brief Returns whether reconnection is enabled
+ * @return Whether reconnection is enabled
+ */
+bool SocketConnector::autoReconnectEnabled(void) const
+{
+	Q_D(const SocketConnector);
+	return d->m_reconnect_enabled;
+}
+
+/**
+ * @brief Sets the base delay of reconnection attempts
+ * @param delay Shortest delay (msec); the default is 100 ms
+ * @see setAutoReconnectEnabled()
+ */
+void SocketConnector::setReconnectDelay(uint delay)
+{
+	Q_D(SocketConnector);
+	d->m_reconnect_delay = delay;
+}
+
+/**
+ * @brief Returns the base delay of reconnection attempts
+ * @return Base delay (msec)
+ */
+uint SocketConnector::reconnectDelay(void) const
+{
+	Q_D(const SocketConnector);
+	return d->m_reconnect_delay;
+}
+
+/**
+ * @brief Sets the longest delay of a reconnection attempt
+ * @param delay Longest delay (msec); the default is 30 seconds. Delays above @c INT_MAX are capped at @c INT_MAX
+ * @see setAutoReconnectEnabled()
+ */
+void SocketConnector::setMaxReconnectDelay(uint delay)
+{
+	Q_D(SocketConnector);
+	d->m_max_reconnect_delay = delay;
+}
+
+/**
+ * @brief Returns the longest delay of a reconnection attempt
+ * @return Longest delay (msec)
+ */
+uint SocketConnector::maxReconnectDelay(void) const
+{
+	Q_D(const SocketConnector);
+	return d->m_max_reconnect_delay;
+}
+
+/**
+ * @brief Limits the number of consecutive reconnection attempts
+ * @param attempts Number of attempts after the failure of the connection requested with connectToHost(), or -1 (the default) for no limit
+ * @see reconnectAbandoned()
+ */
+void SocketConnector::setMaxReconnectAttempts(int attempts)
+{
+	Q_D(SocketConnector);
+	d->m_max_reconnect_attempts = attempts;
+}
+
+/**
+ * @brief Returns the limit of consecutive reconnection attempts
+ * @return Number of attempts, or -1 for no limit
+ */
+int SocketConnector::maxReconnectAttempts(void) const
+{
+	Q_D(const SocketConnector);
+	return d->m_max_reconnect_attempts;
+}
+
+/**
+ * @brief Returns the number of the last scheduled reconnection attempt
+ * @return Attempt number, or 0 if no attempt has been made since the last connectToHost() or the last successful connection
+ */
+int SocketConnector::reconnectAttempt(void) const
+{
+	Q_D(const SocketConnector);
+	return d->m_reconnect_attempt;
+}
+
+/**
+ * @brief Schedules a reconnection to the host of the last connectToHost()
+ * @return Whether an attempt has been scheduled (or is already pending)
+ * @see setAutoReconnectEnabled()
+ *
+ * SocketConnector does not watch the connection once it is established: when the connection handed off
+ * with assignTo() or releaseSocketDescriptor() is lost, call this function to get it back with the same backoff
+ * as a failed connection. Reconnection must be enabled and SocketConnector must be in @c UnconnectedState or @c BoundState.
+ */
+bool SocketConnector::scheduleReconnect(void)
+{
+	Q_D(SocketConnector);
+	return d->reconnect();
+}
+
 #include "moc_socketconnector.cpp"
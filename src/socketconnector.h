@@ -1,35 +1,86 @@
 #ifndef SOCKETCONNECTOR_H
 #define SOCKETCONNECTOR_H
 
+#include <QtCore/QFuture>
+#include <QtCore/QList>
+#include <QtCore/QMetaType>
 #include <QtCore/QObject>
 #include <QtNetwork/QAbstractSocket>
 #include <QtNetwork/QHostInfo>
+#include "socketoptionprofile.h"
 
 #if QT_VERSION < 0x050000
 typedef qptrdiff qintptr;
 #endif
 
+QT_FORWARD_DECLARE_CLASS(QLocalSocket)
+
+class AddressScoreboard;
+class CircuitBreaker;
+class HostInfoCache;
+class PortAllocator;
 class SocketConnectorPrivate;
+class SocketReservoir;
+class SourceAddressSet;
 
 class SocketConnector : public QObject {
 	Q_OBJECT
 public:
+	struct ConnectionTimings {
+		struct Attempt {
+			QHostAddress address;
+			qint64 started;
+			qint64 finished;
+			int error;
+
+			Attempt(void) : address(), started(-1), finished(-1), error(0) {}
+		};
+
+		qint64 lookupStarted;
+		qint64 lookupFinished;
+		QList<Attempt> attempts;
+		qint64 finished;
+		bool connected;
+
+		ConnectionTimings(void) : lookupStarted(-1), lookupFinished(-1), attempts(), finished(-1), connected(false) {}
+	};
+
+	enum PrefetchMode {
+		PrefetchLookup,
+		PrefetchConnection
+	};
+
 	SocketConnector(QObject* parent = 0);
 	virtual ~SocketConnector(void);
 	bool createSocket(int domain, int type, int proto = 0);
 	bool createTcpSocket(void);
 	bool createUdpSocket(void);
+	bool createLocalSocket(void);
 	bool bindTo(const QHostAddress& a, quint16 port = 0);
 	void connectToHost(const QString& address, quint16 port);
 	void connectToHost(const QHostAddress& address, quint16 port);
 	void disconnectFromHost(void);
 	void abort(void);
 
+	bool prefetch(const QString& host, quint16 port, PrefetchMode mode = PrefetchConnection, int budget = 1000);
+	quint64 prefetchCount(void) const;
+	quint64 prefetchHits(void) const;
+	quint64 prefetchExpired(void) const;
+
 	bool waitForConnected(int timeout = 30000);
+	QFuture<qintptr> connectAsync(const QString& address, quint16 port);
+	QFuture<qintptr> connectAsync(const QHostAddress& address, quint16 port);
+	static QFuture<qintptr> whenAny(const QList<QFuture<qintptr> >& futures);
+	static QFuture<qintptr> whenAll(const QList<QFuture<qintptr> >& futures);
+	qintptr connectToHostBlocking(const QString& address, quint16 port, int timeout = 30000);
+	qintptr connectToHostBlocking(const QHostAddress& address, quint16 port, int timeout = 30000);
 
 	bool assignTo(QAbstractSocket* target);
+	bool assignTo(QLocalSocket* target);
+	qintptr releaseSocketDescriptor(void);
 
 	QAbstractSocket::SocketType socketType(void) const;
+	bool isLocalSocket(void) const;
 	QAbstractSocket::SocketState state(void) const;
 	QAbstractSocket::SocketError error(void) const;
 
@@ -38,12 +89,59 @@ public:
 	void setConnectionTimeout(uint timeout);
 	uint connectionTimeout(void) const;
 
+	void setBindAddressNoPort(bool enable);
+	bool bindAddressNoPort(void) const;
+	void setPortAllocator(PortAllocator* allocator);
+	PortAllocator* portAllocator(void) const;
+	void setSourceAddressSet(SourceAddressSet* set);
+	SourceAddressSet* sourceAddressSet(void) const;
+	void setSocketReservoir(SocketReservoir* reservoir);
+	SocketReservoir* socketReservoir(void) const;
+
+	bool setSocketOptionProfile(const SocketOptionProfile& profile);
+	SocketOptionProfile socketOptionProfile(void) const;
+
+	void setHostInfoCache(HostInfoCache* cache);
+	HostInfoCache* hostInfoCache(void) const;
+	void setAddressScoreboard(AddressScoreboard* scoreboard);
+	AddressScoreboard* addressScoreboard(void) const;
+	void setCircuitBreaker(CircuitBreaker* breaker);
+	CircuitBreaker* circuitBreaker(void) const;
+
+	void setFastOpenData(const QByteArray& data);
+	QByteArray fastOpenData(void) const;
+	bool fastOpenAccepted(void) const;
+	qint64 fastOpenBytesSent(void) const;
+
+	void setHappyEyeballsEnabled(bool enable);
+	bool happyEyeballsEnabled(void) const;
+	void setAttemptDelay(uint delay);
+	uint attemptDelay(void) const;
+
+	void setTimingsEnabled(bool enable);
+	bool timingsEnabled(void) const;
+	ConnectionTimings connectionTimings(void) const;
+
+	void setAutoReconnectEnabled(bool enable);
+	bool autoReconnectEnabled(void) const;
+	void setReconnectDelay(uint delay);
+	uint reconnectDelay(void) const;
+	void setMaxReconnectDelay(uint delay);
+	uint maxReconnectDelay(void) const;
+	void setMaxReconnectAttempts(int attempts);
+	int maxReconnectAttempts(void) const;
+	int reconnectAttempt(void) const;
+	bool scheduleReconnect(void);
+
 Q_SIGNALS:
 	void hostFound(void);
 	void connected(void);
 	void disconnected(void);
 	void stateChanged(QAbstractSocket::SocketState);
 	void error(QAbstractSocket::SocketError);
+	void connectionTimed(const SocketConnector::ConnectionTimings& timings);
+	void reconnectScheduled(int attempt, int delay);
+	void reconnectAbandoned(int attempts);
 
 private:
 	Q_DISABLE_COPY(SocketConnector)
@@ -55,10 +153,22 @@ private:
 #endif
 
 	Q_PRIVATE_SLOT(d_func(), void _q_startConnecting(QHostInfo))
-	Q_PRIVATE_SLOT(d_func(), void _q_connectToNextAddress())
 	Q_PRIVATE_SLOT(d_func(), void _q_connected(int))
 	Q_PRIVATE_SLOT(d_func(), void _q_abortConnection())
+	Q_PRIVATE_SLOT(d_func(), void _q_attemptTimedOut(int))
+	Q_PRIVATE_SLOT(d_func(), void _q_raceNextAttempt())
+	Q_PRIVATE_SLOT(d_func(), void _q_raceAttemptReady(int))
+	Q_PRIVATE_SLOT(d_func(), void _q_raceTimedOut())
+	Q_PRIVATE_SLOT(d_func(), void _q_settleFuture())
+	Q_PRIVATE_SLOT(d_func(), void _q_futureCanceled())
+	Q_PRIVATE_SLOT(d_func(), void _q_reconnect())
+	Q_PRIVATE_SLOT(d_func(), void _q_connectionFailed())
+	Q_PRIVATE_SLOT(d_func(), void _q_prefetchLookedUp(QHostInfo))
+	Q_PRIVATE_SLOT(d_func(), void _q_prefetchReady(int))
+	Q_PRIVATE_SLOT(d_func(), void _q_prefetchExpired())
 
 };
 
+Q_DECLARE_METATYPE(SocketConnector::ConnectionTimings)
+
 #endif // SOCKETCONNECTOR_H
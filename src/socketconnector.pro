@@ -6,14 +6,80 @@ CONFIG  += staticlib create_prl release
 DESTDIR  = ../lib
 
 HEADERS = \
+	addressscoreboard.h \
+	circuitbreaker.h \
+	connectawaitable.h \
+	hostinfocache.h \
+	hostinfocache_p.h \
+	portallocator.h \
 	socketconnector.h \
-	socketconnector_p.h
+	socketconnector_p.h \
+	socketconnectorpool.h \
+	socketconnectorpool_p.h \
+	socketdispatcher.h \
+	socketdispatcher_p.h \
+	socketfuturejoin_p.h \
+	socketoptionprofile.h \
+	socketreservoir.h \
+	sourceaddressset.h
 
 SOURCES = \
+	addressscoreboard.cpp \
+	circuitbreaker.cpp \
+	hostinfocache.cpp \
+	hostinfocache_p.cpp \
+	portallocator.cpp \
 	socketconnector.cpp \
-	socketconnector_p.cpp
+	socketconnector_p.cpp \
+	socketconnectorpool.cpp \
+	socketconnectorpool_p.cpp \
+	socketdispatcher.cpp \
+	socketdispatcher_p.cpp \
+	socketfuturejoin_p.cpp \
+	socketoptionprofile.cpp \
+	socketreservoir.cpp \
+	sourceaddressset.cpp
 
-headers.files = socketconnector.h
+headers.files = \
+	addressscoreboard.h \
+	circuitbreaker.h \
+	connectawaitable.h \
+	hostinfocache.h \
+	portallocator.h \
+	socketconnector.h \
+	socketconnectorpool.h \
+	socketdispatcher.h \
+	socketoptionprofile.h \
+	socketreservoir.h \
+	sourceaddressset.h
+
+linux* {
+	HEADERS += \
+		batchconnector.h \
+		batchconnector_p.h \
+		connectorengine.h \
+		connectorengine_p.h \
+		connecttracker_p.h \
+		datagramchannel.h \
+		datagramchannel_p.h \
+		iouring_p.h \
+		socketacceptor.h \
+		socketacceptor_p.h
+
+	SOURCES += \
+		batchconnector.cpp \
+		batchconnector_p.cpp \
+		connectorengine.cpp \
+		connectorengine_p.cpp \
+		connecttracker_p.cpp \
+		datagramchannel.cpp \
+		datagramchannel_p.cpp \
+		iouring_p.cpp \
+		socketacceptor.cpp \
+		socketacceptor_p.cpp
+
+	headers.files += batchconnector.h connectorengine.h datagramchannel.h socketacceptor.h
+}
 
 unix {
 	CONFIG += create_pc
@@ -1,27 +1,160 @@
 #include <QtCore/QEventLoop>
+#include <QtCore/QFile>
 #include <QtCore/QSocketNotifier>
 #include <QtCore/QTimer>
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/socket.h>
+#include <sys/un.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <net/if.h>
+#include <climits>
 #include <errno.h>
+#include <poll.h>
+#include <stddef.h>
+#include <time.h>
+#ifdef Q_OS_LINUX
+#	include <sys/timerfd.h>
+#endif
+#include "addressscoreboard.h"
+#include "circuitbreaker.h"
+#include "hostinfocache.h"
+#include "portallocator.h"
+#include "socketreservoir.h"
+#include "sourceaddressset.h"
 #include "socketconnector.h"
 #include "socketconnector_p.h"
 
+#ifndef MSG_FASTOPEN
+#	define MSG_FASTOPEN 0x20000000
+#endif
+
+#ifndef TCPI_OPT_SYN_DATA
+#	define TCPI_OPT_SYN_DATA 32
+#endif
+
+#ifndef IP_BIND_ADDRESS_NO_PORT
+#	define IP_BIND_ADDRESS_NO_PORT 24
+#endif
+
+static const int max_port_attempts = 16;
+
+static qint64 monotonicNsecs(void)
+{
+	struct timespec ts;
+	::clock_gettime(CLOCK_MONOTONIC, &ts);
+	return qint64(ts.tv_sec) * Q_INT64_C(1000000000) + ts.tv_nsec;
+}
+
+static qint64 monotonicMsecs(void)
+{
+	return monotonicNsecs() / 1000000;
+}
+
+static QAbstractSocket::SocketError localSocketError(int err)
+{
+	switch (err) {
+		case ENOENT:
+		case ENOTDIR:
+		case ENAMETOOLONG:
+			return QAbstractSocket::HostNotFoundError;
+
+		case EACCES:
+		case EPERM:
+			return QAbstractSocket::SocketAccessError;
+
+		case ETIMEDOUT:
+			return QAbstractSocket::SocketTimeoutError;
+
+		default:
+			// EAGAIN: the backlog of the listening socket is full
+			return QAbstractSocket::ConnectionRefusedError;
+	}
+}
+
+/*
+ * RFC 8305, section 4: start with the family of the first address returned by the resolver
+ * and then alternate between the families
+ */
+static QList<QHostAddress> interleaveFamilies(const QList<QHostAddress>& list)
+{
+	QList<QHostAddress> v4;
+	QList<QHostAddress> v6;
+
+	for (int i=0; i<list.size(); ++i) {
+		const QHostAddress& a = list.at(i);
+		switch (a.protocol()) {
+			case QAbstractSocket::IPv4Protocol: v4.append(a); break;
+			case QAbstractSocket::IPv6Protocol: v6.append(a); break;
+			default: break;
+		}
+	}
+
+	bool v6first = !v6.isEmpty() && list.first().protocol() == QAbstractSocket::IPv6Protocol;
+	const QList<QHostAddress>& first  = v6first ? v6 : v4;
+	const QList<QHostAddress>& second = v6first ? v4 : v6;
+
+	QList<QHostAddress> res;
+	int i = 0;
+	int j = 0;
+	while (i < first.size() || j < second.size()) {
+		if (i < first.size()) {
+			res.append(first.at(i++));
+		}
+
+		if (j < second.size()) {
+			res.append(second.at(j++));
+		}
+	}
+
+	return res;
+}
+
 SocketConnectorPrivate::SocketConnectorPrivate(SocketConnector* const q)
 	: q_ptr(q), m_fd(-1), m_domain(-1), m_type(-1), m_proto(-1), m_port(0), m_connectiont_timeout(30000),
 	  m_state(QAbstractSocket::UnconnectedState), m_error(QAbstractSocket::UnknownSocketError),
-	  m_lookup_id(-1), m_notifier(0), m_timer(0)
+	  m_next_address(0), m_lookup_id(-1), m_cache(0), m_notifier(0), m_timer(0), m_timerfd(-1), m_timer_notifier(0),
+	  m_happy_eyeballs(false), m_attempt_delay(250), m_race(), m_race_timer(0), m_race_deadline(0),
+	  m_fastopen_data(), m_fastopen_sent(0), m_fastopen_accepted(false), m_profile(),
+	  m_bind_no_port(false), m_port_allocator(0), m_source_set(0), m_reservoir(0), m_connected_source(),
+	  m_timings_enabled(false), m_timings(), m_timing_mark(-1), m_attempt_started(-1), m_attempt_timing(-1),
+	  m_scoreboard(0), m_breaker(0), m_breaker_host(), m_breaker_pending(false),
+	  m_future(), m_future_pending(false), m_future_watcher(0),
+	  m_reconnect_enabled(false), m_reconnect_delay(100), m_max_reconnect_delay(30000), m_max_reconnect_attempts(-1),
+	  m_reconnect_attempt(0), m_reconnect_sleep(0), m_reconnect_seed((quint32(monotonicNsecs()) ^ quint32(quintptr(q))) | 1u),
+	  m_reconnect_armed(false), m_reconnecting(false), m_reconnect_host(), m_rebind_address(), m_rebind_port(0), m_reconnect_timer(0),
+	  m_prefetch_host(), m_prefetch_port(0), m_prefetch_connect(false), m_prefetch_lookup_id(-1), m_prefetch_addresses(),
+	  m_prefetch_resolved(false), m_prefetch_next(0), m_prefetch_fd(-1), m_prefetch_connected(false), m_prefetch_notifier(0),
+	  m_prefetch_timer(0), m_prefetch_count(0), m_prefetch_hits(0), m_prefetch_expired(0)
 {
 }
 
 SocketConnectorPrivate::~SocketConnectorPrivate(void)
 {
+	this->finishFuture(-1);
+
+	if (this->m_breaker_pending && this->m_breaker) {
+		this->m_breaker->cancel(this->m_breaker_host, this->m_port);
+	}
+
+	this->dropPrefetch(false);
+	this->stopRace(-1);
+	delete this->m_race_timer;
 	delete this->m_timer;
+	delete this->m_reconnect_timer;
+	delete this->m_prefetch_timer;
+	delete this->m_timer_notifier;
 	delete this->m_notifier;
+	if (-1 != this->m_timerfd) {
+		::close(this->m_timerfd);
+	}
+
 	if (-1 != this->m_fd) {
+		if (QAbstractSocket::ConnectedState == this->m_state) {
+			this->releaseSource();
+		}
+
 		::close(this->m_fd);
 	}
 }
@@ -37,6 +170,8 @@ bool SocketConnectorPrivate::createSocket(int domain, int type, int proto)
 	this->m_proto  = proto;
 
 	this->disconnectFromHost();
+	this->m_rebind_address.clear();
+	this->m_rebind_port = 0;
 	this->m_fd = this->recreateSocket();
 
 	return this->m_fd != -1;
@@ -55,25 +190,21 @@ bool SocketConnectorPrivate::bindTo(const QHostAddress& a, quint16 port)
 	}
 
 	bool res;
-	switch (a.protocol()) {
-		case QAbstractSocket::IPv4Protocol:
-			res = this->bindV4(a, port);
-			break;
-
-		case QAbstractSocket::IPv6Protocol:
-			res = this->bindV6(a, port);
-			break;
-
-		default:
-			res = false;
-			break;
+	if ((!port && this->m_port_allocator) || this->m_source_set) {
+		// The local address or port is chosen when the destination is known
+		res = QAbstractSocket::IPv4Protocol == a.protocol() || QAbstractSocket::IPv6Protocol == a.protocol();
+	}
+	else {
+		res = this->bindSocket(this->m_fd, a, port);
 	}
 
 	Q_Q(SocketConnector);
 	if (res) {
 		this->m_state = QAbstractSocket::BoundState;
-		this->m_bound_address = a;
-		this->m_bound_port    = port;
+		this->m_bound_address  = a;
+		this->m_bound_port     = port;
+		this->m_rebind_address = a;
+		this->m_rebind_port    = port;
 		Q_EMIT q->stateChanged(this->m_state);
 		return true;
 	}
@@ -92,16 +223,55 @@ void SocketConnectorPrivate::connectToHost(const QString& address, quint16 port)
 
 	Q_Q(SocketConnector);
 
-	this->m_port  = port;
+	if (!this->m_reconnecting) {
+		// A connection requested by the caller starts the backoff over
+		this->m_reconnect_attempt = 0;
+		this->m_reconnect_sleep   = 0;
+	}
+
+	this->m_reconnect_host  = address;
+	this->m_reconnect_armed = true;
+	this->m_port            = port;
+
+	if (!this->admit(address, port)) {
+		this->m_error = QAbstractSocket::ConnectionRefusedError;
+		Q_EMIT q->error(this->m_error);
+		return;
+	}
+
+	this->m_fastopen_sent     = 0;
+	this->m_fastopen_accepted = false;
+	this->startTimings();
+
+	if (AF_UNIX == this->m_domain) {
+		// A path needs no lookup
+		this->lookupTimed();
+		this->connectToPath(address);
+		return;
+	}
+
 	this->m_state = QAbstractSocket::HostLookupState;
 	Q_EMIT q->stateChanged(this->m_state);
 
+	if (this->claimPrefetch(address, port)) {
+		return;
+	}
+
 	QHostAddress tmp;
 	if (tmp.setAddress(address)) {
 		QHostInfo info;
 		info.setAddresses(QList<QHostAddress>() << tmp);
 		this->_q_startConnecting(info);
 	}
+	else if (this->m_cache) {
+		QHostInfo info;
+		if (this->m_cache->cachedHostInfo(address, &info)) {
+			this->_q_startConnecting(info);
+		}
+		else {
+			this->m_lookup_id = this->m_cache->lookupHost(address, q, SLOT(_q_startConnecting(QHostInfo)));
+		}
+	}
 	else {
 		this->m_lookup_id = QHostInfo::lookupHost(address, q, SLOT(_q_startConnecting(QHostInfo)));
 	}
@@ -113,6 +283,7 @@ void SocketConnectorPrivate::disconnectFromHost(void)
 
 	QAbstractSocket::SocketState prev = this->m_state;
 
+	this->stopReconnect();
 	if (-1 != this->m_fd) {
 		this->m_state = QAbstractSocket::ClosingState;
 		Q_EMIT q->stateChanged(this->m_state);
@@ -126,26 +297,42 @@ void SocketConnectorPrivate::disconnectFromHost(void)
 	}
 
 	if (QAbstractSocket::ConnectedState == prev) {
+		if (-1 != this->m_fd) {
+			this->releaseSource();
+		}
+
 		Q_EMIT q->disconnected();
 	}
 
-	delete this->m_notifier;
-	delete this->m_timer;
-	this->m_notifier = 0;
-	this->m_timer    = 0;
+	if (this->m_breaker_pending && this->m_breaker) {
+		this->m_breaker_pending = false;
+		this->m_breaker->cancel(this->m_breaker_host, this->m_port);
+	}
+
+	// The notifier and the timer are kept for the next connection
+	this->stopRace(-1);
+	this->stopAttempt();
 	this->m_addresses.clear();
 	this->m_fd = -1;
 	this->m_bound_address.clear();
+	this->finishFuture(-1);
 }
 
 void SocketConnectorPrivate::abort(void)
 {
+	this->stopReconnect();
 	if (QAbstractSocket::UnconnectedState == this->m_state) {
 		return;
 	}
 
 	if (-1 != this->m_lookup_id) {
-		QHostInfo::abortHostLookup(this->m_lookup_id);
+		if (this->m_cache) {
+			this->m_cache->abortHostLookup(this->m_lookup_id);
+		}
+		else {
+			QHostInfo::abortHostLookup(this->m_lookup_id);
+		}
+
 		this->m_lookup_id = -1;
 	}
 
@@ -160,6 +347,11 @@ bool SocketConnectorPrivate::waitForConnected(int timeout)
 		return true;
 	}
 
+	// The attempts may have failed synchronously, within connectToHost()
+	if (QAbstractSocket::HostLookupState != this->m_state && QAbstractSocket::ConnectingState != this->m_state) {
+		return false;
+	}
+
 	QEventLoop loop;
 	QObject::connect(q, SIGNAL(connected()), &loop, SLOT(quit()));
 	QObject::connect(q, SIGNAL(error(QAbstractSocket::SocketError)), &loop, SLOT(quit()));
@@ -180,7 +372,269 @@ bool SocketConnectorPrivate::waitForConnected(int timeout)
 	}
 }
 
-bool SocketConnectorPrivate::bindV4(const QHostAddress& a, quint16 port)
+QFuture<qintptr> SocketConnectorPrivate::connectAsync(const QString& address, quint16 port)
+{
+	Q_Q(SocketConnector);
+
+	QFutureInterface<qintptr> future;
+	future.reportStarted();
+
+	if (this->m_future_pending || (QAbstractSocket::UnconnectedState != this->m_state && QAbstractSocket::BoundState != this->m_state)) {
+		qWarning("%s called when already looking up or connecting/connected to \"%s\"", Q_FUNC_INFO, qPrintable(address));
+		future.reportResult(qintptr(-1));
+		future.reportFinished();
+		return future.future();
+	}
+
+	if (-1 == this->m_fd && !this->createSocket(AF_INET, SOCK_STREAM, 0)) {
+		future.reportResult(qintptr(-1));
+		future.reportFinished();
+		return future.future();
+	}
+
+	if (!this->m_future_watcher) {
+		// Set up once: the same slots settle every future of this connector
+		this->m_future_watcher = new QFutureWatcher<qintptr>(q);
+		QObject::connect(this->m_future_watcher, SIGNAL(canceled()), q, SLOT(_q_futureCanceled()));
+		QObject::connect(q, SIGNAL(connected()), q, SLOT(_q_settleFuture()));
+		QObject::connect(q, SIGNAL(error(QAbstractSocket::SocketError)), q, SLOT(_q_settleFuture()));
+	}
+
+	this->m_future         = future;
+	this->m_future_pending = true;
+	this->m_future_watcher->setFuture(future.future());
+
+	this->connectToHost(address, port);
+	return future.future();
+}
+
+qintptr SocketConnectorPrivate::connectBlocking(const QString& address, quint16 port, int timeout)
+{
+	if (QAbstractSocket::UnconnectedState != this->m_state && QAbstractSocket::BoundState != this->m_state) {
+		qWarning("%s called when already looking up or connecting/connected to \"%s\"", Q_FUNC_INFO, qPrintable(address));
+		return -1;
+	}
+
+	if (-1 == this->m_fd) {
+		qWarning("%s: call SocketConnector::createSocket() first", Q_FUNC_INFO);
+		return -1;
+	}
+
+	if (!this->admit(address, port)) {
+		this->m_error = QAbstractSocket::ConnectionRefusedError;
+		return -1;
+	}
+
+	qint64 deadline = (timeout < 0) ? -1 : monotonicMsecs() + timeout;
+	this->m_port = port;
+	this->startTimings();
+
+	if (AF_UNIX == this->m_domain) {
+		this->lookupTimed();
+		this->m_fastopen_sent     = 0;
+		this->m_fastopen_accepted = false;
+
+		int wait = this->attemptTimeout();
+		if (-1 != deadline) {
+			wait = int(qMin(qint64(timeout), qint64(wait)));
+		}
+
+		int res = this->connectLocal(this->m_fd, address);
+		if (-1 == res && EINPROGRESS == errno && this->pollConnected(this->m_fd, wait)) {
+			res = 0;
+		}
+
+		if (res) {
+			this->m_error = localSocketError(errno);
+			this->finishConnection(false, false);
+
+			// Leave a fresh socket for the next connectToHostBlocking()
+			this->resetSocket();
+			return -1;
+		}
+
+		this->finishConnection(true, false);
+		this->finishFastOpen();
+
+		int fd = this->m_fd;
+		this->m_fd    = -1;
+		this->m_state = QAbstractSocket::UnconnectedState;
+		return fd;
+	}
+
+	QHostInfo info;
+	QHostAddress tmp;
+	if (tmp.setAddress(address)) {
+		info.setAddresses(QList<QHostAddress>() << tmp);
+	}
+	else if (!this->m_cache || !this->m_cache->cachedHostInfo(address, &info)) {
+		info = QHostInfo::fromName(address);
+	}
+
+	this->lookupTimed();
+
+	QList<QHostAddress> addresses = info.addresses();
+	if (addresses.isEmpty()) {
+		this->m_error = QAbstractSocket::HostNotFoundError;
+		this->finishConnection(false, false);
+		return -1;
+	}
+
+	if (this->m_scoreboard) {
+		addresses = this->m_scoreboard->order(addresses, port);
+	}
+
+	this->m_fastopen_sent     = 0;
+	this->m_fastopen_accepted = false;
+	this->m_error             = QAbstractSocket::ConnectionRefusedError;
+
+	bool fresh = true;
+	for (int i=0; i<addresses.size(); ++i) {
+		const QHostAddress& a = addresses.at(i);
+		if (QAbstractSocket::IPv4Protocol != a.protocol() && QAbstractSocket::IPv6Protocol != a.protocol()) {
+			continue;
+		}
+
+		int wait = this->attemptTimeout();
+		if (-1 != deadline) {
+			qint64 left = deadline - monotonicMsecs();
+			if (left <= 0) {
+				this->m_error = QAbstractSocket::SocketTimeoutError;
+				break;
+			}
+
+			wait = int(qMin(left, qint64(wait)));
+		}
+
+		if (!fresh) {
+			if (-1 != this->m_fd) {
+				::close(this->m_fd);
+			}
+
+			this->m_fd = this->recreateSocket();
+			if (-1 == this->m_fd) {
+				this->m_error = QAbstractSocket::UnknownSocketError;
+				break;
+			}
+		}
+
+		fresh = false;
+
+		qint64 started;
+		int timing = this->attemptStarted(a, started);
+		int res    = (QAbstractSocket::IPv4Protocol == a.protocol()) ? this->connectV4(this->m_fd, a) : this->connectV6(this->m_fd, a);
+		if (-1 == res && EINPROGRESS == errno && this->pollConnected(this->m_fd, wait)) {
+			res = 0;
+		}
+
+		int err = res ? errno : 0;
+		this->attemptFinished(a, started, timing, err);
+		if (!res) {
+			this->finishConnection(true, false);
+			this->finishFastOpen();
+
+			if (this->m_source_set) {
+				// The descriptor is handed off: the caller releases the source address
+				struct sockaddr_storage ss;
+				socklen_t l = sizeof(ss);
+				if (!::getsockname(this->m_fd, reinterpret_cast<struct sockaddr*>(&ss), &l)) {
+					this->m_source_set->connectionOpened(QHostAddress(reinterpret_cast<struct sockaddr*>(&ss)));
+				}
+			}
+
+			int fd = this->m_fd;
+			this->m_fd    = -1;
+			this->m_state = QAbstractSocket::UnconnectedState;
+			return fd;
+		}
+
+		if (ETIMEDOUT == err) {
+			this->m_error = QAbstractSocket::SocketTimeoutError;
+		}
+	}
+
+	// Leave a fresh socket for the next connectToHostBlocking(): the last one may still have a connect in progress
+	if (!fresh) {
+		this->resetSocket();
+	}
+
+	this->finishConnection(false, false);
+	return -1;
+}
+
+int SocketConnectorPrivate::attemptTimeout(void) const
+{
+	// A uint timeout above INT_MAX would turn negative: poll() would wait forever and QTimer would refuse it
+	return int(qMin(qint64(this->m_connectiont_timeout), qint64(INT_MAX)));
+}
+
+bool SocketConnectorPrivate::pollConnected(int fd, int timeout)
+{
+	struct pollfd pfd;
+	pfd.fd      = fd;
+	pfd.events  = POLLOUT;
+	pfd.revents = 0;
+
+	qint64 deadline = monotonicMsecs() + timeout;
+	int res;
+	do {
+		res = ::poll(&pfd, 1, timeout);
+		if (-1 == res && EINTR == errno) {
+			timeout = int(qMax(deadline - monotonicMsecs(), qint64(0)));
+			continue;
+		}
+
+		break;
+	} while (true);
+
+	if (!res) {
+		errno = ETIMEDOUT;
+		return false;
+	}
+
+	if (-1 == res) {
+		return false;
+	}
+
+	int err = 0;
+	socklen_t l = sizeof(err);
+	if (-1 == ::getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &l)) {
+		return false;
+	}
+
+	if (err) {
+		errno = err;
+		return false;
+	}
+
+	return true;
+}
+
+bool SocketConnectorPrivate::bindSocket(int fd, const QHostAddress& a, quint16 port)
+{
+	int one = 1;
+	if (port) {
+		// Lets a fixed port be reused while the previous connection is in TIME_WAIT, like QAbstractSocket::DefaultForPlatform does
+		::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	}
+	else if (this->m_bind_no_port) {
+		// Defer the port reservation to connect(), when the kernel knows the destination
+		::setsockopt(fd, IPPROTO_IP, IP_BIND_ADDRESS_NO_PORT, &one, sizeof(one));
+	}
+
+	switch (a.protocol()) {
+		case QAbstractSocket::IPv4Protocol:
+			return this->bindV4(fd, a, port);
+
+		case QAbstractSocket::IPv6Protocol:
+			return this->bindV6(fd, a, port);
+
+		default:
+			return false;
+	}
+}
+
+bool SocketConnectorPrivate::bindV4(int fd, const QHostAddress& a, quint16 port)
 {
 	struct sockaddr_in sa;
 	memset(&sa, 0, sizeof(sa));
@@ -189,10 +643,10 @@ bool SocketConnectorPrivate::bindV4(const QHostAddress& a, quint16 port)
 	sa.sin_port        = htons(port);
 	sa.sin_addr.s_addr = htonl(a.toIPv4Address());
 
-	return -1 != ::bind(this->m_fd, reinterpret_cast<struct sockaddr*>(&sa), sizeof(sa));
+	return -1 != ::bind(fd, reinterpret_cast<struct sockaddr*>(&sa), sizeof(sa));
 }
 
-bool SocketConnectorPrivate::bindV6(const QHostAddress& a, quint16 port)
+bool SocketConnectorPrivate::bindV6(int fd, const QHostAddress& a, quint16 port)
 {
 	struct sockaddr_in6 sa;
 	memset(&sa, 0, sizeof(sa));
@@ -208,10 +662,10 @@ bool SocketConnectorPrivate::bindV6(const QHostAddress& a, quint16 port)
 	Q_IPV6ADDR tmp = a.toIPv6Address();
 	memcpy(&sa.sin6_addr.s6_addr, &tmp, sizeof(tmp));
 
-	return -1 != ::bind(this->m_fd, reinterpret_cast<struct sockaddr*>(&sa), sizeof(sa));
+	return -1 != ::bind(fd, reinterpret_cast<struct sockaddr*>(&sa), sizeof(sa));
 }
 
-int SocketConnectorPrivate::connectV4(const QHostAddress& a)
+int SocketConnectorPrivate::connectV4(int fd, const QHostAddress& a)
 {
 	struct sockaddr_in sa;
 	memset(&sa, 0, sizeof(sa));
@@ -220,15 +674,10 @@ int SocketConnectorPrivate::connectV4(const QHostAddress& a)
 	sa.sin_port        = htons(this->m_port);
 	sa.sin_addr.s_addr = htonl(a.toIPv4Address());
 
-	int res;
-	do {
-		res = ::connect(this->m_fd, reinterpret_cast<struct sockaddr*>(&sa), sizeof(sa));
-	} while (-1 == res && EINTR == errno);
-
-	return res;
+	return this->connectFrom(fd, AF_INET, a, reinterpret_cast<struct sockaddr*>(&sa), sizeof(sa));
 }
 
-int SocketConnectorPrivate::connectV6(const QHostAddress& a)
+int SocketConnectorPrivate::connectV6(int fd, const QHostAddress& a)
 {
 	struct sockaddr_in6 sa;
 	memset(&sa, 0, sizeof(sa));
@@ -244,143 +693,1296 @@ int SocketConnectorPrivate::connectV6(const QHostAddress& a)
 	Q_IPV6ADDR tmp = a.toIPv6Address();
 	memcpy(&sa.sin6_addr.s6_addr, &tmp, sizeof(tmp));
 
-	int res;
-	do {
-		res = ::connect(this->m_fd, reinterpret_cast<struct sockaddr*>(&sa), sizeof(sa));
-	} while (-1 == res && EINTR == errno);
-
-	return res;
+	return this->connectFrom(fd, AF_INET6, a, reinterpret_cast<struct sockaddr*>(&sa), sizeof(sa));
 }
 
-void SocketConnectorPrivate::_q_startConnecting(const QHostInfo& info)
+int SocketConnectorPrivate::connectFrom(int fd, int domain, const QHostAddress& a, const struct sockaddr* sa, socklen_t len)
 {
-	this->m_addresses = info.addresses();
-	this->m_lookup_id = -1;
+	if (!this->deferBind()) {
+		return this->connectAddress(fd, sa, len);
+	}
 
-	Q_Q(SocketConnector);
+	bool dirty = false;
+	if (!this->m_source_set) {
+		return this->connectFromSource(fd, domain, this->m_bound_address, a, sa, len, dirty);
+	}
 
-	if (this->m_addresses.isEmpty()) {
-		this->m_state = QAbstractSocket::UnconnectedState;
-		this->m_error = QAbstractSocket::HostNotFoundError;
-		Q_EMIT q->stateChanged(this->m_state);
-		Q_EMIT q->error(this->m_error);
-		return;
+	QList<QHostAddress> sources = this->m_source_set->candidates(a, this->m_port);
+	for (int i=0; i<sources.size(); ++i) {
+		int res = this->connectFromSource(fd, domain, sources.at(i), a, sa, len, dirty);
+		if (-1 != res || (EADDRNOTAVAIL != errno && EADDRINUSE != errno)) {
+			return res;
+		}
+
+		// The address may have gone from the interface: try the next one
+		this->m_source_set->reportFailure(sources.at(i));
 	}
 
-	this->m_state = QAbstractSocket::ConnectingState;
-	Q_EMIT q->stateChanged(this->m_state);
-	Q_EMIT q->hostFound();
-	this->_q_connectToNextAddress();
+	errno = EADDRNOTAVAIL;
+	return -1;
 }
 
-void SocketConnectorPrivate::_q_connectToNextAddress(void)
+int SocketConnectorPrivate::connectFromSource(int fd, int domain, const QHostAddress& source, const QHostAddress& a, const struct sockaddr* sa, socklen_t len, bool& dirty)
 {
-	Q_Q(SocketConnector);
+	bool allocate = this->m_port_allocator && !this->m_bound_port;
+	int attempts  = allocate ? max_port_attempts : 1;
 
-	if (this->m_addresses.isEmpty()) {
-		this->m_state = QAbstractSocket::UnconnectedState;
-		this->m_error = QAbstractSocket::ConnectionRefusedError;
-		Q_EMIT q->stateChanged(this->m_state);
-		Q_EMIT q->error(this->m_error);
-		return;
-	}
+	for (int i=0; i<attempts; ++i) {
+		// A socket cannot be bound twice
+		if (dirty && !this->replaceSocket(fd, domain)) {
+			return -1;
+		}
 
-	int res;
-	QHostAddress address = this->m_addresses.takeFirst();
-	switch (address.protocol()) {
-		case QAbstractSocket::IPv4Protocol:
-			res = this->connectV4(address);
-			break;
+		dirty = true;
 
-		case QAbstractSocket::IPv6Protocol:
-			res = this->connectV6(address);
-			break;
+		quint16 port = allocate ? this->m_port_allocator->allocate(source, a, this->m_port) : this->m_bound_port;
+		if (this->bindSocket(fd, source, port)) {
+			int res = this->connectAddress(fd, sa, len);
+			if (-1 != res || (EADDRNOTAVAIL != errno && EADDRINUSE != errno)) {
+				return res;
+			}
+		}
+		else if (EADDRINUSE != errno) {
+			return -1;
+		}
 
-		default:
-			QMetaObject::invokeMethod(q, "_q_connectToNextAddress", Qt::QueuedConnection);
-			return;
-	}
+		if (!allocate) {
+			return -1;
+		}
 
-	if (!res) {
-		this->m_state = QAbstractSocket::ConnectedState;
-		Q_EMIT q->stateChanged(this->m_state);
-		Q_EMIT q->connected();
-		return;
+		this->m_port_allocator->reportConflict();
 	}
 
-	if (errno == EINPROGRESS) {
-		delete this->m_notifier;
-		delete this->m_timer;
-		this->m_notifier = new QSocketNotifier(this->m_fd, QSocketNotifier::Write, q);
-		QObject::connect(this->m_notifier, SIGNAL(activated(int)), q, SLOT(_q_connected(int)));
-		this->m_notifier->setEnabled(true);
+	this->m_port_allocator->reportExhausted();
+	errno = EADDRNOTAVAIL;
+	return -1;
+}
 
-		this->m_timer = new QTimer(q);
-		this->m_timer->setSingleShot(true);
-		QObject::connect(this->m_timer, SIGNAL(timeout()), q, SLOT(_q_abortConnection()));
-		this->m_timer->start(this->m_connectiont_timeout);
+bool SocketConnectorPrivate::deferBind(void) const
+{
+	return this->m_source_set || (this->m_port_allocator && !this->m_bound_address.isNull() && !this->m_bound_port);
+}
+
+bool SocketConnectorPrivate::replaceSocket(int fd, int domain)
+{
+	int tmp = this->createNativeSocket(domain);
+	if (-1 == tmp) {
+		return false;
+	}
+
+	// Keep the descriptor number: it may be watched by a QSocketNotifier
+	int res;
+	do {
+#ifdef Q_OS_LINUX
+		res = ::dup3(tmp, fd, O_CLOEXEC);
+#else
+		res = ::dup2(tmp, fd);
+#endif
+	} while (-1 == res && EINTR == errno);
+
+	::close(tmp);
+	return -1 != res;
+}
+
+int SocketConnectorPrivate::connectAddress(int fd, const struct sockaddr* sa, socklen_t len)
+{
+	int res;
+
+	// The first payload is never sent from the racing attempts: it could reach more than one server
+	if (fd == this->m_fd && SOCK_STREAM == this->m_type && !this->m_fastopen_data.isEmpty()) {
+		this->m_fastopen_sent = 0;
+
+		ssize_t n;
+		do {
+			n = ::sendto(fd, this->m_fastopen_data.constData(), this->m_fastopen_data.size(), MSG_FASTOPEN | MSG_NOSIGNAL, sa, len);
+		} while (-1 == n && EINTR == errno);
+
+		if (n >= 0) {
+			// The data went out in the SYN; the handshake is still in progress
+			this->m_fastopen_sent = n;
+			errno = EINPROGRESS;
+			return -1;
+		}
+
+		if (EOPNOTSUPP != errno) {
+			// EINPROGRESS means that there was no cookie: the SYN requests one, the data will be sent after the handshake
+			return -1;
+		}
+	}
+
+	do {
+		res = ::connect(fd, sa, len);
+	} while (-1 == res && EINTR == errno);
+
+	return res;
+}
+
+int SocketConnectorPrivate::connectLocal(int fd, const QString& path)
+{
+	struct sockaddr_un sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sun_family = AF_UNIX;
+
+	QByteArray name = QFile::encodeName(path);
+	socklen_t len;
+#ifdef Q_OS_LINUX
+	if (name.startsWith('@')) {
+		// Abstract namespace: the name starts with a NUL byte and is not NUL-terminated
+		if (name.size() > int(sizeof(sa.sun_path))) {
+			errno = ENAMETOOLONG;
+			return -1;
+		}
+
+		memcpy(sa.sun_path + 1, name.constData() + 1, name.size() - 1);
+		len = socklen_t(offsetof(struct sockaddr_un, sun_path) + name.size());
+	}
+	else
+#endif
+	{
+		if (name.isEmpty() || name.size() >= int(sizeof(sa.sun_path))) {
+			errno = name.isEmpty() ? ENOENT : ENAMETOOLONG;
+			return -1;
+		}
+
+		memcpy(sa.sun_path, name.constData(), name.size());
+		len = socklen_t(offsetof(struct sockaddr_un, sun_path) + name.size() + 1);
+	}
+
+	// Not connectAddress(): MSG_FASTOPEN is TCP only, the payload is written once connected
+	int res;
+	do {
+		res = ::connect(fd, reinterpret_cast<struct sockaddr*>(&sa), len);
+	} while (-1 == res && EINTR == errno);
+
+	return res;
+}
+
+void SocketConnectorPrivate::connectToPath(const QString& path)
+{
+	Q_Q(SocketConnector);
+
+	// No addresses: a failure of the watched attempt ends the connection in _q_connectToNextAddress()
+	this->m_addresses.clear();
+	this->m_next_address = 0;
+	this->m_state = QAbstractSocket::ConnectingState;
+	Q_EMIT q->stateChanged(this->m_state);
+
+	int res = this->connectLocal(this->m_fd, path);
+	if (!res) {
+		this->finishFastOpen();
+		this->setConnected();
 		return;
 	}
 
-	QMetaObject::invokeMethod(q, "_q_connectToNextAddress", Qt::QueuedConnection);
+	if (EINPROGRESS == errno) {
+		this->watchAttempt();
+		return;
+	}
+
+	int err = errno;
+	this->resetSocket();
+	this->finishConnection(false, true);
+	this->m_state = QAbstractSocket::UnconnectedState;
+	this->m_error = localSocketError(err);
+	Q_EMIT q->stateChanged(this->m_state);
+	Q_EMIT q->error(this->m_error);
 }
 
-void SocketConnectorPrivate::_q_connected(int sock)
+void SocketConnectorPrivate::finishFastOpen(void)
 {
-	this->m_notifier->setEnabled(false);
+	this->m_fastopen_accepted = false;
+	if (SOCK_STREAM != this->m_type || this->m_fastopen_data.isEmpty()) {
+		return;
+	}
 
-	int err;
-	socklen_t l = sizeof(err);
-	getsockopt(sock, SOL_SOCKET, SO_ERROR, &err, &l);
+	struct tcp_info info;
+	socklen_t l = sizeof(info);
+	memset(&info, 0, sizeof(info));
+	if (!::getsockopt(this->m_fd, IPPROTO_TCP, TCP_INFO, &info, &l)) {
+		this->m_fastopen_accepted = 0 != (info.tcpi_options & TCPI_OPT_SYN_DATA);
+	}
 
-	if (err) {
-		this->_q_abortConnection();
+	// The kernel retransmits the SYN data itself if the server ignores it; only what did not go out with the SYN is written here
+	while (this->m_fastopen_sent < this->m_fastopen_data.size()) {
+		ssize_t n = ::send(this->m_fd, this->m_fastopen_data.constData() + this->m_fastopen_sent, this->m_fastopen_data.size() - this->m_fastopen_sent, MSG_NOSIGNAL);
+		if (n > 0) {
+			this->m_fastopen_sent += n;
+		}
+		else if (-1 == n && EINTR == errno) {
+			continue;
+		}
+		else {
+			break;
+		}
+	}
+}
+
+void SocketConnectorPrivate::_q_startConnecting(const QHostInfo& info)
+{
+	if (QAbstractSocket::HostLookupState != this->m_state) {
 		return;
 	}
 
-	this->m_notifier->deleteLater();
-	delete this->m_timer;
+	this->m_addresses = info.addresses();
+	this->m_lookup_id = -1;
+	this->lookupTimed();
 
-	this->m_timer    = 0;
-	this->m_notifier = 0;
+	Q_Q(SocketConnector);
 
-	this->m_addresses.clear();
+	if (this->m_addresses.isEmpty()) {
+		this->m_state = QAbstractSocket::UnconnectedState;
+		this->m_error = QAbstractSocket::HostNotFoundError;
+		this->finishConnection(false, true);
+		Q_EMIT q->stateChanged(this->m_state);
+		Q_EMIT q->error(this->m_error);
+		return;
+	}
 
-	this->m_state = QAbstractSocket::ConnectedState;
+	if (this->m_scoreboard) {
+		this->m_addresses = this->m_scoreboard->order(this->m_addresses, this->m_port);
+	}
+
+	this->m_state = QAbstractSocket::ConnectingState;
+	Q_EMIT q->stateChanged(this->m_state);
+	Q_EMIT q->hostFound();
+
+	if (this->m_happy_eyeballs && this->canRace()) {
+		this->m_addresses = interleaveFamilies(this->m_addresses);
+		this->startRace();
+	}
+	else {
+		this->m_next_address = 0;
+		this->_q_connectToNextAddress();
+	}
+}
 
+void SocketConnectorPrivate::_q_connectToNextAddress(void)
+{
 	Q_Q(SocketConnector);
+
+	// The addresses are walked in place and the retries are made in this loop: an attempt allocates nothing
+	while (this->m_next_address < this->m_addresses.size()) {
+		const QHostAddress& address = this->m_addresses.at(this->m_next_address);
+		if (this->m_next_address++ && !this->resetSocket()) {
+			break;
+		}
+
+		int res;
+		switch (address.protocol()) {
+			case QAbstractSocket::IPv4Protocol:
+				this->m_attempt_timing = this->attemptStarted(address, this->m_attempt_started);
+				res = this->connectV4(this->m_fd, address);
+				break;
+
+			case QAbstractSocket::IPv6Protocol:
+				this->m_attempt_timing = this->attemptStarted(address, this->m_attempt_started);
+				res = this->connectV6(this->m_fd, address);
+				break;
+
+			default:
+				continue;
+		}
+
+		if (!res) {
+			this->stopAttempt();
+			this->currentAttemptFinished(0);
+			this->finishFastOpen();
+			this->setConnected();
+			return;
+		}
+
+		if (EINPROGRESS == errno) {
+			this->watchAttempt();
+			return;
+		}
+
+		this->currentAttemptFinished(errno);
+	}
+
+	// Leave a fresh socket for the next connectToHost()
+	this->stopAttempt();
+	this->resetSocket();
+
+	this->m_addresses.clear();
+	this->finishConnection(false, true);
+	this->m_state = QAbstractSocket::UnconnectedState;
+	this->m_error = QAbstractSocket::ConnectionRefusedError;
 	Q_EMIT q->stateChanged(this->m_state);
-	Q_EMIT q->connected();
+	Q_EMIT q->error(this->m_error);
+}
+
+void SocketConnectorPrivate::_q_connected(int sock)
+{
+	int err = 0;
+	socklen_t l = sizeof(err);
+	::getsockopt(sock, SOL_SOCKET, SO_ERROR, &err, &l);
+
+	this->currentAttemptFinished(err);
+	if (err) {
+		// The notifier stays enabled: the next attempt reuses the descriptor number
+		this->_q_connectToNextAddress();
+		return;
+	}
+
+	this->stopAttempt();
+	this->finishFastOpen();
+	this->setConnected();
 }
 
 void SocketConnectorPrivate::_q_abortConnection(void)
 {
-	this->m_notifier->setEnabled(false);
-	delete this->m_notifier;
-	this->m_timer->deleteLater();
+	this->currentAttemptFinished(ETIMEDOUT);
+	this->_q_connectToNextAddress();
+}
+
+void SocketConnectorPrivate::_q_attemptTimedOut(int fd)
+{
+	quint64 expirations;
+	ssize_t n;
+	do {
+		n = ::read(fd, &expirations, sizeof(expirations));
+	} while (-1 == n && EINTR == errno);
+
+	// Nothing to read if the timer has been disarmed after the notification was queued
+	if (n == ssize_t(sizeof(expirations))) {
+		this->_q_abortConnection();
+	}
+}
 
-	this->m_timer    = 0;
-	this->m_notifier = 0;
+bool SocketConnectorPrivate::resetSocket(void)
+{
+	// Keep the descriptor number: the notifier watching it is reused
+	if (-1 != this->m_fd && this->replaceSocket(this->m_fd, this->m_domain)) {
+		return true;
+	}
 
 	if (-1 != this->m_fd) {
 		::close(this->m_fd);
 	}
 
 	this->m_fd = this->recreateSocket();
+	return -1 != this->m_fd;
+}
+
+void SocketConnectorPrivate::watchAttempt(void)
+{
 	Q_Q(SocketConnector);
-	QMetaObject::invokeMethod(q, "_q_connectToNextAddress", Qt::QueuedConnection);
+
+	if (this->m_notifier && this->m_notifier->socket() != this->m_fd) {
+		delete this->m_notifier;
+		this->m_notifier = 0;
+	}
+
+	if (!this->m_notifier) {
+		this->m_notifier = new QSocketNotifier(this->m_fd, QSocketNotifier::Write, q);
+		QObject::connect(this->m_notifier, SIGNAL(activated(int)), q, SLOT(_q_connected(int)));
+	}
+	else if (!this->m_notifier->isEnabled()) {
+		this->m_notifier->setEnabled(true);
+	}
+
+#ifdef Q_OS_LINUX
+	// QTimer::start() allocates the timer registration every time; re-arming a timerfd does not
+	if (-1 == this->m_timerfd) {
+		this->m_timerfd = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+		if (-1 != this->m_timerfd) {
+			this->m_timer_notifier = new QSocketNotifier(this->m_timerfd, QSocketNotifier::Read, q);
+			QObject::connect(this->m_timer_notifier, SIGNAL(activated(int)), q, SLOT(_q_attemptTimedOut(int)));
+		}
+	}
+
+	if (-1 != this->m_timerfd) {
+		struct itimerspec its;
+		memset(&its, 0, sizeof(its));
+		its.it_value.tv_sec  = this->m_connectiont_timeout / 1000;
+		its.it_value.tv_nsec = long(this->m_connectiont_timeout % 1000) * 1000000;
+		if (!its.it_value.tv_sec && !its.it_value.tv_nsec) {
+			its.it_value.tv_nsec = 1;
+		}
+
+		::timerfd_settime(this->m_timerfd, 0, &its, 0);
+		return;
+	}
+#endif
+
+	if (!this->m_timer) {
+		this->m_timer = new QTimer(q);
+		this->m_timer->setSingleShot(true);
+		QObject::connect(this->m_timer, SIGNAL(timeout()), q, SLOT(_q_abortConnection()));
+	}
+
+	this->m_timer->start(this->attemptTimeout());
+}
+
+void SocketConnectorPrivate::stopAttempt(void)
+{
+	if (this->m_notifier) {
+		this->m_notifier->setEnabled(false);
+	}
+
+#ifdef Q_OS_LINUX
+	if (-1 != this->m_timerfd) {
+		struct itimerspec its;
+		memset(&its, 0, sizeof(its));
+		::timerfd_settime(this->m_timerfd, 0, &its, 0);
+
+		// Drop an expiration which has not been delivered yet
+		quint64 expirations;
+		while (-1 == ::read(this->m_timerfd, &expirations, sizeof(expirations)) && EINTR == errno) {
+		}
+	}
+#endif
+
+	if (this->m_timer) {
+		this->m_timer->stop();
+	}
 }
 
 int SocketConnectorPrivate::recreateSocket(void)
 {
-	int fd = ::socket(this->m_domain, this->m_type, this->m_proto);
+	return this->createNativeSocket(this->m_domain);
+}
+
+int SocketConnectorPrivate::createNativeSocket(int domain)
+{
+	// The options and the local address must be in place before the SYN goes out
+	bool bind = !this->m_bound_address.isNull() && !this->deferBind();
+
+	if (this->m_reservoir && this->canUseReservoir(bind)) {
+		int fd = this->m_reservoir->take(domain, this->m_type, this->m_proto, bind ? this->m_bound_address : QHostAddress());
+		if (-1 != fd) {
+			if (!this->m_profile.apply(fd, domain, this->m_type)) {
+				::close(fd);
+				return -1;
+			}
+
+			return fd;
+		}
+	}
+
+#ifdef SOCK_NONBLOCK
+	int fd = ::socket(domain, this->m_type | SOCK_NONBLOCK | SOCK_CLOEXEC, this->m_proto);
+#else
+	int fd = ::socket(domain, this->m_type, this->m_proto);
 	if (fd != -1) {
 		::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+		::fcntl(fd, F_SETFD, FD_CLOEXEC);
+	}
+#endif
 
-		if (!this->m_bound_address.isNull()) {
-			this->bindTo(this->m_bound_address, this->m_bound_port);
-		}
+	if (-1 == fd) {
+		return -1;
+	}
+
+	if (!this->m_profile.apply(fd, domain, this->m_type) || (bind && !this->bindSocket(fd, this->m_bound_address, this->m_bound_port))) {
+		::close(fd);
+		return -1;
 	}
 
 	return fd;
 }
+
+bool SocketConnectorPrivate::canUseReservoir(bool bind) const
+{
+	// The reservoir binds with IP_BIND_ADDRESS_NO_PORT, before the profile is applied
+	return !bind || (!this->m_bound_port && this->m_bind_no_port && this->m_profile.isEmpty());
+}
+
+bool SocketConnectorPrivate::canRace(void) const
+{
+	// Parallel attempts cannot share a fixed local port
+	return this->m_addresses.size() > 1 && (this->m_bound_address.isNull() || 0 == this->m_bound_port);
+}
+
+void SocketConnectorPrivate::startRace(void)
+{
+	Q_Q(SocketConnector);
+
+	this->stopAttempt();
+	delete this->m_race_timer;
+	delete this->m_race_deadline;
+
+	// The racing attempts never carry the first payload in the SYN: it is written by raceWon()
+	this->m_fastopen_sent = 0;
+
+	this->m_race_deadline = new QTimer(q);
+	this->m_race_deadline->setSingleShot(true);
+	QObject::connect(this->m_race_deadline, SIGNAL(timeout()), q, SLOT(_q_raceTimedOut()));
+
+	this->m_race_timer = new QTimer(q);
+	this->m_race_timer->setSingleShot(true);
+	QObject::connect(this->m_race_timer, SIGNAL(timeout()), q, SLOT(_q_raceNextAttempt()));
+
+	this->_q_raceNextAttempt();
+}
+
+void SocketConnectorPrivate::stopRace(int keep)
+{
+	for (int i=0; i<this->m_race.size(); ++i) {
+		const RaceAttempt& r = this->m_race.at(i);
+		r.notifier->setEnabled(false);
+		if (r.notifier->socket() != keep) {
+			this->attemptFinished(r.address, r.started, r.timing, ECANCELED);
+			::close(r.notifier->socket());
+		}
+
+		r.notifier->deleteLater();
+	}
+
+	this->m_race.clear();
+
+	if (this->m_race_timer) {
+		this->m_race_timer->stop();
+		this->m_race_timer->deleteLater();
+		this->m_race_timer = 0;
+
+		this->m_race_deadline->stop();
+		this->m_race_deadline->deleteLater();
+		this->m_race_deadline = 0;
+	}
+}
+
+void SocketConnectorPrivate::raceWon(int fd)
+{
+	this->stopRace(fd);
+
+	if (-1 != this->m_fd) {
+		::close(this->m_fd);
+	}
+
+	this->m_fd = fd;
+	this->finishFastOpen();
+	this->setConnected();
+}
+
+void SocketConnectorPrivate::setConnected(void)
+{
+	this->m_addresses.clear();
+	this->m_connected_source.clear();
+
+	if (this->m_source_set && AF_UNIX != this->m_domain) {
+		struct sockaddr_storage ss;
+		socklen_t l = sizeof(ss);
+		if (!::getsockname(this->m_fd, reinterpret_cast<struct sockaddr*>(&ss), &l)) {
+			this->m_connected_source.setAddress(reinterpret_cast<struct sockaddr*>(&ss));
+			this->m_source_set->connectionOpened(this->m_connected_source);
+		}
+	}
+
+	this->m_state = QAbstractSocket::ConnectedState;
+	this->finishConnection(true, true);
+	this->stopReconnect();
+	this->m_reconnect_attempt = 0;
+	this->m_reconnect_sleep   = 0;
+
+	Q_Q(SocketConnector);
+	Q_EMIT q->stateChanged(this->m_state);
+	Q_EMIT q->connected();
+}
+
+void SocketConnectorPrivate::finishFuture(qintptr fd)
+{
+	if (!this->m_future_pending) {
+		return;
+	}
+
+	this->m_future_pending = false;
+
+	// Nobody is going to take the result of a cancelled future
+	if (this->m_future.isCanceled() && -1 != fd) {
+		::close(int(fd));
+		fd = -1;
+	}
+
+	this->m_future.reportResult(fd);
+	this->m_future.reportFinished();
+	this->m_future = QFutureInterface<qintptr>();
+}
+
+void SocketConnectorPrivate::releaseSource(void)
+{
+	if (this->m_source_set && !this->m_connected_source.isNull()) {
+		this->m_source_set->release(this->m_connected_source);
+	}
+
+	this->m_connected_source.clear();
+}
+
+void SocketConnectorPrivate::_q_raceNextAttempt(void)
+{
+	Q_Q(SocketConnector);
+
+	while (!this->m_addresses.isEmpty()) {
+		QHostAddress address = this->m_addresses.takeFirst();
+		if (!this->m_bound_address.isNull() && this->m_bound_address.protocol() != address.protocol()) {
+			continue;
+		}
+
+		int fd;
+		int res;
+		qint64 started;
+		int timing = this->attemptStarted(address, started);
+		switch (address.protocol()) {
+			case QAbstractSocket::IPv4Protocol:
+				fd  = this->createNativeSocket(AF_INET);
+				res = (-1 != fd) ? this->connectV4(fd, address) : -1;
+				break;
+
+			case QAbstractSocket::IPv6Protocol:
+				fd  = this->createNativeSocket(AF_INET6);
+				res = (-1 != fd) ? this->connectV6(fd, address) : -1;
+				break;
+
+			default:
+				fd  = -1;
+				res = -1;
+				errno = EAFNOSUPPORT;
+				break;
+		}
+
+		if (!res) {
+			this->attemptFinished(address, started, timing, 0);
+			this->raceWon(fd);
+			return;
+		}
+
+		if (-1 != fd && EINPROGRESS == errno) {
+			RaceAttempt r;
+			r.notifier = new QSocketNotifier(fd, QSocketNotifier::Write, q);
+			r.address  = address;
+			r.started  = started;
+			r.timing   = timing;
+			QObject::connect(r.notifier, SIGNAL(activated(int)), q, SLOT(_q_raceAttemptReady(int)));
+			this->m_race.append(r);
+
+			if (!this->m_addresses.isEmpty()) {
+				this->m_race_timer->start(this->m_attempt_delay);
+			}
+
+			// The deadline covers all the attempts in flight: the staggered ones do not push it back
+			if (!this->m_race_deadline->isActive()) {
+				this->m_race_deadline->start(this->attemptTimeout());
+			}
+
+			return;
+		}
+
+		this->attemptFinished(address, started, timing, errno);
+		if (-1 != fd) {
+			::close(fd);
+		}
+	}
+
+	if (this->m_race.isEmpty()) {
+		this->stopRace(-1);
+		this->finishConnection(false, true);
+		this->m_state = QAbstractSocket::UnconnectedState;
+		this->m_error = QAbstractSocket::ConnectionRefusedError;
+		Q_EMIT q->stateChanged(this->m_state);
+		Q_EMIT q->error(this->m_error);
+	}
+}
+
+void SocketConnectorPrivate::_q_raceAttemptReady(int sock)
+{
+	int idx = -1;
+	for (int i=0; i<this->m_race.size(); ++i) {
+		if (this->m_race.at(i).notifier->socket() == sock) {
+			idx = i;
+			break;
+		}
+	}
+
+	if (-1 == idx) {
+		return;
+	}
+
+	RaceAttempt r = this->m_race.at(idx);
+	r.notifier->setEnabled(false);
+
+	int err = 0;
+	socklen_t l = sizeof(err);
+	::getsockopt(sock, SOL_SOCKET, SO_ERROR, &err, &l);
+
+	this->attemptFinished(r.address, r.started, r.timing, err);
+	if (!err) {
+		this->raceWon(sock);
+		return;
+	}
+
+	this->m_race.removeAt(idx);
+	r.notifier->deleteLater();
+	::close(sock);
+
+	// A failed attempt does not have to wait for the attempt delay to expire
+	this->m_race_timer->stop();
+	this->_q_raceNextAttempt();
+}
+
+void SocketConnectorPrivate::_q_raceTimedOut(void)
+{
+	for (int i=0; i<this->m_race.size(); ++i) {
+		const RaceAttempt& r = this->m_race.at(i);
+		r.notifier->setEnabled(false);
+		this->attemptFinished(r.address, r.started, r.timing, ETIMEDOUT);
+		::close(r.notifier->socket());
+		r.notifier->deleteLater();
+	}
+
+	this->m_race.clear();
+	this->m_race_timer->stop();
+	this->_q_raceNextAttempt();
+}
+
+void SocketConnectorPrivate::startTimings(void)
+{
+	if (this->m_timings_enabled) {
+		this->m_timings = SocketConnector::ConnectionTimings();
+		this->m_timings.lookupStarted = monotonicNsecs();
+		this->m_timing_mark = -1;
+	}
+}
+
+void SocketConnectorPrivate::lookupTimed(void)
+{
+	if (this->m_timings_enabled) {
+		// The end of the lookup is the start of the first attempt
+		this->m_timing_mark = monotonicNsecs();
+		this->m_timings.lookupFinished = this->m_timing_mark;
+	}
+	else {
+		this->m_timing_mark = -1;
+	}
+}
+
+int SocketConnectorPrivate::attemptStarted(const QHostAddress& a, qint64& started)
+{
+	started = -1;
+	if (!this->m_timings_enabled && !this->m_scoreboard) {
+		return -1;
+	}
+
+	started = (-1 != this->m_timing_mark) ? this->m_timing_mark : monotonicNsecs();
+	this->m_timing_mark = -1;
+
+	if (!this->m_timings_enabled) {
+		return -1;
+	}
+
+	SocketConnector::ConnectionTimings::Attempt attempt;
+	attempt.address = a;
+	attempt.started = started;
+	this->m_timings.attempts.append(attempt);
+	return this->m_timings.attempts.size() - 1;
+}
+
+void SocketConnectorPrivate::attemptFinished(const QHostAddress& a, qint64 started, int timing, int err)
+{
+	if (-1 == started) {
+		return;
+	}
+
+	// The end of a sequential attempt is the start of the next one
+	qint64 now = monotonicNsecs();
+	this->m_timing_mark = now;
+
+	if (-1 != timing && timing < this->m_timings.attempts.size()) {
+		SocketConnector::ConnectionTimings::Attempt& attempt = this->m_timings.attempts[timing];
+		attempt.finished = now;
+		attempt.error    = err;
+	}
+
+	// An attempt abandoned because another one won says nothing about the address
+	if (this->m_scoreboard && ECANCELED != err) {
+		if (err) {
+			this->m_scoreboard->reportFailure(a, this->m_port, err);
+		}
+		else {
+			this->m_scoreboard->reportSuccess(a, this->m_port, (now - started) / 1000);
+		}
+	}
+}
+
+void SocketConnectorPrivate::currentAttemptFinished(int err)
+{
+	if (this->m_next_address > 0 && this->m_next_address <= this->m_addresses.size()) {
+		this->attemptFinished(this->m_addresses.at(this->m_next_address - 1), this->m_attempt_started, this->m_attempt_timing, err);
+	}
+
+	this->m_attempt_started = -1;
+	this->m_attempt_timing  = -1;
+}
+
+bool SocketConnectorPrivate::admit(const QString& host, quint16 port)
+{
+	if (!this->m_breaker) {
+		return true;
+	}
+
+	if (!this->m_breaker->allow(host, port)) {
+		return false;
+	}
+
+	this->m_breaker_host    = host;
+	this->m_breaker_pending = true;
+	return true;
+}
+
+void SocketConnectorPrivate::finishConnection(bool ok, bool notify)
+{
+	if (this->m_breaker_pending && this->m_breaker) {
+		this->m_breaker_pending = false;
+		if (ok) {
+			this->m_breaker->reportSuccess(this->m_breaker_host, this->m_port);
+		}
+		else {
+			this->m_breaker->reportFailure(this->m_breaker_host, this->m_port);
+		}
+	}
+
+	if (!this->m_timings_enabled) {
+		return;
+	}
+
+	qint64 now = (-1 != this->m_timing_mark) ? this->m_timing_mark : monotonicNsecs();
+	this->m_timing_mark = -1;
+	this->m_timings.finished  = now;
+	this->m_timings.connected = ok;
+
+	if (notify) {
+		Q_Q(SocketConnector);
+		Q_EMIT q->connectionTimed(this->m_timings);
+	}
+}
+
+void SocketConnectorPrivate::_q_settleFuture(void)
+{
+	if (!this->m_future_pending) {
+		return;
+	}
+
+	qintptr fd = -1;
+	if (QAbstractSocket::ConnectedState == this->m_state) {
+		fd            = this->m_fd;
+		this->m_fd    = -1;
+		this->m_state = QAbstractSocket::UnconnectedState;
+
+		// The source address goes with the descriptor; a cancelled future has nobody to release it
+		if (this->m_future.isCanceled()) {
+			this->releaseSource();
+		}
+
+		this->m_connected_source.clear();
+	}
+
+	this->finishFuture(fd);
+}
+
+void SocketConnectorPrivate::_q_futureCanceled(void)
+{
+	if (this->m_future_pending) {
+		this->abort();
+	}
+}
+
+void SocketConnectorPrivate::setReconnectEnabled(bool enable)
+{
+	Q_Q(SocketConnector);
+
+	this->m_reconnect_enabled = enable;
+	if (!enable) {
+		this->stopReconnect();
+		return;
+	}
+
+	if (!this->m_reconnect_timer) {
+		// Set up once: every terminal error() of a connection started with connectToHost() goes through _q_connectionFailed()
+		this->m_reconnect_timer = new QTimer(q);
+		this->m_reconnect_timer->setSingleShot(true);
+		QObject::connect(this->m_reconnect_timer, SIGNAL(timeout()), q, SLOT(_q_reconnect()));
+		QObject::connect(q, SIGNAL(error(QAbstractSocket::SocketError)), q, SLOT(_q_connectionFailed()));
+	}
+}
+
+bool SocketConnectorPrivate::reconnect(void)
+{
+	if (!this->m_reconnect_enabled || this->m_reconnect_host.isEmpty()) {
+		qWarning("%s: enable auto-reconnect and call SocketConnector::connectToHost() first", Q_FUNC_INFO);
+		return false;
+	}
+
+	if (QAbstractSocket::UnconnectedState != this->m_state && QAbstractSocket::BoundState != this->m_state) {
+		qWarning("%s called when already looking up or connecting/connected to \"%s\"", Q_FUNC_INFO, qPrintable(this->m_reconnect_host));
+		return false;
+	}
+
+	if (this->m_reconnect_timer->isActive()) {
+		return true;
+	}
+
+	this->m_reconnect_armed = true;
+	return this->scheduleReconnect();
+}
+
+bool SocketConnectorPrivate::scheduleReconnect(void)
+{
+	Q_Q(SocketConnector);
+
+	if (this->m_max_reconnect_attempts >= 0 && this->m_reconnect_attempt >= this->m_max_reconnect_attempts) {
+		this->m_reconnect_armed = false;
+		Q_EMIT q->reconnectAbandoned(this->m_reconnect_attempt);
+		return false;
+	}
+
+	/*
+	 * Decorrelated jitter: the next delay is random between the base delay and three times the previous one.
+	 * The delays grow exponentially on average, but the clients which have lost their connections together
+	 * do not come back together. A delay above INT_MAX would turn negative for QTimer and reconnectScheduled()
+	 */
+	quint32 base  = qMax(this->m_reconnect_delay, 1u);
+	quint32 cap   = qMin(qMax(this->m_max_reconnect_delay, base), quint32(INT_MAX));
+	quint64 upper = quint64(this->m_reconnect_sleep ? this->m_reconnect_sleep : base) * 3;
+	quint64 delay = base + this->nextRandom() % (upper - base + 1);
+
+	this->m_reconnect_sleep = uint(qMin(delay, quint64(cap)));
+	++this->m_reconnect_attempt;
+
+	this->m_reconnect_timer->start(int(this->m_reconnect_sleep));
+	Q_EMIT q->reconnectScheduled(this->m_reconnect_attempt, int(this->m_reconnect_sleep));
+	return true;
+}
+
+void SocketConnectorPrivate::stopReconnect(void)
+{
+	this->m_reconnect_armed = false;
+	if (this->m_reconnect_timer) {
+		this->m_reconnect_timer->stop();
+	}
+}
+
+quint32 SocketConnectorPrivate::nextRandom(void)
+{
+	// xorshift32; qrand() is seeded with the same value in every thread and process, which is what the jitter has to avoid
+	quint32 x = this->m_reconnect_seed;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	this->m_reconnect_seed = x;
+	return x;
+}
+
+void SocketConnectorPrivate::_q_reconnect(void)
+{
+	if (!this->m_reconnect_armed || (QAbstractSocket::UnconnectedState != this->m_state && QAbstractSocket::BoundState != this->m_state)) {
+		return;
+	}
+
+	Q_Q(SocketConnector);
+
+	if (-1 == this->m_fd) {
+		// The previous connection has been handed off or closed: the socket is made again as createSocket() and bindTo() have left it
+		if (this->m_bound_address.isNull() && !this->m_rebind_address.isNull()) {
+			this->m_bound_address = this->m_rebind_address;
+			this->m_bound_port    = this->m_rebind_port;
+		}
+
+		this->m_fd = this->recreateSocket();
+		if (-1 == this->m_fd) {
+			// Counts as a failed attempt: _q_connectionFailed() schedules the next one
+			this->m_error = QAbstractSocket::SocketResourceError;
+			Q_EMIT q->error(this->m_error);
+			return;
+		}
+
+		if (!this->m_bound_address.isNull()) {
+			this->m_state = QAbstractSocket::BoundState;
+			Q_EMIT q->stateChanged(this->m_state);
+		}
+	}
+
+	this->m_reconnecting = true;
+	this->connectToHost(this->m_reconnect_host, quint16(this->m_port));
+	this->m_reconnecting = false;
+}
+
+void SocketConnectorPrivate::_q_connectionFailed(void)
+{
+	// The handler of error() may have started another connection by itself
+	if (!this->m_reconnect_enabled || !this->m_reconnect_armed || (QAbstractSocket::UnconnectedState != this->m_state && QAbstractSocket::BoundState != this->m_state)) {
+		return;
+	}
+
+	this->scheduleReconnect();
+}
+
+bool SocketConnectorPrivate::prefetch(const QString& host, quint16 port, bool connect, int budget)
+{
+	Q_Q(SocketConnector);
+
+	if (AF_UNIX == this->m_domain || host.isEmpty()) {
+		return false;
+	}
+
+	if (host == this->m_prefetch_host && port == this->m_prefetch_port) {
+		// The same target: the work goes on with the new budget
+		this->m_prefetch_timer->start(budget);
+		if (connect && !this->m_prefetch_connect) {
+			this->m_prefetch_connect = true;
+			if (this->m_prefetch_resolved) {
+				this->m_prefetch_next = 0;
+				this->prefetchNextAddress();
+			}
+		}
+
+		return true;
+	}
+
+	this->dropPrefetch(true);
+
+	++this->m_prefetch_count;
+	this->m_prefetch_host    = host;
+	this->m_prefetch_port    = port;
+	this->m_prefetch_connect = connect;
+
+	if (!this->m_prefetch_timer) {
+		this->m_prefetch_timer = new QTimer(q);
+		this->m_prefetch_timer->setSingleShot(true);
+		QObject::connect(this->m_prefetch_timer, SIGNAL(timeout()), q, SLOT(_q_prefetchExpired()));
+	}
+
+	this->m_prefetch_timer->start(budget);
+
+	QHostAddress tmp;
+	QHostInfo info;
+	if (tmp.setAddress(host)) {
+		this->prefetchResolved(QList<QHostAddress>() << tmp);
+	}
+	else if (this->m_cache && this->m_cache->cachedHostInfo(host, &info)) {
+		this->prefetchResolved(info.addresses());
+	}
+	else if (this->m_cache) {
+		this->m_prefetch_lookup_id = this->m_cache->lookupHost(host, q, SLOT(_q_prefetchLookedUp(QHostInfo)));
+	}
+	else {
+		this->m_prefetch_lookup_id = QHostInfo::lookupHost(host, q, SLOT(_q_prefetchLookedUp(QHostInfo)));
+	}
+
+	return true;
+}
+
+void SocketConnectorPrivate::prefetchResolved(const QList<QHostAddress>& addresses)
+{
+	this->m_prefetch_lookup_id = -1;
+	this->m_prefetch_resolved  = true;
+	this->m_prefetch_addresses = this->m_scoreboard ? this->m_scoreboard->order(addresses, this->m_prefetch_port) : addresses;
+	this->m_prefetch_next      = 0;
+
+	if (this->m_prefetch_connect) {
+		this->prefetchNextAddress();
+	}
+}
+
+void SocketConnectorPrivate::prefetchNextAddress(void)
+{
+	/*
+	 * The connection must be the one connectToHost() would have made: the socket of the same family, options and local address.
+	 * A fixed local port cannot be shared, and the fast open payload must not be sent to a server which may never be used
+	 */
+	if (SOCK_STREAM != this->m_type || !this->m_fastopen_data.isEmpty() || (!this->m_bound_address.isNull() && 0 != this->m_bound_port)) {
+		return;
+	}
+
+	Q_Q(SocketConnector);
+
+	while (this->m_prefetch_next < this->m_prefetch_addresses.size()) {
+		const QHostAddress& a = this->m_prefetch_addresses.at(this->m_prefetch_next++);
+		int family;
+		switch (a.protocol()) {
+			case QAbstractSocket::IPv4Protocol: family = AF_INET;  break;
+			case QAbstractSocket::IPv6Protocol: family = AF_INET6; break;
+			default: continue;
+		}
+
+		if (family != this->m_domain) {
+			continue;
+		}
+
+		int fd = this->createNativeSocket(family);
+		if (-1 == fd) {
+			return;
+		}
+
+		// connectV4() and connectV6() take the port of the connection being made
+		int port     = this->m_port;
+		this->m_port = this->m_prefetch_port;
+		int res      = (AF_INET == family) ? this->connectV4(fd, a) : this->connectV6(fd, a);
+		int err      = errno;
+		this->m_port = port;
+
+		if (!res) {
+			this->m_prefetch_fd        = fd;
+			this->m_prefetch_connected = true;
+			return;
+		}
+
+		if (EINPROGRESS == err) {
+			this->m_prefetch_fd       = fd;
+			this->m_prefetch_notifier = new QSocketNotifier(fd, QSocketNotifier::Write, q);
+			QObject::connect(this->m_prefetch_notifier, SIGNAL(activated(int)), q, SLOT(_q_prefetchReady(int)));
+			return;
+		}
+
+		::close(fd);
+	}
+}
+
+bool SocketConnectorPrivate::claimPrefetch(const QString& host, quint16 port)
+{
+	if (this->m_prefetch_host.isNull() || host != this->m_prefetch_host || port != this->m_prefetch_port) {
+		return false;
+	}
+
+	++this->m_prefetch_hits;
+
+	if (-1 != this->m_prefetch_lookup_id) {
+		// The lookup goes on for connectToHost(): _q_prefetchLookedUp() hands the result over
+		this->m_lookup_id          = this->m_prefetch_lookup_id;
+		this->m_prefetch_lookup_id = -1;
+		this->dropPrefetch(false);
+		return true;
+	}
+
+	QList<QHostAddress> addresses = this->m_prefetch_addresses;
+	int fd         = this->m_prefetch_fd;
+	int next       = this->m_prefetch_next;
+	bool connected = this->m_prefetch_connected;
+
+	this->m_prefetch_fd = -1;
+	this->dropPrefetch(false);
+
+	// The socket may have been created anew since prefetch()
+	if (-1 != fd && (QAbstractSocket::IPv4Protocol == addresses.at(next - 1).protocol() ? AF_INET : AF_INET6) != this->m_domain) {
+		::close(fd);
+		fd = -1;
+	}
+
+	if (-1 == fd) {
+		QHostInfo info;
+		info.setAddresses(addresses);
+		this->_q_startConnecting(info);
+		return true;
+	}
+
+	Q_Q(SocketConnector);
+
+	// The speculative connection replaces the socket made by createSocket(); the remaining addresses are tried if it fails
+	if (-1 != this->m_fd) {
+		::close(this->m_fd);
+	}
+
+	this->m_fd           = fd;
+	this->m_addresses    = addresses;
+	this->m_next_address = next;
+	this->lookupTimed();
+
+	this->m_state = QAbstractSocket::ConnectingState;
+	Q_EMIT q->stateChanged(this->m_state);
+	Q_EMIT q->hostFound();
+
+	if (connected) {
+		this->finishFastOpen();
+		this->setConnected();
+	}
+	else {
+		this->m_attempt_timing = this->attemptStarted(addresses.at(next - 1), this->m_attempt_started);
+		this->watchAttempt();
+	}
+
+	return true;
+}
+
+void SocketConnectorPrivate::dropPrefetch(bool expired)
+{
+	if (this->m_prefetch_host.isNull()) {
+		return;
+	}
+
+	if (-1 != this->m_prefetch_lookup_id) {
+		if (this->m_cache) {
+			this->m_cache->abortHostLookup(this->m_prefetch_lookup_id);
+		}
+		else {
+			QHostInfo::abortHostLookup(this->m_prefetch_lookup_id);
+		}
+	}
+
+	if (this->m_prefetch_notifier) {
+		this->m_prefetch_notifier->setEnabled(false);
+		this->m_prefetch_notifier->deleteLater();
+		this->m_prefetch_notifier = 0;
+	}
+
+	if (-1 != this->m_prefetch_fd) {
+		::close(this->m_prefetch_fd);
+	}
+
+	if (this->m_prefetch_timer) {
+		this->m_prefetch_timer->stop();
+	}
+
+	if (expired) {
+		++this->m_prefetch_expired;
+	}
+
+	this->m_prefetch_host.clear();
+	this->m_prefetch_port      = 0;
+	this->m_prefetch_connect   = false;
+	this->m_prefetch_lookup_id = -1;
+	this->m_prefetch_addresses.clear();
+	this->m_prefetch_resolved  = false;
+	this->m_prefetch_next      = 0;
+	this->m_prefetch_fd        = -1;
+	this->m_prefetch_connected = false;
+}
+
+void SocketConnectorPrivate::_q_prefetchLookedUp(const QHostInfo& info)
+{
+	if (-1 != this->m_lookup_id && info.lookupId() == this->m_lookup_id) {
+		// The lookup has been claimed by connectToHost()
+		this->_q_startConnecting(info);
+		return;
+	}
+
+	if (-1 != this->m_prefetch_lookup_id && info.lookupId() == this->m_prefetch_lookup_id) {
+		this->prefetchResolved(info.addresses());
+	}
+}
+
+void SocketConnectorPrivate::_q_prefetchReady(int sock)
+{
+	if (sock != this->m_prefetch_fd) {
+		return;
+	}
+
+	this->m_prefetch_notifier->setEnabled(false);
+	this->m_prefetch_notifier->deleteLater();
+	this->m_prefetch_notifier = 0;
+
+	int err = 0;
+	socklen_t l = sizeof(err);
+	::getsockopt(sock, SOL_SOCKET, SO_ERROR, &err, &l);
+
+	if (!err) {
+		this->m_prefetch_connected = true;
+		return;
+	}
+
+	::close(sock);
+	this->m_prefetch_fd = -1;
+	this->prefetchNextAddress();
+}
+
+void SocketConnectorPrivate::_q_prefetchExpired(void)
+{
+	this->dropPrefetch(true);
+}
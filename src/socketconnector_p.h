@@ -1,8 +1,14 @@
 #ifndef SOCKETCONNECTOR_P_H
 #define SOCKETCONNECTOR_P_H
 
+#include <QtCore/QByteArray>
+#include <QtCore/QFutureInterface>
+#include <QtCore/QFutureWatcher>
 #include <QtNetwork/QHostAddress>
+#include <sys/socket.h>
 #include <QtNetwork/QHostInfo>
+#include "socketconnector.h"
+#include "socketoptionprofile.h"
 #include "qt4compat.h"
 
 #if QT_VERSION >= 0x040400
@@ -13,7 +19,13 @@ class QSocketNotifier;
 class QTimer;
 #endif
 
+class AddressScoreboard;
+class CircuitBreaker;
+class HostInfoCache;
+class PortAllocator;
 class SocketConnector;
+class SocketReservoir;
+class SourceAddressSet;
 
 class Q_DECL_HIDDEN SocketConnectorPrivate {
 	Q_DECLARE_PUBLIC(SocketConnector)
@@ -29,6 +41,12 @@ public:
 	void abort(void);
 
 	bool waitForConnected(int timeout);
+	QFuture<qintptr> connectAsync(const QString& address, quint16 port);
+	qintptr connectBlocking(const QString& address, quint16 port, int timeout);
+
+	void setReconnectEnabled(bool enable);
+	bool reconnect(void);
+	bool prefetch(const QString& host, quint16 port, bool connect, int budget);
 private:
 	int m_fd;
 	int m_domain;
@@ -39,22 +57,136 @@ private:
 	QAbstractSocket::SocketState m_state;
 	QAbstractSocket::SocketError m_error;
 	QList<QHostAddress> m_addresses;
+	int m_next_address;
 	QHostAddress m_bound_address;
 	quint16 m_bound_port;
 	int m_lookup_id;
+	HostInfoCache* m_cache;
 	QSocketNotifier* m_notifier;
 	QTimer* m_timer;
+	int m_timerfd;
+	QSocketNotifier* m_timer_notifier;
+	bool m_happy_eyeballs;
+	uint m_attempt_delay;
+	struct RaceAttempt {
+		QSocketNotifier* notifier;
+		QHostAddress address;
+		qint64 started;
+		int timing;
+	};
+
+	QList<RaceAttempt> m_race;
+	QTimer* m_race_timer;
+	QTimer* m_race_deadline;
+	QByteArray m_fastopen_data;
+	int m_fastopen_sent;
+	bool m_fastopen_accepted;
+	SocketOptionProfile m_profile;
+	bool m_bind_no_port;
+	PortAllocator* m_port_allocator;
+	SourceAddressSet* m_source_set;
+	SocketReservoir* m_reservoir;
+	QHostAddress m_connected_source;
+	bool m_timings_enabled;
+	SocketConnector::ConnectionTimings m_timings;
+	qint64 m_timing_mark;
+	qint64 m_attempt_started;
+	int m_attempt_timing;
+	AddressScoreboard* m_scoreboard;
+	CircuitBreaker* m_breaker;
+	QString m_breaker_host;
+	bool m_breaker_pending;
+	QFutureInterface<qintptr> m_future;
+	bool m_future_pending;
+	QFutureWatcher<qintptr>* m_future_watcher;
+	bool m_reconnect_enabled;
+	uint m_reconnect_delay;
+	uint m_max_reconnect_delay;
+	int m_max_reconnect_attempts;
+	int m_reconnect_attempt;
+	uint m_reconnect_sleep;
+	quint32 m_reconnect_seed;
+	bool m_reconnect_armed;
+	bool m_reconnecting;
+	QString m_reconnect_host;
+	QHostAddress m_rebind_address;
+	quint16 m_rebind_port;
+	QTimer* m_reconnect_timer;
+	QString m_prefetch_host;
+	quint16 m_prefetch_port;
+	bool m_prefetch_connect;
+	int m_prefetch_lookup_id;
+	QList<QHostAddress> m_prefetch_addresses;
+	bool m_prefetch_resolved;
+	int m_prefetch_next;
+	int m_prefetch_fd;
+	bool m_prefetch_connected;
+	QSocketNotifier* m_prefetch_notifier;
+	QTimer* m_prefetch_timer;
+	quint64 m_prefetch_count;
+	quint64 m_prefetch_hits;
+	quint64 m_prefetch_expired;
 
 	int recreateSocket(void);
-	bool bindV4(const QHostAddress& a, quint16 port);
-	bool bindV6(const QHostAddress& a, quint16 port);
-	int connectV4(const QHostAddress& a);
-	int connectV6(const QHostAddress& a);
+	bool resetSocket(void);
+	int createNativeSocket(int domain);
+	bool canUseReservoir(bool bind) const;
+	bool bindSocket(int fd, const QHostAddress& a, quint16 port);
+	bool bindV4(int fd, const QHostAddress& a, quint16 port);
+	bool bindV6(int fd, const QHostAddress& a, quint16 port);
+	int connectV4(int fd, const QHostAddress& a);
+	int connectV6(int fd, const QHostAddress& a);
+	int connectFrom(int fd, int domain, const QHostAddress& a, const struct sockaddr* sa, socklen_t len);
+	int connectFromSource(int fd, int domain, const QHostAddress& source, const QHostAddress& a, const struct sockaddr* sa, socklen_t len, bool& dirty);
+	int connectAddress(int fd, const struct sockaddr* sa, socklen_t len);
+	int connectLocal(int fd, const QString& path);
+	void connectToPath(const QString& path);
+	bool deferBind(void) const;
+	bool replaceSocket(int fd, int domain);
+	bool pollConnected(int fd, int timeout);
+	int attemptTimeout(void) const;
+	void finishFastOpen(void);
+	void setConnected(void);
+	void startTimings(void);
+	void lookupTimed(void);
+	int attemptStarted(const QHostAddress& a, qint64& started);
+	void attemptFinished(const QHostAddress& a, qint64 started, int timing, int err);
+	void currentAttemptFinished(int err);
+	bool admit(const QString& host, quint16 port);
+	void finishConnection(bool ok, bool notify);
+	void releaseSource(void);
+	void finishFuture(qintptr fd);
+	bool scheduleReconnect(void);
+	void stopReconnect(void);
+	quint32 nextRandom(void);
+	void prefetchResolved(const QList<QHostAddress>& addresses);
+	void prefetchNextAddress(void);
+	bool claimPrefetch(const QString& host, quint16 port);
+	void dropPrefetch(bool expired);
+
+	void watchAttempt(void);
+	void stopAttempt(void);
+
+	bool canRace(void) const;
+	void startRace(void);
+	void stopRace(int keep);
+	void raceWon(int fd);
 
 	void _q_startConnecting(const QHostInfo& info);
 	void _q_connectToNextAddress(void);
 	void _q_connected(int sock);
 	void _q_abortConnection(void);
+	void _q_attemptTimedOut(int fd);
+	void _q_raceNextAttempt(void);
+	void _q_raceAttemptReady(int sock);
+	void _q_raceTimedOut(void);
+	void _q_settleFuture(void);
+	void _q_futureCanceled(void);
+	void _q_reconnect(void);
+	void _q_connectionFailed(void);
+	void _q_prefetchLookedUp(const QHostInfo& info);
+	void _q_prefetchReady(int sock);
+	void _q_prefetchExpired(void);
 };
 
 #endif // SOCKETCONNECTOR_P_H
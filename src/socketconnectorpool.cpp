@@ -0,0 +1,217 @@
+#include <unistd.h>
+#include "socketconnectorpool.h"
+#include "socketconnectorpool_p.h"
+
+/**
+ * @class SocketConnectorPool
+ *
+ * @brief The SocketConnectorPool class keeps a number of pre-connected sockets ready to be handed out
+ *
+ * Connections are grouped by the key (host, port, local address). For every known key the pool keeps between
+ * minIdle() and maxIdle() connected descriptors: when the number of idle and pending connections drops below minIdle(),
+ * the pool starts enough SocketConnector's in the background to get back to maxIdle().
+ *
+ * acquire() hands out an idle connection with a single call to @c QAbstractSocket::setSocketDescriptor().
+ * If there is no idle connection for the key, acquire() fails immediately (this is counted as a miss),
+ * and the caller is expected to connect on its own; the key gets warmed up for the subsequent calls.
+ *
+ * Connections which have been idle for longer than idleTimeout() or which have been closed by the peer are discarded.
+ *
+ * A host name is resolved before its first connections are started, and the sockets are made for the family of the first
+ * address. When the connections of a key fail, the key is not refilled for a second; the delay doubles with every further
+ * failure, up to a minute, and the host name is resolved again.
+ */
+
+/**
+ * @brief Creates a new @c SocketConnectorPool
+ * @param parent Object parent
+ */
+SocketConnectorPool::SocketConnectorPool(QObject* parent)
+	: QObject(parent), d_ptr(new SocketConnectorPoolPrivate(this))
+{
+}
+
+/**
+ * @brief Destroys the @c SocketConnectorPool and closes all idle connections
+ */
+SocketConnectorPool::~SocketConnectorPool(void)
+{
+#if QT_VERSION < 0x040600
+	delete this->d_ptr;
+	this->d_ptr = 0;
+#endif
+}
+
+/**
+ * @brief Starts establishing minIdle() connections to @a host on the given @a port
+ * @param host Host address or name
+ * @param port Host port, in native byte order
+ * @param local Local address to bind the connections to (if null, the connections are not bound)
+ */
+void SocketConnectorPool::warmUp(const QString& host, quint16 port, const QHostAddress& local)
+{
+	Q_D(SocketConnectorPool);
+	d->warmUp(SocketConnectorPoolKey(host, port, local));
+}
+
+/**
+ * @brief Assigns an idle connection to @a target
+ * @param target Target socket
+ * @param host Host address or name
+ * @param port Host port, in native byte order
+ * @param local Local address the connection must be bound to
+ * @return Whether an idle connection was available and @c target->setSocketDescriptor() succeeded
+ * @see acquireDescriptor()
+ */
+bool SocketConnectorPool::acquire(QAbstractSocket* target, const QString& host, quint16 port, const QHostAddress& local)
+{
+	qintptr fd = this->acquireDescriptor(host, port, local);
+	if (-1 == fd) {
+		return false;
+	}
+
+	if (!target->setSocketDescriptor(fd, QAbstractSocket::ConnectedState, QIODevice::ReadWrite)) {
+		::close(int(fd));
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief Takes an idle connection out of the pool
+ * @param host Host address or name
+ * @param port Host port, in native byte order
+ * @param local Local address the connection must be bound to
+ * @return Native socket descriptor (the caller becomes its owner), or -1 if there is no idle connection
+ */
+qintptr SocketConnectorPool::acquireDescriptor(const QString& host, quint16 port, const QHostAddress& local)
+{
+	Q_D(SocketConnectorPool);
+	return d->acquire(SocketConnectorPoolKey(host, port, local));
+}
+
+/**
+ * @brief Closes all idle connections, aborts all pending ones and forgets all keys
+ */
+void SocketConnectorPool::clear(void)
+{
+	Q_D(SocketConnectorPool);
+	d->clear();
+}
+
+/**
+ * @brief Returns the number of idle connections for the given key
+ * @param host Host address or name
+ * @param port Host port, in native byte order
+ * @param local Local address
+ * @return Number of idle connections
+ */
+int SocketConnectorPool::idleCount(const QString& host, quint16 port, const QHostAddress& local) const
+{
+	Q_D(const SocketConnectorPool);
+	return d->idleCount(SocketConnectorPoolKey(host, port, local));
+}
+
+/**
+ * @brief Sets the low watermark of idle connections per key
+ * @param n Number of connections (2 by default)
+ */
+void SocketConnectorPool::setMinIdle(int n)
+{
+	Q_D(SocketConnectorPool);
+	d->m_min_idle = qMax(0, n);
+}
+
+/**
+ * @brief Returns the low watermark of idle connections per key
+ * @return Number of connections
+ */
+int SocketConnectorPool::minIdle(void) const
+{
+	Q_D(const SocketConnectorPool);
+	return d->m_min_idle;
+}
+
+/**
+ * @brief Sets the maximum number of idle connections per key
+ * @param n Number of connections (4 by default)
+ */
+void SocketConnectorPool::setMaxIdle(int n)
+{
+	Q_D(SocketConnectorPool);
+	d->m_max_idle = qMax(0, n);
+}
+
+/**
+ * @brief Returns the maximum number of idle connections per key
+ * @return Number of connections
+ */
+int SocketConnectorPool::maxIdle(void) const
+{
+	Q_D(const SocketConnectorPool);
+	return d->m_max_idle;
+}
+
+/**
+ * @brief Sets the time after which an idle connection is discarded
+ * @param timeout Timeout (msec); 0 means that idle connections never expire. The default is 60000.
+ */
+void SocketConnectorPool::setIdleTimeout(uint timeout)
+{
+	Q_D(SocketConnectorPool);
+	d->m_idle_timeout = timeout;
+}
+
+/**
+ * @brief Returns the time after which an idle connection is discarded
+ * @return Timeout (msec)
+ */
+uint SocketConnectorPool::idleTimeout(void) const
+{
+	Q_D(const SocketConnectorPool);
+	return d->m_idle_timeout;
+}
+
+/**
+ * @brief Sets the connection timeout used for the background connections
+ * @param timeout Timeout value (msec)
+ * @see SocketConnector::setConnectionTimeout()
+ */
+void SocketConnectorPool::setConnectionTimeout(uint timeout)
+{
+	Q_D(SocketConnectorPool);
+	d->m_connection_timeout = timeout;
+}
+
+/**
+ * @brief Returns the connection timeout used for the background connections
+ * @return Connection timeout (msec)
+ */
+uint SocketConnectorPool::connectionTimeout(void) const
+{
+	Q_D(const SocketConnectorPool);
+	return d->m_connection_timeout;
+}
+
+/**
+ * @brief Returns the number of acquire() calls served from the pool
+ * @return Number of hits
+ */
+quint64 SocketConnectorPool::hits(void) const
+{
+	Q_D(const SocketConnectorPool);
+	return d->m_hits;
+}
+
+/**
+ * @brief Returns the number of acquire() calls which found no idle connection
+ * @return Number of misses
+ */
+quint64 SocketConnectorPool::misses(void) const
+{
+	Q_D(const SocketConnectorPool);
+	return d->m_misses;
+}
+
+#include "moc_socketconnectorpool.cpp"
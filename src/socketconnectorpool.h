@@ -0,0 +1,55 @@
+#ifndef SOCKETCONNECTORPOOL_H
+#define SOCKETCONNECTORPOOL_H
+
+#include <QtCore/QObject>
+#include <QtNetwork/QAbstractSocket>
+#include <QtNetwork/QHostAddress>
+#include <QtNetwork/QHostInfo>
+
+#if QT_VERSION < 0x050000
+typedef qptrdiff qintptr;
+#endif
+
+class SocketConnectorPoolPrivate;
+
+class SocketConnectorPool : public QObject {
+	Q_OBJECT
+public:
+	SocketConnectorPool(QObject* parent = 0);
+	virtual ~SocketConnectorPool(void);
+
+	void warmUp(const QString& host, quint16 port, const QHostAddress& local = QHostAddress());
+	bool acquire(QAbstractSocket* target, const QString& host, quint16 port, const QHostAddress& local = QHostAddress());
+	qintptr acquireDescriptor(const QString& host, quint16 port, const QHostAddress& local = QHostAddress());
+	void clear(void);
+
+	int idleCount(const QString& host, quint16 port, const QHostAddress& local = QHostAddress()) const;
+
+	void setMinIdle(int n);
+	int minIdle(void) const;
+	void setMaxIdle(int n);
+	int maxIdle(void) const;
+	void setIdleTimeout(uint timeout);
+	uint idleTimeout(void) const;
+	void setConnectionTimeout(uint timeout);
+	uint connectionTimeout(void) const;
+
+	quint64 hits(void) const;
+	quint64 misses(void) const;
+
+private:
+	Q_DISABLE_COPY(SocketConnectorPool)
+	Q_DECLARE_PRIVATE(SocketConnectorPool)
+#if QT_VERSION >= 0x040600
+	QScopedPointer<SocketConnectorPoolPrivate> d_ptr;
+#else
+	SocketConnectorPoolPrivate* d_ptr;
+#endif
+
+	Q_PRIVATE_SLOT(d_func(), void _q_connected())
+	Q_PRIVATE_SLOT(d_func(), void _q_error())
+	Q_PRIVATE_SLOT(d_func(), void _q_lookedUp(QHostInfo))
+	Q_PRIVATE_SLOT(d_func(), void _q_housekeeping())
+};
+
+#endif // SOCKETCONNECTORPOOL_H
@@ -0,0 +1,307 @@
+#include <QtCore/QTimer>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <errno.h>
+#include "socketconnector.h"
+#include "socketconnectorpool.h"
+#include "socketconnectorpool_p.h"
+
+// The first retry of a failing key waits this long; every further failure doubles the delay, up to max_retry_delay
+static const qint64 min_retry_delay = 1000;
+static const qint64 max_retry_delay = 60000;
+
+SocketConnectorPoolPrivate::SocketConnectorPoolPrivate(SocketConnectorPool* const q)
+	: q_ptr(q), m_buckets(), m_connectors(), m_lookups(), m_clock(), m_timer(new QTimer(q)), m_min_idle(2), m_max_idle(4),
+	  m_idle_timeout(60000), m_connection_timeout(30000), m_hits(0), m_misses(0)
+{
+	this->m_clock.start();
+	this->m_timer->setInterval(1000);
+	QObject::connect(this->m_timer, SIGNAL(timeout()), q, SLOT(_q_housekeeping()));
+}
+
+SocketConnectorPoolPrivate::~SocketConnectorPoolPrivate(void)
+{
+	this->clear();
+}
+
+void SocketConnectorPoolPrivate::warmUp(const SocketConnectorPoolKey& key)
+{
+	this->refill(key, this->m_buckets[key]);
+
+	if (!this->m_timer->isActive()) {
+		this->m_timer->start();
+	}
+}
+
+int SocketConnectorPoolPrivate::acquire(const SocketConnectorPoolKey& key)
+{
+	Bucket& bucket = this->m_buckets[key];
+	int fd         = -1;
+
+	while (!bucket.idle.isEmpty()) {
+		IdleSocket s = bucket.idle.takeFirst();
+		if (SocketConnectorPoolPrivate::isAlive(s.fd)) {
+			fd = s.fd;
+			break;
+		}
+
+		::close(s.fd);
+	}
+
+	if (-1 != fd) {
+		++this->m_hits;
+	}
+	else {
+		++this->m_misses;
+	}
+
+	this->warmUp(key);
+	return fd;
+}
+
+void SocketConnectorPoolPrivate::clear(void)
+{
+	Q_Q(SocketConnectorPool);
+
+	QHash<SocketConnectorPoolKey, Bucket>::ConstIterator it = this->m_buckets.constBegin();
+	while (it != this->m_buckets.constEnd()) {
+		const QList<IdleSocket>& idle = it.value().idle;
+		for (int i=0; i<idle.size(); ++i) {
+			::close(idle.at(i).fd);
+		}
+
+		++it;
+	}
+
+	QHash<SocketConnector*, SocketConnectorPoolKey>::ConstIterator ci = this->m_connectors.constBegin();
+	while (ci != this->m_connectors.constEnd()) {
+		SocketConnector* conn = ci.key();
+		conn->disconnect(q);
+		conn->abort();
+		conn->deleteLater();
+		++ci;
+	}
+
+	QHash<int, SocketConnectorPoolKey>::ConstIterator li = this->m_lookups.constBegin();
+	while (li != this->m_lookups.constEnd()) {
+		QHostInfo::abortHostLookup(li.key());
+		++li;
+	}
+
+	this->m_buckets.clear();
+	this->m_connectors.clear();
+	this->m_lookups.clear();
+	this->m_timer->stop();
+}
+
+int SocketConnectorPoolPrivate::idleCount(const SocketConnectorPoolKey& key) const
+{
+	QHash<SocketConnectorPoolKey, Bucket>::ConstIterator it = this->m_buckets.constFind(key);
+	return (it != this->m_buckets.constEnd()) ? it.value().idle.size() : 0;
+}
+
+void SocketConnectorPoolPrivate::refill(const SocketConnectorPoolKey& key, Bucket& bucket)
+{
+	Q_Q(SocketConnectorPool);
+
+	int have = bucket.idle.size() + bucket.pending.size();
+	if (have >= this->m_min_idle || this->m_clock.elapsed() < bucket.retry_at) {
+		return;
+	}
+
+	int family = this->family(key, bucket);
+	if (!family) {
+		return;
+	}
+
+	// Refill up to the high watermark so that a burst of acquire() calls does not trigger a refill every time
+	int target = qMax(this->m_min_idle, this->m_max_idle);
+	for (; have < target; ++have) {
+		SocketConnector* conn = new SocketConnector(q);
+		conn->setConnectionTimeout(this->m_connection_timeout);
+
+		if (!conn->createSocket(family, SOCK_STREAM, 0) || (!key.local.isNull() && !conn->bindTo(key.local))) {
+			delete conn;
+			break;
+		}
+
+		QObject::connect(conn, SIGNAL(connected()), q, SLOT(_q_connected()));
+		QObject::connect(conn, SIGNAL(error(QAbstractSocket::SocketError)), q, SLOT(_q_error()));
+		bucket.pending.append(conn);
+		this->m_connectors.insert(conn, key);
+		conn->connectToHost(key.host, key.port);
+	}
+}
+
+int SocketConnectorPoolPrivate::family(const SocketConnectorPoolKey& key, Bucket& bucket)
+{
+	Q_Q(SocketConnectorPool);
+
+	if (!key.local.isNull()) {
+		return (QAbstractSocket::IPv6Protocol == key.local.protocol()) ? AF_INET6 : AF_INET;
+	}
+
+	QHostAddress tmp;
+	if (tmp.setAddress(key.host)) {
+		return (QAbstractSocket::IPv6Protocol == tmp.protocol()) ? AF_INET6 : AF_INET;
+	}
+
+	// The family of a host name is known only when it is resolved: an AF_INET socket cannot reach an AAAA-only host
+	if (!bucket.family && -1 == bucket.lookup_id) {
+		bucket.lookup_id = QHostInfo::lookupHost(key.host, q, SLOT(_q_lookedUp(QHostInfo)));
+		this->m_lookups.insert(bucket.lookup_id, key);
+	}
+
+	return bucket.family;
+}
+
+void SocketConnectorPoolPrivate::failed(Bucket& bucket)
+{
+	qint64 now = this->m_clock.elapsed();
+
+	// All the pending connections of a key usually fail together: they count as one failure
+	if (now < bucket.retry_at) {
+		return;
+	}
+
+	int shift       = qMin(bucket.failures, 6);
+	bucket.retry_at = now + qMin(min_retry_delay << shift, max_retry_delay);
+	bucket.family   = 0;
+	++bucket.failures;
+}
+
+void SocketConnectorPoolPrivate::finish(SocketConnector* conn)
+{
+	Q_Q(SocketConnectorPool);
+
+	QHash<SocketConnector*, SocketConnectorPoolKey>::Iterator it = this->m_connectors.find(conn);
+	if (it != this->m_connectors.end()) {
+		this->m_buckets[it.value()].pending.removeOne(conn);
+		this->m_connectors.erase(it);
+	}
+
+	conn->disconnect(q);
+	conn->deleteLater();
+}
+
+bool SocketConnectorPoolPrivate::isAlive(int fd)
+{
+	// An idle connection must not be readable: that means either EOF/RST or unsolicited data
+	struct pollfd p;
+	p.fd      = fd;
+	p.events  = POLLIN;
+	p.revents = 0;
+
+	int res;
+	do {
+		res = ::poll(&p, 1, 0);
+	} while (-1 == res && EINTR == errno);
+
+	return 0 == res;
+}
+
+void SocketConnectorPoolPrivate::_q_connected(void)
+{
+	Q_Q(SocketConnectorPool);
+	SocketConnector* conn = qobject_cast<SocketConnector*>(q->sender());
+
+	QHash<SocketConnector*, SocketConnectorPoolKey>::ConstIterator it = this->m_connectors.constFind(conn);
+	if (it == this->m_connectors.constEnd()) {
+		return;
+	}
+
+	Bucket& bucket = this->m_buckets[it.value()];
+	int fd         = conn->releaseSocketDescriptor();
+	this->finish(conn);
+
+	bucket.failures = 0;
+	bucket.retry_at = 0;
+
+	if (-1 != fd) {
+		if (bucket.idle.size() < qMax(this->m_min_idle, this->m_max_idle)) {
+			IdleSocket s;
+			s.fd    = fd;
+			s.since = this->m_clock.elapsed();
+			bucket.idle.append(s);
+		}
+		else {
+			::close(fd);
+		}
+	}
+}
+
+void SocketConnectorPoolPrivate::_q_error(void)
+{
+	Q_Q(SocketConnectorPool);
+	SocketConnector* conn = qobject_cast<SocketConnector*>(q->sender());
+	if (conn) {
+		QHash<SocketConnector*, SocketConnectorPoolKey>::ConstIterator it = this->m_connectors.constFind(conn);
+		if (it != this->m_connectors.constEnd()) {
+			this->failed(this->m_buckets[it.value()]);
+		}
+
+		this->finish(conn);
+	}
+}
+
+void SocketConnectorPoolPrivate::_q_lookedUp(const QHostInfo& info)
+{
+	QHash<int, SocketConnectorPoolKey>::Iterator li = this->m_lookups.find(info.lookupId());
+	if (li == this->m_lookups.end()) {
+		return;
+	}
+
+	SocketConnectorPoolKey key = li.value();
+	this->m_lookups.erase(li);
+
+	QHash<SocketConnectorPoolKey, Bucket>::Iterator it = this->m_buckets.find(key);
+	if (it == this->m_buckets.end()) {
+		return;
+	}
+
+	Bucket& bucket   = it.value();
+	bucket.lookup_id = -1;
+
+	// The connections go to the address the resolver prefers; SocketConnector skips the addresses of the other family
+	QList<QHostAddress> addresses = info.addresses();
+	for (int i=0; i<addresses.size(); ++i) {
+		QAbstractSocket::NetworkLayerProtocol proto = addresses.at(i).protocol();
+		if (QAbstractSocket::IPv4Protocol == proto || QAbstractSocket::IPv6Protocol == proto) {
+			bucket.family = (QAbstractSocket::IPv6Protocol == proto) ? AF_INET6 : AF_INET;
+			break;
+		}
+	}
+
+	if (!bucket.family) {
+		this->failed(bucket);
+		return;
+	}
+
+	this->refill(key, bucket);
+}
+
+void SocketConnectorPoolPrivate::_q_housekeeping(void)
+{
+	qint64 now = this->m_clock.elapsed();
+
+	QHash<SocketConnectorPoolKey, Bucket>::Iterator it = this->m_buckets.begin();
+	while (it != this->m_buckets.end()) {
+		QList<IdleSocket>& idle = it.value().idle;
+		if (this->m_idle_timeout) {
+			int i = 0;
+			while (i < idle.size()) {
+				if (now - idle.at(i).since >= qint64(this->m_idle_timeout)) {
+					::close(idle.at(i).fd);
+					idle.removeAt(i);
+				}
+				else {
+					++i;
+				}
+			}
+		}
+
+		this->refill(it.key(), it.value());
+		++it;
+	}
+}
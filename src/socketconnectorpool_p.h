@@ -0,0 +1,94 @@
+#ifndef SOCKETCONNECTORPOOL_P_H
+#define SOCKETCONNECTORPOOL_P_H
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtNetwork/QHostAddress>
+#include <QtNetwork/QHostInfo>
+#include "qt4compat.h"
+
+#if QT_VERSION >= 0x040400
+QT_FORWARD_DECLARE_CLASS(QTimer)
+#else
+class QTimer;
+#endif
+
+class SocketConnector;
+class SocketConnectorPool;
+
+struct Q_DECL_HIDDEN SocketConnectorPoolKey {
+	QString host;
+	quint16 port;
+	QHostAddress local;
+
+	SocketConnectorPoolKey(const QString& h, quint16 p, const QHostAddress& l)
+		: host(h), port(p), local(l)
+	{
+	}
+
+	bool operator==(const SocketConnectorPoolKey& other) const
+	{
+		return this->port == other.port && this->host == other.host && this->local == other.local;
+	}
+};
+
+inline uint qHash(const SocketConnectorPoolKey& key)
+{
+	return qHash(key.host) ^ (uint(key.port) << 16) ^ qHash(key.local.toString());
+}
+
+class Q_DECL_HIDDEN SocketConnectorPoolPrivate {
+	Q_DECLARE_PUBLIC(SocketConnectorPool)
+	SocketConnectorPool* const q_ptr;
+public:
+	SocketConnectorPoolPrivate(SocketConnectorPool* const q);
+	~SocketConnectorPoolPrivate(void);
+
+	void warmUp(const SocketConnectorPoolKey& key);
+	int acquire(const SocketConnectorPoolKey& key);
+	void clear(void);
+	int idleCount(const SocketConnectorPoolKey& key) const;
+
+private:
+	struct IdleSocket {
+		int fd;
+		qint64 since;
+	};
+
+	struct Bucket {
+		QList<IdleSocket> idle;
+		QList<SocketConnector*> pending;
+		int family;
+		int lookup_id;
+		int failures;
+		qint64 retry_at;
+
+		Bucket(void) : idle(), pending(), family(0), lookup_id(-1), failures(0), retry_at(0) {}
+	};
+
+	QHash<SocketConnectorPoolKey, Bucket> m_buckets;
+	QHash<SocketConnector*, SocketConnectorPoolKey> m_connectors;
+	QHash<int, SocketConnectorPoolKey> m_lookups;
+	QElapsedTimer m_clock;
+	QTimer* m_timer;
+	int m_min_idle;
+	int m_max_idle;
+	uint m_idle_timeout;
+	uint m_connection_timeout;
+	quint64 m_hits;
+	quint64 m_misses;
+
+	void refill(const SocketConnectorPoolKey& key, Bucket& bucket);
+	int family(const SocketConnectorPoolKey& key, Bucket& bucket);
+	void failed(Bucket& bucket);
+	void finish(SocketConnector* conn);
+	static bool isAlive(int fd);
+
+	void _q_connected(void);
+	void _q_error(void);
+	void _q_lookedUp(const QHostInfo& info);
+	void _q_housekeeping(void);
+};
+
+#endif // SOCKETCONNECTORPOOL_P_H
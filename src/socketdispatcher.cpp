@@ -0,0 +1,166 @@
+#include <QtCore/QMutexLocker>
+#include <QtCore/QThread>
+#include "socketconnector.h"
+#include "socketdispatcher.h"
+#include "socketdispatcher_p.h"
+
+/**
+ * @class SocketFactory
+ *
+ * @brief The SocketFactory class creates the consumers of the connections handed off by SocketDispatcher
+ *
+ * createSocket() is called in the thread of the worker the factory has been registered for. It takes the ownership
+ * of the connected descriptor @a fd and returns the object which uses it (like a @c QLocalSocket); the worker counts
+ * the connection towards its load until that object is destroyed. If createSocket() returns 0, the descriptor is closed.
+ *
+ * @see SocketDispatcher::addWorker()
+ */
+
+/**
+ * @class SocketDispatcher
+ *
+ * @brief The SocketDispatcher class spreads connected sockets across worker threads
+ *
+ * The connections are established in one thread and dispatch()ed to the least loaded worker. A worker is either
+ * a receiver object, which gets a @c QTcpSocket created in its thread, or a thread with a SocketFactory.
+ * The load of a worker is the number of connections which have been dispatched to it and whose sockets still exist.
+ *
+ * A dispatch costs one posted event: the descriptor travels in the event, and the socket is created when the event
+ * is delivered in the thread of the worker. Should the worker go away first, the descriptor is closed along with the event.
+ *
+ * dispatch() is thread-safe. The worker threads must run an event loop.
+ */
+
+/**
+ * @brief Creates a dispatcher with no workers
+ * @param parent Object parent
+ */
+SocketDispatcher::SocketDispatcher(QObject* parent)
+	: QObject(parent), d_ptr(new SocketDispatcherPrivate(this))
+{
+}
+
+/**
+ * @brief Destroys the dispatcher
+ *
+ * The sockets already handed off are not affected; the connections which have not been delivered yet are closed.
+ */
+SocketDispatcher::~SocketDispatcher(void)
+{
+#if QT_VERSION < 0x040600
+	delete this->d_ptr;
+	this->d_ptr = 0;
+#endif
+}
+
+/**
+ * @brief Adds a worker which hands the connections to @a receiver
+ * @param receiver Receiver of the sockets; the worker runs in its thread
+ * @param member Slot taking a @c QTcpSocket* (as in @code SLOT(handleSocket(QTcpSocket*)) @endcode)
+ * @return Index of the worker
+ *
+ * The socket has no parent: the receiver takes its ownership.
+ * Unix domain sockets need a worker with a SocketFactory.
+ */
+int SocketDispatcher::addWorker(QObject* receiver, const char* member)
+{
+	Q_D(SocketDispatcher);
+
+	QByteArray method(member + 1); // Skip the SLOT()/SIGNAL() code
+	method.truncate(method.indexOf('('));
+
+	SocketDispatcherWorker* worker = new SocketDispatcherWorker(receiver, method, 0);
+	worker->moveToThread(receiver->thread());
+	return d->addWorker(worker);
+}
+
+/**
+ * @brief Adds a worker which runs in @a thread and passes the connections to @a factory
+ * @param thread Thread of the worker
+ * @param factory Factory of the sockets; it must outlive the dispatcher
+ * @return Index of the worker
+ */
+int SocketDispatcher::addWorker(QThread* thread, SocketFactory* factory)
+{
+	Q_D(SocketDispatcher);
+
+	SocketDispatcherWorker* worker = new SocketDispatcherWorker(0, QByteArray(), factory);
+	worker->moveToThread(thread);
+	return d->addWorker(worker);
+}
+
+/**
+ * @brief Returns the number of workers
+ * @return Number of workers
+ */
+int SocketDispatcher::workerCount(void) const
+{
+	Q_D(const SocketDispatcher);
+	QMutexLocker locker(&d->m_mutex);
+	return d->m_workers.size();
+}
+
+/**
+ * @brief Takes the connected socket of @a conn and hands it off to the least loaded worker
+ * @param conn Connector in @c ConnectedState
+ * @return Index of the worker, or -1 if @a conn is not connected or there are no workers
+ *
+ * On success @a conn enters @c UnconnectedState, as after SocketConnector::assignTo(); on failure it is left untouched.
+ * If @a conn has a source address set, the owner of the worker's socket releases the source address before closing it,
+ * see SourceAddressSet::releaseSocket().
+ */
+int SocketDispatcher::dispatch(SocketConnector* conn)
+{
+	// The workers are never removed: once there is one, the dispatch cannot fail
+	if (!this->workerCount()) {
+		return -1;
+	}
+
+	qintptr fd = conn->releaseSocketDescriptor();
+	if (-1 == fd) {
+		return -1;
+	}
+
+	return this->dispatch(fd);
+}
+
+/**
+ * @brief Hands off the connected descriptor @a fd to the least loaded worker
+ * @param fd Connected socket descriptor
+ * @return Index of the worker, or -1 if there are no workers
+ * @overload
+ *
+ * On success the dispatcher owns @a fd; on failure the caller still does.
+ */
+int SocketDispatcher::dispatch(qintptr fd)
+{
+	Q_D(SocketDispatcher);
+	return d->dispatch(int(fd));
+}
+
+/**
+ * @brief Returns the load of @a worker
+ * @param worker Index of the worker
+ * @return Number of connections in flight to the worker or owned by its sockets, or -1 if there is no such worker
+ */
+int SocketDispatcher::load(int worker) const
+{
+	Q_D(const SocketDispatcher);
+	QMutexLocker locker(&d->m_mutex);
+	if (worker < 0 || worker >= d->m_workers.size()) {
+		return -1;
+	}
+
+	return d->m_workers.at(worker)->load();
+}
+
+/**
+ * @brief Returns the number of the connections dispatched so far
+ * @return Number of successful dispatch() calls
+ */
+quint64 SocketDispatcher::dispatched(void) const
+{
+	Q_D(const SocketDispatcher);
+	QMutexLocker locker(&d->m_mutex);
+	return d->m_dispatched;
+}
@@ -0,0 +1,48 @@
+#ifndef SOCKETDISPATCHER_H
+#define SOCKETDISPATCHER_H
+
+#include <QtCore/QObject>
+#include <QtNetwork/QAbstractSocket>
+
+#if QT_VERSION < 0x050000
+typedef qptrdiff qintptr;
+#endif
+
+QT_FORWARD_DECLARE_CLASS(QThread)
+
+class SocketConnector;
+class SocketDispatcherPrivate;
+
+class SocketFactory {
+public:
+	virtual ~SocketFactory(void) {}
+	virtual QObject* createSocket(qintptr fd) = 0;
+};
+
+class SocketDispatcher : public QObject {
+	Q_OBJECT
+public:
+	SocketDispatcher(QObject* parent = 0);
+	virtual ~SocketDispatcher(void);
+
+	int addWorker(QObject* receiver, const char* member);
+	int addWorker(QThread* thread, SocketFactory* factory);
+	int workerCount(void) const;
+
+	int dispatch(SocketConnector* conn);
+	int dispatch(qintptr fd);
+
+	int load(int worker) const;
+	quint64 dispatched(void) const;
+
+private:
+	Q_DISABLE_COPY(SocketDispatcher)
+	Q_DECLARE_PRIVATE(SocketDispatcher)
+#if QT_VERSION >= 0x040600
+	QScopedPointer<SocketDispatcherPrivate> d_ptr;
+#else
+	SocketDispatcherPrivate* d_ptr;
+#endif
+};
+
+#endif // SOCKETDISPATCHER_H
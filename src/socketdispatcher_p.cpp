@@ -0,0 +1,149 @@
+#include <QtCore/QCoreApplication>
+#include <QtCore/QMetaObject>
+#include <QtCore/QMutexLocker>
+#include <QtNetwork/QTcpSocket>
+#include <unistd.h>
+#include "socketdispatcher.h"
+#include "socketdispatcher_p.h"
+
+SocketHandoffEvent::SocketHandoffEvent(int fd)
+	: QEvent(SocketHandoffEvent::eventType()), m_fd(fd)
+{
+}
+
+SocketHandoffEvent::~SocketHandoffEvent(void)
+{
+	// An event is deleted undelivered when its receiver is gone: the descriptor must not leak
+	if (-1 != this->m_fd) {
+		::close(this->m_fd);
+	}
+}
+
+int SocketHandoffEvent::take(void)
+{
+	int fd = this->m_fd;
+	this->m_fd = -1;
+	return fd;
+}
+
+QEvent::Type SocketHandoffEvent::eventType(void)
+{
+	static int type = QEvent::registerEventType();
+	return QEvent::Type(type);
+}
+
+SocketDispatcherWorker::SocketDispatcherWorker(QObject* receiver, const QByteArray& method, SocketFactory* factory)
+	: QObject(0), m_receiver(receiver), m_method(method), m_factory(factory), m_load(0)
+{
+}
+
+int SocketDispatcherWorker::load(void) const
+{
+	return const_cast<QAtomicInt&>(this->m_load).fetchAndAddRelaxed(0);
+}
+
+void SocketDispatcherWorker::handOff(int fd)
+{
+	// The connection counts towards the load from now on, so that the next dispatch() sees it
+	this->m_load.ref();
+	QCoreApplication::postEvent(this, new SocketHandoffEvent(fd));
+}
+
+bool SocketDispatcherWorker::event(QEvent* e)
+{
+	if (e->type() != SocketHandoffEvent::eventType()) {
+		return QObject::event(e);
+	}
+
+	int fd = static_cast<SocketHandoffEvent*>(e)->take();
+	if (!this->adopt(fd)) {
+		::close(fd);
+		this->m_load.deref();
+	}
+
+	return true;
+}
+
+void SocketDispatcherWorker::released(void)
+{
+	this->m_load.deref();
+}
+
+bool SocketDispatcherWorker::adopt(int fd)
+{
+	if (this->m_factory) {
+		QObject* obj = this->m_factory->createSocket(fd);
+		if (obj) {
+			QObject::connect(obj, SIGNAL(destroyed()), this, SLOT(released()));
+		}
+
+		return obj != 0;
+	}
+
+	if (!this->m_receiver) {
+		return false;
+	}
+
+	QTcpSocket* sock = new QTcpSocket();
+	if (!sock->setSocketDescriptor(fd, QAbstractSocket::ConnectedState, QIODevice::ReadWrite)) {
+		delete sock;
+		return false;
+	}
+
+	// Connected before the receiver gets the socket: the receiver may delete it right away
+	QObject::connect(sock, SIGNAL(destroyed()), this, SLOT(released()));
+
+	if (!QMetaObject::invokeMethod(this->m_receiver, this->m_method.constData(), Qt::DirectConnection, Q_ARG(QTcpSocket*, sock))) {
+		qWarning("%s: failed to invoke %s::%s()", Q_FUNC_INFO, this->m_receiver->metaObject()->className(), this->m_method.constData());
+		delete sock;
+	}
+
+	return true;
+}
+
+SocketDispatcherPrivate::SocketDispatcherPrivate(SocketDispatcher* const q)
+	: q_ptr(q), m_mutex(), m_workers(), m_next(0), m_dispatched(0)
+{
+}
+
+SocketDispatcherPrivate::~SocketDispatcherPrivate(void)
+{
+	// The workers live in their threads; the pending connections are closed along with them
+	for (int i=0; i<this->m_workers.size(); ++i) {
+		this->m_workers.at(i)->deleteLater();
+	}
+}
+
+int SocketDispatcherPrivate::addWorker(SocketDispatcherWorker* worker)
+{
+	QMutexLocker locker(&this->m_mutex);
+	this->m_workers.append(worker);
+	return this->m_workers.size() - 1;
+}
+
+int SocketDispatcherPrivate::dispatch(int fd)
+{
+	QMutexLocker locker(&this->m_mutex);
+
+	int n = this->m_workers.size();
+	if (!n) {
+		return -1;
+	}
+
+	// The least loaded worker wins; the scan starts after the previous choice so that equal loads are served in turn
+	int best      = -1;
+	int best_load = 0;
+	for (int i=0; i<n; ++i) {
+		int idx  = (this->m_next + i) % n;
+		int load = this->m_workers.at(idx)->load();
+		if (-1 == best || load < best_load) {
+			best      = idx;
+			best_load = load;
+		}
+	}
+
+	this->m_next = (best + 1) % n;
+	++this->m_dispatched;
+	this->m_workers.at(best)->handOff(fd);
+	return best;
+}
@@ -0,0 +1,72 @@
+#ifndef SOCKETDISPATCHER_P_H
+#define SOCKETDISPATCHER_P_H
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QByteArray>
+#include <QtCore/QEvent>
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QObject>
+#include <QtCore/QPointer>
+#include "qt4compat.h"
+
+class SocketDispatcher;
+class SocketFactory;
+
+class Q_DECL_HIDDEN SocketHandoffEvent : public QEvent {
+public:
+	SocketHandoffEvent(int fd);
+	virtual ~SocketHandoffEvent(void);
+
+	int take(void);
+
+	static QEvent::Type eventType(void);
+
+private:
+	int m_fd;
+};
+
+/*
+ * Lives in the thread of the worker: the sockets it creates get the right thread affinity
+ */
+class Q_DECL_HIDDEN SocketDispatcherWorker : public QObject {
+	Q_OBJECT
+public:
+	SocketDispatcherWorker(QObject* receiver, const QByteArray& method, SocketFactory* factory);
+
+	int load(void) const;
+	void handOff(int fd);
+
+protected:
+	virtual bool event(QEvent* e);
+
+private Q_SLOTS:
+	void released(void);
+
+private:
+	QPointer<QObject> m_receiver;
+	QByteArray m_method;
+	SocketFactory* m_factory;
+	QAtomicInt m_load;
+
+	bool adopt(int fd);
+};
+
+class Q_DECL_HIDDEN SocketDispatcherPrivate {
+	Q_DECLARE_PUBLIC(SocketDispatcher)
+	SocketDispatcher* const q_ptr;
+public:
+	SocketDispatcherPrivate(SocketDispatcher* const q);
+	~SocketDispatcherPrivate(void);
+
+	int addWorker(SocketDispatcherWorker* worker);
+	int dispatch(int fd);
+
+private:
+	mutable QMutex m_mutex;
+	QList<SocketDispatcherWorker*> m_workers;
+	int m_next;
+	quint64 m_dispatched;
+};
+
+#endif // SOCKETDISPATCHER_P_H
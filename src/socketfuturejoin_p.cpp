@@ -0,0 +1,105 @@
+#include <QtCore/QCoreApplication>
+#include <QtCore/QThread>
+#include <unistd.h>
+#include "socketfuturejoin_p.h"
+
+QFuture<qintptr> SocketFutureJoin::start(SocketFutureJoin::Mode mode, const QList<QFuture<qintptr> >& futures)
+{
+	if (futures.isEmpty()) {
+		QFutureInterface<qintptr> res;
+		res.reportStarted();
+		if (Any == mode) {
+			res.reportResult(qintptr(-1));
+		}
+
+		res.reportFinished();
+		return res.future();
+	}
+
+	SocketFutureJoin* join = new SocketFutureJoin(mode, futures);
+	QFuture<qintptr> res   = join->m_result.future();
+
+	QThread* main = QCoreApplication::instance() ? QCoreApplication::instance()->thread() : join->thread();
+	join->moveToThread(main);
+	return res;
+}
+
+SocketFutureJoin::SocketFutureJoin(SocketFutureJoin::Mode mode, const QList<QFuture<qintptr> >& futures)
+	: QObject(0), m_mode(mode), m_result(), m_result_watcher(this), m_watchers(), m_settled(0), m_done(false)
+{
+	this->m_result.reportStarted();
+	if (All == mode) {
+		this->m_result.setExpectedResultCount(futures.size());
+	}
+
+	QObject::connect(&this->m_result_watcher, SIGNAL(canceled()), this, SLOT(canceled()));
+	this->m_result_watcher.setFuture(this->m_result.future());
+
+	for (int i=0; i<futures.size(); ++i) {
+		QFutureWatcher<qintptr>* w = new QFutureWatcher<qintptr>(this);
+		QObject::connect(w, SIGNAL(finished()), this, SLOT(settled()));
+		this->m_watchers.append(w);
+		w->setFuture(futures.at(i));
+	}
+}
+
+void SocketFutureJoin::settled(void)
+{
+	QFutureWatcher<qintptr>* w = static_cast<QFutureWatcher<qintptr>*>(this->sender());
+	int index = this->m_watchers.indexOf(w);
+	if (-1 == index) {
+		return;
+	}
+
+	qintptr fd = w->future().resultCount() ? w->result() : -1;
+	++this->m_settled;
+
+	if (All == this->m_mode) {
+		if (this->m_result.isCanceled() && -1 != fd) {
+			::close(int(fd));
+			fd = -1;
+		}
+
+		this->m_result.reportResult(fd, index);
+	}
+	else if (-1 != fd) {
+		if (this->m_done || this->m_result.isCanceled()) {
+			// Has been established after the winner: nobody takes it
+			::close(int(fd));
+		}
+		else {
+			this->m_done = true;
+			this->m_result.reportResult(fd);
+			this->m_result.reportFinished();
+			this->cancelPending();
+		}
+	}
+
+	if (this->m_settled == this->m_watchers.size()) {
+		if (!this->m_done) {
+			this->m_done = true;
+			if (Any == this->m_mode) {
+				this->m_result.reportResult(qintptr(-1));
+			}
+
+			this->m_result.reportFinished();
+		}
+
+		this->deleteLater();
+	}
+}
+
+void SocketFutureJoin::canceled(void)
+{
+	this->cancelPending();
+}
+
+void SocketFutureJoin::cancelPending(void)
+{
+	for (int i=0; i<this->m_watchers.size(); ++i) {
+		QFutureWatcher<qintptr>* w = this->m_watchers.at(i);
+		if (!w->isFinished()) {
+			w->cancel();
+		}
+	}
+}
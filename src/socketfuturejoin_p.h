@@ -0,0 +1,45 @@
+#ifndef SOCKETFUTUREJOIN_P_H
+#define SOCKETFUTUREJOIN_P_H
+
+#include <QtCore/QFutureInterface>
+#include <QtCore/QFutureWatcher>
+#include <QtCore/QList>
+#include <QtCore/QObject>
+#include "qt4compat.h"
+
+#if QT_VERSION < 0x050000
+typedef qptrdiff qintptr;
+#endif
+
+/*
+ * Combines the futures of several connections; lives in the main thread, so that the thread
+ * which has called SocketConnector::whenAny() or whenAll() needs no event loop and never waits
+ */
+class Q_DECL_HIDDEN SocketFutureJoin : public QObject {
+	Q_OBJECT
+public:
+	enum Mode {
+		Any,
+		All
+	};
+
+	static QFuture<qintptr> start(Mode mode, const QList<QFuture<qintptr> >& futures);
+
+private Q_SLOTS:
+	void settled(void);
+	void canceled(void);
+
+private:
+	SocketFutureJoin(Mode mode, const QList<QFuture<qintptr> >& futures);
+
+	Mode m_mode;
+	QFutureInterface<qintptr> m_result;
+	QFutureWatcher<qintptr> m_result_watcher;
+	QList<QFutureWatcher<qintptr>*> m_watchers;
+	int m_settled;
+	bool m_done;
+
+	void cancelPending(void);
+};
+
+#endif // SOCKETFUTUREJOIN_P_H
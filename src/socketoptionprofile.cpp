@@ -0,0 +1,230 @@
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <netinet/tcp.h>
+#include "socketoptionprofile.h"
+
+/**
+ * @class SocketOptionProfile
+ *
+ * @brief The SocketOptionProfile class describes the socket options to be set before the socket connects
+ *
+ * Options set after SocketConnector::assignTo() come too late for the handshake: the SYN has already been sent
+ * with the default buffer sizes, TOS and mark. A profile passed to SocketConnector::setSocketOptionProfile()
+ * is applied to every socket the connector creates, right after the socket is created.
+ *
+ * Only the options which have been set are applied. All option values are non-negative; boolean options take 0 or 1.
+ * TCP options are ignored for non-stream and @c AF_UNIX sockets; @c TypeOfService maps to @c IP_TOS or @c IPV6_TCLASS
+ * depending on the socket domain. The options not supported by the platform make apply() fail.
+ */
+
+/**
+ * @brief Creates an empty profile
+ */
+SocketOptionProfile::SocketOptionProfile(void)
+	: m_congestion()
+{
+	this->clear();
+}
+
+/**
+ * @brief Sets the option @a o to @a value
+ * @param o Option
+ * @param value Value; a negative value unsets the option
+ */
+void SocketOptionProfile::setOption(Option o, int value)
+{
+	if (o >= 0 && o < OptionCount) {
+		this->m_values[o] = qMax(-1, value);
+	}
+}
+
+/**
+ * @brief Returns the value of the option @a o
+ * @param o Option
+ * @return Option value or -1 if the option is not set
+ */
+int SocketOptionProfile::option(Option o) const
+{
+	return (o >= 0 && o < OptionCount) ? this->m_values[o] : -1;
+}
+
+/**
+ * @brief Returns whether the option @a o is set
+ * @param o Option
+ * @return Whether the option is set
+ */
+bool SocketOptionProfile::hasOption(Option o) const
+{
+	return -1 != this->option(o);
+}
+
+/**
+ * @brief Unsets the option @a o
+ * @param o Option
+ */
+void SocketOptionProfile::unsetOption(Option o)
+{
+	this->setOption(o, -1);
+}
+
+/**
+ * @brief Sets the TCP congestion control algorithm (@c TCP_CONGESTION)
+ * @param algorithm Algorithm name (like @c "bbr"); empty to leave the system default
+ */
+void SocketOptionProfile::setCongestionControl(const QByteArray& algorithm)
+{
+	this->m_congestion = algorithm;
+}
+
+/**
+ * @brief Returns the TCP congestion control algorithm
+ * @return Algorithm name
+ */
+QByteArray SocketOptionProfile::congestionControl(void) const
+{
+	return this->m_congestion;
+}
+
+/**
+ * @brief Returns whether no options are set
+ * @return Whether the profile is empty
+ */
+bool SocketOptionProfile::isEmpty(void) const
+{
+	for (int i=0; i<OptionCount; ++i) {
+		if (-1 != this->m_values[i]) {
+			return false;
+		}
+	}
+
+	return this->m_congestion.isEmpty();
+}
+
+/**
+ * @brief Unsets all options
+ */
+void SocketOptionProfile::clear(void)
+{
+	for (int i=0; i<OptionCount; ++i) {
+		this->m_values[i] = -1;
+	}
+
+	this->m_congestion.clear();
+}
+
+static bool setIntOption(int fd, int level, int name, int value)
+{
+	return -1 != ::setsockopt(fd, level, name, &value, sizeof(value));
+}
+
+/**
+ * @brief Applies the profile to the socket @a fd
+ * @param fd Socket descriptor
+ * @param domain Socket domain (like @c AF_INET)
+ * @param type Socket type (like @c SOCK_STREAM)
+ * @return Whether all options have been set
+ *
+ * The function does not stop at the first failure.
+ */
+bool SocketOptionProfile::apply(int fd, int domain, int type) const
+{
+	bool ok = true;
+	int v;
+
+	if (-1 != (v = this->m_values[SendBufferSize])) {
+		ok = setIntOption(fd, SOL_SOCKET, SO_SNDBUF, v) && ok;
+	}
+
+	if (-1 != (v = this->m_values[ReceiveBufferSize])) {
+		ok = setIntOption(fd, SOL_SOCKET, SO_RCVBUF, v) && ok;
+	}
+
+	if (-1 != (v = this->m_values[TypeOfService])) {
+		if (AF_INET == domain) {
+			ok = setIntOption(fd, IPPROTO_IP, IP_TOS, v) && ok;
+		}
+		else if (AF_INET6 == domain) {
+			ok = setIntOption(fd, IPPROTO_IPV6, IPV6_TCLASS, v) && ok;
+		}
+	}
+
+	if (-1 != (v = this->m_values[Mark])) {
+#ifdef SO_MARK
+		ok = setIntOption(fd, SOL_SOCKET, SO_MARK, v) && ok;
+#else
+		ok = false;
+#endif
+	}
+
+	if (-1 != (v = this->m_values[KeepAlive])) {
+		ok = setIntOption(fd, SOL_SOCKET, SO_KEEPALIVE, v ? 1 : 0) && ok;
+	}
+
+	// The TCP options do not apply to the datagram and the local sockets
+	if (SOCK_STREAM != type || (AF_INET != domain && AF_INET6 != domain)) {
+		return ok;
+	}
+
+	if (-1 != (v = this->m_values[NoDelay])) {
+		ok = setIntOption(fd, IPPROTO_TCP, TCP_NODELAY, v ? 1 : 0) && ok;
+	}
+
+	if (-1 != (v = this->m_values[QuickAck])) {
+#ifdef TCP_QUICKACK
+		ok = setIntOption(fd, IPPROTO_TCP, TCP_QUICKACK, v ? 1 : 0) && ok;
+#else
+		ok = false;
+#endif
+	}
+
+	if (-1 != (v = this->m_values[KeepAliveIdle])) {
+#ifdef TCP_KEEPIDLE
+		ok = setIntOption(fd, IPPROTO_TCP, TCP_KEEPIDLE, v) && ok;
+#else
+		ok = false;
+#endif
+	}
+
+	if (-1 != (v = this->m_values[KeepAliveInterval])) {
+#ifdef TCP_KEEPINTVL
+		ok = setIntOption(fd, IPPROTO_TCP, TCP_KEEPINTVL, v) && ok;
+#else
+		ok = false;
+#endif
+	}
+
+	if (-1 != (v = this->m_values[KeepAliveCount])) {
+#ifdef TCP_KEEPCNT
+		ok = setIntOption(fd, IPPROTO_TCP, TCP_KEEPCNT, v) && ok;
+#else
+		ok = false;
+#endif
+	}
+
+	if (-1 != (v = this->m_values[UserTimeout])) {
+#ifdef TCP_USER_TIMEOUT
+		ok = setIntOption(fd, IPPROTO_TCP, TCP_USER_TIMEOUT, v) && ok;
+#else
+		ok = false;
+#endif
+	}
+
+	if (-1 != (v = this->m_values[NotSentLowWatermark])) {
+#ifdef TCP_NOTSENT_LOWAT
+		ok = setIntOption(fd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, v) && ok;
+#else
+		ok = false;
+#endif
+	}
+
+	if (!this->m_congestion.isEmpty()) {
+#ifdef TCP_CONGESTION
+		ok = -1 != ::setsockopt(fd, IPPROTO_TCP, TCP_CONGESTION, this->m_congestion.constData(), this->m_congestion.size()) && ok;
+#else
+		ok = false;
+#endif
+	}
+
+	return ok;
+}
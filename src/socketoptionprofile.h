@@ -0,0 +1,44 @@
+#ifndef SOCKETOPTIONPROFILE_H
+#define SOCKETOPTIONPROFILE_H
+
+#include <QtCore/QByteArray>
+
+class SocketOptionProfile {
+public:
+	enum Option {
+		SendBufferSize,
+		ReceiveBufferSize,
+		NoDelay,
+		QuickAck,
+		KeepAlive,
+		KeepAliveIdle,
+		KeepAliveInterval,
+		KeepAliveCount,
+		UserTimeout,
+		TypeOfService,
+		Mark,
+		NotSentLowWatermark,
+		OptionCount
+	};
+
+	SocketOptionProfile(void);
+
+	void setOption(Option o, int value);
+	int option(Option o) const;
+	bool hasOption(Option o) const;
+	void unsetOption(Option o);
+
+	void setCongestionControl(const QByteArray& algorithm);
+	QByteArray congestionControl(void) const;
+
+	bool isEmpty(void) const;
+	void clear(void);
+
+	bool apply(int fd, int domain, int type) const;
+
+private:
+	int m_values[OptionCount];
+	QByteArray m_congestion;
+};
+
+#endif // SOCKETOPTIONPROFILE_H
@@ -0,0 +1,392 @@
+#include <QtCore/QMutexLocker>
+#include <QtCore/QThread>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <net/if.h>
+#include <errno.h>
+#include <string.h>
+#include "socketreservoir.h"
+
+#ifndef IP_BIND_ADDRESS_NO_PORT
+#	define IP_BIND_ADDRESS_NO_PORT 24
+#endif
+
+// How long the refiller leaves a pool alone after its socket could not be created; the other pools are filled meanwhile
+static const qint64 retry_delay = 100;
+
+/*
+ * Makes the sockets in the background; it is woken up by SocketReservoir whenever a pool falls below the depth
+ */
+class Q_DECL_HIDDEN SocketReservoirRefiller : public QThread {
+public:
+	explicit SocketReservoirRefiller(SocketReservoir* reservoir)
+		: QThread(0), m_reservoir(reservoir)
+	{
+	}
+
+protected:
+	virtual void run(void)
+	{
+		this->m_reservoir->refill();
+	}
+
+private:
+	SocketReservoir* m_reservoir;
+};
+
+/**
+ * @class SocketReservoir
+ *
+ * @brief The SocketReservoir class keeps non-blocking sockets ready for the connectors
+ *
+ * Every socket a connector creates costs a @c socket() call and, for a bound socket, a @c bind() call, made in the thread
+ * of the connector right before the connection attempt and again after every failed attempt. A connector with a reservoir
+ * (see SocketConnector::setSocketReservoir()) takes a ready socket instead, and a background thread makes a new one.
+ *
+ * The sockets are kept in pools, one per domain, type, protocol and local address; a pool is created by reserve() or by
+ * the first take(), and the refiller thread keeps up to depth() sockets in every pool. The sockets are non-blocking and
+ * close-on-exec; the sockets of a pool with a local address are bound to it with @c IP_BIND_ADDRESS_NO_PORT,
+ * so that they do not hold ephemeral ports while they wait: the port is chosen by @c connect().
+ *
+ * A take() from an empty pool is a miss: the caller creates the socket itself. Tune depth() by missRate() and available().
+ * A pool whose sockets cannot be made (see failures()), for example because its local address is gone, is retried
+ * after a short delay and does not hold up the other pools.
+ *
+ * The class is thread-safe and can be shared by any number of connectors.
+ */
+
+/**
+ * @brief Creates an empty reservoir and starts its refiller thread
+ * @param depth Number of sockets kept in every pool
+ */
+SocketReservoir::SocketReservoir(int depth)
+	: m_mutex(), m_wake(), m_clock(), m_pools(), m_depth(qMax(depth, 1)), m_stopping(false), m_hits(0), m_misses(0), m_failures(0),
+	  m_refiller(new SocketReservoirRefiller(this))
+{
+	this->m_clock.start();
+	this->m_refiller->start();
+}
+
+/**
+ * @brief Stops the refiller thread and closes the sockets in the reservoir
+ */
+SocketReservoir::~SocketReservoir(void)
+{
+	{
+		QMutexLocker locker(&this->m_mutex);
+		this->m_stopping = true;
+		this->m_wake.wakeAll();
+	}
+
+	this->m_refiller->wait();
+	delete this->m_refiller;
+	this->clear();
+}
+
+/**
+ * @brief Creates the pool of sockets of @a domain, @a type and @a proto bound to @a local, to be filled in the background
+ * @param domain Socket domain (@c AF_INET, @c AF_INET6, @c AF_UNIX)
+ * @param type Socket type (@c SOCK_STREAM, @c SOCK_DGRAM, @c SOCK_SEQPACKET)
+ * @param proto Protocol
+ * @param local Local address (with no port); null for the sockets which are not bound
+ *
+ * Call it for the pools the connectors are going to use, so that their first take() is not a miss.
+ */
+void SocketReservoir::reserve(int domain, int type, int proto, const QHostAddress& local)
+{
+	QMutexLocker locker(&this->m_mutex);
+	this->poolFor(domain, type, proto, local);
+}
+
+/**
+ * @brief Takes a socket from the pool of @a domain, @a type and @a proto bound to @a local
+ * @param domain Socket domain
+ * @param type Socket type
+ * @param proto Protocol
+ * @param local Local address; null for the sockets which are not bound
+ * @return Non-blocking socket descriptor owned by the caller, or -1 if the pool is empty
+ */
+int SocketReservoir::take(int domain, int type, int proto, const QHostAddress& local)
+{
+	QMutexLocker locker(&this->m_mutex);
+	Pool& p = this->m_pools[this->poolFor(domain, type, proto, local)];
+
+	if (p.sockets.isEmpty()) {
+		++this->m_misses;
+		return -1;
+	}
+
+	++this->m_hits;
+	int fd = p.sockets.takeLast();
+	this->m_wake.wakeOne();
+	return fd;
+}
+
+/**
+ * @brief Closes all the sockets in the reservoir and forgets the pools
+ */
+void SocketReservoir::clear(void)
+{
+	QMutexLocker locker(&this->m_mutex);
+	for (int i=0; i<this->m_pools.size(); ++i) {
+		const QList<int>& sockets = this->m_pools.at(i).sockets;
+		for (int j=0; j<sockets.size(); ++j) {
+			::close(sockets.at(j));
+		}
+	}
+
+	this->m_pools.clear();
+}
+
+/**
+ * @brief Sets the number of sockets kept in every pool
+ * @param depth Depth
+ *
+ * The sockets above the new depth are closed.
+ */
+void SocketReservoir::setDepth(int depth)
+{
+	QMutexLocker locker(&this->m_mutex);
+	this->m_depth = qMax(depth, 1);
+
+	for (int i=0; i<this->m_pools.size(); ++i) {
+		QList<int>& sockets = this->m_pools[i].sockets;
+		while (sockets.size() > this->m_depth) {
+			::close(sockets.takeLast());
+		}
+	}
+
+	this->m_wake.wakeOne();
+}
+
+/**
+ * @brief Returns the number of sockets kept in every pool
+ * @return Depth
+ */
+int SocketReservoir::depth(void) const
+{
+	QMutexLocker locker(&this->m_mutex);
+	return this->m_depth;
+}
+
+/**
+ * @brief Returns the number of sockets ready in the pool of @a domain, @a type and @a proto bound to @a local
+ * @param domain Socket domain
+ * @param type Socket type
+ * @param proto Protocol
+ * @param local Local address
+ * @return Current depth of the pool; 0 if there is no such pool
+ */
+int SocketReservoir::available(int domain, int type, int proto, const QHostAddress& local) const
+{
+	QMutexLocker locker(&this->m_mutex);
+	int idx = this->indexOf(domain, type, proto, local);
+	return (-1 != idx) ? this->m_pools.at(idx).sockets.size() : 0;
+}
+
+/**
+ * @brief Returns the number of take() calls which have returned a socket
+ * @return Number of hits
+ */
+quint64 SocketReservoir::hits(void) const
+{
+	QMutexLocker locker(&this->m_mutex);
+	return this->m_hits;
+}
+
+/**
+ * @brief Returns the number of take() calls which have found the pool empty
+ * @return Number of misses
+ */
+quint64 SocketReservoir::misses(void) const
+{
+	QMutexLocker locker(&this->m_mutex);
+	return this->m_misses;
+}
+
+/**
+ * @brief Returns the share of take() calls which have found the pool empty
+ * @return Miss rate, between 0 and 1
+ */
+qreal SocketReservoir::missRate(void) const
+{
+	QMutexLocker locker(&this->m_mutex);
+	quint64 total = this->m_hits + this->m_misses;
+	return total ? qreal(this->m_misses) / qreal(total) : qreal(0);
+}
+
+/**
+ * @brief Returns the number of sockets the refiller has failed to create or bind
+ * @return Number of failures
+ */
+quint64 SocketReservoir::failures(void) const
+{
+	QMutexLocker locker(&this->m_mutex);
+	return this->m_failures;
+}
+
+int SocketReservoir::indexOf(int domain, int type, int proto, const QHostAddress& local) const
+{
+	for (int i=0; i<this->m_pools.size(); ++i) {
+		const Pool& p = this->m_pools.at(i);
+		if (p.domain == domain && p.type == type && p.proto == proto && p.local == local) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+int SocketReservoir::poolFor(int domain, int type, int proto, const QHostAddress& local)
+{
+	int idx = this->indexOf(domain, type, proto, local);
+	if (-1 == idx) {
+		Pool p;
+		p.domain   = domain;
+		p.type     = type;
+		p.proto    = proto;
+		p.local    = local;
+		p.retry_at = 0;
+		this->m_pools.append(p);
+		idx = this->m_pools.size() - 1;
+		this->m_wake.wakeOne();
+	}
+
+	return idx;
+}
+
+int SocketReservoir::emptiestPool(qint64 now, qint64* wait) const
+{
+	int idx = -1;
+	int min = this->m_depth;
+	*wait   = -1;
+
+	for (int i=0; i<this->m_pools.size(); ++i) {
+		const Pool& p = this->m_pools.at(i);
+		int n         = p.sockets.size();
+		if (n >= this->m_depth) {
+			continue;
+		}
+
+		// A failing pool would always be the emptiest one and starve the others
+		if (now < p.retry_at) {
+			qint64 left = p.retry_at - now;
+			*wait = (-1 == *wait) ? left : qMin(*wait, left);
+			continue;
+		}
+
+		if (n < min) {
+			min = n;
+			idx = i;
+		}
+	}
+
+	return idx;
+}
+
+void SocketReservoir::refill(void)
+{
+	QMutexLocker locker(&this->m_mutex);
+
+	while (!this->m_stopping) {
+		qint64 wait;
+		int idx = this->emptiestPool(this->m_clock.elapsed(), &wait);
+		if (-1 == idx) {
+			if (-1 == wait) {
+				this->m_wake.wait(&this->m_mutex);
+			}
+			else {
+				this->m_wake.wait(&this->m_mutex, static_cast<unsigned long>(wait));
+			}
+
+			continue;
+		}
+
+		// The socket is made without the lock: take() never waits for the system calls
+		Pool key = this->m_pools.at(idx);
+		key.sockets.clear();
+
+		locker.unlock();
+		int fd = createSocket(key);
+		locker.relock();
+
+		// The pool may have been cleared or filled up in the meantime
+		idx = this->indexOf(key.domain, key.type, key.proto, key.local);
+
+		if (-1 == fd) {
+			++this->m_failures;
+			if (-1 != idx) {
+				this->m_pools[idx].retry_at = this->m_clock.elapsed() + retry_delay;
+			}
+
+			continue;
+		}
+
+		if (-1 != idx && this->m_pools.at(idx).sockets.size() < this->m_depth) {
+			this->m_pools[idx].sockets.append(fd);
+		}
+		else {
+			::close(fd);
+		}
+	}
+}
+
+int SocketReservoir::createSocket(const Pool& p)
+{
+#ifdef SOCK_NONBLOCK
+	int fd = ::socket(p.domain, p.type | SOCK_NONBLOCK | SOCK_CLOEXEC, p.proto);
+#else
+	int fd = ::socket(p.domain, p.type, p.proto);
+	if (fd != -1) {
+		::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+		::fcntl(fd, F_SETFD, FD_CLOEXEC);
+	}
+#endif
+
+	if (-1 == fd || p.local.isNull()) {
+		return fd;
+	}
+
+	struct sockaddr_storage ss;
+	socklen_t len = 0;
+	memset(&ss, 0, sizeof(ss));
+
+	switch (p.local.protocol()) {
+		case QAbstractSocket::IPv4Protocol: {
+			struct sockaddr_in* sa = reinterpret_cast<struct sockaddr_in*>(&ss);
+			sa->sin_family      = AF_INET;
+			sa->sin_addr.s_addr = htonl(p.local.toIPv4Address());
+			len = sizeof(struct sockaddr_in);
+			break;
+		}
+
+		case QAbstractSocket::IPv6Protocol: {
+			struct sockaddr_in6* sa = reinterpret_cast<struct sockaddr_in6*>(&ss);
+			sa->sin6_family = AF_INET6;
+#ifndef QT_NO_IPV6IFNAME
+			sa->sin6_scope_id = ::if_nametoindex(p.local.scopeId().toLatin1().data());
+#else
+			sa->sin6_scope_id = p.local.scopeId().toInt();
+#endif
+			Q_IPV6ADDR tmp = p.local.toIPv6Address();
+			memcpy(&sa->sin6_addr.s6_addr, &tmp, sizeof(tmp));
+			len = sizeof(struct sockaddr_in6);
+			break;
+		}
+
+		default:
+			break;
+	}
+
+	// The port is chosen by connect(): a socket waiting in the pool holds no port
+	int one = 1;
+	::setsockopt(fd, IPPROTO_IP, IP_BIND_ADDRESS_NO_PORT, &one, sizeof(one));
+	if (!len || -1 == ::bind(fd, reinterpret_cast<struct sockaddr*>(&ss), len)) {
+		::close(fd);
+		return -1;
+	}
+
+	return fd;
+}
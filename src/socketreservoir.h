@@ -0,0 +1,61 @@
+#ifndef SOCKETRESERVOIR_H
+#define SOCKETRESERVOIR_H
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QWaitCondition>
+#include <QtNetwork/QHostAddress>
+
+class SocketReservoirRefiller;
+
+class SocketReservoir {
+public:
+	SocketReservoir(int depth = 16);
+	~SocketReservoir(void);
+
+	void reserve(int domain, int type, int proto = 0, const QHostAddress& local = QHostAddress());
+	int take(int domain, int type, int proto = 0, const QHostAddress& local = QHostAddress());
+	void clear(void);
+
+	void setDepth(int depth);
+	int depth(void) const;
+
+	int available(int domain, int type, int proto = 0, const QHostAddress& local = QHostAddress()) const;
+	quint64 hits(void) const;
+	quint64 misses(void) const;
+	qreal missRate(void) const;
+	quint64 failures(void) const;
+
+private:
+	Q_DISABLE_COPY(SocketReservoir)
+	friend class SocketReservoirRefiller;
+
+	struct Pool {
+		int domain;
+		int type;
+		int proto;
+		QHostAddress local;
+		QList<int> sockets;
+		qint64 retry_at;
+	};
+
+	mutable QMutex m_mutex;
+	QWaitCondition m_wake;
+	QElapsedTimer m_clock;
+	QList<Pool> m_pools;
+	int m_depth;
+	bool m_stopping;
+	quint64 m_hits;
+	quint64 m_misses;
+	quint64 m_failures;
+	SocketReservoirRefiller* m_refiller;
+
+	int indexOf(int domain, int type, int proto, const QHostAddress& local) const;
+	int poolFor(int domain, int type, int proto, const QHostAddress& local);
+	int emptiestPool(qint64 now, qint64* wait) const;
+	void refill(void);
+	static int createSocket(const Pool& p);
+};
+
+#endif // SOCKETRESERVOIR_H
@@ -0,0 +1,245 @@
+#include <QtCore/QMutexLocker>
+#include <sys/socket.h>
+#include "sourceaddressset.h"
+
+/**
+ * @class SourceAddressSet
+ *
+ * @brief The SourceAddressSet class spreads outgoing connections across several local addresses
+ *
+ * A connector with a source address set (see SocketConnector::setSourceAddressSet()) binds every connection attempt
+ * to an address from the set, chosen by policy():
+ * @li @c RoundRobin: the addresses are used in turn;
+ * @li @c LeastConnections: the address with the fewest open connections is used;
+ * @li @c DestinationHash: the address is chosen by the hash of the destination, so that a destination always uses the same address.
+ *
+ * Only the addresses of the same family as the destination are considered. If the connector cannot bind to the chosen
+ * address (for example, because it has been removed from the interface), it moves on to the next candidate.
+ *
+ * The connection counts include the connections established through the set and not yet released. A connector releases
+ * its connection when it is disconnected or destroyed while connected. A connection which leaves the connector is released
+ * by its new owner, with releaseSocket() or with release() of its local address, once it is closed; this applies to all
+ * the hand-off paths: SocketConnector::assignTo(), SocketConnector::releaseSocketDescriptor(), the result of
+ * SocketConnector::connectAsync() and SocketConnector::connectToHostBlocking(), and SocketDispatcher::dispatch().
+ * The class is thread-safe.
+ */
+
+/**
+ * @brief Creates an empty set
+ * @param policy Address selection policy
+ */
+SourceAddressSet::SourceAddressSet(Policy policy)
+	: m_mutex(), m_sources(), m_policy(policy), m_cursor(0)
+{
+}
+
+/**
+ * @brief Adds the address @a a to the set
+ * @param a Local address
+ */
+void SourceAddressSet::addAddress(const QHostAddress& a)
+{
+	QMutexLocker locker(&this->m_mutex);
+	if (-1 == this->indexOf(a) && !a.isNull()) {
+		Source s;
+		s.address     = a;
+		s.connections = 0;
+		s.failures    = 0;
+		this->m_sources.append(s);
+	}
+}
+
+/**
+ * @brief Removes the address @a a from the set
+ * @param a Local address
+ */
+void SourceAddressSet::removeAddress(const QHostAddress& a)
+{
+	QMutexLocker locker(&this->m_mutex);
+	int idx = this->indexOf(a);
+	if (-1 != idx) {
+		this->m_sources.removeAt(idx);
+	}
+}
+
+/**
+ * @brief Returns the addresses in the set
+ * @return Local addresses
+ */
+QList<QHostAddress> SourceAddressSet::addresses(void) const
+{
+	QMutexLocker locker(&this->m_mutex);
+	QList<QHostAddress> res;
+	for (int i=0; i<this->m_sources.size(); ++i) {
+		res.append(this->m_sources.at(i).address);
+	}
+
+	return res;
+}
+
+/**
+ * @brief Sets the address selection policy
+ * @param policy Policy
+ */
+void SourceAddressSet::setPolicy(Policy policy)
+{
+	QMutexLocker locker(&this->m_mutex);
+	this->m_policy = policy;
+}
+
+/**
+ * @brief Returns the address selection policy
+ * @return Policy
+ */
+SourceAddressSet::Policy SourceAddressSet::policy(void) const
+{
+	QMutexLocker locker(&this->m_mutex);
+	return this->m_policy;
+}
+
+/**
+ * @brief Returns the local addresses to try for a connection to @a destination, best first
+ * @param destination Remote address
+ * @param port Remote port
+ * @return Local addresses of the same family as @a destination
+ */
+QList<QHostAddress> SourceAddressSet::candidates(const QHostAddress& destination, quint16 port)
+{
+	QMutexLocker locker(&this->m_mutex);
+
+	QList<int> eligible;
+	for (int i=0; i<this->m_sources.size(); ++i) {
+		if (this->m_sources.at(i).address.protocol() == destination.protocol()) {
+			eligible.append(i);
+		}
+	}
+
+	QList<QHostAddress> res;
+	int n = eligible.size();
+	if (!n) {
+		return res;
+	}
+
+	uint start;
+	switch (this->m_policy) {
+		case DestinationHash:
+			start = qHash(destination.toString()) ^ port;
+			break;
+
+		case LeastConnections:
+		case RoundRobin:
+		default:
+			start = this->m_cursor++;
+			break;
+	}
+
+	for (int i=0; i<n; ++i) {
+		res.append(this->m_sources.at(eligible.at(int((start + uint(i)) % uint(n)))).address);
+	}
+
+	if (LeastConnections == this->m_policy) {
+		// Stable insertion sort: the round-robin order breaks the ties
+		for (int i=1; i<res.size(); ++i) {
+			QHostAddress a = res.at(i);
+			int c = this->m_sources.at(this->indexOf(a)).connections;
+			int j = i;
+			while (j > 0 && this->m_sources.at(this->indexOf(res.at(j-1))).connections > c) {
+				res[j] = res.at(j-1);
+				--j;
+			}
+
+			res[j] = a;
+		}
+	}
+
+	return res;
+}
+
+/**
+ * @brief Records a new connection from @a source
+ * @param source Local address
+ */
+void SourceAddressSet::connectionOpened(const QHostAddress& source)
+{
+	QMutexLocker locker(&this->m_mutex);
+	int idx = this->indexOf(source);
+	if (-1 != idx) {
+		++this->m_sources[idx].connections;
+	}
+}
+
+/**
+ * @brief Records that a connection from @a source has been closed
+ * @param source Local address
+ */
+void SourceAddressSet::release(const QHostAddress& source)
+{
+	QMutexLocker locker(&this->m_mutex);
+	int idx = this->indexOf(source);
+	if (-1 != idx && this->m_sources.at(idx).connections > 0) {
+		--this->m_sources[idx].connections;
+	}
+}
+
+/**
+ * @brief Records that the connection @a socket is about to be closed
+ * @param socket Native descriptor of a connection established through the set, still open
+ *
+ * The source address is the local address of @a socket; call this function before the descriptor is closed.
+ */
+void SourceAddressSet::releaseSocket(qintptr socket)
+{
+	struct sockaddr_storage ss;
+	socklen_t l = sizeof(ss);
+	if (!::getsockname(int(socket), reinterpret_cast<struct sockaddr*>(&ss), &l)) {
+		this->release(QHostAddress(reinterpret_cast<struct sockaddr*>(&ss)));
+	}
+}
+
+/**
+ * @brief Records that binding to @a source failed
+ * @param source Local address
+ */
+void SourceAddressSet::reportFailure(const QHostAddress& source)
+{
+	QMutexLocker locker(&this->m_mutex);
+	int idx = this->indexOf(source);
+	if (-1 != idx) {
+		++this->m_sources[idx].failures;
+	}
+}
+
+/**
+ * @brief Returns the number of open connections from @a source
+ * @param source Local address
+ * @return Number of connections
+ */
+int SourceAddressSet::connectionCount(const QHostAddress& source) const
+{
+	QMutexLocker locker(&this->m_mutex);
+	int idx = this->indexOf(source);
+	return (-1 != idx) ? this->m_sources.at(idx).connections : 0;
+}
+
+/**
+ * @brief Returns the number of failed binds to @a source
+ * @param source Local address
+ * @return Number of failures
+ */
+quint64 SourceAddressSet::failureCount(const QHostAddress& source) const
+{
+	QMutexLocker locker(&this->m_mutex);
+	int idx = this->indexOf(source);
+	return (-1 != idx) ? this->m_sources.at(idx).failures : 0;
+}
+
+int SourceAddressSet::indexOf(const QHostAddress& a) const
+{
+	for (int i=0; i<this->m_sources.size(); ++i) {
+		if (this->m_sources.at(i).address == a) {
+			return i;
+		}
+	}
+
+	return -1;
+}
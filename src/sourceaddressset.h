@@ -0,0 +1,56 @@
+#ifndef SOURCEADDRESSSET_H
+#define SOURCEADDRESSSET_H
+
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtNetwork/QHostAddress>
+
+#if QT_VERSION < 0x050000
+typedef qptrdiff qintptr;
+#endif
+
+class SourceAddressSet {
+public:
+	enum Policy {
+		RoundRobin,
+		LeastConnections,
+		DestinationHash
+	};
+
+	SourceAddressSet(Policy policy = RoundRobin);
+
+	void addAddress(const QHostAddress& a);
+	void removeAddress(const QHostAddress& a);
+	QList<QHostAddress> addresses(void) const;
+
+	void setPolicy(Policy policy);
+	Policy policy(void) const;
+
+	QList<QHostAddress> candidates(const QHostAddress& destination, quint16 port);
+
+	void connectionOpened(const QHostAddress& source);
+	void release(const QHostAddress& source);
+	void releaseSocket(qintptr socket);
+	void reportFailure(const QHostAddress& source);
+
+	int connectionCount(const QHostAddress& source) const;
+	quint64 failureCount(const QHostAddress& source) const;
+
+private:
+	Q_DISABLE_COPY(SourceAddressSet)
+
+	struct Source {
+		QHostAddress address;
+		int connections;
+		quint64 failures;
+	};
+
+	mutable QMutex m_mutex;
+	QList<Source> m_sources;
+	Policy m_policy;
+	uint m_cursor;
+
+	int indexOf(const QHostAddress& a) const;
+};
+
+#endif // SOURCEADDRESSSET_H
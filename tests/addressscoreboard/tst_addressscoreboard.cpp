@@ -0,0 +1,117 @@
+#include <QtCore/QCoreApplication>
+#include <QtNetwork/QTcpServer>
+#include <QtTest/QTest>
+#include <errno.h>
+#include "addressscoreboard.h"
+#include "hostinfocache.h"
+#include "socketconnector.h"
+
+class AddressScoreboardTest : public QObject {
+	Q_OBJECT
+public:
+	explicit AddressScoreboardTest(QObject* parent = 0)
+		: QObject(parent), m_a(QLatin1String("192.0.2.1")), m_b(QLatin1String("192.0.2.2")), m_c(QLatin1String("192.0.2.3"))
+	{
+	}
+
+private:
+	QHostAddress m_a;
+	QHostAddress m_b;
+	QHostAddress m_c;
+
+private Q_SLOTS:
+	void testDefaults(void)
+	{
+		AddressScoreboard board;
+		QCOMPARE(board.halfLife(), uint(30000));
+
+		QList<QHostAddress> list = QList<QHostAddress>() << this->m_a << this->m_b << this->m_c;
+		QCOMPARE(board.order(list, 80), list);
+
+		AddressScoreboard::Health h = board.health(this->m_a, 80);
+		QCOMPARE(h.successes, quint64(0));
+		QCOMPARE(h.failures, quint64(0));
+		QCOMPARE(h.rtt, qint64(-1));
+	}
+
+	void testOrder(void)
+	{
+		AddressScoreboard board;
+		QList<QHostAddress> list = QList<QHostAddress>() << this->m_a << this->m_b << this->m_c;
+
+		board.reportFailure(this->m_a, 80, ECONNREFUSED);
+		board.reportSuccess(this->m_c, 80, 100);
+		board.reportSuccess(this->m_b, 80, 500);
+		QCOMPARE(board.order(list, 80), QList<QHostAddress>() << this->m_c << this->m_b << this->m_a);
+
+		// The outcomes are per port
+		QCOMPARE(board.order(list, 443), list);
+
+		AddressScoreboard::Health h = board.health(this->m_a, 80);
+		QCOMPARE(h.failures, quint64(1));
+		QCOMPARE(h.lastError, int(ECONNREFUSED));
+		QVERIFY(h.penalty > 0.5);
+
+		board.reportSuccess(this->m_a, 80, 50);
+		QCOMPARE(board.order(list, 80).first(), this->m_a);
+		QCOMPARE(board.health(this->m_a, 80).penalty, qreal(0));
+
+		board.clear();
+		QCOMPARE(board.order(list, 80), list);
+	}
+
+	void testDecay(void)
+	{
+		AddressScoreboard board;
+		board.setHalfLife(50);
+		QCOMPARE(board.halfLife(), uint(50));
+
+		QList<QHostAddress> list = QList<QHostAddress>() << this->m_a << this->m_b;
+		board.reportFailure(this->m_a, 80, ETIMEDOUT);
+		QCOMPARE(board.order(list, 80).first(), this->m_b);
+
+		// The failed address gets probed again once the penalty has decayed
+		QTest::qWait(200);
+		QCOMPARE(board.order(list, 80), list);
+	}
+
+	void testConnector(void)
+	{
+		QTcpServer server;
+		QVERIFY(server.listen(QHostAddress::LocalHost));
+
+		// The server listens on 127.0.0.1 only: 127.0.0.2 refuses the connections
+		const QString name = QLatin1String("scoreboard.test");
+		QHostAddress dead(QLatin1String("127.0.0.2"));
+		QHostInfo info;
+		info.setHostName(name);
+		info.setAddresses(QList<QHostAddress>() << dead << QHostAddress(QHostAddress::LocalHost));
+
+		HostInfoCache cache;
+		cache.insert(name, info);
+
+		AddressScoreboard board;
+		for (int i=0; i<2; ++i) {
+			SocketConnector conn;
+			conn.setHostInfoCache(&cache);
+			conn.setAddressScoreboard(&board);
+			QCOMPARE(conn.addressScoreboard(), &board);
+			QVERIFY(conn.createTcpSocket());
+			conn.connectToHost(name, server.serverPort());
+			QVERIFY(conn.waitForConnected(5000));
+		}
+
+		// The second connection goes to the healthy address right away
+		QCOMPARE(board.health(dead, server.serverPort()).failures, quint64(1));
+		QCOMPARE(board.health(QHostAddress(QHostAddress::LocalHost), server.serverPort()).successes, quint64(2));
+	}
+};
+
+int main(int argc, char** argv)
+{
+	QCoreApplication a(argc, argv);
+	AddressScoreboardTest t;
+	return QTest::qExec(&t, argc, argv);
+}
+
+#include "tst_addressscoreboard.moc"
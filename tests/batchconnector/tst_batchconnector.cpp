@@ -0,0 +1,231 @@
+#include <QtCore/QCoreApplication>
+#include <QtCore/QEventLoop>
+#include <QtCore/QMap>
+#include <QtCore/QTimer>
+#include <QtNetwork/QTcpServer>
+#include <QtNetwork/QTcpSocket>
+#include <QtTest/QTest>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <string.h>
+#include <unistd.h>
+#include "batchconnector.h"
+
+class BatchConnectorTest : public QObject {
+	Q_OBJECT
+public:
+	explicit BatchConnectorTest(QObject* parent = 0)
+		: QObject(parent), m_conn(0), m_server(0), m_connected(), m_errors()
+	{
+	}
+
+protected Q_SLOTS:
+	void handleConnected(int id, qintptr socket)
+	{
+		this->m_connected.insert(id, socket);
+	}
+
+	void handleError(int id, QAbstractSocket::SocketError e)
+	{
+		this->m_errors.insert(id, e);
+	}
+
+private:
+	BatchConnector* m_conn;
+	QTcpServer* m_server;
+	QMap<int, qintptr> m_connected;
+	QMap<int, QAbstractSocket::SocketError> m_errors;
+
+private Q_SLOTS:
+	void init(void)
+	{
+		this->m_conn   = new BatchConnector(this);
+		this->m_server = new QTcpServer(this);
+		this->m_connected.clear();
+		this->m_errors.clear();
+
+		QVERIFY(QObject::connect(this->m_conn, SIGNAL(connected(int,qintptr)), this, SLOT(handleConnected(int,qintptr))));
+		QVERIFY(QObject::connect(this->m_conn, SIGNAL(error(int,QAbstractSocket::SocketError)), this, SLOT(handleError(int,QAbstractSocket::SocketError))));
+		QVERIFY(this->m_server->listen(QHostAddress::LocalHost));
+	}
+
+	void cleanup(void)
+	{
+		QMap<int, qintptr>::ConstIterator it = this->m_connected.constBegin();
+		while (it != this->m_connected.constEnd()) {
+			::close(int(it.value()));
+			++it;
+		}
+
+		delete this->m_conn;
+		delete this->m_server;
+		this->m_conn   = 0;
+		this->m_server = 0;
+	}
+
+	void testConnectMany(void)
+	{
+		QTcpServer closed;
+		QVERIFY(closed.listen(QHostAddress::LocalHost));
+		quint16 closed_port = closed.serverPort();
+		closed.close();
+
+		QList<BatchConnector::Endpoint> endpoints;
+		endpoints
+			<< BatchConnector::Endpoint(QHostAddress::LocalHost, this->m_server->serverPort())
+			<< BatchConnector::Endpoint(QHostAddress::LocalHost, closed_port)
+			<< BatchConnector::Endpoint(QHostAddress(), 80)
+			<< BatchConnector::Endpoint(QHostAddress::LocalHost, this->m_server->serverPort(), QHostAddress::LocalHost)
+		;
+
+		QEventLoop loop;
+		QVERIFY(QObject::connect(this->m_conn, SIGNAL(finished()), &loop, SLOT(quit())));
+		QTimer::singleShot(5000, &loop, SLOT(quit()));
+
+		int first = this->m_conn->connectMany(endpoints);
+		if (this->m_conn->pendingCount()) {
+			loop.exec();
+		}
+
+		QCOMPARE(this->m_conn->pendingCount(), 0);
+		QCOMPARE(this->m_connected.size(), 2);
+		QCOMPARE(this->m_errors.size(), 2);
+		QVERIFY(this->m_connected.contains(first));
+		QVERIFY(this->m_connected.contains(first + 3));
+		QCOMPARE(this->m_errors.value(first + 1), QAbstractSocket::ConnectionRefusedError);
+		QCOMPARE(this->m_errors.value(first + 2), QAbstractSocket::UnsupportedSocketOperationError);
+
+		QTcpSocket s;
+		QVERIFY(s.setSocketDescriptor(this->m_connected.take(first)));
+		QCOMPARE(s.state(), QAbstractSocket::ConnectedState);
+		QCOMPARE(s.peerPort(), this->m_server->serverPort());
+	}
+
+	void testAbort(void)
+	{
+		QList<BatchConnector::Endpoint> endpoints;
+		endpoints << BatchConnector::Endpoint(QHostAddress::LocalHost, this->m_server->serverPort());
+
+		this->m_conn->connectMany(endpoints);
+		this->m_conn->abort();
+		QCOMPARE(this->m_conn->pendingCount(), 0);
+		QTest::qWait(100);
+		QVERIFY(this->m_errors.isEmpty());
+	}
+
+	void testTimeoutOrder(void)
+	{
+		// A listener with a full accept queue drops the SYNs: the connections to it time out
+		struct sockaddr_in sa;
+		memset(&sa, 0, sizeof(sa));
+		sa.sin_family      = AF_INET;
+		sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK + 1);
+
+		int one = 1;
+		int l   = ::socket(AF_INET, SOCK_STREAM, 0);
+		::setsockopt(l, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+		QVERIFY(!::bind(l, reinterpret_cast<struct sockaddr*>(&sa), sizeof(sa)));
+		QVERIFY(!::listen(l, 0));
+
+		socklen_t len = sizeof(sa);
+		QVERIFY(!::getsockname(l, reinterpret_cast<struct sockaddr*>(&sa), &len));
+		int c = ::socket(AF_INET, SOCK_STREAM, 0);
+		QVERIFY(!::connect(c, reinterpret_cast<struct sockaddr*>(&sa), sizeof(sa)));
+
+		QList<BatchConnector::Endpoint> endpoints;
+		endpoints << BatchConnector::Endpoint(QHostAddress(QLatin1String("127.0.0.2")), ntohs(sa.sin_port));
+
+		// The later batch with the shorter timeout expires first
+		this->m_conn->setConnectionTimeout(5000);
+		int slow = this->m_conn->connectMany(endpoints);
+		this->m_conn->setConnectionTimeout(100);
+		int fast = this->m_conn->connectMany(endpoints);
+
+		QTRY_VERIFY(this->m_errors.contains(fast));
+		QCOMPARE(this->m_errors.value(fast), QAbstractSocket::SocketTimeoutError);
+		QVERIFY(!this->m_errors.contains(slow));
+		QCOMPARE(this->m_conn->pendingCount(), 1);
+
+		this->m_conn->abort();
+		::close(c);
+		::close(l);
+	}
+
+	void testBackend(void)
+	{
+		QCOMPARE(this->m_conn->backend(), BatchConnector::EpollBackend);
+		QVERIFY(this->m_conn->setBackend(BatchConnector::AutoBackend));
+		QCOMPARE(this->m_conn->backend(), BatchConnector::isIoUringAvailable() ? BatchConnector::IoUringBackend : BatchConnector::EpollBackend);
+		QCOMPARE(this->m_conn->setBackend(BatchConnector::IoUringBackend), BatchConnector::isIoUringAvailable());
+		QVERIFY(this->m_conn->setBackend(BatchConnector::EpollBackend));
+		QCOMPARE(this->m_conn->backend(), BatchConnector::EpollBackend);
+
+		QList<BatchConnector::Endpoint> endpoints;
+		endpoints << BatchConnector::Endpoint(QHostAddress::LocalHost, this->m_server->serverPort());
+		this->m_conn->connectMany(endpoints);
+		if (this->m_conn->pendingCount()) {
+			QVERIFY(!this->m_conn->setBackend(BatchConnector::AutoBackend));
+		}
+	}
+
+	void testIoUringBackend(void)
+	{
+		if (!this->m_conn->setBackend(BatchConnector::IoUringBackend)) {
+#if QT_VERSION < 0x050000
+			QSKIP("io_uring is not available", SkipAll);
+#else
+			QSKIP("io_uring is not available");
+#endif
+		}
+
+		QTcpServer closed;
+		QVERIFY(closed.listen(QHostAddress::LocalHost));
+		quint16 closed_port = closed.serverPort();
+		closed.close();
+
+		QList<BatchConnector::Endpoint> endpoints;
+		endpoints
+			<< BatchConnector::Endpoint(QHostAddress::LocalHost, this->m_server->serverPort())
+			<< BatchConnector::Endpoint(QHostAddress::LocalHost, closed_port)
+			<< BatchConnector::Endpoint(QHostAddress(), 80)
+			<< BatchConnector::Endpoint(QHostAddress::LocalHost, this->m_server->serverPort(), QHostAddress::LocalHost)
+		;
+
+		QEventLoop loop;
+		QVERIFY(QObject::connect(this->m_conn, SIGNAL(finished()), &loop, SLOT(quit())));
+		QTimer::singleShot(5000, &loop, SLOT(quit()));
+
+		int first = this->m_conn->connectMany(endpoints);
+		if (this->m_conn->pendingCount()) {
+			loop.exec();
+		}
+
+		QCOMPARE(this->m_conn->pendingCount(), 0);
+		QCOMPARE(this->m_connected.size(), 2);
+		QCOMPARE(this->m_errors.size(), 2);
+		QVERIFY(this->m_connected.contains(first));
+		QVERIFY(this->m_connected.contains(first + 3));
+		QCOMPARE(this->m_errors.value(first + 1), QAbstractSocket::ConnectionRefusedError);
+		QCOMPARE(this->m_errors.value(first + 2), QAbstractSocket::UnsupportedSocketOperationError);
+
+		QTcpSocket s;
+		QVERIFY(s.setSocketDescriptor(this->m_connected.take(first)));
+		QCOMPARE(s.state(), QAbstractSocket::ConnectedState);
+		QCOMPARE(s.peerPort(), this->m_server->serverPort());
+
+		this->m_conn->connectMany(endpoints.mid(0, 1));
+		this->m_conn->abort();
+		QCOMPARE(this->m_conn->pendingCount(), 0);
+		QTest::qWait(100);
+		QCOMPARE(this->m_errors.size(), 2);
+	}
+};
+
+int main(int argc, char** argv)
+{
+	QCoreApplication a(argc, argv);
+	BatchConnectorTest t;
+	return QTest::qExec(&t, argc, argv);
+}
+
+#include "tst_batchconnector.moc"
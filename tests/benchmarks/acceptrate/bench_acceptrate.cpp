@@ -0,0 +1,226 @@
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QSemaphore>
+#include <QtCore/QThread>
+#include <QtNetwork/QTcpServer>
+#include <QtTest/QTest>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <string.h>
+#include <unistd.h>
+#include "socketacceptor.h"
+
+/*
+ * Makes the connections with blocking connect() calls, so that the client side does not limit the accept rate
+ */
+class Client : public QThread {
+public:
+	Client(quint16 port, int count)
+		: QThread(0), m_port(port), m_count(count), m_failed(0)
+	{
+	}
+
+	int failed(void) const
+	{
+		return this->m_failed;
+	}
+
+protected:
+	virtual void run(void)
+	{
+		struct sockaddr_in sa;
+		memset(&sa, 0, sizeof(sa));
+		sa.sin_family      = AF_INET;
+		sa.sin_port        = htons(this->m_port);
+		sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+		for (int i=0; i<this->m_count; ++i) {
+			int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+			if (-1 == fd || -1 == ::connect(fd, reinterpret_cast<struct sockaddr*>(&sa), sizeof(sa))) {
+				++this->m_failed;
+			}
+
+			// The server resets the connection: neither side is left in TIME_WAIT
+			if (-1 != fd) {
+				::close(fd);
+			}
+		}
+	}
+
+private:
+	quint16 m_port;
+	int m_count;
+	int m_failed;
+};
+
+static void resetAndClose(int fd)
+{
+	struct linger l;
+	l.l_onoff  = 1;
+	l.l_linger = 0;
+	::setsockopt(fd, SOL_SOCKET, SO_LINGER, &l, sizeof(l));
+	::close(fd);
+}
+
+/*
+ * The best case for QTcpServer: the descriptors are taken in incomingConnection(), no QTcpSocket is created.
+ * The listen backlog is the one QTcpServer chooses
+ */
+class CountingServer : public QTcpServer {
+public:
+	explicit CountingServer(QObject* parent = 0)
+		: QTcpServer(parent), m_accepted(0)
+	{
+	}
+
+	int accepted(void) const
+	{
+		return this->m_accepted;
+	}
+
+protected:
+#if QT_VERSION >= 0x050000
+	virtual void incomingConnection(qintptr socket)
+#else
+	virtual void incomingConnection(int socket)
+#endif
+	{
+		resetAndClose(int(socket));
+		++this->m_accepted;
+	}
+
+private:
+	int m_accepted;
+};
+
+class AcceptRateBenchmark : public QObject {
+	Q_OBJECT
+public:
+	explicit AcceptRateBenchmark(QObject* parent = 0)
+		: QObject(parent), m_done()
+	{
+	}
+
+protected Q_SLOTS:
+	// Called in the listener threads
+	void handleNewConnection(qintptr socket)
+	{
+		resetAndClose(int(socket));
+		this->m_done.release();
+	}
+
+private:
+	QSemaphore m_done;
+
+	static QList<Client*> startClients(quint16 port, int count)
+	{
+		int n = qMax(QThread::idealThreadCount(), 2);
+		QList<Client*> clients;
+		for (int i=0; i<n; ++i) {
+			clients.append(new Client(port, count / n + (i < count % n ? 1 : 0)));
+			clients.last()->start();
+		}
+
+		return clients;
+	}
+
+	static int finishClients(QList<Client*>& clients)
+	{
+		int failed = 0;
+		for (int i=0; i<clients.size(); ++i) {
+			clients.at(i)->wait();
+			failed += clients.at(i)->failed();
+		}
+
+		qDeleteAll(clients);
+		clients.clear();
+		return failed;
+	}
+
+	static void report(const char* name, int n, qint64 nsecs, int failed)
+	{
+		qDebug("%s: %d connections, %.0f accepts/s, %d failed connects", name, n, nsecs ? double(n) * 1e9 / double(nsecs) : 0.0, failed);
+	}
+
+private Q_SLOTS:
+	void qTcpServer(void)
+	{
+		const int count = 20000;
+
+		CountingServer server;
+		QVERIFY(server.listen(QHostAddress::LocalHost));
+
+		qint64 elapsed = 0;
+		int failed     = 0;
+
+		QBENCHMARK {
+			int base = server.accepted();
+			QElapsedTimer timer;
+			timer.start();
+
+			QList<Client*> clients = startClients(server.serverPort(), count);
+			while (server.accepted() - base < count && timer.elapsed() < 60000) {
+				QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+			}
+
+			elapsed = timer.nsecsElapsed();
+			failed  = finishClients(clients);
+			QCOMPARE(server.accepted() - base, count);
+		}
+
+		report("QTcpServer", count, elapsed, failed);
+	}
+
+	void socketAcceptor_data(void)
+	{
+		QTest::addColumn<int>("listeners");
+		QTest::addColumn<bool>("steering");
+
+		int cores = qMax(QThread::idealThreadCount(), 1);
+		for (int n=1; n<cores; n *= 2) {
+			QTest::newRow(QByteArray::number(n).constData()) << n << false;
+		}
+
+		QTest::newRow(QByteArray::number(cores).constData()) << cores << false;
+		QTest::newRow((QByteArray::number(cores) + " steered").constData()) << cores << true;
+	}
+
+	void socketAcceptor(void)
+	{
+		QFETCH(int, listeners);
+		QFETCH(bool, steering);
+		const int count = 20000;
+
+		SocketAcceptor acceptor;
+		acceptor.setListenerCount(listeners);
+		acceptor.setCpuSteeringEnabled(steering);
+		QObject::connect(&acceptor, SIGNAL(newConnection(qintptr)), this, SLOT(handleNewConnection(qintptr)), Qt::DirectConnection);
+		QVERIFY(acceptor.listen(QHostAddress::LocalHost));
+
+		qint64 elapsed = 0;
+		int failed     = 0;
+
+		QBENCHMARK {
+			QElapsedTimer timer;
+			timer.start();
+
+			QList<Client*> clients = startClients(acceptor.serverPort(), count);
+			QVERIFY(this->m_done.tryAcquire(count, 60000));
+
+			elapsed = timer.nsecsElapsed();
+			failed  = finishClients(clients);
+		}
+
+		QByteArray name = "SocketAcceptor, " + QByteArray::number(listeners) + " listener(s)" + (steering ? ", steered" : "");
+		report(name.constData(), count, elapsed, failed);
+	}
+};
+
+int main(int argc, char** argv)
+{
+	QCoreApplication a(argc, argv);
+	AcceptRateBenchmark t;
+	return QTest::qExec(&t, argc, argv);
+}
+
+#include "bench_acceptrate.moc"
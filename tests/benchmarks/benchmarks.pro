@@ -0,0 +1,7 @@
+TEMPLATE = subdirs
+
+SUBDIRS += blockingconnect connectlatency unixconnect
+
+linux* {
+	SUBDIRS += acceptrate connectbackends connectmany connectorengine datagrams
+}
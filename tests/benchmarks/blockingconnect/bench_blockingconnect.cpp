@@ -0,0 +1,88 @@
+#include <QtCore/QCoreApplication>
+#include <QtTest/QTest>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "socketconnector.h"
+
+class BlockingConnectBenchmark : public QObject {
+	Q_OBJECT
+public:
+	explicit BlockingConnectBenchmark(QObject* parent = 0)
+		: QObject(parent), m_listener(-1), m_port(0)
+	{
+	}
+
+private:
+	// A plain listening socket: the accept queue is drained without an event loop
+	int m_listener;
+	quint16 m_port;
+
+	void acceptOne(void)
+	{
+		int fd = ::accept(this->m_listener, 0, 0);
+		if (-1 != fd) {
+			::close(fd);
+		}
+	}
+
+private Q_SLOTS:
+	void initTestCase(void)
+	{
+		struct sockaddr_in sa;
+		socklen_t l = sizeof(sa);
+		memset(&sa, 0, sizeof(sa));
+		sa.sin_family      = AF_INET;
+		sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+		this->m_listener = ::socket(AF_INET, SOCK_STREAM, 0);
+		QVERIFY(this->m_listener != -1);
+		QVERIFY(!::bind(this->m_listener, reinterpret_cast<struct sockaddr*>(&sa), sizeof(sa)));
+		QVERIFY(!::listen(this->m_listener, 128));
+		QVERIFY(!::getsockname(this->m_listener, reinterpret_cast<struct sockaddr*>(&sa), &l));
+		this->m_port = ntohs(sa.sin_port);
+	}
+
+	void cleanupTestCase(void)
+	{
+		::close(this->m_listener);
+		this->m_listener = -1;
+	}
+
+	void blocking(void)
+	{
+		SocketConnector conn;
+		QHostAddress address(QHostAddress::LocalHost);
+
+		QBENCHMARK {
+			conn.createTcpSocket();
+			qintptr fd = conn.connectToHostBlocking(address, this->m_port, 5000);
+			QVERIFY(fd != -1);
+			::close(int(fd));
+			this->acceptOne();
+		}
+	}
+
+	void eventLoop(void)
+	{
+		SocketConnector conn;
+		QHostAddress address(QHostAddress::LocalHost);
+
+		QBENCHMARK {
+			conn.createTcpSocket();
+			conn.connectToHost(address, this->m_port);
+			QVERIFY(conn.waitForConnected(5000));
+			conn.disconnectFromHost();
+			this->acceptOne();
+		}
+	}
+};
+
+int main(int argc, char** argv)
+{
+	QCoreApplication a(argc, argv);
+	BlockingConnectBenchmark t;
+	return QTest::qExec(&t, argc, argv);
+}
+
+#include "bench_blockingconnect.moc"
@@ -0,0 +1,17 @@
+QT      += network testlib
+QT      -= gui
+TARGET   = bench_blockingconnect
+CONFIG  += console
+CONFIG  -= app_bundle
+TEMPLATE = app
+DESTDIR  = ..
+
+lessThan(QT_MAJOR_VERSION, 5): CONFIG += qtestlib
+
+SOURCES  = bench_blockingconnect.cpp
+
+INCLUDEPATH += ../../../src
+DEPENDPATH  += ../../../src
+LIBS        += -L$$OUT_PWD/$$DESTDIR/../../lib -lsocketconnector
+
+unix: PRE_TARGETDEPS += $$OUT_PWD/$$DESTDIR/../../lib/libsocketconnector.a
@@ -0,0 +1,275 @@
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QEventLoop>
+#include <QtCore/QFile>
+#include <QtCore/QThread>
+#include <QtCore/QTimer>
+#include <QtTest/QTest>
+#include <linux/perf_event.h>
+#include <netinet/in.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include "batchconnector.h"
+
+/*
+ * Accepts and closes the connections in a separate thread, so that the syscalls of the server side are not counted
+ */
+class Acceptor : public QThread {
+public:
+	explicit Acceptor(int listener)
+		: QThread(0), m_listener(listener)
+	{
+	}
+
+protected:
+	virtual void run(void)
+	{
+		while (true) {
+			int fd = ::accept(this->m_listener, 0, 0);
+			if (-1 != fd) {
+				::close(fd);
+			}
+			else if (EINTR != errno && ECONNABORTED != errno) {
+				// shutdown() of the listening socket
+				break;
+			}
+		}
+	}
+
+private:
+	int m_listener;
+};
+
+/*
+ * Counts the system calls made by the calling thread with the raw_syscalls:sys_enter tracepoint.
+ * Needs the tracefs and a permissive kernel.perf_event_paranoid (or CAP_PERFMON)
+ */
+class SyscallCounter {
+public:
+	SyscallCounter(void)
+		: m_fd(-1)
+	{
+		static const char* paths[] = {
+			"/sys/kernel/tracing/events/raw_syscalls/sys_enter/id",
+			"/sys/kernel/debug/tracing/events/raw_syscalls/sys_enter/id"
+		};
+
+		for (size_t i=0; i<sizeof(paths)/sizeof(paths[0]) && -1 == this->m_fd; ++i) {
+			QFile f(QLatin1String(paths[i]));
+			if (!f.open(QIODevice::ReadOnly)) {
+				continue;
+			}
+
+			struct perf_event_attr attr;
+			memset(&attr, 0, sizeof(attr));
+			attr.type     = PERF_TYPE_TRACEPOINT;
+			attr.size     = sizeof(attr);
+			attr.config   = f.readAll().trimmed().toULongLong();
+			attr.disabled = 1;
+
+			this->m_fd = int(::syscall(__NR_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC));
+		}
+	}
+
+	~SyscallCounter(void)
+	{
+		if (-1 != this->m_fd) {
+			::close(this->m_fd);
+		}
+	}
+
+	bool isValid(void) const
+	{
+		return -1 != this->m_fd;
+	}
+
+	void start(void)
+	{
+		if (-1 != this->m_fd) {
+			::ioctl(this->m_fd, PERF_EVENT_IOC_RESET, 0);
+			::ioctl(this->m_fd, PERF_EVENT_IOC_ENABLE, 0);
+		}
+	}
+
+	quint64 stop(void)
+	{
+		quint64 value = 0;
+		if (-1 != this->m_fd) {
+			::ioctl(this->m_fd, PERF_EVENT_IOC_DISABLE, 0);
+			if (sizeof(value) != ::read(this->m_fd, &value, sizeof(value))) {
+				value = 0;
+			}
+		}
+
+		return value;
+	}
+
+private:
+	int m_fd;
+};
+
+class ConnectBackendsBenchmark : public QObject {
+	Q_OBJECT
+public:
+	explicit ConnectBackendsBenchmark(QObject* parent = 0)
+		: QObject(parent), m_listener(-1), m_port(0), m_acceptors(), m_remaining(0), m_errors(0), m_loop(0)
+	{
+	}
+
+protected Q_SLOTS:
+	void handleConnected(int, qintptr socket)
+	{
+		// Reset instead of FIN: the client side does not pile up TIME_WAIT sockets and run out of ports
+		struct linger l;
+		l.l_onoff  = 1;
+		l.l_linger = 0;
+		::setsockopt(int(socket), SOL_SOCKET, SO_LINGER, &l, sizeof(l));
+		::close(int(socket));
+		this->done();
+	}
+
+	void handleError(int, QAbstractSocket::SocketError)
+	{
+		++this->m_errors;
+		this->done();
+	}
+
+private:
+	int m_listener;
+	quint16 m_port;
+	QList<Acceptor*> m_acceptors;
+	int m_remaining;
+	int m_errors;
+	QEventLoop* m_loop;
+
+	void done(void)
+	{
+		if (!--this->m_remaining && this->m_loop) {
+			this->m_loop->quit();
+		}
+	}
+
+	void wait(void)
+	{
+		QEventLoop loop;
+		this->m_loop = &loop;
+		QTimer::singleShot(60000, &loop, SLOT(quit()));
+		if (this->m_remaining) {
+			loop.exec();
+		}
+
+		this->m_loop = 0;
+	}
+
+	static void report(const char* name, int n, qint64 nsecs, const SyscallCounter& counter, quint64 syscalls, int errors)
+	{
+		double rate = nsecs ? double(n) * 1e9 / double(nsecs) : 0.0;
+		if (counter.isValid()) {
+			qDebug("%s: %d connections, %.0f connections/s, %.2f syscalls/connection, %d errors", name, n, rate, double(syscalls) / double(n), errors);
+		}
+		else {
+			qDebug("%s: %d connections, %.0f connections/s, syscalls/connection unavailable, %d errors", name, n, rate, errors);
+		}
+	}
+
+private Q_SLOTS:
+	void initTestCase(void)
+	{
+		struct sockaddr_in sa;
+		socklen_t l = sizeof(sa);
+		memset(&sa, 0, sizeof(sa));
+		sa.sin_family      = AF_INET;
+		sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+		this->m_listener = ::socket(AF_INET, SOCK_STREAM, 0);
+		QVERIFY(this->m_listener != -1);
+		QVERIFY(!::bind(this->m_listener, reinterpret_cast<struct sockaddr*>(&sa), sizeof(sa)));
+		QVERIFY(!::listen(this->m_listener, 4096));
+		QVERIFY(!::getsockname(this->m_listener, reinterpret_cast<struct sockaddr*>(&sa), &l));
+		this->m_port = ntohs(sa.sin_port);
+
+		int n = qMax(QThread::idealThreadCount(), 1);
+		for (int i=0; i<n; ++i) {
+			this->m_acceptors.append(new Acceptor(this->m_listener));
+			this->m_acceptors.last()->start();
+		}
+	}
+
+	void cleanupTestCase(void)
+	{
+		::shutdown(this->m_listener, SHUT_RDWR);
+		for (int i=0; i<this->m_acceptors.size(); ++i) {
+			this->m_acceptors.at(i)->wait();
+		}
+
+		qDeleteAll(this->m_acceptors);
+		this->m_acceptors.clear();
+		::close(this->m_listener);
+		this->m_listener = -1;
+	}
+
+	void connectRate_data(void)
+	{
+		QTest::addColumn<int>("backend");
+		QTest::addColumn<int>("count");
+
+		QTest::newRow("epoll, 100") << int(BatchConnector::EpollBackend) << 100;
+		QTest::newRow("epoll, 1000") << int(BatchConnector::EpollBackend) << 1000;
+		QTest::newRow("io_uring, 100") << int(BatchConnector::IoUringBackend) << 100;
+		QTest::newRow("io_uring, 1000") << int(BatchConnector::IoUringBackend) << 1000;
+	}
+
+	void connectRate(void)
+	{
+		QFETCH(int, backend);
+		QFETCH(int, count);
+
+		BatchConnector conn;
+		if (!conn.setBackend(BatchConnector::Backend(backend))) {
+#if QT_VERSION < 0x050000
+			QSKIP("The backend is not available", SkipSingle);
+#else
+			QSKIP("The backend is not available");
+#endif
+		}
+
+		QObject::connect(&conn, SIGNAL(connected(int,qintptr)), this, SLOT(handleConnected(int,qintptr)));
+		QObject::connect(&conn, SIGNAL(error(int,QAbstractSocket::SocketError)), this, SLOT(handleError(int,QAbstractSocket::SocketError)));
+
+		QList<BatchConnector::Endpoint> endpoints;
+		for (int i=0; i<count; ++i) {
+			endpoints << BatchConnector::Endpoint(QHostAddress::LocalHost, this->m_port);
+		}
+
+		SyscallCounter counter;
+		quint64 syscalls = 0;
+		qint64 elapsed   = 0;
+		this->m_errors   = 0;
+
+		QBENCHMARK {
+			QElapsedTimer timer;
+			timer.start();
+			counter.start();
+			this->m_remaining = count;
+			conn.connectMany(endpoints);
+			this->wait();
+			syscalls = counter.stop();
+			elapsed  = timer.nsecsElapsed();
+		}
+
+		report(QTest::currentDataTag(), count, elapsed, counter, syscalls, this->m_errors);
+	}
+};
+
+int main(int argc, char** argv)
+{
+	QCoreApplication a(argc, argv);
+	ConnectBackendsBenchmark t;
+	return QTest::qExec(&t, argc, argv);
+}
+
+#include "bench_connectbackends.moc"
@@ -0,0 +1,380 @@
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QEventLoop>
+#include <QtCore/QFile>
+#include <QtCore/QStringList>
+#include <QtCore/QTextStream>
+#include <QtCore/QTimer>
+#include <QtCore/QVector>
+#include <QtNetwork/QTcpServer>
+#include <QtNetwork/QTcpSocket>
+#include <algorithm>
+#include <climits>
+#include <stdlib.h>
+#include "hostinfocache.h"
+#include "socketconnector.h"
+
+/*
+ * Connect latency and throughput of SocketConnector compared with QTcpSocket::connectToHost().
+ *
+ * Usage: bench_connectlatency [-n iterations] [-d duration_ms] [-o file]
+ *
+ * Every result is written as one JSON object per line (to stdout unless -o is given), e.g.
+ * {"benchmark":"latency","client":"SocketConnector","samples":1000,"p50_us":41.2,"p99_us":97.0}
+ */
+
+#ifdef __GLIBC__
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t n, size_t size);
+extern "C" void* __libc_realloc(void* ptr, size_t size);
+
+static bool counting = false;
+static qint64 allocations = 0;
+
+extern "C" void* malloc(size_t size)
+{
+	if (counting) {
+		++allocations;
+	}
+
+	return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t n, size_t size)
+{
+	if (counting) {
+		++allocations;
+	}
+
+	return __libc_calloc(n, size);
+}
+
+extern "C" void* realloc(void* ptr, size_t size)
+{
+	if (counting) {
+		++allocations;
+	}
+
+	return __libc_realloc(ptr, size);
+}
+#endif
+
+class ConnectLatencyBenchmark : public QObject {
+	Q_OBJECT
+public:
+	enum Client {
+		SocketConnectorClient,
+		BoundSocketConnectorClient,
+		QTcpSocketClient,
+		BoundQTcpSocketClient
+	};
+
+	ConnectLatencyBenchmark(int iterations, int duration, QTextStream* out, QObject* parent = 0)
+		: QObject(parent), m_iterations(iterations), m_duration(duration), m_out(out), m_server(0), m_cache(0), m_dead()
+	{
+	}
+
+	bool run(void)
+	{
+		this->m_server = new QTcpServer(this);
+		this->m_server->setMaxPendingConnections(INT_MAX);
+		QObject::connect(this->m_server, SIGNAL(newConnection()), this, SLOT(drain()));
+		if (!this->m_server->listen(QHostAddress::LocalHost)) {
+			return false;
+		}
+
+		// The server listens on 127.0.0.1 only: the other loopback addresses refuse the connections
+		this->m_cache = new HostInfoCache(this);
+		for (int i=2; i<=4; ++i) {
+			this->m_dead.append(QHostAddress(quint32(0x7F000000 + i)));
+		}
+
+		QList<Client> clients = QList<Client>() << SocketConnectorClient << QTcpSocketClient << BoundSocketConnectorClient;
+#if QT_VERSION >= 0x050000
+		clients << BoundQTcpSocketClient;
+#endif
+
+		for (int i=0; i<clients.size(); ++i) {
+			this->latency(clients.at(i));
+		}
+
+		for (int i=0; i<clients.size(); ++i) {
+			this->throughput(clients.at(i));
+		}
+
+		this->failover(SocketConnectorClient);
+		this->failover(QTcpSocketClient);
+
+#ifdef __GLIBC__
+		this->allocationsPerConnect(SocketConnectorClient);
+		this->allocationsPerConnect(QTcpSocketClient);
+#endif
+
+		return true;
+	}
+
+protected Q_SLOTS:
+	void drain(void)
+	{
+		while (this->m_server->hasPendingConnections()) {
+			delete this->m_server->nextPendingConnection();
+		}
+	}
+
+private:
+	int m_iterations;
+	int m_duration;
+	QTextStream* m_out;
+	QTcpServer* m_server;
+	HostInfoCache* m_cache;
+	QList<QHostAddress> m_dead;
+
+	static const char* clientName(Client client)
+	{
+		switch (client) {
+			case SocketConnectorClient:      return "SocketConnector";
+			case BoundSocketConnectorClient: return "SocketConnector+bindTo";
+			case QTcpSocketClient:           return "QTcpSocket";
+			case BoundQTcpSocketClient:      return "QTcpSocket+bind";
+			default:                         return "unknown";
+		}
+	}
+
+	static double percentile(const QVector<qint64>& sorted, int p)
+	{
+		if (sorted.isEmpty()) {
+			return 0;
+		}
+
+		int idx = qMin(sorted.size() - 1, sorted.size() * p / 100);
+		return double(sorted.at(idx)) / 1000.0;
+	}
+
+	/*
+	 * Connects to the first address in @a addresses which accepts the connection, in the order given,
+	 * and closes the connection
+	 */
+	bool connectOnce(Client client, const QString& host, const QList<QHostAddress>& addresses)
+	{
+		quint16 port = this->m_server->serverPort();
+		QEventLoop loop;
+		QTimer::singleShot(5000, &loop, SLOT(quit()));
+
+		switch (client) {
+			case SocketConnectorClient:
+			case BoundSocketConnectorClient: {
+				SocketConnector conn;
+				conn.setHostInfoCache(this->m_cache);
+				QObject::connect(&conn, SIGNAL(connected()), &loop, SLOT(quit()));
+				QObject::connect(&conn, SIGNAL(error(QAbstractSocket::SocketError)), &loop, SLOT(quit()));
+
+				if (!conn.createTcpSocket() || (BoundSocketConnectorClient == client && !conn.bindTo(QHostAddress::LocalHost))) {
+					return false;
+				}
+
+				conn.connectToHost(host, port);
+				if (QAbstractSocket::ConnectingState == conn.state() || QAbstractSocket::HostLookupState == conn.state()) {
+					loop.exec();
+				}
+
+				bool res = QAbstractSocket::ConnectedState == conn.state();
+				conn.disconnectFromHost();
+				return res;
+			}
+
+			case QTcpSocketClient:
+			case BoundQTcpSocketClient: {
+				QTcpSocket sock;
+				QObject::connect(&sock, SIGNAL(connected()), &loop, SLOT(quit()));
+				QObject::connect(&sock, SIGNAL(error(QAbstractSocket::SocketError)), &loop, SLOT(quit()));
+
+				// QTcpSocket cannot be given an address list: the addresses are tried in turn, as QAbstractSocket does
+				for (int i=0; i<addresses.size(); ++i) {
+#if QT_VERSION >= 0x050000
+					if (BoundQTcpSocketClient == client && !sock.bind(QHostAddress::LocalHost)) {
+						return false;
+					}
+#endif
+
+					sock.connectToHost(addresses.at(i), port);
+					if (QAbstractSocket::ConnectedState != sock.state()) {
+						loop.exec();
+					}
+
+					if (QAbstractSocket::ConnectedState == sock.state()) {
+						sock.abort();
+						return true;
+					}
+
+					sock.abort();
+				}
+
+				return false;
+			}
+
+			default:
+				return false;
+		}
+	}
+
+	bool connectOnce(Client client)
+	{
+		return this->connectOnce(client, QLatin1String("127.0.0.1"), QList<QHostAddress>() << QHostAddress(QHostAddress::LocalHost));
+	}
+
+	void report(const QString& json)
+	{
+		*this->m_out << json << '\n';
+		this->m_out->flush();
+	}
+
+	void latency(Client client)
+	{
+		QVector<qint64> samples;
+		samples.reserve(this->m_iterations);
+
+		int failures = 0;
+		QElapsedTimer timer;
+		for (int i=0; i<this->m_iterations; ++i) {
+			timer.start();
+			if (this->connectOnce(client)) {
+				samples.append(timer.nsecsElapsed());
+			}
+			else {
+				++failures;
+			}
+		}
+
+		std::sort(samples.begin(), samples.end());
+		this->report(
+			QString(QLatin1String("{\"benchmark\":\"latency\",\"client\":\"%1\",\"samples\":%2,\"failures\":%3,\"p50_us\":%4,\"p99_us\":%5}"))
+				.arg(QLatin1String(clientName(client)))
+				.arg(samples.size())
+				.arg(failures)
+				.arg(percentile(samples, 50), 0, 'f', 1)
+				.arg(percentile(samples, 99), 0, 'f', 1)
+		);
+	}
+
+	void throughput(Client client)
+	{
+		int n = 0;
+		QElapsedTimer timer;
+		timer.start();
+		while (timer.elapsed() < this->m_duration) {
+			if (this->connectOnce(client)) {
+				++n;
+			}
+		}
+
+		qint64 elapsed = timer.nsecsElapsed();
+		this->report(
+			QString(QLatin1String("{\"benchmark\":\"throughput\",\"client\":\"%1\",\"connections\":%2,\"connects_per_sec\":%3}"))
+				.arg(QLatin1String(clientName(client)))
+				.arg(n)
+				.arg(elapsed ? double(n) * 1e9 / double(elapsed) : 0.0, 0, 'f', 0)
+		);
+	}
+
+	void failover(Client client)
+	{
+		const QString name = QLatin1String("failover.bench");
+		QList<QHostAddress> addresses = this->m_dead;
+		addresses.append(QHostAddress(QHostAddress::LocalHost));
+
+		QHostInfo info;
+		info.setHostName(name);
+		info.setAddresses(addresses);
+		this->m_cache->insert(name, info);
+
+		QVector<qint64> samples;
+		samples.reserve(this->m_iterations);
+
+		QElapsedTimer timer;
+		for (int i=0; i<this->m_iterations; ++i) {
+			timer.start();
+			if (this->connectOnce(client, name, addresses)) {
+				samples.append(timer.nsecsElapsed());
+			}
+		}
+
+		std::sort(samples.begin(), samples.end());
+		this->report(
+			QString(QLatin1String("{\"benchmark\":\"failover\",\"client\":\"%1\",\"dead_addresses\":%2,\"samples\":%3,\"p50_us\":%4,\"p99_us\":%5}"))
+				.arg(QLatin1String(clientName(client)))
+				.arg(this->m_dead.size())
+				.arg(samples.size())
+				.arg(percentile(samples, 50), 0, 'f', 1)
+				.arg(percentile(samples, 99), 0, 'f', 1)
+		);
+	}
+
+#ifdef __GLIBC__
+	void allocationsPerConnect(Client client)
+	{
+		int n = 0;
+		allocations = 0;
+		for (int i=0; i<this->m_iterations; ++i) {
+			counting = true;
+			bool res = this->connectOnce(client);
+			counting = false;
+			n += res ? 1 : 0;
+		}
+
+		this->report(
+			QString(QLatin1String("{\"benchmark\":\"allocations\",\"client\":\"%1\",\"connections\":%2,\"allocs_per_connect\":%3}"))
+				.arg(QLatin1String(clientName(client)))
+				.arg(n)
+				.arg(n ? double(allocations) / double(n) : 0.0, 0, 'f', 1)
+		);
+	}
+#endif
+};
+
+int main(int argc, char** argv)
+{
+	QCoreApplication a(argc, argv);
+
+	int iterations = 1000;
+	int duration   = 2000;
+	QString output;
+
+	QStringList args = a.arguments();
+	for (int i=1; i<args.size(); ++i) {
+		const QString& arg = args.at(i);
+		if (i + 1 < args.size() && QLatin1String("-n") == arg) {
+			iterations = qMax(1, args.at(++i).toInt());
+		}
+		else if (i + 1 < args.size() && QLatin1String("-d") == arg) {
+			duration = qMax(1, args.at(++i).toInt());
+		}
+		else if (i + 1 < args.size() && QLatin1String("-o") == arg) {
+			output = args.at(++i);
+		}
+		else {
+			qWarning("Usage: %s [-n iterations] [-d duration_ms] [-o file]", qPrintable(args.at(0)));
+			return 1;
+		}
+	}
+
+	QFile f;
+	bool ok;
+	if (output.isEmpty()) {
+		ok = f.open(stdout, QIODevice::WriteOnly);
+	}
+	else {
+		f.setFileName(output);
+		ok = f.open(QIODevice::WriteOnly | QIODevice::Truncate);
+	}
+
+	if (!ok) {
+		qWarning("Cannot open %s", qPrintable(output));
+		return 1;
+	}
+
+	QTextStream out(&f);
+	ConnectLatencyBenchmark b(iterations, duration, &out);
+	return b.run() ? 0 : 1;
+}
+
+#include "bench_connectlatency.moc"
@@ -0,0 +1,15 @@
+QT      += network
+QT      -= gui
+TARGET   = bench_connectlatency
+CONFIG  += console
+CONFIG  -= app_bundle
+TEMPLATE = app
+DESTDIR  = ..
+
+SOURCES  = bench_connectlatency.cpp
+
+INCLUDEPATH += ../../../src
+DEPENDPATH  += ../../../src
+LIBS        += -L$$OUT_PWD/$$DESTDIR/../../lib -lsocketconnector
+
+unix: PRE_TARGETDEPS += $$OUT_PWD/$$DESTDIR/../../lib/libsocketconnector.a
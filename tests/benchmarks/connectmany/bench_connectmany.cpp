@@ -0,0 +1,169 @@
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QEventLoop>
+#include <QtCore/QTimer>
+#include <QtNetwork/QTcpServer>
+#include <QtNetwork/QTcpSocket>
+#include <QtTest/QTest>
+#include <climits>
+#include <unistd.h>
+#include "batchconnector.h"
+#include "socketconnector.h"
+
+class ConnectManyBenchmark : public QObject {
+	Q_OBJECT
+public:
+	explicit ConnectManyBenchmark(QObject* parent = 0)
+		: QObject(parent), m_server(0), m_remaining(0), m_loop(0)
+	{
+	}
+
+protected Q_SLOTS:
+	void drain(void)
+	{
+		while (this->m_server->hasPendingConnections()) {
+			delete this->m_server->nextPendingConnection();
+		}
+	}
+
+	void batchConnected(int, qintptr socket)
+	{
+		::close(int(socket));
+		this->done();
+	}
+
+	void batchError(int, QAbstractSocket::SocketError)
+	{
+		this->done();
+	}
+
+	void connectorConnected(void)
+	{
+		SocketConnector* conn = qobject_cast<SocketConnector*>(this->sender());
+		::close(int(conn->releaseSocketDescriptor()));
+		this->done();
+	}
+
+	void connectorError(void)
+	{
+		this->done();
+	}
+
+private:
+	QTcpServer* m_server;
+	int m_remaining;
+	QEventLoop* m_loop;
+
+	void done(void)
+	{
+		if (!--this->m_remaining && this->m_loop) {
+			this->m_loop->quit();
+		}
+	}
+
+	void wait(void)
+	{
+		QEventLoop loop;
+		this->m_loop = &loop;
+		QTimer::singleShot(30000, &loop, SLOT(quit()));
+		if (this->m_remaining) {
+			loop.exec();
+		}
+
+		this->m_loop = 0;
+	}
+
+	static void report(const char* name, int n, qint64 nsecs)
+	{
+		qDebug("%s: %d connections, %.0f connections/s", name, n, nsecs ? double(n) * 1e9 / double(nsecs) : 0.0);
+	}
+
+private Q_SLOTS:
+	void initTestCase(void)
+	{
+		this->m_server = new QTcpServer(this);
+		this->m_server->setMaxPendingConnections(INT_MAX);
+		QVERIFY(QObject::connect(this->m_server, SIGNAL(newConnection()), this, SLOT(drain())));
+		QVERIFY(this->m_server->listen(QHostAddress::LocalHost));
+	}
+
+	void cleanupTestCase(void)
+	{
+		delete this->m_server;
+		this->m_server = 0;
+	}
+
+	void connectMany_data(void)
+	{
+		QTest::addColumn<int>("count");
+		QTest::newRow("100") << 100;
+		QTest::newRow("1000") << 1000;
+	}
+
+	void connectMany(void)
+	{
+		QFETCH(int, count);
+
+		QList<BatchConnector::Endpoint> endpoints;
+		for (int i=0; i<count; ++i) {
+			endpoints << BatchConnector::Endpoint(QHostAddress::LocalHost, this->m_server->serverPort());
+		}
+
+		BatchConnector conn;
+		QObject::connect(&conn, SIGNAL(connected(int,qintptr)), this, SLOT(batchConnected(int,qintptr)));
+		QObject::connect(&conn, SIGNAL(error(int,QAbstractSocket::SocketError)), this, SLOT(batchError(int,QAbstractSocket::SocketError)));
+
+		qint64 elapsed = 0;
+		QBENCHMARK {
+			QElapsedTimer timer;
+			timer.start();
+			this->m_remaining = count;
+			conn.connectMany(endpoints);
+			this->wait();
+			elapsed = timer.nsecsElapsed();
+		}
+
+		report("BatchConnector", count, elapsed);
+	}
+
+	void perConnector_data(void)
+	{
+		this->connectMany_data();
+	}
+
+	void perConnector(void)
+	{
+		QFETCH(int, count);
+
+		qint64 elapsed = 0;
+		QBENCHMARK {
+			QElapsedTimer timer;
+			timer.start();
+			QList<SocketConnector*> connectors;
+			this->m_remaining = count;
+			for (int i=0; i<count; ++i) {
+				SocketConnector* conn = new SocketConnector(this);
+				QObject::connect(conn, SIGNAL(connected()), this, SLOT(connectorConnected()));
+				QObject::connect(conn, SIGNAL(error(QAbstractSocket::SocketError)), this, SLOT(connectorError()));
+				conn->createTcpSocket();
+				conn->connectToHost(QHostAddress(QHostAddress::LocalHost), this->m_server->serverPort());
+				connectors.append(conn);
+			}
+
+			this->wait();
+			elapsed = timer.nsecsElapsed();
+			qDeleteAll(connectors);
+		}
+
+		report("SocketConnector", count, elapsed);
+	}
+};
+
+int main(int argc, char** argv)
+{
+	QCoreApplication a(argc, argv);
+	ConnectManyBenchmark t;
+	return QTest::qExec(&t, argc, argv);
+}
+
+#include "bench_connectmany.moc"
@@ -0,0 +1,165 @@
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QSemaphore>
+#include <QtCore/QThread>
+#include <QtTest/QTest>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <errno.h>
+#include <unistd.h>
+#include "connectorengine.h"
+
+/*
+ * Accepts and closes the connections with blocking accept() calls, so that the server side does not limit the connect rate
+ */
+class Acceptor : public QThread {
+public:
+	explicit Acceptor(int listener)
+		: QThread(0), m_listener(listener)
+	{
+	}
+
+protected:
+	virtual void run(void)
+	{
+		while (true) {
+			int fd = ::accept(this->m_listener, 0, 0);
+			if (-1 != fd) {
+				::close(fd);
+			}
+			else if (EINTR != errno && ECONNABORTED != errno) {
+				// shutdown() of the listening socket
+				break;
+			}
+		}
+	}
+
+private:
+	int m_listener;
+};
+
+class ConnectorEngineBenchmark : public QObject {
+	Q_OBJECT
+public:
+	explicit ConnectorEngineBenchmark(QObject* parent = 0)
+		: QObject(parent), m_listener(-1), m_port(0), m_acceptors(), m_done(), m_errors(0)
+	{
+	}
+
+protected Q_SLOTS:
+	// Called in the shard threads
+	void handleConnected(int, qintptr socket)
+	{
+		// Reset instead of FIN: the client side does not pile up TIME_WAIT sockets and run out of ports
+		struct linger l;
+		l.l_onoff  = 1;
+		l.l_linger = 0;
+		::setsockopt(int(socket), SOL_SOCKET, SO_LINGER, &l, sizeof(l));
+		::close(int(socket));
+		this->m_done.release();
+	}
+
+	void handleError(int, QAbstractSocket::SocketError)
+	{
+		this->m_errors.ref();
+		this->m_done.release();
+	}
+
+private:
+	int m_listener;
+	quint16 m_port;
+	QList<Acceptor*> m_acceptors;
+	QSemaphore m_done;
+	QAtomicInt m_errors;
+
+	static void report(int shards, int n, qint64 nsecs, int errors)
+	{
+		qDebug("%d shard(s): %d connections, %.0f connections/s, %d errors", shards, n, nsecs ? double(n) * 1e9 / double(nsecs) : 0.0, errors);
+	}
+
+private Q_SLOTS:
+	void initTestCase(void)
+	{
+		struct sockaddr_in sa;
+		socklen_t l = sizeof(sa);
+		memset(&sa, 0, sizeof(sa));
+		sa.sin_family      = AF_INET;
+		sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+		this->m_listener = ::socket(AF_INET, SOCK_STREAM, 0);
+		QVERIFY(this->m_listener != -1);
+		QVERIFY(!::bind(this->m_listener, reinterpret_cast<struct sockaddr*>(&sa), sizeof(sa)));
+		QVERIFY(!::listen(this->m_listener, 4096));
+		QVERIFY(!::getsockname(this->m_listener, reinterpret_cast<struct sockaddr*>(&sa), &l));
+		this->m_port = ntohs(sa.sin_port);
+
+		int n = qMax(QThread::idealThreadCount(), 1);
+		for (int i=0; i<n; ++i) {
+			this->m_acceptors.append(new Acceptor(this->m_listener));
+			this->m_acceptors.last()->start();
+		}
+	}
+
+	void cleanupTestCase(void)
+	{
+		::shutdown(this->m_listener, SHUT_RDWR);
+		for (int i=0; i<this->m_acceptors.size(); ++i) {
+			this->m_acceptors.at(i)->wait();
+		}
+
+		qDeleteAll(this->m_acceptors);
+		this->m_acceptors.clear();
+		::close(this->m_listener);
+		this->m_listener = -1;
+	}
+
+	void connectRate_data(void)
+	{
+		QTest::addColumn<int>("shards");
+
+		int cores = qMax(QThread::idealThreadCount(), 1);
+		for (int n=1; n<cores; n *= 2) {
+			QTest::newRow(QByteArray::number(n).constData()) << n;
+		}
+
+		QTest::newRow(QByteArray::number(cores).constData()) << cores;
+	}
+
+	void connectRate(void)
+	{
+		QFETCH(int, shards);
+		const int count = 5000;
+
+		ConnectorEngine engine;
+		engine.setShardCount(shards);
+		QObject::connect(&engine, SIGNAL(connected(int,qintptr)), this, SLOT(handleConnected(int,qintptr)), Qt::DirectConnection);
+		QObject::connect(&engine, SIGNAL(error(int,QAbstractSocket::SocketError)), this, SLOT(handleError(int,QAbstractSocket::SocketError)), Qt::DirectConnection);
+		QVERIFY(engine.start());
+
+		BatchConnector::Endpoint e(QHostAddress::LocalHost, this->m_port);
+		qint64 elapsed = 0;
+		this->m_errors.fetchAndStoreRelaxed(0);
+
+		QBENCHMARK {
+			QElapsedTimer timer;
+			timer.start();
+			for (int i=0; i<count; ++i) {
+				engine.submit(e);
+			}
+
+			QVERIFY(this->m_done.tryAcquire(count, 60000));
+			elapsed = timer.nsecsElapsed();
+		}
+
+		report(shards, count, elapsed, this->m_errors.fetchAndAddRelaxed(0));
+	}
+};
+
+int main(int argc, char** argv)
+{
+	QCoreApplication a(argc, argv);
+	ConnectorEngineBenchmark t;
+	return QTest::qExec(&t, argc, argv);
+}
+
+#include "bench_connectorengine.moc"
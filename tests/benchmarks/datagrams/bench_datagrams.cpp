@@ -0,0 +1,234 @@
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtNetwork/QUdpSocket>
+#include <QtTest/QTest>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <string.h>
+#include <unistd.h>
+#include "datagramchannel.h"
+
+/*
+ * Sends the datagrams in bursts which fit into the receive buffer and reads every burst back,
+ * so that the loopback does not drop anything and both sides are measured
+ */
+class DatagramsBenchmark : public QObject {
+	Q_OBJECT
+public:
+	explicit DatagramsBenchmark(QObject* parent = 0)
+		: QObject(parent)
+	{
+	}
+
+private:
+	enum {
+		total = 100000,
+		burst = 64
+	};
+
+	static int boundSocket(quint16* port)
+	{
+		struct sockaddr_in sa;
+		socklen_t l = sizeof(sa);
+		memset(&sa, 0, sizeof(sa));
+		sa.sin_family      = AF_INET;
+		sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+		int fd  = ::socket(AF_INET, SOCK_DGRAM, 0);
+		int buf = 4 * 1024 * 1024;
+		::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &buf, sizeof(buf));
+		::bind(fd, reinterpret_cast<struct sockaddr*>(&sa), sizeof(sa));
+		::getsockname(fd, reinterpret_cast<struct sockaddr*>(&sa), &l);
+		*port = ntohs(sa.sin_port);
+		return fd;
+	}
+
+	static int connectedSocket(quint16 port)
+	{
+		struct sockaddr_in sa;
+		memset(&sa, 0, sizeof(sa));
+		sa.sin_family      = AF_INET;
+		sa.sin_port        = htons(port);
+		sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+		int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+		::connect(fd, reinterpret_cast<struct sockaddr*>(&sa), sizeof(sa));
+		return fd;
+	}
+
+	static void report(const char* name, int size, int n, qint64 nsecs)
+	{
+		double rate = nsecs ? double(n) * 1e9 / double(nsecs) : 0.0;
+		qDebug("%s, %d bytes: %d datagrams, %.0f datagrams/s, %.1f MB/s", name, size, n, rate, rate * size / 1e6);
+	}
+
+private Q_SLOTS:
+	void qUdpSocket_data(void)
+	{
+		QTest::addColumn<int>("size");
+		QTest::newRow("64") << 64;
+		QTest::newRow("512") << 512;
+		QTest::newRow("1400") << 1400;
+	}
+
+	void qUdpSocket(void)
+	{
+		QFETCH(int, size);
+
+		quint16 port;
+		QUdpSocket receiver;
+		QUdpSocket sender;
+		QVERIFY(receiver.setSocketDescriptor(boundSocket(&port), QAbstractSocket::BoundState));
+		QVERIFY(sender.setSocketDescriptor(connectedSocket(port), QAbstractSocket::ConnectedState));
+
+		QByteArray payload(size, 'x');
+		QByteArray buffer(size, 0);
+		int received = 0;
+		qint64 elapsed = 0;
+
+		QBENCHMARK {
+			QElapsedTimer timer;
+			timer.start();
+			received = 0;
+			for (int sent=0; sent<total; sent += burst) {
+				for (int i=0; i<burst; ++i) {
+					sender.write(payload);
+				}
+
+				for (int i=0; i<burst; ++i) {
+					if (receiver.readDatagram(buffer.data(), size) > 0) {
+						++received;
+					}
+				}
+			}
+
+			elapsed = timer.nsecsElapsed();
+		}
+
+		report("QUdpSocket", size, received, elapsed);
+	}
+
+	void datagramChannel_data(void)
+	{
+		this->qUdpSocket_data();
+	}
+
+	void datagramChannel(void)
+	{
+		QFETCH(int, size);
+
+		quint16 port;
+		DatagramChannel receiver;
+		DatagramChannel sender;
+		QVERIFY(receiver.setSocketDescriptor(boundSocket(&port)));
+		QVERIFY(sender.setSocketDescriptor(connectedSocket(port)));
+
+		DatagramRing out(burst, size);
+		DatagramRing in(burst, size);
+		for (int i=0; i<burst; ++i) {
+			memset(out.data(i), 'x', size);
+			out.setSize(i, size);
+		}
+
+		int received = 0;
+		qint64 elapsed = 0;
+
+		QBENCHMARK {
+			QElapsedTimer timer;
+			timer.start();
+			received = 0;
+			for (int sent=0; sent<total; sent += burst) {
+				int n = 0;
+				while (n < burst) {
+					int res = sender.send(out, n, burst - n);
+					if (res < 0) {
+						break;
+					}
+
+					n += res;
+				}
+
+				int res = receiver.receive(in, 0, burst);
+				if (res > 0) {
+					received += res;
+				}
+			}
+
+			elapsed = timer.nsecsElapsed();
+		}
+
+		report("DatagramChannel", size, received, elapsed);
+	}
+
+
+	void datagramChannelGso_data(void)
+	{
+		this->qUdpSocket_data();
+	}
+
+	void datagramChannelGso(void)
+	{
+		QFETCH(int, size);
+
+		if (!DatagramChannel::isSegmentationOffloadSupported()) {
+#if QT_VERSION < 0x050000
+			QSKIP("UDP_SEGMENT is not supported", SkipSingle);
+#else
+			QSKIP("UDP_SEGMENT is not supported");
+#endif
+		}
+
+		quint16 port;
+		DatagramChannel receiver;
+		DatagramChannel sender;
+		QVERIFY(receiver.setSocketDescriptor(boundSocket(&port)));
+		QVERIFY(sender.setSocketDescriptor(connectedSocket(port)));
+
+		// One slot carries as many segments as fit into 64 KiB (at most 64 of them)
+		int segments = qMin(int(burst), 65507 / size);
+		DatagramRing out(1, segments * size);
+		DatagramRing in(burst, size);
+		memset(out.data(0), 'x', segments * size);
+		out.setSize(0, segments * size);
+		out.setSegmentSize(0, size);
+
+		int received = 0;
+		qint64 elapsed = 0;
+
+		QBENCHMARK {
+			QElapsedTimer timer;
+			timer.start();
+			received = 0;
+			for (int sent=0; sent<total; sent += segments) {
+				if (1 != sender.send(out, 0, 1)) {
+					break;
+				}
+
+				int n = 0;
+				while (n < segments) {
+					int res = receiver.receive(in, n, segments - n);
+					if (res <= 0) {
+						break;
+					}
+
+					n += res;
+				}
+
+				received += n;
+			}
+
+			elapsed = timer.nsecsElapsed();
+		}
+
+		report("DatagramChannel + GSO", size, received, elapsed);
+	}
+};
+
+int main(int argc, char** argv)
+{
+	QCoreApplication a(argc, argv);
+	DatagramsBenchmark t;
+	return QTest::qExec(&t, argc, argv);
+}
+
+#include "bench_datagrams.moc"
@@ -0,0 +1,206 @@
+#include <QtCore/QCoreApplication>
+#include <QtTest/QTest>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <stddef.h>
+#include <unistd.h>
+#include "socketconnector.h"
+
+class UnixConnectBenchmark : public QObject {
+	Q_OBJECT
+public:
+	explicit UnixConnectBenchmark(QObject* parent = 0)
+		: QObject(parent), m_path()
+	{
+	}
+
+private:
+	QByteArray m_path;
+
+	/*
+	 * Returns a plain listening socket: the accept queue is drained without an event loop.
+	 * The address to connect to is returned in @a address
+	 */
+	int listen(int domain, int type, QString& address, quint16& port)
+	{
+		int fd = ::socket(domain, type, 0);
+		if (-1 == fd) {
+			return -1;
+		}
+
+		int res;
+		if (AF_UNIX == domain) {
+			struct sockaddr_un sa;
+			memset(&sa, 0, sizeof(sa));
+			sa.sun_family = AF_UNIX;
+			memcpy(sa.sun_path, this->m_path.constData(), this->m_path.size());
+
+			::unlink(this->m_path.constData());
+			res = ::bind(fd, reinterpret_cast<struct sockaddr*>(&sa), socklen_t(offsetof(struct sockaddr_un, sun_path) + this->m_path.size() + 1));
+			address = QString::fromLocal8Bit(this->m_path);
+			port    = 0;
+		}
+		else {
+			struct sockaddr_in sa;
+			socklen_t l = sizeof(sa);
+			memset(&sa, 0, sizeof(sa));
+			sa.sin_family      = AF_INET;
+			sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+			res = ::bind(fd, reinterpret_cast<struct sockaddr*>(&sa), sizeof(sa));
+			if (!res) {
+				res = ::getsockname(fd, reinterpret_cast<struct sockaddr*>(&sa), &l);
+			}
+
+			address = QLatin1String("127.0.0.1");
+			port    = ntohs(sa.sin_port);
+		}
+
+		if (-1 == res || -1 == ::listen(fd, 128)) {
+			::close(fd);
+			return -1;
+		}
+
+		return fd;
+	}
+
+	void addRows(void)
+	{
+		QTest::addColumn<int>("domain");
+		QTest::addColumn<int>("type");
+
+		QTest::newRow("tcp loopback")   << int(AF_INET) << int(SOCK_STREAM);
+		QTest::newRow("unix stream")    << int(AF_UNIX) << int(SOCK_STREAM);
+		QTest::newRow("unix seqpacket") << int(AF_UNIX) << int(SOCK_SEQPACKET);
+	}
+
+private Q_SLOTS:
+	void initTestCase(void)
+	{
+		this->m_path = "/tmp/bench_unixconnect." + QByteArray::number(QCoreApplication::applicationPid());
+	}
+
+	void cleanupTestCase(void)
+	{
+		::unlink(this->m_path.constData());
+	}
+
+	void connectBlocking_data(void)
+	{
+		this->addRows();
+	}
+
+	void connectBlocking(void)
+	{
+		QFETCH(int, domain);
+		QFETCH(int, type);
+
+		QString address;
+		quint16 port;
+		int listener = this->listen(domain, type, address, port);
+		QVERIFY(listener != -1);
+
+		SocketConnector conn;
+		QBENCHMARK {
+			conn.createSocket(domain, type);
+			qintptr fd = conn.connectToHostBlocking(address, port, 5000);
+			QVERIFY(fd != -1);
+			::close(int(fd));
+
+			int peer = ::accept(listener, 0, 0);
+			if (-1 != peer) {
+				::close(peer);
+			}
+		}
+
+		::close(listener);
+	}
+
+	void connectEventLoop_data(void)
+	{
+		this->addRows();
+	}
+
+	void connectEventLoop(void)
+	{
+		QFETCH(int, domain);
+		QFETCH(int, type);
+
+		QString address;
+		quint16 port;
+		int listener = this->listen(domain, type, address, port);
+		QVERIFY(listener != -1);
+
+		SocketConnector conn;
+		QBENCHMARK {
+			conn.createSocket(domain, type);
+			conn.connectToHost(address, port);
+			QVERIFY(conn.waitForConnected(5000));
+			conn.disconnectFromHost();
+
+			int peer = ::accept(listener, 0, 0);
+			if (-1 != peer) {
+				::close(peer);
+			}
+		}
+
+		::close(listener);
+	}
+
+	void roundTrip_data(void)
+	{
+		this->addRows();
+	}
+
+	// One byte there and back on a connected pair: what the sidecar traffic pays per request
+	void roundTrip(void)
+	{
+		QFETCH(int, domain);
+		QFETCH(int, type);
+
+		QString address;
+		quint16 port;
+		int listener = this->listen(domain, type, address, port);
+		QVERIFY(listener != -1);
+
+		SocketConnector conn;
+		QVERIFY(conn.createSocket(domain, type));
+		int fd = int(conn.connectToHostBlocking(address, port, 5000));
+		QVERIFY(fd != -1);
+
+		int peer = ::accept(listener, 0, 0);
+		QVERIFY(peer != -1);
+
+		// The connector leaves the socket non-blocking
+		::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+		if (AF_INET == domain) {
+			int one = 1;
+			::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+			::setsockopt(peer, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+		}
+
+		char c = 'x';
+		QBENCHMARK {
+			QCOMPARE(::send(fd, &c, 1, MSG_NOSIGNAL), ssize_t(1));
+			QCOMPARE(::recv(peer, &c, 1, 0), ssize_t(1));
+			QCOMPARE(::send(peer, &c, 1, MSG_NOSIGNAL), ssize_t(1));
+			QCOMPARE(::recv(fd, &c, 1, 0), ssize_t(1));
+		}
+
+		::close(peer);
+		::close(fd);
+		::close(listener);
+	}
+};
+
+int main(int argc, char** argv)
+{
+	QCoreApplication a(argc, argv);
+	UnixConnectBenchmark t;
+	return QTest::qExec(&t, argc, argv);
+}
+
+#include "bench_unixconnect.moc"
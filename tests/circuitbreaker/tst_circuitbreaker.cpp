@@ -0,0 +1,115 @@
+#include <QtCore/QCoreApplication>
+#include <QtNetwork/QTcpServer>
+#include <QtTest/QSignalSpy>
+#include <QtTest/QTest>
+#include "circuitbreaker.h"
+#include "socketconnector.h"
+
+class CircuitBreakerTest : public QObject {
+	Q_OBJECT
+public:
+	explicit CircuitBreakerTest(QObject* parent = 0)
+		: QObject(parent), m_host(QLatin1String("upstream.test"))
+	{
+	}
+
+private:
+	QString m_host;
+
+private Q_SLOTS:
+	void testDefaults(void)
+	{
+		CircuitBreaker breaker;
+		QCOMPARE(breaker.failureThreshold(), uint(5));
+		QCOMPARE(breaker.openTime(), uint(30000));
+		QCOMPARE(breaker.probeLimit(), uint(1));
+		QCOMPARE(breaker.state(this->m_host, 80), CircuitBreaker::Closed);
+		QVERIFY(breaker.allow(this->m_host, 80));
+	}
+
+	void testTrip(void)
+	{
+		CircuitBreaker breaker(3, 100, 1);
+
+		// A success in between resets the count of the consecutive failures
+		breaker.reportFailure(this->m_host, 80);
+		breaker.reportFailure(this->m_host, 80);
+		breaker.reportSuccess(this->m_host, 80);
+		breaker.reportFailure(this->m_host, 80);
+		breaker.reportFailure(this->m_host, 80);
+		QCOMPARE(breaker.state(this->m_host, 80), CircuitBreaker::Closed);
+
+		breaker.reportFailure(this->m_host, 80);
+		QCOMPARE(breaker.state(this->m_host, 80), CircuitBreaker::Open);
+		QCOMPARE(breaker.trips(this->m_host, 80), quint64(1));
+		QCOMPARE(breaker.trips(), quint64(1));
+		QCOMPARE(breaker.state(this->m_host, 443), CircuitBreaker::Closed);
+
+		QVERIFY(!breaker.allow(this->m_host, 80));
+		QCOMPARE(breaker.rejections(), quint64(1));
+
+		QTest::qWait(150);
+		QCOMPARE(breaker.state(this->m_host, 80), CircuitBreaker::HalfOpen);
+
+		// Only one probe at a time; a failed probe opens the circuit again
+		QVERIFY(breaker.allow(this->m_host, 80));
+		QVERIFY(!breaker.allow(this->m_host, 80));
+		breaker.reportFailure(this->m_host, 80);
+		QCOMPARE(breaker.state(this->m_host, 80), CircuitBreaker::Open);
+		QCOMPARE(breaker.trips(this->m_host, 80), quint64(2));
+
+		QTest::qWait(150);
+		QVERIFY(breaker.allow(this->m_host, 80));
+		breaker.cancel(this->m_host, 80);
+		QVERIFY(breaker.allow(this->m_host, 80));
+		breaker.reportSuccess(this->m_host, 80);
+		QCOMPARE(breaker.state(this->m_host, 80), CircuitBreaker::Closed);
+
+		breaker.reset();
+		QCOMPARE(breaker.trips(this->m_host, 80), quint64(0));
+	}
+
+	void testConnector(void)
+	{
+		QTcpServer closed;
+		QVERIFY(closed.listen(QHostAddress::LocalHost));
+		quint16 port = closed.serverPort();
+		closed.close();
+
+		CircuitBreaker breaker(2, 60000, 1);
+		const QString host = QLatin1String("127.0.0.1");
+
+		for (int i=0; i<2; ++i) {
+			SocketConnector conn;
+			conn.setCircuitBreaker(&breaker);
+			QCOMPARE(conn.circuitBreaker(), &breaker);
+			QVERIFY(conn.createTcpSocket());
+			conn.connectToHost(host, port);
+			QVERIFY(!conn.waitForConnected(5000));
+		}
+
+		QCOMPARE(breaker.state(host, port), CircuitBreaker::Open);
+
+		// The open circuit fails the connection from within connectToHost()
+		SocketConnector conn;
+		conn.setCircuitBreaker(&breaker);
+		QSignalSpy spy(&conn, SIGNAL(hostFound()));
+		QVERIFY(conn.createTcpSocket());
+		conn.connectToHost(host, port);
+		QCOMPARE(conn.state(), QAbstractSocket::UnconnectedState);
+		QCOMPARE(conn.error(), QAbstractSocket::ConnectionRefusedError);
+		QCOMPARE(spy.count(), 0);
+		QCOMPARE(breaker.rejections(), quint64(1));
+		QCOMPARE(conn.connectToHostBlocking(host, port, 1000), qintptr(-1));
+		QCOMPARE(breaker.rejections(), quint64(2));
+	}
+};
+
+int main(int argc, char** argv)
+{
+	QCoreApplication a(argc, argv);
+	CircuitBreakerTest t;
+	return QTest::qExec(&t, argc, argv);
+}
+
+#include "tst_circuitbreaker.moc"
@@ -0,0 +1,170 @@
+#include <QtCore/QCoreApplication>
+#include <QtCore/QEventLoop>
+#include <QtCore/QTimer>
+#include <QtNetwork/QTcpServer>
+#include <QtTest/QTest>
+#include <stdlib.h>
+#include "hostinfocache.h"
+#include "socketconnector.h"
+
+#ifdef __GLIBC__
+/*
+ * Every heap allocation goes through malloc(): operator new as well as the Qt containers.
+ * The definitions below interpose the C library ones for the whole process.
+ */
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t n, size_t size);
+extern "C" void* __libc_realloc(void* ptr, size_t size);
+
+static bool counting = false;
+static int allocations = 0;
+
+extern "C" void* malloc(size_t size)
+{
+	if (counting) {
+		++allocations;
+	}
+
+	return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t n, size_t size)
+{
+	if (counting) {
+		++allocations;
+	}
+
+	return __libc_calloc(n, size);
+}
+
+extern "C" void* realloc(void* ptr, size_t size)
+{
+	if (counting) {
+		++allocations;
+	}
+
+	return __libc_realloc(ptr, size);
+}
+#endif
+
+class ConnectAllocationsTest : public QObject {
+	Q_OBJECT
+public:
+	explicit ConnectAllocationsTest(QObject* parent = 0)
+		: QObject(parent), m_cache(0), m_port(0)
+	{
+	}
+
+protected Q_SLOTS:
+	void startCounting(void)
+	{
+#ifdef __GLIBC__
+		allocations = 0;
+		counting    = true;
+#endif
+	}
+
+	void stopCounting(void)
+	{
+#ifdef __GLIBC__
+		counting = false;
+#endif
+	}
+
+private:
+	HostInfoCache* m_cache;
+	quint16 m_port;
+
+	/*
+	 * Counts the allocations made from the moment the host is found until the connector gives up
+	 * on @a n addresses, none of which accepts connections
+	 */
+	int measure(int n)
+	{
+		const QString name = QString(QLatin1String("allocations%1.test")).arg(n);
+
+		QList<QHostAddress> addresses;
+		for (int i=1; i<=n; ++i) {
+			addresses.append(QHostAddress(quint32(0x7F000000 + i)));
+		}
+
+		QHostInfo info;
+		info.setHostName(name);
+		info.setAddresses(addresses);
+		this->m_cache->insert(name, info);
+
+		SocketConnector conn;
+		conn.setHostInfoCache(this->m_cache);
+		if (!conn.createTcpSocket()) {
+			return -1;
+		}
+
+		QEventLoop loop;
+		QObject::connect(&conn, SIGNAL(hostFound()), this, SLOT(startCounting()));
+		QObject::connect(&conn, SIGNAL(error(QAbstractSocket::SocketError)), this, SLOT(stopCounting()));
+		QObject::connect(&conn, SIGNAL(connected()), this, SLOT(stopCounting()));
+		QObject::connect(&conn, SIGNAL(error(QAbstractSocket::SocketError)), &loop, SLOT(quit()));
+		QTimer::singleShot(5000, &loop, SLOT(quit()));
+
+		conn.connectToHost(name, this->m_port);
+		if (QAbstractSocket::UnconnectedState != conn.state()) {
+			loop.exec();
+		}
+
+		this->stopCounting();
+		if (QAbstractSocket::UnconnectedState != conn.state() || QAbstractSocket::ConnectionRefusedError != conn.error()) {
+			return -1;
+		}
+
+#ifdef __GLIBC__
+		return allocations;
+#else
+		return 0;
+#endif
+	}
+
+private Q_SLOTS:
+	void initTestCase(void)
+	{
+#ifndef __GLIBC__
+#	if QT_VERSION < 0x050000
+		QSKIP("Counting the allocations requires glibc", SkipAll);
+#	else
+		QSKIP("Counting the allocations requires glibc");
+#	endif
+#endif
+
+		this->m_cache = new HostInfoCache(this);
+
+		QTcpServer server;
+		QVERIFY(server.listen(QHostAddress::LocalHost));
+		this->m_port = server.serverPort();
+		server.close();
+	}
+
+	void testAdditionalAddresses(void)
+	{
+		// Warm up the lazily initialized state of Qt and of the C library
+		QVERIFY(this->measure(1) >= 0);
+
+		int one = this->measure(1);
+		QVERIFY(one >= 0);
+
+		int four = this->measure(4);
+		QVERIFY(four >= 0);
+		QCOMPARE(four, one);
+
+		int eight = this->measure(8);
+		QVERIFY(eight >= 0);
+		QCOMPARE(eight, one);
+	}
+};
+
+int main(int argc, char** argv)
+{
+	QCoreApplication a(argc, argv);
+	ConnectAllocationsTest t;
+	return QTest::qExec(&t, argc, argv);
+}
+
+#include "tst_connectallocations.moc"
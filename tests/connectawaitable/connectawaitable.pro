@@ -0,0 +1,21 @@
+QT      += network testlib
+QT      -= gui
+TARGET   = tst_connectawaitable
+CONFIG  += console
+CONFIG  -= app_bundle
+TEMPLATE = app
+DESTDIR  = ..
+
+lessThan(QT_MAJOR_VERSION, 5): CONFIG += qtestlib
+
+# The awaitable needs C++20 coroutines; GCC 10 also wants -fcoroutines
+CONFIG += c++2a
+*-g++*: QMAKE_CXXFLAGS += -fcoroutines
+
+SOURCES  = tst_connectawaitable.cpp
+
+INCLUDEPATH += ../../src
+DEPENDPATH  += ../../src
+LIBS        += -L$$OUT_PWD/$$DESTDIR/../lib -lsocketconnector
+
+unix: PRE_TARGETDEPS += $$OUT_PWD/$$DESTDIR/../lib/libsocketconnector.a
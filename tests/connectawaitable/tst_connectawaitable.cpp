@@ -0,0 +1,284 @@
+#include <QtCore/QCoreApplication>
+#include <QtNetwork/QTcpServer>
+#include <QtNetwork/QTcpSocket>
+#include <QtTest/QTest>
+#include <exception>
+#include <new>
+#include <stdlib.h>
+#include <unistd.h>
+#include "connectawaitable.h"
+#include "socketconnector.h"
+
+static int allocations = 0;
+
+void* operator new(std::size_t size)
+{
+	++allocations;
+	void* p = malloc(size ? size : 1);
+	if (!p) {
+		throw std::bad_alloc();
+	}
+
+	return p;
+}
+
+void* operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	free(p);
+}
+
+#ifdef SOCKETCONNECTOR_HAS_COROUTINES
+
+/*
+ * The smallest coroutine type: starts eagerly, keeps its frame until the Task is destroyed
+ */
+struct Task {
+	struct promise_type {
+		Task get_return_object(void)
+		{
+			return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+		}
+
+		std::suspend_never initial_suspend(void) noexcept { return std::suspend_never(); }
+		std::suspend_always final_suspend(void) noexcept { return std::suspend_always(); }
+		void return_void(void) {}
+		void unhandled_exception(void) { std::terminate(); }
+	};
+
+	explicit Task(std::coroutine_handle<promise_type> h) : handle(h) {}
+	Task(Task&& other) : handle(other.handle) { other.handle = nullptr; }
+
+	~Task(void)
+	{
+		if (this->handle) {
+			this->handle.destroy();
+		}
+	}
+
+	bool done(void) const
+	{
+		return this->handle.done();
+	}
+
+	std::coroutine_handle<promise_type> handle;
+};
+
+static Task connectTo(SocketConnector* conn, QString address, quint16 port, int timeout, ConnectResult* result)
+{
+	*result = co_await awaitConnect(conn, address, port, timeout);
+}
+
+static Task retry(SocketConnector* conn, quint16 bad, quint16 good, ConnectResult* r1, ConnectResult* r2)
+{
+	*r1 = co_await awaitConnect(conn, QHostAddress(QHostAddress::LocalHost), bad);
+	*r2 = co_await awaitConnect(conn, QHostAddress(QHostAddress::LocalHost), good);
+}
+
+#endif
+
+class ConnectAwaitableTest : public QObject {
+	Q_OBJECT
+public:
+	explicit ConnectAwaitableTest(QObject* parent = 0)
+		: QObject(parent), m_server(0)
+	{
+	}
+
+private:
+	QTcpServer* m_server;
+
+private Q_SLOTS:
+	void initTestCase(void)
+	{
+#ifndef SOCKETCONNECTOR_HAS_COROUTINES
+		QSKIP("The compiler does not support coroutines");
+#endif
+	}
+
+	void init(void)
+	{
+		this->m_server = new QTcpServer(this);
+		QVERIFY(this->m_server->listen(QHostAddress::LocalHost));
+	}
+
+	void cleanup(void)
+	{
+		delete this->m_server;
+		this->m_server = 0;
+	}
+
+	void testConnected(void)
+	{
+#ifdef SOCKETCONNECTOR_HAS_COROUTINES
+		SocketConnector conn;
+		ConnectResult r;
+		Task t = connectTo(&conn, QLatin1String("127.0.0.1"), this->m_server->serverPort(), 5000, &r);
+
+		QTRY_VERIFY(t.done());
+		QVERIFY(r.isValid());
+		QCOMPARE(conn.state(), QAbstractSocket::UnconnectedState);
+		QCOMPARE(conn.socketDescriptor(), qintptr(-1));
+
+		QTcpSocket s;
+		QVERIFY(s.setSocketDescriptor(r.socket));
+		QCOMPARE(s.state(), QAbstractSocket::ConnectedState);
+		QCOMPARE(s.peerPort(), this->m_server->serverPort());
+#endif
+	}
+
+	void testRefused(void)
+	{
+#ifdef SOCKETCONNECTOR_HAS_COROUTINES
+		QTcpServer closed;
+		QVERIFY(closed.listen(QHostAddress::LocalHost));
+		quint16 port = closed.serverPort();
+		closed.close();
+
+		SocketConnector conn;
+		ConnectResult r;
+		Task t = connectTo(&conn, QLatin1String("127.0.0.1"), port, -1, &r);
+
+		QTRY_VERIFY(t.done());
+		QVERIFY(!r.isValid());
+		QCOMPARE(r.error, QAbstractSocket::ConnectionRefusedError);
+#endif
+	}
+
+	void testBusy(void)
+	{
+#ifdef SOCKETCONNECTOR_HAS_COROUTINES
+		SocketConnector conn;
+		QVERIFY(conn.createTcpSocket());
+		conn.connectToHost(QLatin1String("localhost"), this->m_server->serverPort());
+
+		// Fails without suspending
+		ConnectResult r;
+		Task t = connectTo(&conn, QLatin1String("127.0.0.1"), this->m_server->serverPort(), -1, &r);
+		QVERIFY(t.done());
+		QCOMPARE(r.error, QAbstractSocket::OperationError);
+		conn.abort();
+#endif
+	}
+
+	void testAbort(void)
+	{
+#ifdef SOCKETCONNECTOR_HAS_COROUTINES
+		SocketConnector conn;
+		ConnectResult r;
+		Task t = connectTo(&conn, QLatin1String("localhost"), this->m_server->serverPort(), -1, &r);
+		QVERIFY(!t.done());
+		QCOMPARE(conn.state(), QAbstractSocket::HostLookupState);
+
+		conn.abort();
+		QTRY_VERIFY(t.done());
+		QVERIFY(!r.isValid());
+		QCOMPARE(r.error, QAbstractSocket::OperationError);
+#endif
+	}
+
+	void testDestroyCoroutine(void)
+	{
+#ifdef SOCKETCONNECTOR_HAS_COROUTINES
+		SocketConnector conn;
+		ConnectResult r;
+		{
+			Task t = connectTo(&conn, QLatin1String("localhost"), this->m_server->serverPort(), -1, &r);
+			QVERIFY(!t.done());
+		}
+
+		QCOMPARE(conn.state(), QAbstractSocket::UnconnectedState);
+		QTest::qWait(100);
+		QVERIFY(!r.isValid());
+		QCOMPARE(r.error, QAbstractSocket::UnknownSocketError);
+#endif
+	}
+
+	void testReuse(void)
+	{
+#ifdef SOCKETCONNECTOR_HAS_COROUTINES
+		SocketConnector conn;
+		int counts[3];
+
+		// The allocations made by the await up to the suspension, with the coroutine frame and the connect itself
+		for (int i=0; i<3; ++i) {
+			ConnectResult r;
+			int before = allocations;
+			Task t     = connectTo(&conn, QLatin1String("127.0.0.1"), this->m_server->serverPort(), 5000, &r);
+			counts[i]  = allocations - before;
+
+			QTRY_VERIFY(t.done());
+			QVERIFY(r.isValid());
+			::close(int(r.socket));
+			QVERIFY(this->m_server->hasPendingConnections() || this->m_server->waitForNewConnection(5000));
+			delete this->m_server->nextPendingConnection();
+		}
+
+		qDebug("Allocations per await: %d, %d, %d", counts[0], counts[1], counts[2]);
+
+		int helpers = 0;
+		const QObjectList& children = conn.children();
+		for (int i=0; i<children.size(); ++i) {
+			helpers += dynamic_cast<ConnectAwaitHelper*>(children.at(i)) ? 1 : 0;
+		}
+
+		// The helper and its connections come with the first await only
+		QCOMPARE(helpers, 1);
+		QVERIFY(counts[1] < counts[0]);
+		QVERIFY(counts[2] <= counts[1]);
+#endif
+	}
+
+	void testAwaitAgain(void)
+	{
+#ifdef SOCKETCONNECTOR_HAS_COROUTINES
+		QTcpServer closed;
+		QVERIFY(closed.listen(QHostAddress::LocalHost));
+		quint16 port = closed.serverPort();
+		closed.close();
+
+		// The helper is free again by the time the coroutine is resumed
+		SocketConnector conn;
+		ConnectResult r1;
+		ConnectResult r2;
+		Task t = retry(&conn, port, this->m_server->serverPort(), &r1, &r2);
+
+		QTRY_VERIFY(t.done());
+		QCOMPARE(r1.error, QAbstractSocket::ConnectionRefusedError);
+		QVERIFY(r2.isValid());
+		::close(int(r2.socket));
+#endif
+	}
+
+	void testDestroyConnector(void)
+	{
+#ifdef SOCKETCONNECTOR_HAS_COROUTINES
+		SocketConnector* conn = new SocketConnector();
+		ConnectResult r;
+		Task t = connectTo(conn, QLatin1String("localhost"), this->m_server->serverPort(), -1, &r);
+		QVERIFY(!t.done());
+
+		delete conn;
+		QTRY_VERIFY(t.done());
+		QCOMPARE(r.error, QAbstractSocket::OperationError);
+#endif
+	}
+};
+
+int main(int argc, char** argv)
+{
+	QCoreApplication a(argc, argv);
+	ConnectAwaitableTest t;
+	return QTest::qExec(&t, argc, argv);
+}
+
+#include "tst_connectawaitable.moc"
@@ -0,0 +1,208 @@
+#include <QtCore/QCoreApplication>
+#include <QtCore/QMap>
+#include <QtCore/QThread>
+#include <QtNetwork/QTcpServer>
+#include <QtNetwork/QTcpSocket>
+#include <QtTest/QTest>
+#include <algorithm>
+#include <unistd.h>
+#include "connectorengine.h"
+
+class Submitter : public QThread {
+public:
+	Submitter(ConnectorEngine* engine, const BatchConnector::Endpoint& e, int count)
+		: QThread(0), m_engine(engine), m_endpoint(e), m_count(count), m_failed(0)
+	{
+	}
+
+	int failed(void) const
+	{
+		return this->m_failed;
+	}
+
+protected:
+	virtual void run(void)
+	{
+		for (int i=0; i<this->m_count; ++i) {
+			if (-1 == this->m_engine->submit(this->m_endpoint)) {
+				++this->m_failed;
+			}
+		}
+	}
+
+private:
+	ConnectorEngine* m_engine;
+	BatchConnector::Endpoint m_endpoint;
+	int m_count;
+	int m_failed;
+};
+
+class ConnectorEngineTest : public QObject {
+	Q_OBJECT
+public:
+	explicit ConnectorEngineTest(QObject* parent = 0)
+		: QObject(parent), m_engine(0), m_server(0), m_connected(), m_errors(), m_wrong_thread(0)
+	{
+	}
+
+protected Q_SLOTS:
+	void handleConnected(int id, qintptr socket)
+	{
+		this->checkThread();
+		this->m_connected.insert(id, socket);
+	}
+
+	void handleError(int id, QAbstractSocket::SocketError e)
+	{
+		this->checkThread();
+		this->m_errors.insert(id, e);
+	}
+
+	void drain(void)
+	{
+		while (this->m_server->hasPendingConnections()) {
+			delete this->m_server->nextPendingConnection();
+		}
+	}
+
+private:
+	ConnectorEngine* m_engine;
+	QTcpServer* m_server;
+	QMap<int, qintptr> m_connected;
+	QMap<int, QAbstractSocket::SocketError> m_errors;
+	int m_wrong_thread;
+
+	void checkThread(void)
+	{
+		if (QThread::currentThread() != this->thread()) {
+			++this->m_wrong_thread;
+		}
+	}
+
+	bool waitFor(int count)
+	{
+		for (int i=0; i<1000 && this->m_connected.size() + this->m_errors.size() < count; ++i) {
+			QTest::qWait(10);
+		}
+
+		return this->m_connected.size() + this->m_errors.size() == count;
+	}
+
+private Q_SLOTS:
+	void init(void)
+	{
+		this->m_engine = new ConnectorEngine(this);
+		this->m_server = new QTcpServer(this);
+		this->m_connected.clear();
+		this->m_errors.clear();
+		this->m_wrong_thread = 0;
+
+		QVERIFY(QObject::connect(this->m_engine, SIGNAL(connected(int,qintptr)), this, SLOT(handleConnected(int,qintptr))));
+		QVERIFY(QObject::connect(this->m_engine, SIGNAL(error(int,QAbstractSocket::SocketError)), this, SLOT(handleError(int,QAbstractSocket::SocketError))));
+		QVERIFY(QObject::connect(this->m_server, SIGNAL(newConnection()), this, SLOT(drain())));
+		this->m_server->setMaxPendingConnections(1000);
+		QVERIFY(this->m_server->listen(QHostAddress::LocalHost));
+	}
+
+	void cleanup(void)
+	{
+		delete this->m_engine;
+		this->m_engine = 0;
+
+		QMap<int, qintptr>::ConstIterator it = this->m_connected.constBegin();
+		while (it != this->m_connected.constEnd()) {
+			::close(int(it.value()));
+			++it;
+		}
+
+		delete this->m_server;
+		this->m_server = 0;
+	}
+
+	void testStartStop(void)
+	{
+		BatchConnector::Endpoint e(QHostAddress::LocalHost, this->m_server->serverPort());
+
+		QVERIFY(!this->m_engine->isRunning());
+		QCOMPARE(this->m_engine->submit(e), -1);
+		QCOMPARE(this->m_engine->connectionTimeout(), uint(30000));
+		QCOMPARE(this->m_engine->shardCount(), qMax(QThread::idealThreadCount(), 1));
+
+		this->m_engine->setShardCount(2);
+		this->m_engine->setCpuAffinity(QList<int>() << 0);
+		QCOMPARE(this->m_engine->cpuAffinity(), QList<int>() << 0);
+		QVERIFY(this->m_engine->start());
+		QVERIFY(this->m_engine->isRunning());
+		QCOMPARE(this->m_engine->shardCount(), 2);
+
+		int id = this->m_engine->submit(e);
+		QVERIFY(id != -1);
+		QVERIFY(this->waitFor(1));
+		QVERIFY(this->m_connected.contains(id));
+
+		this->m_engine->stop();
+		QVERIFY(!this->m_engine->isRunning());
+		QCOMPARE(this->m_engine->submit(e), -1);
+	}
+
+	void testManyProducers(void)
+	{
+		const int producers = 4;
+		const int count     = 50;
+
+		BatchConnector::Endpoint e(QHostAddress::LocalHost, this->m_server->serverPort());
+		this->m_engine->setShardCount(3);
+		QVERIFY(this->m_engine->start());
+
+		QList<Submitter*> submitters;
+		for (int i=0; i<producers; ++i) {
+			submitters.append(new Submitter(this->m_engine, e, count));
+			submitters.last()->start();
+		}
+
+		for (int i=0; i<producers; ++i) {
+			QVERIFY(submitters.at(i)->wait(10000));
+			QCOMPARE(submitters.at(i)->failed(), 0);
+		}
+
+		qDeleteAll(submitters);
+
+		QVERIFY(this->waitFor(producers * count));
+		QCOMPARE(this->m_connected.size(), producers * count);
+		QCOMPARE(this->m_wrong_thread, 0);
+
+		// The IDs are unique and so are the descriptors
+		QList<qintptr> fds = this->m_connected.values();
+		std::sort(fds.begin(), fds.end());
+		for (int i=1; i<fds.size(); ++i) {
+			QVERIFY(fds.at(i) != fds.at(i - 1));
+		}
+	}
+
+	void testErrors(void)
+	{
+		QTcpServer closed;
+		QVERIFY(closed.listen(QHostAddress::LocalHost));
+		quint16 port = closed.serverPort();
+		closed.close();
+
+		this->m_engine->setShardCount(1);
+		QVERIFY(this->m_engine->start());
+
+		int refused = this->m_engine->submit(BatchConnector::Endpoint(QHostAddress::LocalHost, port));
+		int invalid = this->m_engine->submit(BatchConnector::Endpoint(QHostAddress(), port));
+
+		QVERIFY(this->waitFor(2));
+		QCOMPARE(this->m_errors.value(refused), QAbstractSocket::ConnectionRefusedError);
+		QCOMPARE(this->m_errors.value(invalid), QAbstractSocket::UnsupportedSocketOperationError);
+	}
+};
+
+int main(int argc, char** argv)
+{
+	QCoreApplication a(argc, argv);
+	ConnectorEngineTest t;
+	return QTest::qExec(&t, argc, argv);
+}
+
+#include "tst_connectorengine.moc"
@@ -0,0 +1,259 @@
+#include <QtCore/QCoreApplication>
+#include <QtCore/QEventLoop>
+#include <QtCore/QTimer>
+#include <QtTest/QTest>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <string.h>
+#include <unistd.h>
+#include "datagramchannel.h"
+#include "socketconnector.h"
+
+class DatagramChannelTest : public QObject {
+	Q_OBJECT
+public:
+	explicit DatagramChannelTest(QObject* parent = 0)
+		: QObject(parent), m_receiver(0), m_sender(0), m_port(0)
+	{
+	}
+
+private:
+	DatagramChannel* m_receiver;
+	DatagramChannel* m_sender;
+	quint16 m_port;
+
+	int receiveAll(DatagramRing& ring, int first, int count)
+	{
+		int total = 0;
+		for (int i=0; i<50 && total < count; ++i) {
+			int n = this->m_receiver->receive(ring, first + total, count - total);
+			if (n < 0) {
+				return n;
+			}
+
+			total += n;
+			if (total < count) {
+				QTest::qWait(10);
+			}
+		}
+
+		return total;
+	}
+
+private Q_SLOTS:
+	void init(void)
+	{
+		struct sockaddr_in sa;
+		socklen_t l = sizeof(sa);
+		memset(&sa, 0, sizeof(sa));
+		sa.sin_family      = AF_INET;
+		sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+		int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+		QVERIFY(fd != -1);
+		QVERIFY(!::bind(fd, reinterpret_cast<struct sockaddr*>(&sa), sizeof(sa)));
+		QVERIFY(!::getsockname(fd, reinterpret_cast<struct sockaddr*>(&sa), &l));
+		this->m_port = ntohs(sa.sin_port);
+
+		this->m_receiver = new DatagramChannel(this);
+		QVERIFY(this->m_receiver->setSocketDescriptor(fd));
+		QCOMPARE(this->m_receiver->socketDescriptor(), qintptr(fd));
+
+		SocketConnector conn;
+		QVERIFY(conn.createUdpSocket());
+		qintptr sock = conn.connectToHostBlocking(QHostAddress(QHostAddress::LocalHost), this->m_port);
+		QVERIFY(sock != -1);
+
+		this->m_sender = new DatagramChannel(this);
+		QVERIFY(this->m_sender->setSocketDescriptor(sock));
+	}
+
+	void cleanup(void)
+	{
+		delete this->m_receiver;
+		delete this->m_sender;
+		this->m_receiver = 0;
+		this->m_sender   = 0;
+	}
+
+	void testRing(void)
+	{
+		char storage[4 * 16];
+		DatagramRing ring(storage, 4, 16);
+		QCOMPARE(ring.count(), 4);
+		QCOMPARE(ring.slotSize(), 16);
+		QVERIFY(ring.data(0) == storage);
+		QVERIFY(ring.data(3) == storage + 48);
+
+		ring.setSize(1, 100);
+		QCOMPARE(ring.size(1), 16);
+		ring.setSegmentSize(1, 8);
+		QCOMPARE(ring.segmentSize(1), 8);
+
+		QVERIFY(ring.setDestination(2, QHostAddress(QHostAddress::LocalHost), 1234));
+		QVERIFY(!ring.setDestination(3, QHostAddress(), 1234));
+		QCOMPARE(ring.sender(2), QHostAddress(QHostAddress::LocalHost));
+		QCOMPARE(ring.senderPort(2), quint16(1234));
+		ring.clearDestination(2);
+		QVERIFY(ring.sender(2).isNull());
+		QCOMPARE(ring.senderPort(2), quint16(0));
+	}
+
+	void testSendReceive(void)
+	{
+		const int count = 32;
+		DatagramRing out(count, 64);
+		DatagramRing in(count, 64);
+
+		for (int i=0; i<count; ++i) {
+			int size = 1 + i;
+			memset(out.data(i), 'a' + (i % 26), size);
+			out.setSize(i, size);
+		}
+
+		QCOMPARE(this->m_sender->send(out, 0, count), count);
+		QCOMPARE(this->receiveAll(in, 0, count), count);
+
+		for (int i=0; i<count; ++i) {
+			QCOMPARE(in.size(i), 1 + i);
+			QCOMPARE(in.data(i)[0], char('a' + (i % 26)));
+			QCOMPARE(in.segmentSize(i), 0);
+			QCOMPARE(in.sender(i), QHostAddress(QHostAddress::LocalHost));
+		}
+
+		// Nothing left
+		QCOMPARE(this->m_receiver->receive(in, 0, count), 0);
+	}
+
+	void testReply(void)
+	{
+		DatagramRing ring(2, 32);
+		memcpy(ring.data(0), "ping", 4);
+		ring.setSize(0, 4);
+		QCOMPARE(this->m_sender->send(ring, 0, 1), 1);
+		QCOMPARE(this->receiveAll(ring, 1, 1), 1);
+		QVERIFY(ring.senderPort(1) != 0);
+
+		// The received slot is addressed to its sender
+		memcpy(ring.data(1), "pong", 4);
+		QCOMPARE(this->m_receiver->send(ring, 1, 1), 1);
+
+		DatagramRing reply(1, 32);
+		int n = 0;
+		for (int i=0; i<50 && !n; ++i) {
+			n = this->m_sender->receive(reply, 0, 1);
+			if (!n) {
+				QTest::qWait(10);
+			}
+		}
+
+		QCOMPARE(n, 1);
+		QCOMPARE(QByteArray(reply.data(0), reply.size(0)), QByteArray("pong"));
+		QCOMPARE(reply.senderPort(0), this->m_port);
+	}
+
+	void testSegmentation(void)
+	{
+		if (!DatagramChannel::isSegmentationOffloadSupported()) {
+#if QT_VERSION < 0x050000
+			QSKIP("UDP_SEGMENT is not supported", SkipSingle);
+#else
+			QSKIP("UDP_SEGMENT is not supported");
+#endif
+		}
+
+		DatagramRing out(1, 4000);
+		memset(out.data(0), 'x', 4000);
+		out.setSize(0, 4000);
+		out.setSegmentSize(0, 1000);
+		QCOMPARE(this->m_sender->send(out, 0, 1), 1);
+
+		DatagramRing in(4, 1500);
+		QCOMPARE(this->receiveAll(in, 0, 4), 4);
+		for (int i=0; i<4; ++i) {
+			QCOMPARE(in.size(i), 1000);
+		}
+	}
+
+	void testReceiveOffload(void)
+	{
+		if (!DatagramChannel::isSegmentationOffloadSupported() || !this->m_receiver->setReceiveOffloadEnabled(true)) {
+#if QT_VERSION < 0x050000
+			QSKIP("UDP_GRO is not supported", SkipSingle);
+#else
+			QSKIP("UDP_GRO is not supported");
+#endif
+		}
+
+		QVERIFY(this->m_receiver->receiveOffloadEnabled());
+
+		DatagramRing out(1, 4000);
+		memset(out.data(0), 'x', 4000);
+		out.setSize(0, 4000);
+		out.setSegmentSize(0, 1000);
+		QCOMPARE(this->m_sender->send(out, 0, 1), 1);
+
+		// The segments sent together come back as one slot
+		DatagramRing in(1, 65536);
+		QCOMPARE(this->receiveAll(in, 0, 1), 1);
+		QCOMPARE(in.size(0), 4000);
+		QCOMPARE(in.segmentSize(0), 1000);
+	}
+
+	void testReadyRead(void)
+	{
+		QEventLoop loop;
+		QVERIFY(QObject::connect(this->m_receiver, SIGNAL(readyRead()), &loop, SLOT(quit())));
+		QTimer::singleShot(5000, &loop, SLOT(quit()));
+
+		DatagramRing ring(1, 16);
+		ring.setSize(0, 1);
+		QCOMPARE(this->m_sender->send(ring, 0, 1), 1);
+		loop.exec();
+
+		QCOMPARE(this->m_receiver->receive(ring, 0, 1), 1);
+	}
+
+	void testTakeSocket(void)
+	{
+		DatagramChannel channel;
+
+		SocketConnector tcp;
+		QVERIFY(tcp.createTcpSocket());
+		QVERIFY(!channel.takeSocket(&tcp));
+
+		SocketConnector udp;
+		QVERIFY(udp.createUdpSocket());
+		QVERIFY(!channel.takeSocket(&udp));
+
+		QEventLoop loop;
+		QVERIFY(QObject::connect(&udp, SIGNAL(connected()), &loop, SLOT(quit())));
+		QVERIFY(QObject::connect(&udp, SIGNAL(error(QAbstractSocket::SocketError)), &loop, SLOT(quit())));
+		QTimer::singleShot(5000, &loop, SLOT(quit()));
+		udp.connectToHost(QHostAddress(QHostAddress::LocalHost), this->m_port);
+		if (QAbstractSocket::ConnectedState != udp.state()) {
+			loop.exec();
+		}
+
+		QCOMPARE(udp.state(), QAbstractSocket::ConnectedState);
+		QVERIFY(channel.takeSocket(&udp));
+		QCOMPARE(udp.state(), QAbstractSocket::UnconnectedState);
+		QVERIFY(channel.socketDescriptor() != -1);
+
+		channel.close();
+		QCOMPARE(channel.socketDescriptor(), qintptr(-1));
+
+		DatagramRing ring(1, 16);
+		QCOMPARE(channel.send(ring, 0, 1), -1);
+		QCOMPARE(this->m_sender->send(ring, 0, 2), -1);
+	}
+};
+
+int main(int argc, char** argv)
+{
+	QCoreApplication a(argc, argv);
+	DatagramChannelTest t;
+	return QTest::qExec(&t, argc, argv);
+}
+
+#include "tst_datagramchannel.moc"
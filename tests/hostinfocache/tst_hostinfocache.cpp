@@ -0,0 +1,135 @@
+#include <QtCore/QCoreApplication>
+#include <QtNetwork/QTcpServer>
+#include <QtTest/QTest>
+#include "hostinfocache.h"
+#include "socketconnector.h"
+
+class HostInfoCacheTest : public QObject {
+	Q_OBJECT
+public:
+	explicit HostInfoCacheTest(QObject* parent = 0)
+		: QObject(parent), m_cache(0), m_results()
+	{
+	}
+
+protected Q_SLOTS:
+	void lookedUp(const QHostInfo& info)
+	{
+		this->m_results.append(info);
+	}
+
+private:
+	HostInfoCache* m_cache;
+	QList<QHostInfo> m_results;
+
+	bool waitForResults(int n)
+	{
+		for (int i=0; i<50 && this->m_results.size() < n; ++i) {
+			QTest::qWait(100);
+		}
+
+		return this->m_results.size() >= n;
+	}
+
+private Q_SLOTS:
+	void init(void)
+	{
+		this->m_cache = new HostInfoCache(this);
+		this->m_results.clear();
+	}
+
+	void cleanup(void)
+	{
+		delete this->m_cache;
+		this->m_cache = 0;
+	}
+
+	void testDefaults(void)
+	{
+		QCOMPARE(this->m_cache->ttl(), uint(60000));
+		QCOMPARE(this->m_cache->negativeTtl(), uint(5000));
+		QCOMPARE(this->m_cache->refreshThreshold(), uint(80));
+		QCOMPARE(this->m_cache->hitRate(), qreal(0));
+	}
+
+	void testCoalescing(void)
+	{
+		const QString name = QLatin1String("localhost");
+		QHostInfo info;
+
+		QVERIFY(!this->m_cache->cachedHostInfo(name, &info));
+		QCOMPARE(this->m_cache->misses(), quint64(1));
+
+		int id1 = this->m_cache->lookupHost(name, this, SLOT(lookedUp(QHostInfo)));
+		int id2 = this->m_cache->lookupHost(name, this, SLOT(lookedUp(QHostInfo)));
+		QVERIFY(id1 != id2);
+
+		QVERIFY(this->waitForResults(2));
+		QCOMPARE(this->m_cache->lookupCount(), quint64(1));
+		QCOMPARE(this->m_results.at(0).lookupId(), id1);
+		QCOMPARE(this->m_results.at(1).lookupId(), id2);
+
+		QVERIFY(this->m_cache->cachedHostInfo(name, &info));
+		QCOMPARE(info.addresses(), this->m_results.at(0).addresses());
+		QCOMPARE(this->m_cache->hits(), quint64(1));
+		QCOMPARE(this->m_cache->hitRate(), qreal(0.5));
+
+		this->m_cache->clear();
+		QVERIFY(!this->m_cache->cachedHostInfo(name, &info));
+	}
+
+	void testAbort(void)
+	{
+		int id = this->m_cache->lookupHost(QLatin1String("localhost"), this, SLOT(lookedUp(QHostInfo)));
+		this->m_cache->abortHostLookup(id);
+
+		for (int i=0; i<20 && !this->m_cache->lookupCount(); ++i) {
+			QTest::qWait(100);
+		}
+
+		QCOMPARE(this->m_cache->lookupCount(), quint64(1));
+		QVERIFY(this->m_results.isEmpty());
+	}
+
+	void testInsert(void)
+	{
+		const QString name = QLatin1String("static.test");
+		QHostInfo info;
+		info.setHostName(name);
+		info.setAddresses(QList<QHostAddress>() << QHostAddress(QHostAddress::LocalHost));
+		this->m_cache->insert(name, info);
+
+		QHostInfo res;
+		QVERIFY(this->m_cache->cachedHostInfo(name, &res));
+		QCOMPARE(res.addresses(), info.addresses());
+		QCOMPARE(this->m_cache->lookupCount(), quint64(0));
+	}
+
+	void testConnectorHit(void)
+	{
+		QTcpServer server;
+		QVERIFY(server.listen(QHostAddress::LocalHost));
+
+		this->m_cache->lookupHost(QLatin1String("localhost"), this, SLOT(lookedUp(QHostInfo)));
+		QVERIFY(this->waitForResults(1));
+
+		SocketConnector conn;
+		conn.setHostInfoCache(this->m_cache);
+		QCOMPARE(conn.hostInfoCache(), this->m_cache);
+		QVERIFY(conn.createTcpSocket());
+
+		// A hit must not require an event loop iteration
+		conn.connectToHost(QLatin1String("localhost"), server.serverPort());
+		QVERIFY(conn.state() != QAbstractSocket::HostLookupState);
+		QCOMPARE(this->m_cache->hits(), quint64(1));
+	}
+};
+
+int main(int argc, char** argv)
+{
+	QCoreApplication a(argc, argv);
+	HostInfoCacheTest t;
+	return QTest::qExec(&t, argc, argv);
+}
+
+#include "tst_hostinfocache.moc"
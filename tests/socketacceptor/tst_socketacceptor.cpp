@@ -0,0 +1,156 @@
+#include <QtCore/QCoreApplication>
+#include <QtCore/QThread>
+#include <QtNetwork/QTcpServer>
+#include <QtNetwork/QTcpSocket>
+#include <QtTest/QSignalSpy>
+#include <QtTest/QTest>
+#include <fcntl.h>
+#include <unistd.h>
+#include "socketacceptor.h"
+
+class SocketAcceptorTest : public QObject {
+	Q_OBJECT
+public:
+	explicit SocketAcceptorTest(QObject* parent = 0)
+		: QObject(parent), m_sockets(), m_wrong_thread(0)
+	{
+	}
+
+protected Q_SLOTS:
+	void handleNewConnection(qintptr socket)
+	{
+		if (QThread::currentThread() != this->thread()) {
+			++this->m_wrong_thread;
+		}
+
+		this->m_sockets.append(socket);
+	}
+
+private:
+	QList<qintptr> m_sockets;
+	int m_wrong_thread;
+
+private Q_SLOTS:
+	void init(void)
+	{
+		this->m_sockets.clear();
+		this->m_wrong_thread = 0;
+	}
+
+	void cleanup(void)
+	{
+		for (int i=0; i<this->m_sockets.size(); ++i) {
+			::close(int(this->m_sockets.at(i)));
+		}
+
+		this->m_sockets.clear();
+	}
+
+	void testAccept(void)
+	{
+		SocketAcceptor acceptor;
+		acceptor.setListenerCount(4);
+		QObject::connect(&acceptor, SIGNAL(newConnection(qintptr)), this, SLOT(handleNewConnection(qintptr)));
+		QVERIFY(acceptor.listen(QHostAddress::LocalHost));
+		QVERIFY(acceptor.isListening());
+		QVERIFY(acceptor.serverPort() != 0);
+		QCOMPARE(acceptor.listenerCount(), 4);
+
+		const int n = 32;
+		QList<QTcpSocket*> clients;
+		for (int i=0; i<n; ++i) {
+			clients.append(new QTcpSocket(this));
+			clients.last()->connectToHost(QHostAddress::LocalHost, acceptor.serverPort());
+		}
+
+		QTRY_COMPARE(this->m_sockets.size(), n);
+		QCOMPARE(this->m_wrong_thread, 0);
+
+		for (int i=0; i<n; ++i) {
+			int flags = ::fcntl(int(this->m_sockets.at(i)), F_GETFL);
+			QVERIFY(flags & O_NONBLOCK);
+			QVERIFY(::fcntl(int(this->m_sockets.at(i)), F_GETFD) & FD_CLOEXEC);
+		}
+
+		qDeleteAll(clients);
+	}
+
+	void testAssignTo(void)
+	{
+		SocketAcceptor acceptor;
+		acceptor.setListenerCount(2);
+		acceptor.setCpuSteeringEnabled(true);
+		QObject::connect(&acceptor, SIGNAL(newConnection(qintptr)), this, SLOT(handleNewConnection(qintptr)));
+		QVERIFY(acceptor.listen(QHostAddress::LocalHost));
+
+		QTcpSocket client;
+		client.connectToHost(QHostAddress::LocalHost, acceptor.serverPort());
+		QVERIFY(client.waitForConnected(5000));
+		QTRY_COMPARE(this->m_sockets.size(), 1);
+
+		QTcpSocket peer;
+		QVERIFY(SocketAcceptor::assignTo(this->m_sockets.takeFirst(), &peer));
+		QCOMPARE(peer.state(), QAbstractSocket::ConnectedState);
+		QCOMPARE(peer.peerPort(), client.localPort());
+
+		client.write("ping");
+		QVERIFY(client.waitForBytesWritten(5000));
+		QTRY_COMPARE(peer.bytesAvailable(), qint64(4));
+		QCOMPARE(peer.readAll(), QByteArray("ping"));
+	}
+
+	void testAddressInUse(void)
+	{
+		// Without SO_REUSEPORT the port cannot be shared
+		QTcpServer server;
+		QVERIFY(server.listen(QHostAddress::LocalHost));
+
+		SocketAcceptor acceptor;
+		QVERIFY(!acceptor.listen(QHostAddress::LocalHost, server.serverPort()));
+		QVERIFY(!acceptor.isListening());
+		QCOMPARE(acceptor.serverError(), QAbstractSocket::AddressInUseError);
+	}
+
+	void testClose(void)
+	{
+		SocketAcceptor acceptor;
+		acceptor.setListenerCount(2);
+		QVERIFY(acceptor.listen(QHostAddress::LocalHost));
+		quint16 port = acceptor.serverPort();
+
+		acceptor.close();
+		QVERIFY(!acceptor.isListening());
+		QCOMPARE(acceptor.serverPort(), quint16(0));
+
+		QTcpSocket client;
+		client.connectToHost(QHostAddress::LocalHost, port);
+		QVERIFY(!client.waitForConnected(5000));
+		QCOMPARE(client.error(), QAbstractSocket::ConnectionRefusedError);
+
+		// The acceptor can listen again
+		QVERIFY(acceptor.listen(QHostAddress::LocalHost, port));
+		QCOMPARE(acceptor.serverPort(), port);
+	}
+
+	void testNoReceivers(void)
+	{
+		SocketAcceptor acceptor;
+		acceptor.setListenerCount(1);
+		QVERIFY(acceptor.listen(QHostAddress::LocalHost));
+
+		// Nobody takes the accepted socket: it is closed, and the client sees the EOF
+		QTcpSocket client;
+		client.connectToHost(QHostAddress::LocalHost, acceptor.serverPort());
+		QVERIFY(client.waitForConnected(5000));
+		QTRY_COMPARE(client.state(), QAbstractSocket::UnconnectedState);
+	}
+};
+
+int main(int argc, char** argv)
+{
+	QCoreApplication a(argc, argv);
+	SocketAcceptorTest t;
+	return QTest::qExec(&t, argc, argv);
+}
+
+#include "tst_socketacceptor.moc"
@@ -1,12 +1,32 @@
 #include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
 #include <QtCore/QEventLoop>
+#include <QtCore/QFile>
+#include <QtCore/QFutureWatcher>
 #include <QtCore/QTimer>
+#include <QtNetwork/QLocalServer>
+#include <QtNetwork/QLocalSocket>
+#include <QtNetwork/QHostInfo>
 #include <QtNetwork/QTcpServer>
 #include <QtNetwork/QTcpSocket>
 #include <QtNetwork/QNetworkAddressEntry>
 #include <QtNetwork/QNetworkInterface>
+#include <QtTest/QSignalSpy>
 #include <QtTest/QTest>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include "hostinfocache.h"
+#include "portallocator.h"
 #include "socketconnector.h"
+#include "socketreservoir.h"
+#include "sourceaddressset.h"
 
 class SocketConnectorTest : public QObject {
 	Q_OBJECT
@@ -36,6 +56,59 @@ private:
 	QHostAddress m_peer;
 	int m_peer_port;
 
+	static bool waitForFuture(const QFuture<qintptr>& f)
+	{
+		QFutureWatcher<qintptr> w;
+		QEventLoop loop;
+		QObject::connect(&w, SIGNAL(finished()), &loop, SLOT(quit()));
+		QTimer::singleShot(5000, &loop, SLOT(quit()));
+		w.setFuture(f);
+		if (!f.isFinished()) {
+			loop.exec();
+		}
+
+		return f.isFinished();
+	}
+
+	/*
+	 * Listens on @a address and fills the accept queue: the kernel drops the SYNs sent to it afterwards,
+	 * and the connections to it neither succeed nor fail. Returns the listener and the connection filling the queue
+	 */
+	static QPair<int, int> blackhole(const QHostAddress& address, quint16 port)
+	{
+		struct sockaddr_in sa;
+		memset(&sa, 0, sizeof(sa));
+		sa.sin_family      = AF_INET;
+		sa.sin_port        = htons(port);
+		sa.sin_addr.s_addr = htonl(address.toIPv4Address());
+
+		int one = 1;
+		int l = ::socket(AF_INET, SOCK_STREAM, 0);
+		::setsockopt(l, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+		if (::bind(l, reinterpret_cast<struct sockaddr*>(&sa), sizeof(sa)) || ::listen(l, 0)) {
+			::close(l);
+			return qMakePair(-1, -1);
+		}
+
+		int c = ::socket(AF_INET, SOCK_STREAM, 0);
+		if (::connect(c, reinterpret_cast<struct sockaddr*>(&sa), sizeof(sa))) {
+			::close(c);
+			::close(l);
+			return qMakePair(-1, -1);
+		}
+
+		return qMakePair(l, c);
+	}
+
+	quint16 closedPort(void)
+	{
+		QTcpServer closed;
+		closed.listen(QHostAddress::LocalHost);
+		quint16 port = closed.serverPort();
+		closed.close();
+		return port;
+	}
+
 private Q_SLOTS:
 	void initTestCase(void)
 	{
@@ -151,6 +224,40 @@ private Q_SLOTS:
 		QVERIFY(this->m_conn->socketDescriptor() != -1);
 	}
 
+	void testSocketOptionProfile(void)
+	{
+		SocketOptionProfile profile;
+		QVERIFY(profile.isEmpty());
+		QCOMPARE(profile.option(SocketOptionProfile::NoDelay), -1);
+
+		profile.setOption(SocketOptionProfile::SendBufferSize, 65536);
+		profile.setOption(SocketOptionProfile::NoDelay, 1);
+		profile.setOption(SocketOptionProfile::KeepAlive, 1);
+		QVERIFY(!profile.isEmpty());
+		QVERIFY(profile.hasOption(SocketOptionProfile::NoDelay));
+
+		QVERIFY(this->m_conn->setSocketOptionProfile(profile));
+		QVERIFY(this->m_conn->createTcpSocket());
+
+		int fd = int(this->m_conn->socketDescriptor());
+		int v  = 0;
+		socklen_t l = sizeof(v);
+		QVERIFY(!::getsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &v, &l));
+		QCOMPARE(v, 1);
+		QVERIFY(!::getsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &v, &l));
+		QCOMPARE(v, 1);
+		QVERIFY(!::getsockopt(fd, SOL_SOCKET, SO_SNDBUF, &v, &l));
+		QVERIFY(v >= 65536);
+
+		QVERIFY(::fcntl(fd, F_GETFL) & O_NONBLOCK);
+		QVERIFY(::fcntl(fd, F_GETFD) & FD_CLOEXEC);
+
+		profile.setCongestionControl("no-such-algorithm");
+		this->m_conn->setSocketOptionProfile(profile);
+		QVERIFY(!this->m_conn->createTcpSocket());
+		QCOMPARE(this->m_conn->socketDescriptor(), qintptr(-1));
+	}
+
 	void testWaitForConnected(void)
 	{
 		QCOMPARE(this->m_conn->socketDescriptor(), qintptr(-1));
@@ -300,6 +407,749 @@ private Q_SLOTS:
 		QCOMPARE(this->m_peer, this->m_addr);
 		QCOMPARE(this->m_peer_port, int(port));
 	}
+
+	void testPortAllocator(void)
+	{
+		PortAllocator allocator(40000, 40009);
+		QCOMPARE(allocator.firstPort(), quint16(40000));
+		QCOMPARE(allocator.lastPort(), quint16(40009));
+
+		QHostAddress local(QHostAddress::LocalHost);
+		for (int i=0; i<10; ++i) {
+			quint16 port = allocator.allocate(local, QHostAddress(QLatin1String("192.0.2.1")), 80);
+			QVERIFY(port >= 40000 && port <= 40009);
+		}
+
+		QCOMPARE(allocator.reuses(), quint64(0));
+		allocator.allocate(local, QHostAddress(QLatin1String("192.0.2.2")), 80);
+		QCOMPARE(allocator.reuses(), quint64(1));
+		QCOMPARE(allocator.allocations(), quint64(11));
+
+		this->m_conn->setPortAllocator(&allocator);
+		QCOMPARE(this->m_conn->portAllocator(), &allocator);
+		QVERIFY(this->m_conn->createTcpSocket());
+		QVERIFY(this->m_conn->bindTo(QHostAddress::LocalHost));
+
+		QEventLoop loop;
+		QVERIFY(QObject::connect(this->m_server, SIGNAL(newConnection()), &loop, SLOT(quit())));
+		QTimer::singleShot(5000, &loop, SLOT(quit()));
+
+		this->m_conn->connectToHost(this->m_server->serverAddress(), this->m_server->serverPort());
+		loop.exec();
+
+		QCOMPARE(this->m_conn->state(), QAbstractSocket::ConnectedState);
+		QVERIFY(this->m_peer_port >= 40000 && this->m_peer_port <= 40009);
+		QCOMPARE(allocator.allocations(), quint64(12) + allocator.conflicts());
+		QCOMPARE(allocator.exhaustions(), quint64(0));
+	}
+
+	void testBindAddressNoPort(void)
+	{
+		QVERIFY(!this->m_conn->bindAddressNoPort());
+		this->m_conn->setBindAddressNoPort(true);
+		QVERIFY(this->m_conn->bindAddressNoPort());
+
+		QVERIFY(this->m_conn->createTcpSocket());
+		QVERIFY(this->m_conn->bindTo(QHostAddress::LocalHost));
+
+		QEventLoop loop;
+		QVERIFY(QObject::connect(this->m_server, SIGNAL(newConnection()), &loop, SLOT(quit())));
+		QTimer::singleShot(5000, &loop, SLOT(quit()));
+
+		this->m_conn->connectToHost(this->m_server->serverAddress(), this->m_server->serverPort());
+		loop.exec();
+
+		QCOMPARE(this->m_conn->state(), QAbstractSocket::ConnectedState);
+		QCOMPARE(this->m_peer, QHostAddress(QHostAddress::LocalHost));
+		QVERIFY(this->m_peer_port > 0);
+	}
+
+	void testConnectBlocking(void)
+	{
+		QSignalSpy found(this->m_conn, SIGNAL(hostFound()));
+		QSignalSpy connected(this->m_conn, SIGNAL(connected()));
+
+		QCOMPARE(this->m_conn->connectToHostBlocking(this->m_server->serverAddress(), this->m_server->serverPort()), qintptr(-1));
+
+		QVERIFY(this->m_conn->createTcpSocket());
+		qintptr fd = this->m_conn->connectToHostBlocking(this->m_server->serverAddress(), this->m_server->serverPort(), 5000);
+		QVERIFY(fd != -1);
+		QCOMPARE(this->m_conn->state(), QAbstractSocket::UnconnectedState);
+		QCOMPARE(this->m_conn->socketDescriptor(), qintptr(-1));
+		QCOMPARE(found.count(), 0);
+		QCOMPARE(connected.count(), 0);
+
+		QVERIFY(this->m_server->hasPendingConnections() || this->m_server->waitForNewConnection(5000));
+		delete this->m_server->nextPendingConnection();
+		::close(int(fd));
+
+		QTcpServer closed;
+		QVERIFY(closed.listen(QHostAddress::LocalHost));
+		quint16 port = closed.serverPort();
+		closed.close();
+
+		QVERIFY(this->m_conn->createTcpSocket());
+		QCOMPARE(this->m_conn->connectToHostBlocking(QHostAddress(QHostAddress::LocalHost), port, 5000), qintptr(-1));
+		QCOMPARE(this->m_conn->error(), QAbstractSocket::ConnectionRefusedError);
+	}
+
+	void testConnectBlockingTimeout(void)
+	{
+		QHostAddress dead(QLatin1String("127.0.0.2"));
+		QPair<int, int> bh = blackhole(dead, this->m_server->serverPort());
+		if (-1 == bh.first) {
+#if QT_VERSION < 0x050000
+			QSKIP("Failed to set up a blackholed address", SkipSingle);
+#else
+			QSKIP("Failed to set up a blackholed address");
+#endif
+		}
+
+		QVERIFY(this->m_conn->createTcpSocket());
+		QCOMPARE(this->m_conn->connectToHostBlocking(dead, this->m_server->serverPort(), 200), qintptr(-1));
+		QCOMPARE(this->m_conn->error(), QAbstractSocket::SocketTimeoutError);
+
+		// The timed out socket is replaced: the next call does not need createTcpSocket()
+		qintptr fd = this->m_conn->connectToHostBlocking(this->m_server->serverAddress(), this->m_server->serverPort(), 5000);
+		QVERIFY(fd != -1);
+		QVERIFY(this->m_server->hasPendingConnections() || this->m_server->waitForNewConnection(5000));
+		delete this->m_server->nextPendingConnection();
+		::close(int(fd));
+
+		::close(bh.second);
+		::close(bh.first);
+	}
+
+	void testConnectionTimings(void)
+	{
+		qRegisterMetaType<SocketConnector::ConnectionTimings>("SocketConnector::ConnectionTimings");
+		QSignalSpy spy(this->m_conn, SIGNAL(connectionTimed(SocketConnector::ConnectionTimings)));
+
+		QVERIFY(!this->m_conn->timingsEnabled());
+		this->m_conn->setTimingsEnabled(true);
+		QVERIFY(this->m_conn->timingsEnabled());
+
+		QVERIFY(this->m_conn->createTcpSocket());
+		this->m_conn->connectToHost(this->m_server->serverAddress(), this->m_server->serverPort());
+		QVERIFY(this->m_conn->waitForConnected(5000));
+		QCOMPARE(spy.count(), 1);
+
+		SocketConnector::ConnectionTimings t = this->m_conn->connectionTimings();
+		QVERIFY(t.connected);
+		QVERIFY(t.lookupStarted != -1);
+		QVERIFY(t.lookupStarted <= t.lookupFinished);
+		QCOMPARE(t.attempts.size(), 1);
+		QCOMPARE(t.attempts.at(0).address, this->m_server->serverAddress());
+		QCOMPARE(t.attempts.at(0).error, 0);
+		QVERIFY(t.lookupFinished <= t.attempts.at(0).started);
+		QVERIFY(t.attempts.at(0).started <= t.attempts.at(0).finished);
+		QVERIFY(t.attempts.at(0).finished <= t.finished);
+
+		QTcpServer closed;
+		QVERIFY(closed.listen(QHostAddress::LocalHost));
+		quint16 port = closed.serverPort();
+		closed.close();
+
+		QVERIFY(this->m_conn->createTcpSocket());
+		this->m_conn->connectToHost(QHostAddress(QHostAddress::LocalHost), port);
+		QVERIFY(!this->m_conn->waitForConnected(5000));
+		QCOMPARE(spy.count(), 2);
+
+		t = this->m_conn->connectionTimings();
+		QVERIFY(!t.connected);
+		QCOMPARE(t.attempts.size(), 1);
+		QCOMPARE(t.attempts.at(0).error, int(ECONNREFUSED));
+	}
+
+	void testSourceAddressSet(void)
+	{
+		QHostAddress bogus(QLatin1String("192.0.2.1"));
+		QHostAddress local(QHostAddress::LocalHost);
+
+		SourceAddressSet set;
+		set.addAddress(bogus);
+		set.addAddress(local);
+		set.addAddress(QHostAddress(QHostAddress::LocalHostIPv6));
+		QCOMPARE(set.addresses().size(), 3);
+		QCOMPARE(set.candidates(local, 80), QList<QHostAddress>() << bogus << local);
+		QCOMPARE(set.candidates(local, 80), QList<QHostAddress>() << local << bogus);
+
+		set.setPolicy(SourceAddressSet::DestinationHash);
+		QList<QHostAddress> c = set.candidates(QHostAddress(QLatin1String("192.0.2.2")), 80);
+		QCOMPARE(set.candidates(QHostAddress(QLatin1String("192.0.2.2")), 80), c);
+
+		// The first candidate is not a local address: the connector must move on to the next one
+		set.setPolicy(SourceAddressSet::LeastConnections);
+		set.connectionOpened(local);
+		QCOMPARE(set.candidates(local, 80).first(), bogus);
+		set.release(local);
+
+		this->m_conn->setSourceAddressSet(&set);
+		QCOMPARE(this->m_conn->sourceAddressSet(), &set);
+		QVERIFY(this->m_conn->createTcpSocket());
+
+		QEventLoop loop;
+		QVERIFY(QObject::connect(this->m_server, SIGNAL(newConnection()), &loop, SLOT(quit())));
+		QTimer::singleShot(5000, &loop, SLOT(quit()));
+
+		set.connectionOpened(local);
+		this->m_conn->connectToHost(this->m_server->serverAddress(), this->m_server->serverPort());
+		loop.exec();
+
+		QCOMPARE(this->m_conn->state(), QAbstractSocket::ConnectedState);
+		QCOMPARE(this->m_peer, local);
+		QCOMPARE(set.failureCount(bogus), quint64(1));
+		QCOMPARE(set.connectionCount(local), 2);
+
+		this->m_conn->disconnectFromHost();
+		QCOMPARE(set.connectionCount(local), 1);
+
+		// A handed off connection is released by its new owner, whatever the hand-off path
+		set.release(local);
+		QVERIFY(this->m_conn->createTcpSocket());
+		QFuture<qintptr> f = this->m_conn->connectAsync(this->m_server->serverAddress(), this->m_server->serverPort());
+		QVERIFY(waitForFuture(f));
+		qintptr fd = f.result();
+		QVERIFY(fd != -1);
+		QCOMPARE(set.connectionCount(local), 1);
+
+		set.releaseSocket(fd);
+		::close(int(fd));
+		QCOMPARE(set.connectionCount(local), 0);
+
+		QVERIFY(this->m_conn->createTcpSocket());
+		this->m_conn->connectToHost(this->m_server->serverAddress(), this->m_server->serverPort());
+		QTRY_COMPARE(this->m_conn->state(), QAbstractSocket::ConnectedState);
+		fd = this->m_conn->releaseSocketDescriptor();
+		QCOMPARE(set.connectionCount(local), 1);
+
+		// The connector no longer owns the source address
+		this->m_conn->disconnectFromHost();
+		QCOMPARE(set.connectionCount(local), 1);
+		set.releaseSocket(fd);
+		::close(int(fd));
+		QCOMPARE(set.connectionCount(local), 0);
+	}
+
+	void testHappyEyeballs(void)
+	{
+		QVERIFY(!this->m_conn->happyEyeballsEnabled());
+		QCOMPARE(this->m_conn->attemptDelay(), uint(250));
+
+		this->m_conn->setHappyEyeballsEnabled(true);
+		this->m_conn->setAttemptDelay(50);
+		QVERIFY(this->m_conn->happyEyeballsEnabled());
+		QCOMPARE(this->m_conn->attemptDelay(), uint(50));
+
+		QVERIFY(this->m_conn->createTcpSocket());
+
+		QEventLoop loop;
+		QVERIFY(QObject::connect(this->m_server, SIGNAL(newConnection()), &loop, SLOT(quit())));
+		QTimer::singleShot(5000, &loop, SLOT(quit()));
+
+		// "localhost" usually resolves to both ::1 and 127.0.0.1 while the server listens on IPv4 only
+		this->m_conn->connectToHost(QLatin1String("localhost"), this->m_server->serverPort());
+		loop.exec();
+
+		QCOMPARE(this->m_conn->state(), QAbstractSocket::ConnectedState);
+		QVERIFY(this->m_conn->socketDescriptor() != -1);
+		QCOMPARE(this->m_peer, QHostAddress(QHostAddress::LocalHost));
+
+		QTcpSocket* s = new QTcpSocket(this);
+		QVERIFY(this->m_conn->assignTo(s));
+		QCOMPARE(s->state(), QAbstractSocket::ConnectedState);
+		QCOMPARE(s->peerPort(), this->m_server->serverPort());
+		QCOMPARE(this->m_conn->socketDescriptor(), qintptr(-1));
+	}
+
+	void testHappyEyeballsFallback(void)
+	{
+		QTcpServer server;
+		QVERIFY(server.listen(QHostAddress::LocalHost));
+
+		QHostAddress dead(QLatin1String("127.0.0.2"));
+		QHostAddress dead2(QLatin1String("127.0.0.3"));
+		QPair<int, int> bh1 = blackhole(dead, server.serverPort());
+		QPair<int, int> bh2 = blackhole(dead2, server.serverPort());
+		if (-1 == bh1.first || -1 == bh2.first) {
+#if QT_VERSION < 0x050000
+			QSKIP("Failed to set up a blackholed address", SkipSingle);
+#else
+			QSKIP("Failed to set up a blackholed address");
+#endif
+		}
+
+		QHostInfo info;
+		info.setAddresses(QList<QHostAddress>() << dead << QHostAddress(QHostAddress::LocalHost));
+		QHostInfo lost;
+		lost.setAddresses(QList<QHostAddress>() << dead << dead2);
+
+		HostInfoCache cache;
+		cache.insert(QLatin1String("fallback.test"), info);
+		cache.insert(QLatin1String("lost.test"), lost);
+
+		SocketConnector conn;
+		conn.setHostInfoCache(&cache);
+		conn.setHappyEyeballsEnabled(true);
+		conn.setAttemptDelay(100);
+		conn.setConnectionTimeout(3000);
+		QVERIFY(conn.createTcpSocket());
+
+		// The first address never answers: the staggered attempt wins after about attemptDelay()
+		QElapsedTimer t;
+		t.start();
+		conn.connectToHost(QLatin1String("fallback.test"), server.serverPort());
+		QTRY_COMPARE(conn.state(), QAbstractSocket::ConnectedState);
+		QVERIFY(t.elapsed() >= 90);
+		QVERIFY(t.elapsed() < 1000);
+		::close(int(conn.releaseSocketDescriptor()));
+
+		// The deadline of the race is not pushed back by the staggered attempt
+		conn.setAttemptDelay(200);
+		conn.setConnectionTimeout(300);
+		QVERIFY(conn.createTcpSocket());
+		QSignalSpy errors(&conn, SIGNAL(error(QAbstractSocket::SocketError)));
+		t.start();
+		conn.connectToHost(QLatin1String("lost.test"), server.serverPort());
+		QTRY_COMPARE(errors.count(), 1);
+		QVERIFY(t.elapsed() < 450);
+		QCOMPARE(conn.state(), QAbstractSocket::UnconnectedState);
+
+		::close(bh1.second);
+		::close(bh1.first);
+		::close(bh2.second);
+		::close(bh2.first);
+	}
+
+	void testFastOpen(void)
+	{
+		const QByteArray payload("GET / HTTP/1.0\r\n\r\n");
+
+		int qlen = 16;
+		::setsockopt(int(this->m_server->socketDescriptor()), IPPROTO_TCP, TCP_FASTOPEN, &qlen, sizeof(qlen));
+
+		// Bit 0 enables the client side of TFO, bit 1 the server side
+		int sysctl = 0;
+		QFile f(QLatin1String("/proc/sys/net/ipv4/tcp_fastopen"));
+		if (f.open(QIODevice::ReadOnly)) {
+			sysctl = f.readAll().trimmed().toInt();
+		}
+
+		this->m_server->disconnect(this);
+		this->m_conn->setFastOpenData(payload);
+		QCOMPARE(this->m_conn->fastOpenData(), payload);
+
+		// The first connection obtains the cookie, the second one may use it
+		for (int i=0; i<2; ++i) {
+			QVERIFY(this->m_conn->createTcpSocket());
+			this->m_conn->connectToHost(this->m_server->serverAddress(), this->m_server->serverPort());
+			QVERIFY(this->m_conn->waitForConnected(5000));
+			QCOMPARE(this->m_conn->fastOpenBytesSent(), qint64(payload.size()));
+
+			if (i && 3 == (sysctl & 3)) {
+				QVERIFY(this->m_conn->fastOpenAccepted());
+			}
+
+			QVERIFY(this->m_server->hasPendingConnections() || this->m_server->waitForNewConnection(5000));
+			QTcpSocket* peer = this->m_server->nextPendingConnection();
+			QVERIFY(peer != 0);
+
+			QByteArray received;
+			while (received.size() < payload.size() && peer->waitForReadyRead(5000)) {
+				received += peer->readAll();
+			}
+
+			QCOMPARE(received, payload);
+			delete peer;
+			this->m_conn->disconnectFromHost();
+		}
+	}
+
+	void testFastOpenRace(void)
+	{
+		const QByteArray payload("GET / HTTP/1.0\r\n\r\n");
+
+		QTcpServer server;
+		QVERIFY(server.listen(QHostAddress::LocalHost));
+
+		QHostInfo info;
+		info.setAddresses(QList<QHostAddress>() << QHostAddress(QLatin1String("127.0.0.2")) << QHostAddress(QHostAddress::LocalHost));
+		HostInfoCache cache;
+		cache.insert(QLatin1String("race.test"), info);
+
+		SocketConnector conn;
+		conn.setHostInfoCache(&cache);
+		conn.setHappyEyeballsEnabled(true);
+		conn.setAttemptDelay(50);
+		conn.setFastOpenData(payload);
+
+		// The payload is written by the winner of the race, before connected()
+		QVERIFY(conn.createTcpSocket());
+		conn.connectToHost(QLatin1String("race.test"), server.serverPort());
+		QTRY_COMPARE(conn.state(), QAbstractSocket::ConnectedState);
+		QCOMPARE(conn.fastOpenBytesSent(), qint64(payload.size()));
+		QVERIFY(!conn.fastOpenAccepted());
+
+		QVERIFY(server.hasPendingConnections() || server.waitForNewConnection(5000));
+		QTcpSocket* peer = server.nextPendingConnection();
+		QVERIFY(peer != 0);
+
+		QByteArray received;
+		while (received.size() < payload.size() && peer->waitForReadyRead(5000)) {
+			received += peer->readAll();
+		}
+
+		QCOMPARE(received, payload);
+		delete peer;
+		conn.disconnectFromHost();
+	}
+
+	void testUnixSocket(void)
+	{
+		QString name = QString::fromLatin1("tst_socketconnector_%1").arg(QCoreApplication::applicationPid());
+		QLocalServer::removeServer(name);
+
+		QLocalServer server;
+		QVERIFY(server.listen(name));
+
+		QVERIFY(this->m_conn->createLocalSocket());
+		QVERIFY(this->m_conn->isLocalSocket());
+		QCOMPARE(this->m_conn->socketType(), QAbstractSocket::UnknownSocketType);
+
+		QSignalSpy found(this->m_conn, SIGNAL(hostFound()));
+		this->m_conn->connectToHost(server.fullServerName(), 0);
+		QVERIFY(this->m_conn->waitForConnected(5000));
+		QCOMPARE(found.count(), 0);
+
+		QLocalSocket* s = new QLocalSocket(this);
+		QVERIFY(this->m_conn->assignTo(s));
+		QCOMPARE(s->state(), QLocalSocket::ConnectedState);
+		QCOMPARE(this->m_conn->socketDescriptor(), qintptr(-1));
+
+		QVERIFY(server.hasPendingConnections() || server.waitForNewConnection(5000));
+		QLocalSocket* peer = server.nextPendingConnection();
+		QVERIFY(peer != 0);
+
+		s->write("ping");
+		QVERIFY(s->waitForBytesWritten(5000));
+		QVERIFY(peer->bytesAvailable() || peer->waitForReadyRead(5000));
+		QCOMPARE(peer->readAll(), QByteArray("ping"));
+		delete s;
+
+		QVERIFY(this->m_conn->createLocalSocket());
+		this->m_conn->connectToHost(server.fullServerName() + QLatin1String(".missing"), 0);
+		QCOMPARE(this->m_conn->state(), QAbstractSocket::UnconnectedState);
+		QCOMPARE(this->m_conn->error(), QAbstractSocket::HostNotFoundError);
+		QVERIFY(!this->m_conn->waitForConnected(1000));
+	}
+
+	void testUnixSeqPacket(void)
+	{
+#ifndef Q_OS_LINUX
+#if QT_VERSION < 0x050000
+		QSKIP("The abstract namespace is Linux only", SkipSingle);
+#else
+		QSKIP("The abstract namespace is Linux only");
+#endif
+#else
+		QByteArray name = "tst_socketconnector_" + QByteArray::number(QCoreApplication::applicationPid());
+
+		struct sockaddr_un sa;
+		memset(&sa, 0, sizeof(sa));
+		sa.sun_family = AF_UNIX;
+		memcpy(sa.sun_path + 1, name.constData(), name.size());
+
+		int lfd = ::socket(AF_UNIX, SOCK_SEQPACKET, 0);
+		QVERIFY(lfd != -1);
+		QVERIFY(!::bind(lfd, reinterpret_cast<struct sockaddr*>(&sa), socklen_t(offsetof(struct sockaddr_un, sun_path) + 1 + name.size())));
+		QVERIFY(!::listen(lfd, 4));
+
+		QString path = QLatin1Char('@') + QString::fromLatin1(name);
+
+		QVERIFY(this->m_conn->createSocket(AF_UNIX, SOCK_SEQPACKET));
+		qintptr fd = this->m_conn->connectToHostBlocking(path, 0, 5000);
+		QVERIFY(fd != -1);
+
+		int peer = ::accept(lfd, 0, 0);
+		QVERIFY(peer != -1);
+
+		// The message boundaries are kept
+		char buf[16];
+		QCOMPARE(::send(int(fd), "ab", 2, 0), ssize_t(2));
+		QCOMPARE(::send(int(fd), "cd", 2, 0), ssize_t(2));
+		QCOMPARE(::recv(peer, buf, sizeof(buf), 0), ssize_t(2));
+		QCOMPARE(::recv(peer, buf, sizeof(buf), 0), ssize_t(2));
+		::close(peer);
+		::close(int(fd));
+
+		QVERIFY(this->m_conn->createSocket(AF_UNIX, SOCK_SEQPACKET));
+		this->m_conn->connectToHost(path, 0);
+		QVERIFY(this->m_conn->waitForConnected(5000));
+
+		QLocalSocket s;
+		QVERIFY(!this->m_conn->assignTo(&s));
+		fd = this->m_conn->releaseSocketDescriptor();
+		QVERIFY(fd != -1);
+		::close(int(fd));
+
+		peer = ::accept(lfd, 0, 0);
+		QVERIFY(peer != -1);
+		::close(peer);
+		::close(lfd);
+#endif
+	}
+
+	void testConnectAsync(void)
+	{
+		// A TCP socket is created
+		QFuture<qintptr> f = this->m_conn->connectAsync(this->m_server->serverAddress(), this->m_server->serverPort());
+		QVERIFY(waitForFuture(f));
+		qintptr fd = f.result();
+		QVERIFY(fd != -1);
+		QCOMPARE(this->m_conn->state(), QAbstractSocket::UnconnectedState);
+		QCOMPARE(this->m_conn->socketDescriptor(), qintptr(-1));
+
+		QTcpSocket s;
+		QVERIFY(s.setSocketDescriptor(fd));
+		QCOMPARE(s.peerPort(), this->m_server->serverPort());
+
+		f = this->m_conn->connectAsync(QHostAddress(QHostAddress::LocalHost), this->closedPort());
+		QVERIFY(waitForFuture(f));
+		QCOMPARE(f.result(), qintptr(-1));
+		QCOMPARE(this->m_conn->error(), QAbstractSocket::ConnectionRefusedError);
+
+		// Busy connector: fails at once
+		QVERIFY(this->m_conn->createTcpSocket());
+		f = this->m_conn->connectAsync(QLatin1String("localhost"), this->m_server->serverPort());
+		QFuture<qintptr> busy = this->m_conn->connectAsync(QLatin1String("localhost"), this->m_server->serverPort());
+		QVERIFY(busy.isFinished());
+		QCOMPARE(busy.result(), qintptr(-1));
+
+		// Cancelling aborts the connection
+		QCOMPARE(this->m_conn->state(), QAbstractSocket::HostLookupState);
+		f.cancel();
+		QVERIFY(waitForFuture(f));
+		QVERIFY(f.isCanceled());
+		QCOMPARE(this->m_conn->state(), QAbstractSocket::UnconnectedState);
+	}
+
+	void testWhenAny(void)
+	{
+		SocketConnector refused;
+		SocketConnector ok;
+
+		QList<QFuture<qintptr> > futures;
+		futures
+			<< refused.connectAsync(QHostAddress(QHostAddress::LocalHost), this->closedPort())
+			<< ok.connectAsync(this->m_server->serverAddress(), this->m_server->serverPort())
+		;
+
+		QFuture<qintptr> any = SocketConnector::whenAny(futures);
+		QVERIFY(waitForFuture(any));
+		QVERIFY(any.result() != -1);
+		::close(int(any.result()));
+
+		futures.clear();
+		futures << refused.connectAsync(QHostAddress(QHostAddress::LocalHost), this->closedPort());
+		any = SocketConnector::whenAny(futures);
+		QVERIFY(waitForFuture(any));
+		QCOMPARE(any.result(), qintptr(-1));
+
+		any = SocketConnector::whenAny(QList<QFuture<qintptr> >());
+		QVERIFY(any.isFinished());
+		QCOMPARE(any.result(), qintptr(-1));
+	}
+
+	void testWhenAll(void)
+	{
+		SocketConnector ok;
+		SocketConnector refused;
+
+		QList<QFuture<qintptr> > futures;
+		futures
+			<< ok.connectAsync(this->m_server->serverAddress(), this->m_server->serverPort())
+			<< refused.connectAsync(QHostAddress(QHostAddress::LocalHost), this->closedPort())
+		;
+
+		QFuture<qintptr> all = SocketConnector::whenAll(futures);
+		QVERIFY(waitForFuture(all));
+
+		QList<qintptr> results = all.results();
+		QCOMPARE(results.size(), 2);
+		QVERIFY(results.at(0) != -1);
+		QCOMPARE(results.at(1), qintptr(-1));
+		::close(int(results.at(0)));
+	}
+
+	void testReconnectBackoff(void)
+	{
+		SocketConnector conn;
+		QVERIFY(conn.createTcpSocket());
+		conn.setAutoReconnectEnabled(true);
+		conn.setReconnectDelay(10);
+		conn.setMaxReconnectDelay(40);
+		conn.setMaxReconnectAttempts(3);
+
+		QSignalSpy scheduled(&conn, SIGNAL(reconnectScheduled(int,int)));
+		QSignalSpy abandoned(&conn, SIGNAL(reconnectAbandoned(int)));
+		QSignalSpy errors(&conn, SIGNAL(error(QAbstractSocket::SocketError)));
+
+		conn.connectToHost(QHostAddress(QHostAddress::LocalHost), this->closedPort());
+		QTRY_COMPARE(abandoned.count(), 1);
+		QCOMPARE(abandoned.at(0).at(0).toInt(), 3);
+		QCOMPARE(errors.count(), 4);
+		QCOMPARE(scheduled.count(), 3);
+
+		int prev = 10;
+		for (int i=0; i<scheduled.count(); ++i) {
+			int attempt = scheduled.at(i).at(0).toInt();
+			int delay   = scheduled.at(i).at(1).toInt();
+			QCOMPARE(attempt, i + 1);
+			QVERIFY(delay >= 10 && delay <= 40);
+			QVERIFY(delay <= prev * 3);
+			prev = delay;
+		}
+
+		// Nothing more is scheduled
+		QTest::qWait(100);
+		QCOMPARE(scheduled.count(), 3);
+		QCOMPARE(conn.state(), QAbstractSocket::UnconnectedState);
+	}
+
+	void testReconnect(void)
+	{
+		QTcpServer server;
+		quint16 port = this->closedPort();
+
+		SocketConnector conn;
+		QVERIFY(conn.createTcpSocket());
+		conn.setAutoReconnectEnabled(true);
+		conn.setReconnectDelay(300);
+		conn.setMaxReconnectDelay(300);
+
+		QSignalSpy scheduled(&conn, SIGNAL(reconnectScheduled(int,int)));
+		conn.connectToHost(QHostAddress(QHostAddress::LocalHost), port);
+		QTRY_COMPARE(scheduled.count(), 1);
+		QCOMPARE(conn.state(), QAbstractSocket::UnconnectedState);
+		QCOMPARE(conn.reconnectAttempt(), 1);
+
+		// The server comes back before the next attempt
+		QVERIFY(server.listen(QHostAddress::LocalHost, port));
+		QTRY_COMPARE(conn.state(), QAbstractSocket::ConnectedState);
+		QCOMPARE(conn.reconnectAttempt(), 0);
+
+		// The handed off connection is lost: the socket is created again
+		::close(int(conn.releaseSocketDescriptor()));
+		QVERIFY(conn.scheduleReconnect());
+		QCOMPARE(scheduled.count(), 2);
+		QCOMPARE(scheduled.at(1).at(0).toInt(), 1);
+		QTRY_COMPARE(conn.state(), QAbstractSocket::ConnectedState);
+		conn.disconnectFromHost();
+
+		// abort() cancels the pending attempt
+		server.close();
+		QSignalSpy errors(&conn, SIGNAL(error(QAbstractSocket::SocketError)));
+		QVERIFY(conn.createTcpSocket());
+		conn.connectToHost(QHostAddress(QHostAddress::LocalHost), port);
+		QTRY_COMPARE(errors.count(), 1);
+		conn.abort();
+		QTest::qWait(400);
+		QCOMPARE(errors.count(), 1);
+		QCOMPARE(scheduled.count(), 3);
+	}
+
+	void testPrefetchConnection(void)
+	{
+		QTcpServer server;
+		QVERIFY(server.listen(QHostAddress::LocalHost));
+
+		SocketConnector conn;
+		QVERIFY(conn.createTcpSocket());
+		QVERIFY(conn.prefetch(QLatin1String("127.0.0.1"), server.serverPort()));
+		QCOMPARE(conn.state(), QAbstractSocket::UnconnectedState);
+		QTRY_VERIFY(server.hasPendingConnections());
+		QTcpSocket* peer = server.nextPendingConnection();
+
+		// The prefetched connection is claimed: nothing new reaches the server
+		conn.connectToHost(QLatin1String("127.0.0.1"), server.serverPort());
+		QTRY_COMPARE(conn.state(), QAbstractSocket::ConnectedState);
+		QCOMPARE(conn.prefetchHits(), quint64(1));
+
+		QTcpSocket s;
+		QVERIFY(conn.assignTo(&s));
+		QCOMPARE(s.localPort(), peer->peerPort());
+		QTest::qWait(50);
+		QVERIFY(!server.hasPendingConnections());
+		delete peer;
+	}
+
+	void testPrefetchLookup(void)
+	{
+		QTcpServer server;
+		QVERIFY(server.listen(QHostAddress::LocalHost));
+
+		SocketConnector conn;
+		QVERIFY(conn.createTcpSocket());
+		QVERIFY(conn.prefetch(QLatin1String("localhost"), server.serverPort(), SocketConnector::PrefetchLookup));
+		conn.connectToHost(QLatin1String("localhost"), server.serverPort());
+		QTRY_COMPARE(conn.state(), QAbstractSocket::ConnectedState);
+		QCOMPARE(conn.prefetchCount(), quint64(1));
+		QCOMPARE(conn.prefetchHits(), quint64(1));
+		QCOMPARE(conn.prefetchExpired(), quint64(0));
+	}
+
+	void testPrefetchExpired(void)
+	{
+		QTcpServer server;
+		QVERIFY(server.listen(QHostAddress::LocalHost));
+
+		SocketConnector conn;
+		QVERIFY(conn.createTcpSocket());
+
+		// Another target supersedes the hint
+		QVERIFY(conn.prefetch(QLatin1String("127.0.0.1"), this->closedPort()));
+		QVERIFY(conn.prefetch(QLatin1String("127.0.0.1"), server.serverPort(), SocketConnector::PrefetchConnection, 50));
+		QCOMPARE(conn.prefetchExpired(), quint64(1));
+
+		// The unused connection is closed once the budget is spent
+		QTRY_VERIFY(server.hasPendingConnections());
+		QTcpSocket* peer = server.nextPendingConnection();
+		QTRY_COMPARE(conn.prefetchExpired(), quint64(2));
+		QTRY_COMPARE(peer->state(), QAbstractSocket::UnconnectedState);
+		delete peer;
+
+		conn.connectToHost(QLatin1String("127.0.0.1"), server.serverPort());
+		QTRY_COMPARE(conn.state(), QAbstractSocket::ConnectedState);
+		QCOMPARE(conn.prefetchCount(), quint64(2));
+		QCOMPARE(conn.prefetchHits(), quint64(0));
+	}
+
+	void testSocketReservoir(void)
+	{
+		QTcpServer server;
+		QVERIFY(server.listen(QHostAddress::LocalHost));
+
+		SocketReservoir reservoir(2);
+		reservoir.reserve(AF_INET, SOCK_STREAM);
+		QTRY_COMPARE(reservoir.available(AF_INET, SOCK_STREAM), 2);
+
+		SocketConnector conn;
+		conn.setSocketReservoir(&reservoir);
+		QVERIFY(conn.createTcpSocket());
+		QCOMPARE(reservoir.hits(), quint64(1));
+
+		conn.connectToHost(QHostAddress(QHostAddress::LocalHost), server.serverPort());
+		QTRY_COMPARE(conn.state(), QAbstractSocket::ConnectedState);
+		::close(int(conn.releaseSocketDescriptor()));
+
+		// A socket bound to a fixed port is never taken from the reservoir
+		QVERIFY(conn.createTcpSocket());
+		QCOMPARE(reservoir.hits(), quint64(2));
+		QVERIFY(conn.bindTo(QHostAddress::LocalHost, this->closedPort()));
+		conn.connectToHost(QHostAddress(QHostAddress::LocalHost), server.serverPort());
+		QTRY_COMPARE(conn.state(), QAbstractSocket::ConnectedState);
+		QCOMPARE(reservoir.hits() + reservoir.misses(), quint64(2));
+	}
 };
 
 int main(int argc, char** argv)
@@ -0,0 +1,140 @@
+#include <QtCore/QCoreApplication>
+#include <QtNetwork/QTcpServer>
+#include <QtNetwork/QTcpSocket>
+#include <QtTest/QTest>
+#include "socketconnectorpool.h"
+
+class SocketConnectorPoolTest : public QObject {
+	Q_OBJECT
+public:
+	explicit SocketConnectorPoolTest(QObject* parent = 0)
+		: QObject(parent), m_pool(0), m_server(0)
+	{
+	}
+
+private:
+	SocketConnectorPool* m_pool;
+	QTcpServer* m_server;
+
+	bool waitForIdle(int n)
+	{
+		QString host = this->m_server->serverAddress().toString();
+		for (int i=0; i<50 && this->m_pool->idleCount(host, this->m_server->serverPort()) < n; ++i) {
+			QTest::qWait(100);
+		}
+
+		return this->m_pool->idleCount(host, this->m_server->serverPort()) >= n;
+	}
+
+private Q_SLOTS:
+	void init(void)
+	{
+		this->m_pool   = new SocketConnectorPool(this);
+		this->m_server = new QTcpServer(this);
+		QVERIFY(this->m_server->listen(QHostAddress::LocalHost));
+	}
+
+	void cleanup(void)
+	{
+		delete this->m_pool;
+		delete this->m_server;
+		this->m_pool   = 0;
+		this->m_server = 0;
+	}
+
+	void testDefaults(void)
+	{
+		QCOMPARE(this->m_pool->minIdle(), 2);
+		QCOMPARE(this->m_pool->maxIdle(), 4);
+		QCOMPARE(this->m_pool->idleTimeout(), uint(60000));
+		QCOMPARE(this->m_pool->hits(), quint64(0));
+		QCOMPARE(this->m_pool->misses(), quint64(0));
+	}
+
+	void testAcquire(void)
+	{
+		QString host = this->m_server->serverAddress().toString();
+		quint16 port = this->m_server->serverPort();
+
+		QTcpSocket* s = new QTcpSocket(this);
+		QVERIFY(!this->m_pool->acquire(s, host, port));
+		QCOMPARE(this->m_pool->misses(), quint64(1));
+
+		QVERIFY(this->waitForIdle(this->m_pool->maxIdle()));
+		QCOMPARE(this->m_pool->idleCount(host, port), this->m_pool->maxIdle());
+
+		QVERIFY(this->m_pool->acquire(s, host, port));
+		QCOMPARE(s->state(), QAbstractSocket::ConnectedState);
+		QCOMPARE(s->peerPort(), port);
+		QCOMPARE(this->m_pool->hits(), quint64(1));
+		QCOMPARE(this->m_pool->idleCount(host, port), this->m_pool->maxIdle() - 1);
+
+		QCOMPARE(this->m_pool->idleCount(host, port + 1), 0);
+	}
+
+	void testHostName(void)
+	{
+		// Whatever family "localhost" resolves to first, the server accepts it
+		QTcpServer server;
+#if QT_VERSION >= 0x050000
+		QVERIFY(server.listen(QHostAddress::Any));
+#else
+		QVERIFY(server.listen(QHostAddress::LocalHost));
+#endif
+
+		QString host = QLatin1String("localhost");
+		quint16 port = server.serverPort();
+
+		this->m_pool->setMinIdle(1);
+		this->m_pool->setMaxIdle(1);
+		this->m_pool->warmUp(host, port);
+		for (int i=0; i<50 && !this->m_pool->idleCount(host, port); ++i) {
+			QTest::qWait(100);
+		}
+
+		QCOMPARE(this->m_pool->idleCount(host, port), 1);
+	}
+
+	void testPeerClosed(void)
+	{
+		QString host = this->m_server->serverAddress().toString();
+		quint16 port = this->m_server->serverPort();
+
+		this->m_pool->setMinIdle(1);
+		this->m_pool->setMaxIdle(1);
+		this->m_pool->warmUp(host, port);
+		QVERIFY(this->waitForIdle(1));
+
+		QVERIFY(this->m_server->hasPendingConnections() || this->m_server->waitForNewConnection(1000));
+		QTcpSocket* peer = this->m_server->nextPendingConnection();
+		QVERIFY(peer != 0);
+		peer->abort();
+		QTest::qWait(100);
+
+		QCOMPARE(this->m_pool->acquireDescriptor(host, port), qintptr(-1));
+		QCOMPARE(this->m_pool->misses(), quint64(1));
+	}
+
+	void testClear(void)
+	{
+		QString host = this->m_server->serverAddress().toString();
+		quint16 port = this->m_server->serverPort();
+
+		this->m_pool->setMinIdle(1);
+		this->m_pool->setMaxIdle(1);
+		this->m_pool->warmUp(host, port);
+		QVERIFY(this->waitForIdle(1));
+
+		this->m_pool->clear();
+		QCOMPARE(this->m_pool->idleCount(host, port), 0);
+	}
+};
+
+int main(int argc, char** argv)
+{
+	QCoreApplication a(argc, argv);
+	SocketConnectorPoolTest t;
+	return QTest::qExec(&t, argc, argv);
+}
+
+#include "tst_socketconnectorpool.moc"
@@ -0,0 +1,284 @@
+#include <QtCore/QCoreApplication>
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QThread>
+#include <QtNetwork/QLocalSocket>
+#include <QtNetwork/QTcpServer>
+#include <QtNetwork/QTcpSocket>
+#include <QtTest/QTest>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "socketconnector.h"
+#include "socketdispatcher.h"
+
+class Receiver : public QObject {
+	Q_OBJECT
+public:
+	explicit Receiver(bool keep)
+		: QObject(0), m_mutex(), m_keep(keep), m_count(0), m_wrong(0)
+	{
+	}
+
+	int count(void)
+	{
+		QMutexLocker locker(&this->m_mutex);
+		return this->m_count;
+	}
+
+	int wrong(void)
+	{
+		QMutexLocker locker(&this->m_mutex);
+		return this->m_wrong;
+	}
+
+public Q_SLOTS:
+	void handleSocket(QTcpSocket* sock)
+	{
+		QMutexLocker locker(&this->m_mutex);
+		++this->m_count;
+		if (sock->thread() != QThread::currentThread() || this->thread() != QThread::currentThread() || sock->state() != QAbstractSocket::ConnectedState) {
+			++this->m_wrong;
+		}
+
+		if (this->m_keep) {
+			sock->setParent(this);
+		}
+		else {
+			delete sock;
+		}
+	}
+
+private:
+	QMutex m_mutex;
+	bool m_keep;
+	int m_count;
+	int m_wrong;
+};
+
+class LocalFactory : public QObject, public SocketFactory {
+	Q_OBJECT
+public:
+	explicit LocalFactory(bool refuse)
+		: QObject(0), m_mutex(), m_refuse(refuse), m_count(0), m_wrong(0)
+	{
+	}
+
+	virtual QObject* createSocket(qintptr fd)
+	{
+		QMutexLocker locker(&this->m_mutex);
+		++this->m_count;
+		if (this->thread() != QThread::currentThread()) {
+			++this->m_wrong;
+		}
+
+		if (this->m_refuse) {
+			return 0;
+		}
+
+		QLocalSocket* sock = new QLocalSocket(this);
+		if (!sock->setSocketDescriptor(fd)) {
+			++this->m_wrong;
+		}
+
+		return sock;
+	}
+
+	int count(void)
+	{
+		QMutexLocker locker(&this->m_mutex);
+		return this->m_count;
+	}
+
+	int wrong(void)
+	{
+		QMutexLocker locker(&this->m_mutex);
+		return this->m_wrong;
+	}
+
+public Q_SLOTS:
+	void clear(void)
+	{
+		qDeleteAll(this->children());
+	}
+
+private:
+	QMutex m_mutex;
+	bool m_refuse;
+	int m_count;
+	int m_wrong;
+};
+
+class SocketDispatcherTest : public QObject {
+	Q_OBJECT
+public:
+	explicit SocketDispatcherTest(QObject* parent = 0)
+		: QObject(parent), m_server(0)
+	{
+		this->m_threads[0] = 0;
+		this->m_threads[1] = 0;
+	}
+
+private:
+	QTcpServer* m_server;
+	QThread* m_threads[2];
+
+	bool connectOne(SocketConnector& conn)
+	{
+		if (!conn.createTcpSocket()) {
+			return false;
+		}
+
+		conn.connectToHost(this->m_server->serverAddress(), this->m_server->serverPort());
+		return conn.waitForConnected(5000);
+	}
+
+	// The objects living in the worker threads can only be destroyed once the threads are gone
+	void stopThreads(void)
+	{
+		for (int i=0; i<2; ++i) {
+			if (this->m_threads[i]) {
+				this->m_threads[i]->quit();
+				this->m_threads[i]->wait();
+				delete this->m_threads[i];
+				this->m_threads[i] = 0;
+			}
+		}
+	}
+
+	static bool waitFor(Receiver& r, int count)
+	{
+		for (int i=0; i<500 && r.count() < count; ++i) {
+			QTest::qWait(10);
+		}
+
+		return r.count() == count;
+	}
+
+	static bool waitForLoad(const SocketDispatcher& d, int worker, int load)
+	{
+		for (int i=0; i<500 && d.load(worker) != load; ++i) {
+			QTest::qWait(10);
+		}
+
+		return d.load(worker) == load;
+	}
+
+private Q_SLOTS:
+	void init(void)
+	{
+		this->m_server = new QTcpServer(this);
+		QVERIFY(this->m_server->listen(QHostAddress::LocalHost));
+
+		for (int i=0; i<2; ++i) {
+			this->m_threads[i] = new QThread(this);
+			this->m_threads[i]->start();
+		}
+	}
+
+	void cleanup(void)
+	{
+		this->stopThreads();
+		delete this->m_server;
+		this->m_server = 0;
+	}
+
+	void testDispatch(void)
+	{
+		Receiver keep(true);
+		Receiver drop(false);
+		keep.moveToThread(this->m_threads[0]);
+		drop.moveToThread(this->m_threads[1]);
+
+		{
+			SocketDispatcher dispatcher;
+			SocketConnector conn;
+
+			QVERIFY(this->connectOne(conn));
+			QCOMPARE(dispatcher.dispatch(&conn), -1);
+			QCOMPARE(conn.state(), QAbstractSocket::ConnectedState);
+			conn.disconnectFromHost();
+
+			QCOMPARE(dispatcher.addWorker(&keep, SLOT(handleSocket(QTcpSocket*))), 0);
+			QCOMPARE(dispatcher.addWorker(&drop, SLOT(handleSocket(QTcpSocket*))), 1);
+			QCOMPARE(dispatcher.workerCount(), 2);
+			QCOMPARE(dispatcher.load(2), -1);
+
+			// Equal loads are served in turn; an undelivered connection counts as load
+			QVERIFY(this->connectOne(conn));
+			QCOMPARE(dispatcher.dispatch(&conn), 0);
+			QCOMPARE(conn.state(), QAbstractSocket::UnconnectedState);
+			QCOMPARE(conn.socketDescriptor(), qintptr(-1));
+
+			QVERIFY(this->connectOne(conn));
+			QCOMPARE(dispatcher.dispatch(&conn), 1);
+
+			QVERIFY(waitFor(keep, 1));
+			QVERIFY(waitFor(drop, 1));
+			QCOMPARE(keep.wrong(), 0);
+			QCOMPARE(drop.wrong(), 0);
+
+			// The second worker has deleted its socket: it is less loaded now
+			QVERIFY(waitForLoad(dispatcher, 1, 0));
+			QCOMPARE(dispatcher.load(0), 1);
+
+			QVERIFY(this->connectOne(conn));
+			QCOMPARE(dispatcher.dispatch(&conn), 1);
+			QVERIFY(waitFor(drop, 2));
+			QCOMPARE(dispatcher.dispatched(), quint64(3));
+		}
+
+		this->stopThreads();
+	}
+
+	void testFactory(void)
+	{
+		LocalFactory factory(false);
+		LocalFactory refuse(true);
+		factory.moveToThread(this->m_threads[0]);
+		refuse.moveToThread(this->m_threads[1]);
+
+		{
+			SocketDispatcher dispatcher;
+			QCOMPARE(dispatcher.addWorker(this->m_threads[0], &factory), 0);
+
+			int sv[2];
+			QVERIFY(!::socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+			QCOMPARE(dispatcher.dispatch(qintptr(sv[0])), 0);
+
+			for (int i=0; i<500 && !factory.count(); ++i) {
+				QTest::qWait(10);
+			}
+
+			QCOMPARE(factory.count(), 1);
+			QCOMPARE(factory.wrong(), 0);
+			QCOMPARE(dispatcher.load(0), 1);
+
+			QVERIFY(QMetaObject::invokeMethod(&factory, "clear", Qt::QueuedConnection));
+			QVERIFY(waitForLoad(dispatcher, 0, 0));
+			::close(sv[1]);
+
+			// A refused descriptor is closed by the dispatcher
+			SocketDispatcher other;
+			QCOMPARE(other.addWorker(this->m_threads[1], &refuse), 0);
+			QVERIFY(!::socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+			QCOMPARE(other.dispatch(qintptr(sv[0])), 0);
+			QVERIFY(waitForLoad(other, 0, 0));
+			QCOMPARE(refuse.count(), 1);
+
+			char c;
+			QCOMPARE(::recv(sv[1], &c, 1, MSG_DONTWAIT), ssize_t(0));
+			::close(sv[1]);
+		}
+
+		this->stopThreads();
+	}
+};
+
+int main(int argc, char** argv)
+{
+	QCoreApplication a(argc, argv);
+	SocketDispatcherTest t;
+	return QTest::qExec(&t, argc, argv);
+}
+
+#include "tst_socketdispatcher.moc"
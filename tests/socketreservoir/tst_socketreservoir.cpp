@@ -0,0 +1,111 @@
+#include <QtCore/QCoreApplication>
+#include <QtTest/QTest>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "socketreservoir.h"
+
+class SocketReservoirTest : public QObject {
+	Q_OBJECT
+private Q_SLOTS:
+	void testDefaults(void)
+	{
+		SocketReservoir reservoir;
+		QCOMPARE(reservoir.depth(), 16);
+		QCOMPARE(reservoir.hits(), quint64(0));
+		QCOMPARE(reservoir.misses(), quint64(0));
+		QCOMPARE(reservoir.missRate(), qreal(0));
+		QCOMPARE(reservoir.available(AF_INET, SOCK_STREAM), 0);
+	}
+
+	void testRefill(void)
+	{
+		SocketReservoir reservoir(4);
+
+		// The first take() creates the pool and misses
+		QCOMPARE(reservoir.take(AF_INET, SOCK_STREAM), -1);
+		QCOMPARE(reservoir.misses(), quint64(1));
+		QTRY_COMPARE(reservoir.available(AF_INET, SOCK_STREAM), 4);
+
+		int fd = reservoir.take(AF_INET, SOCK_STREAM);
+		QVERIFY(fd != -1);
+		QCOMPARE(reservoir.hits(), quint64(1));
+		QCOMPARE(reservoir.missRate(), qreal(0.5));
+
+		int type = 0;
+		socklen_t len = sizeof(type);
+		QCOMPARE(::getsockopt(fd, SOL_SOCKET, SO_TYPE, &type, &len), 0);
+		QCOMPARE(type, int(SOCK_STREAM));
+		QVERIFY(::fcntl(fd, F_GETFL) & O_NONBLOCK);
+		QVERIFY(::fcntl(fd, F_GETFD) & FD_CLOEXEC);
+		::close(fd);
+
+		QTRY_COMPARE(reservoir.available(AF_INET, SOCK_STREAM), 4);
+
+		// The pools are keyed by the type too
+		QCOMPARE(reservoir.available(AF_INET, SOCK_DGRAM), 0);
+
+		reservoir.setDepth(2);
+		QCOMPARE(reservoir.available(AF_INET, SOCK_STREAM), 2);
+
+		reservoir.clear();
+		QCOMPARE(reservoir.available(AF_INET, SOCK_STREAM), 0);
+	}
+
+	void testBound(void)
+	{
+		SocketReservoir reservoir(2);
+		QHostAddress local(QHostAddress::LocalHost);
+		reservoir.reserve(AF_INET, SOCK_STREAM, 0, local);
+		QTRY_COMPARE(reservoir.available(AF_INET, SOCK_STREAM, 0, local), 2);
+		QCOMPARE(reservoir.available(AF_INET, SOCK_STREAM), 0);
+
+		int fd = reservoir.take(AF_INET, SOCK_STREAM, 0, local);
+		QVERIFY(fd != -1);
+		QCOMPARE(reservoir.misses(), quint64(0));
+
+		struct sockaddr_in sa;
+		socklen_t len = sizeof(sa);
+		QCOMPARE(::getsockname(fd, reinterpret_cast<struct sockaddr*>(&sa), &len), 0);
+		QCOMPARE(QHostAddress(ntohl(sa.sin_addr.s_addr)), local);
+		::close(fd);
+	}
+
+	void testBindFailure(void)
+	{
+		// TEST-NET-1 is not a local address: the sockets cannot be bound to it
+		SocketReservoir reservoir(2);
+		QHostAddress remote(QLatin1String("192.0.2.1"));
+		reservoir.reserve(AF_INET, SOCK_STREAM, 0, remote);
+		QTRY_VERIFY(reservoir.failures() > 0);
+		QCOMPARE(reservoir.available(AF_INET, SOCK_STREAM, 0, remote), 0);
+		QCOMPARE(reservoir.take(AF_INET, SOCK_STREAM, 0, remote), -1);
+	}
+
+	void testFailingPoolDoesNotStarve(void)
+	{
+		// The failing pool stays the emptiest one, and yet the other pool is filled
+		SocketReservoir reservoir(2);
+		QHostAddress remote(QLatin1String("192.0.2.1"));
+		reservoir.reserve(AF_INET, SOCK_STREAM, 0, remote);
+		QTRY_VERIFY(reservoir.failures() > 0);
+
+		reservoir.reserve(AF_INET, SOCK_STREAM);
+		QTRY_COMPARE(reservoir.available(AF_INET, SOCK_STREAM), 2);
+		QCOMPARE(reservoir.available(AF_INET, SOCK_STREAM, 0, remote), 0);
+
+		// The failing pool is still retried
+		quint64 failures = reservoir.failures();
+		QTRY_VERIFY(reservoir.failures() > failures);
+	}
+};
+
+int main(int argc, char** argv)
+{
+	QCoreApplication a(argc, argv);
+	SocketReservoirTest t;
+	return QTest::qExec(&t, argc, argv);
+}
+
+#include "tst_socketreservoir.moc"
@@ -1,6 +1,10 @@
 TEMPLATE = subdirs
-SUBDIRS += socketconnector
+SUBDIRS += socketconnector socketconnectorpool socketdispatcher hostinfocache addressscoreboard circuitbreaker socketreservoir benchmarks
+
+linux* {
+	SUBDIRS += batchconnector connectallocations connectorengine datagramchannel socketacceptor
+}
 
 greaterThan(QT_MAJOR_VERSION, 4) {
-	SUBDIRS += qtbug27678
+	SUBDIRS += connectawaitable qtbug27678
 }